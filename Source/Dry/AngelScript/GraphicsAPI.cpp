@@ -28,6 +28,7 @@
 #include "../Graphics/Animation.h"
 #include "../Graphics/AnimationController.h"
 #include "../Graphics/AnimationState.h"
+#include "../Graphics/BakedAnimatedModel.h"
 #include "../Graphics/Camera.h"
 #include "../Graphics/CustomGeometry.h"
 #include "../Graphics/DebugRenderer.h"
@@ -45,6 +46,8 @@
 #include "../Graphics/ReflectionProbe.h"
 #include "../Graphics/RibbonTrail.h"
 #include "../Graphics/StaticModelGroup.h"
+#include "../Graphics/StreamingTerrain.h"
+#include "../Graphics/StreamingTerrainBlock.h"
 #include "../Graphics/Technique.h"
 #include "../Graphics/Terrain.h"
 #include "../Graphics/TerrainPatch.h"
@@ -385,6 +388,7 @@ static void RegisterRenderPath(asIScriptEngine* engine)
     engine->RegisterObjectProperty("RenderPathCommand", "bool useFogColor", offsetof(RenderPathCommand, useFogColor_));
     engine->RegisterObjectProperty("RenderPathCommand", "bool markToStencil", offsetof(RenderPathCommand, markToStencil_));
     engine->RegisterObjectProperty("RenderPathCommand", "bool vertexLights", offsetof(RenderPathCommand, vertexLights_));
+    engine->RegisterObjectProperty("RenderPathCommand", "bool clusteredLights", offsetof(RenderPathCommand, clusteredLights_));
     engine->RegisterObjectProperty("RenderPathCommand", "bool useLitBase", offsetof(RenderPathCommand, useLitBase_));
     engine->RegisterObjectProperty("RenderPathCommand", "String vertexShaderName", offsetof(RenderPathCommand, vertexShaderName_));
     engine->RegisterObjectProperty("RenderPathCommand", "String pixelShaderName", offsetof(RenderPathCommand, pixelShaderName_));
@@ -762,6 +766,7 @@ static void RegisterBuffers(asIScriptEngine* engine)
     engine->RegisterEnumValue("VertexElementType", "TYPE_VECTOR4", TYPE_VECTOR4);
     engine->RegisterEnumValue("VertexElementType", "TYPE_UBYTE4", TYPE_UBYTE4);
     engine->RegisterEnumValue("VertexElementType", "TYPE_UBYTE4_NORM", TYPE_UBYTE4_NORM);
+    engine->RegisterEnumValue("VertexElementType", "TYPE_HALF2", TYPE_HALF2);
     engine->RegisterEnumValue("VertexElementType", "MAX_VERTEX_ELEMENT_TYPES", MAX_VERTEX_ELEMENT_TYPES);
 
     engine->RegisterEnum("VertexElementSemantic");
@@ -882,6 +887,8 @@ static void RegisterMaterial(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Pass", "bool get_depthWrite() const", asMETHOD(Pass, GetDepthWrite), asCALL_THISCALL);
     engine->RegisterObjectMethod("Pass", "void set_alphaToCoverage(bool)", asMETHOD(Pass, SetAlphaToCoverage), asCALL_THISCALL);
     engine->RegisterObjectMethod("Pass", "bool get_alphaToCoverage() const", asMETHOD(Pass, GetAlphaToCoverage), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Pass", "void set_clusteredLights(bool)", asMETHOD(Pass, SetClusteredLights), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Pass", "bool get_clusteredLights() const", asMETHOD(Pass, GetClusteredLights), asCALL_THISCALL);
     engine->RegisterObjectMethod("Pass", "void set_desktop(bool)", asMETHOD(Technique, SetIsDesktop), asCALL_THISCALL);
     engine->RegisterObjectMethod("Pass", "bool get_desktop() const", asMETHOD(Technique, IsDesktop), asCALL_THISCALL);
     engine->RegisterObjectMethod("Pass", "void set_vertexShader(const String&in)", asMETHOD(Pass, SetVertexShader), asCALL_THISCALL);
@@ -1003,6 +1010,11 @@ static bool ModelSetIndexBuffers(CScriptArray* indexBuffers, Model* ptr)
     return ptr->SetIndexBuffers(ibPtrs);
 }
 
+static bool ModelOptimizeGeometries(Model* ptr)
+{
+    return ptr->OptimizeGeometries();
+}
+
 static void RegisterModel(asIScriptEngine* engine)
 {
     RegisterResourceWithMetadata<Model>(engine, "Model");
@@ -1010,6 +1022,10 @@ static void RegisterModel(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Model", "bool SetVertexBuffers(Array<VertexBuffer@>@+, Array<uint>@+, Array<uint>@+)", asFUNCTION(ModelSetVertexBuffers), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Model", "bool SetIndexBuffers(Array<IndexBuffer@>@+)", asFUNCTION(ModelSetIndexBuffers), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Model", "bool SetGeometry(uint, uint, Geometry@+)", asMETHOD(Model, SetGeometry), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Model", "bool GenerateLodLevels(uint, float reduction = 0.5, float distanceStep = 10.0)", asMETHOD(Model, GenerateLodLevels), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Model", "bool OptimizeGeometries()", asFUNCTION(ModelOptimizeGeometries), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Model", "bool QuantizeTexCoords()", asMETHOD(Model, QuantizeTexCoords), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Model", "bool BuildMeshlets(uint maxTriangles = 128)", asMETHOD(Model, BuildMeshlets), asCALL_THISCALL);
     engine->RegisterObjectMethod("Model", "Geometry@+ GetGeometry(uint, uint) const", asMETHOD(Model, GetGeometry), asCALL_THISCALL);
     engine->RegisterObjectMethod("Model", "void set_boundingBox(const BoundingBox&in)", asMETHOD(Model, SetBoundingBox), asCALL_THISCALL);
     engine->RegisterObjectMethod("Model", "const BoundingBox& get_boundingBox() const", asMETHOD(Model, GetBoundingBox), asCALL_THISCALL);
@@ -1111,6 +1127,7 @@ static void RegisterAnimation(asIScriptEngine* engine)
     engine->RegisterObjectMethod("AnimationTrack", "void InsertKeyFrame(uint, const AnimationKeyFrame&in)", asMETHOD(AnimationTrack, InsertKeyFrame), asCALL_THISCALL);
     engine->RegisterObjectMethod("AnimationTrack", "void RemoveKeyFrame(uint)", asMETHOD(AnimationTrack, RemoveKeyFrame), asCALL_THISCALL);
     engine->RegisterObjectMethod("AnimationTrack", "void RemoveAllKeyFrames()", asMETHOD(AnimationTrack, RemoveAllKeyFrames), asCALL_THISCALL);
+    engine->RegisterObjectMethod("AnimationTrack", "uint ReduceKeyFrames(float, float, float)", asMETHOD(AnimationTrack, ReduceKeyFrames), asCALL_THISCALL);
     engine->RegisterObjectMethod("AnimationTrack", "void set_keyFrames(uint, const AnimationKeyFrame&in)", asMETHOD(AnimationTrack, SetKeyFrame), asCALL_THISCALL);
     engine->RegisterObjectMethod("AnimationTrack", "const AnimationKeyFrame& get_keyFrames(uint) const", asMETHOD(AnimationTrack, GetKeyFrame), asCALL_THISCALL);
     engine->RegisterObjectMethod("AnimationTrack", "uint get_numKeyFrames() const", asMETHOD(AnimationTrack, GetNumKeyFrames), asCALL_THISCALL);
@@ -1138,6 +1155,9 @@ static void RegisterAnimation(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Animation", "const String& get_animationName() const", asMETHOD(Animation, GetAnimationName), asCALL_THISCALL);
     engine->RegisterObjectMethod("Animation", "void set_length(float)", asMETHOD(Animation, SetLength), asCALL_THISCALL);
     engine->RegisterObjectMethod("Animation", "float get_length() const", asMETHOD(Animation, GetLength), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Animation", "void set_compressed(bool)", asMETHOD(Animation, SetCompressed), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Animation", "bool get_compressed() const", asMETHOD(Animation, IsCompressed), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Animation", "uint ReduceKeyFrames(float positionTolerance = 0.0005, float rotationTolerance = 0.05, float scaleTolerance = 0.0005)", asMETHOD(Animation, ReduceKeyFrames), asCALL_THISCALL);
     engine->RegisterObjectMethod("Animation", "AnimationTrack@+ get_tracks(const String&in)", asMETHODPR(Animation, GetTrack, (const String&), AnimationTrack*), asCALL_THISCALL);
     engine->RegisterObjectMethod("Animation", "AnimationTrack@+ GetTrack(uint)", asMETHODPR(Animation, GetTrack, (unsigned), AnimationTrack*), asCALL_THISCALL);
     engine->RegisterObjectMethod("Animation", "uint get_numTracks() const", asMETHOD(Animation, GetNumTracks), asCALL_THISCALL);
@@ -1341,6 +1361,19 @@ static void RegisterStaticModelGroup(asIScriptEngine* engine)
     engine->RegisterObjectMethod("StaticModelGroup", "void RemoveAllInstanceNodes()", asMETHOD(StaticModelGroup, RemoveAllInstanceNodes), asCALL_THISCALL);
     engine->RegisterObjectMethod("StaticModelGroup", "uint get_numInstanceNodes() const", asMETHOD(StaticModelGroup, GetNumInstanceNodes), asCALL_THISCALL);
     engine->RegisterObjectMethod("StaticModelGroup", "Node@+ get_instanceNodes(uint) const", asMETHOD(StaticModelGroup, GetInstanceNode), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StaticModelGroup", "void set_hlodDistance(float)", asMETHOD(StaticModelGroup, SetHlodDistance), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StaticModelGroup", "float get_hlodDistance() const", asMETHOD(StaticModelGroup, GetHlodDistance), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StaticModelGroup", "void set_hlodReduction(float)", asMETHOD(StaticModelGroup, SetHlodReduction), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StaticModelGroup", "float get_hlodReduction() const", asMETHOD(StaticModelGroup, GetHlodReduction), asCALL_THISCALL);
+}
+
+static void RegisterBakedAnimatedModel(asIScriptEngine* engine)
+{
+    RegisterStaticModel<BakedAnimatedModel>(engine, "BakedAnimatedModel", true);
+    engine->RegisterObjectMethod("BakedAnimatedModel", "void set_timeOffset(float)", asMETHOD(BakedAnimatedModel, SetTimeOffset), asCALL_THISCALL);
+    engine->RegisterObjectMethod("BakedAnimatedModel", "float get_timeOffset() const", asMETHOD(BakedAnimatedModel, GetTimeOffset), asCALL_THISCALL);
+    engine->RegisterObjectMethod("BakedAnimatedModel", "void set_speed(float)", asMETHOD(BakedAnimatedModel, SetSpeed), asCALL_THISCALL);
+    engine->RegisterObjectMethod("BakedAnimatedModel", "float get_speed() const", asMETHOD(BakedAnimatedModel, GetSpeed), asCALL_THISCALL);
 }
 
 static void RegisterSkybox(asIScriptEngine* engine)
@@ -1425,6 +1458,8 @@ static void RegisterAnimatedModel(asIScriptEngine* engine)
     engine->RegisterObjectMethod("AnimatedModel", "float get_animationLodBias() const", asMETHOD(AnimatedModel, GetAnimationLodBias), asCALL_THISCALL);
     engine->RegisterObjectMethod("AnimatedModel", "void set_updateInvisible(bool)", asMETHOD(AnimatedModel, SetUpdateInvisible), asCALL_THISCALL);
     engine->RegisterObjectMethod("AnimatedModel", "bool get_updateInvisible() const", asMETHOD(AnimatedModel, GetUpdateInvisible), asCALL_THISCALL);
+    engine->RegisterObjectMethod("AnimatedModel", "void set_writeAllBones(bool)", asMETHOD(AnimatedModel, SetWriteAllBones), asCALL_THISCALL);
+    engine->RegisterObjectMethod("AnimatedModel", "bool get_writeAllBones() const", asMETHOD(AnimatedModel, GetWriteAllBones), asCALL_THISCALL);
     engine->RegisterObjectMethod("AnimatedModel", "Skeleton@+ get_skeleton()", asMETHOD(AnimatedModel, GetSkeleton), asCALL_THISCALL);
     engine->RegisterObjectMethod("AnimatedModel", "uint get_numAnimationStates() const", asMETHOD(AnimatedModel, GetNumAnimationStates), asCALL_THISCALL);
     engine->RegisterObjectMethod("AnimatedModel", "AnimationState@+ get_animationStates(const String&in) const", asMETHODPR(AnimatedModel, GetAnimationState, (const String&) const, AnimationState*), asCALL_THISCALL);
@@ -1813,7 +1848,8 @@ static void RegisterTerrain(asIScriptEngine* engine)
 {
     RegisterDrawable<TerrainPatch>(engine, "TerrainPatch");
     RegisterComponent<Terrain>(engine, "Terrain");
-    engine->RegisterObjectMethod("Terrain", "void ApplyHeightMap()", asMETHOD(Terrain, ApplyHeightMap), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Terrain", "void ApplyHeightMap()", asMETHODPR(Terrain, ApplyHeightMap, (), void), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Terrain", "void ApplyHeightMap(const IntRect&in)", asMETHODPR(Terrain, ApplyHeightMap, (const IntRect&), void), asCALL_THISCALL);
     engine->RegisterObjectMethod("Terrain", "float GetHeight(const Vector3&in) const", asMETHOD(Terrain, GetHeight), asCALL_THISCALL);
     engine->RegisterObjectMethod("Terrain", "Vector3 GetNormal(const Vector3&in) const", asMETHOD(Terrain, GetNormal), asCALL_THISCALL);
     engine->RegisterObjectMethod("Terrain", "TerrainPatch@+ GetPatch(int, int) const", asMETHODPR(Terrain, GetPatch, (int, int) const, TerrainPatch*), asCALL_THISCALL);
@@ -1870,6 +1906,54 @@ static void RegisterTerrain(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Terrain", "Terrain@+ get_eastNeighbor() const", asMETHOD(Terrain, GetWestNeighbor), asCALL_THISCALL);
 }
 
+static bool BuildTerrainTileFile(const String& rawFileName, const IntVector2& size, const String& tileFileName, int patchSize)
+{
+    return StreamingTerrain::BuildTileFile(GetScriptContext(), rawFileName, size, tileFileName, patchSize);
+}
+
+static void RegisterStreamingTerrain(asIScriptEngine* engine)
+{
+    RegisterDrawable<StreamingTerrainBlock>(engine, "StreamingTerrainBlock");
+    engine->RegisterObjectMethod("StreamingTerrainBlock", "const IntVector2& get_coordinates() const", asMETHOD(StreamingTerrainBlock, GetCoordinates), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrainBlock", "uint get_numSelectedNodes() const", asMETHOD(StreamingTerrainBlock, GetNumSelectedNodes), asCALL_THISCALL);
+    RegisterComponent<StreamingTerrain>(engine, "StreamingTerrain");
+    engine->RegisterGlobalFunction("bool BuildTerrainTileFile(const String&in, const IntVector2&in, const String&in, int patchSize = 32)", asFUNCTION(BuildTerrainTileFile), asCALL_CDECL);
+    engine->RegisterObjectMethod("StreamingTerrain", "float GetHeight(const Vector3&in) const", asMETHOD(StreamingTerrain, GetHeight), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "StreamingTerrainBlock@+ GetBlock(int, int) const", asMETHOD(StreamingTerrain, GetBlock), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "bool set_tileFile(const String&in)", asMETHOD(StreamingTerrain, SetTileFile), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "const String& get_tileFile() const", asMETHOD(StreamingTerrain, GetTileFile), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "void set_material(Material@+)", asMETHOD(StreamingTerrain, SetMaterial), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "Material@+ get_material() const", asMETHOD(StreamingTerrain, GetMaterial), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "void set_spacing(const Vector3&in)", asMETHOD(StreamingTerrain, SetSpacing), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "const Vector3& get_spacing() const", asMETHOD(StreamingTerrain, GetSpacing), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "void set_lodDistance(float)", asMETHOD(StreamingTerrain, SetLodDistance), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "float get_lodDistance() const", asMETHOD(StreamingTerrain, GetLodDistance), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "void set_maxTiles(uint)", asMETHOD(StreamingTerrain, SetMaxTiles), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "uint get_maxTiles() const", asMETHOD(StreamingTerrain, GetMaxTiles), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "int get_patchSize() const", asMETHOD(StreamingTerrain, GetPatchSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "uint get_numLevels() const", asMETHOD(StreamingTerrain, GetNumLevels), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "const IntVector2& get_numVertices() const", asMETHOD(StreamingTerrain, GetNumVertices), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "const IntVector2& get_numBlocks() const", asMETHOD(StreamingTerrain, GetNumBlocks), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "uint get_numTiles() const", asMETHOD(StreamingTerrain, GetNumTiles), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "uint get_numLoadingTiles() const", asMETHOD(StreamingTerrain, GetNumLoadingTiles), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "void set_castShadows(bool)", asMETHOD(StreamingTerrain, SetCastShadows), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "bool get_castShadows() const", asMETHOD(StreamingTerrain, GetCastShadows), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "void set_drawDistance(float)", asMETHOD(StreamingTerrain, SetDrawDistance), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "float get_drawDistance() const", asMETHOD(StreamingTerrain, GetDrawDistance), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "void set_shadowDistance(float)", asMETHOD(StreamingTerrain, SetShadowDistance), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "float get_shadowDistance() const", asMETHOD(StreamingTerrain, GetShadowDistance), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "void set_viewMask(uint)", asMETHOD(StreamingTerrain, SetViewMask), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "uint get_viewMask() const", asMETHOD(StreamingTerrain, GetViewMask), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "void set_lightMask(uint)", asMETHOD(StreamingTerrain, SetLightMask), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "uint get_lightMask() const", asMETHOD(StreamingTerrain, GetLightMask), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "void set_shadowMask(uint)", asMETHOD(StreamingTerrain, SetShadowMask), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "uint get_shadowMask() const", asMETHOD(StreamingTerrain, GetShadowMask), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "void set_zoneMask(uint)", asMETHOD(StreamingTerrain, SetZoneMask), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "uint get_zoneMask() const", asMETHOD(StreamingTerrain, GetZoneMask), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "void set_maxLights(uint)", asMETHOD(StreamingTerrain, SetMaxLights), asCALL_THISCALL);
+    engine->RegisterObjectMethod("StreamingTerrain", "uint get_maxLights() const", asMETHOD(StreamingTerrain, GetMaxLights), asCALL_THISCALL);
+}
+
 
 static CScriptArray* GraphicsGetResolutions(int monitor, Graphics* ptr)
 {
@@ -1934,6 +2018,12 @@ static void RegisterGraphics(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Graphics", "const String& get_orientations() const", asMETHOD(Graphics, GetOrientations), asCALL_THISCALL);
     engine->RegisterObjectMethod("Graphics", "void set_shaderCacheDir(const String&in)", asMETHOD(Graphics, SetShaderCacheDir), asCALL_THISCALL);
     engine->RegisterObjectMethod("Graphics", "const String& get_shaderCacheDir() const", asMETHOD(Graphics, GetShaderCacheDir), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Graphics", "void set_asyncShaders(bool)", asMETHOD(Graphics, SetAsyncShaders), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Graphics", "bool get_asyncShaders() const", asMETHOD(Graphics, GetAsyncShaders), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Graphics", "void set_uniformRingSize(uint)", asMETHOD(Graphics, SetUniformRingSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Graphics", "uint get_uniformRingSize() const", asMETHOD(Graphics, GetUniformRingSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Graphics", "uint get_numPendingShaderPrograms() const", asMETHOD(Graphics, GetNumPendingShaderPrograms), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Graphics", "uint get_numPipelineStates() const", asMETHOD(Graphics, GetNumPipelineStates), asCALL_THISCALL);
     engine->RegisterObjectMethod("Graphics", "int get_width() const", asMETHOD(Graphics, GetWidth), asCALL_THISCALL);
     engine->RegisterObjectMethod("Graphics", "int get_height() const", asMETHOD(Graphics, GetHeight), asCALL_THISCALL);
     engine->RegisterObjectMethod("Graphics", "int get_multiSample() const", asMETHOD(Graphics, GetMultiSample), asCALL_THISCALL);
@@ -1948,6 +2038,8 @@ static void RegisterGraphics(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Graphics", "uint get_numPrimitives() const", asMETHOD(Graphics, GetNumPrimitives), asCALL_THISCALL);
     engine->RegisterObjectMethod("Graphics", "uint get_numBatches() const", asMETHOD(Graphics, GetNumBatches), asCALL_THISCALL);
     engine->RegisterObjectMethod("Graphics", "bool get_instancingSupport() const", asMETHOD(Graphics, GetInstancingSupport), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Graphics", "bool get_parallelShaderCompileSupport() const", asMETHOD(Graphics, GetParallelShaderCompileSupport), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Graphics", "bool get_multiDrawIndirectSupport() const", asMETHOD(Graphics, GetMultiDrawIndirectSupport), asCALL_THISCALL);
     engine->RegisterObjectMethod("Graphics", "bool get_lightPrepassSupport() const", asMETHOD(Graphics, GetLightPrepassSupport), asCALL_THISCALL);
     engine->RegisterObjectMethod("Graphics", "bool get_deferredSupport() const", asMETHOD(Graphics, GetDeferredSupport), asCALL_THISCALL);
     engine->RegisterObjectMethod("Graphics", "bool get_hardwareShadowSupport() const", asMETHOD(Graphics, GetHardwareShadowSupport), asCALL_THISCALL);
@@ -2037,10 +2129,20 @@ static void RegisterRenderer(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Renderer", "int get_vsmMultiSample() const", asMETHOD(Renderer, GetVSMMultiSample), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "void set_maxShadowMaps(int)", asMETHOD(Renderer, SetMaxShadowMaps), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "int get_maxShadowMaps() const", asMETHOD(Renderer, GetMaxShadowMaps), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "void set_shadowAtlasSize(int)", asMETHOD(Renderer, SetShadowAtlasSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "int get_shadowAtlasSize() const", asMETHOD(Renderer, GetShadowAtlasSize), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "void set_reuseShadowMaps(bool)", asMETHOD(Renderer, SetReuseShadowMaps), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "bool get_reuseShadowMaps() const", asMETHOD(Renderer, GetReuseShadowMaps), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "void set_dynamicInstancing(bool)", asMETHOD(Renderer, SetDynamicInstancing), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "bool get_dynamicInstancing() const", asMETHOD(Renderer, GetDynamicInstancing), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "void set_multiDrawIndirect(bool)", asMETHOD(Renderer, SetMultiDrawIndirect), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "bool get_multiDrawIndirect() const", asMETHOD(Renderer, GetMultiDrawIndirect), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "void set_clusterCulling(bool)", asMETHOD(Renderer, SetClusterCulling), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "bool get_clusterCulling() const", asMETHOD(Renderer, GetClusterCulling), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "void set_skinInstancing(bool)", asMETHOD(Renderer, SetSkinInstancing), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "bool get_skinInstancing() const", asMETHOD(Renderer, GetSkinInstancing), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "void set_animationBoneBudget(uint)", asMETHOD(Renderer, SetAnimationBoneBudget), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "uint get_animationBoneBudget() const", asMETHOD(Renderer, GetAnimationBoneBudget), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "void set_minInstances(int)", asMETHOD(Renderer, SetMinInstances), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "int get_minInstances() const", asMETHOD(Renderer, GetMinInstances), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "void set_numExtraInstancingBufferElements(int)", asMETHOD(Renderer, SetNumExtraInstancingBufferElements), asCALL_THISCALL);
@@ -2062,8 +2164,10 @@ static void RegisterRenderer(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Renderer", "void set_mobileNormalOffsetMul(float)", asMETHOD(Renderer, SetMobileNormalOffsetMul), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "float get_mobileNormalOffsetMul() const", asMETHOD(Renderer, GetMobileNormalOffsetMul), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "uint get_numPrimitives() const", asMETHOD(Renderer, GetNumPrimitives), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "uint get_numAnimatedBones() const", asMETHOD(Renderer, GetNumAnimatedBones), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "uint get_numBatches() const", asMETHOD(Renderer, GetNumBatches), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "uint get_numViews() const", asMETHOD(Renderer, GetNumViews), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Renderer", "uint get_numPendingShaderPrograms() const", asMETHOD(Renderer, GetNumPendingShaderPrograms), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "uint get_numGeometries(bool) const", asMETHOD(Renderer, GetNumGeometries), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "uint get_numLights(bool) const", asMETHOD(Renderer, GetNumLights), asCALL_THISCALL);
     engine->RegisterObjectMethod("Renderer", "uint get_numShadowMaps(bool) const", asMETHOD(Renderer, GetNumShadowMaps), asCALL_THISCALL);
@@ -2265,6 +2369,7 @@ void RegisterGraphicsAPI(asIScriptEngine* engine)
     RegisterZone(engine);
     RegisterStaticModel(engine);
     RegisterStaticModelGroup(engine);
+    RegisterBakedAnimatedModel(engine);
     RegisterSkybox(engine);
     RegisterAnimatedModel(engine);
     RegisterAnimationController(engine);
@@ -2275,6 +2380,7 @@ void RegisterGraphicsAPI(asIScriptEngine* engine)
     RegisterCustomGeometry(engine);
     RegisterDecalSet(engine);
     RegisterTerrain(engine);
+    RegisterStreamingTerrain(engine);
     RegisterOctree(engine);
     RegisterGraphics(engine);
     RegisterRenderer(engine);
@@ -28,6 +28,7 @@
 #include "../Resource/Image.h"
 #include "../Resource/JSONFile.h"
 #include "../Resource/ResourceCache.h"
+#include "../Resource/DerivedDataCache.h"
 #include "../Resource/Localization.h"
 
 namespace Dry
@@ -140,6 +141,27 @@ static void RegisterLocalization(asIScriptEngine* engine)
     engine->RegisterGlobalFunction("Localization@+ get_localization()", asFUNCTION(GetLocalization), asCALL_CDECL);
 }
 
+static DerivedDataCache* GetDerivedDataCache()
+{
+    return GetScriptContext()->GetSubsystem<DerivedDataCache>();
+}
+
+static void RegisterDerivedDataCache(asIScriptEngine* engine)
+{
+    RegisterObject<DerivedDataCache>(engine, "DerivedDataCache");
+    engine->RegisterObjectMethod("DerivedDataCache", "bool SetCacheDir(const String&in)", asMETHOD(DerivedDataCache, SetCacheDir), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DerivedDataCache", "void Clear()", asMETHOD(DerivedDataCache, Clear), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DerivedDataCache", "String get_cacheDir() const", asMETHOD(DerivedDataCache, GetCacheDir), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DerivedDataCache", "bool get_enabled() const", asMETHOD(DerivedDataCache, IsEnabled), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DerivedDataCache", "void set_sizeBudget(uint64)", asMETHOD(DerivedDataCache, SetSizeBudget), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DerivedDataCache", "uint64 get_sizeBudget() const", asMETHOD(DerivedDataCache, GetSizeBudget), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DerivedDataCache", "uint64 get_totalSize() const", asMETHOD(DerivedDataCache, GetTotalSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DerivedDataCache", "uint get_numEntries() const", asMETHOD(DerivedDataCache, GetNumEntries), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DerivedDataCache", "uint get_numHits() const", asMETHOD(DerivedDataCache, GetNumHits), asCALL_THISCALL);
+    engine->RegisterObjectMethod("DerivedDataCache", "uint get_numMisses() const", asMETHOD(DerivedDataCache, GetNumMisses), asCALL_THISCALL);
+    engine->RegisterGlobalFunction("DerivedDataCache@+ get_derivedDataCache()", asFUNCTION(GetDerivedDataCache), asCALL_CDECL);
+}
+
 static void RegisterResourceCache(asIScriptEngine* engine)
 {
     RegisterObject<ResourceCache>(engine, "ResourceCache");
@@ -180,6 +202,10 @@ static void RegisterResourceCache(asIScriptEngine* engine)
     engine->RegisterObjectMethod("ResourceCache", "bool get_seachPackagesFirst() const", asMETHOD(ResourceCache, GetSearchPackagesFirst), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "void set_autoReloadResources(bool)", asMETHOD(ResourceCache, SetAutoReloadResources), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "bool get_autoReloadResources() const", asMETHOD(ResourceCache, GetAutoReloadResources), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "void set_streamingEnabled(bool)", asMETHOD(ResourceCache, SetStreamingEnabled), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "bool get_streamingEnabled() const", asMETHOD(ResourceCache, IsStreamingEnabled), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "void set_maxStreamingChanges(uint)", asMETHOD(ResourceCache, SetMaxStreamingChanges), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "uint get_maxStreamingChanges() const", asMETHOD(ResourceCache, GetMaxStreamingChanges), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "void set_returnFailedResources(bool)", asMETHOD(ResourceCache, SetReturnFailedResources), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "bool get_returnFailedResources() const", asMETHOD(ResourceCache, GetReturnFailedResources), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "void set_finishBackgroundResourcesMs(int)", asMETHOD(ResourceCache, SetFinishBackgroundResourcesMs), asCALL_THISCALL);
@@ -670,6 +696,7 @@ void RegisterResourceAPI(asIScriptEngine* engine)
 {
     RegisterResource(engine);
     RegisterResourceCache(engine);
+    RegisterDerivedDataCache(engine);
     RegisterImage(engine);
     RegisterJSONValue(engine);
     RegisterJSONFile(engine);
@@ -36,6 +36,7 @@
 #include "../Graphics/Graphics.h"
 #include "../Graphics/Renderer.h"
 #include "../Input/Input.h"
+#include "../IO/AsyncFileReader.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
 #include "../IO/PackageFile.h"
@@ -55,6 +56,7 @@
 #include "../Physics/PhysicsWorld.h"
 #include "../Physics/RaycastVehicle.h"
 #endif
+#include "../Resource/DerivedDataCache.h"
 #include "../Resource/ResourceCache.h"
 #include "../Resource/Localization.h"
 #include "../Scene/Scene.h"
@@ -126,10 +128,12 @@ Engine::Engine(Context* context) :
     context_->RegisterSubsystem(new Profiler(context_));
 #endif
     context_->RegisterSubsystem(new FileSystem(context_));
+    context_->RegisterSubsystem(new AsyncFileReader(context_));
 #ifdef DRY_LOGGING
     context_->RegisterSubsystem(new Log(context_));
 #endif
     context_->RegisterSubsystem(new ResourceCache(context_));
+    context_->RegisterSubsystem(new DerivedDataCache(context_));
     context_->RegisterSubsystem(new Localization(context_));
 #ifdef DRY_NETWORK
     context_->RegisterSubsystem(new Network(context_));
@@ -224,6 +228,13 @@ bool Engine::Initialize(const VariantMap& parameters)
     auto* cache = GetSubsystem<ResourceCache>();
     auto* fileSystem = GetSubsystem<FileSystem>();
 
+    // Enable the derived data cache only when a directory is given
+    auto* derivedDataCache = GetSubsystem<DerivedDataCache>();
+    if (HasParameter(parameters, EP_DERIVED_DATA_CACHE_SIZE))
+        derivedDataCache->SetSizeBudget(GetParameter(parameters, EP_DERIVED_DATA_CACHE_SIZE).GetUInt64());
+    if (HasParameter(parameters, EP_DERIVED_DATA_CACHE_DIR))
+        derivedDataCache->SetCacheDir(GetParameter(parameters, EP_DERIVED_DATA_CACHE_DIR).GetString());
+
     // Initialize graphics & audio output
     if (!headless_)
     {
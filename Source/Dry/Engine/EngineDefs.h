@@ -29,6 +29,8 @@ namespace Dry
 // Engine parameters
 static const String EP_AUTOLOAD_PATHS = "AutoloadPaths";
 static const String EP_BORDERLESS = "Borderless";
+static const String EP_DERIVED_DATA_CACHE_DIR = "DerivedDataCacheDir";
+static const String EP_DERIVED_DATA_CACHE_SIZE = "DerivedDataCacheSize";
 static const String EP_DUMP_SHADERS = "DumpShaders";
 static const String EP_EVENT_PROFILER = "EventProfiler";
 static const String EP_EXTERNAL_WINDOW = "ExternalWindow";
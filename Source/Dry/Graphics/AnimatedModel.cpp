@@ -25,6 +25,8 @@
 
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
+#include "../Core/Thread.h"
+#include "../Core/WorkQueue.h"
 #include "../Graphics/AnimatedModel.h"
 #include "../Graphics/Animation.h"
 #include "../Graphics/AnimationState.h"
@@ -37,12 +39,17 @@
 #include "../Graphics/IndexBuffer.h"
 #include "../Graphics/Material.h"
 #include "../Graphics/Octree.h"
+#include "../Graphics/Renderer.h"
 #include "../Graphics/VertexBuffer.h"
 #include "../IO/Log.h"
 #include "../Resource/ResourceCache.h"
 #include "../Resource/ResourceEvents.h"
 #include "../Scene/Scene.h"
 
+#ifdef DRY_SSE
+#include <xmmintrin.h>
+#endif
+
 #include "../DebugNew.h"
 
 namespace Dry
@@ -75,6 +82,7 @@ AnimatedModel::AnimatedModel(Context* context) :
     animationLodBias_(1.0f),
     animationLodTimer_(-1.0f),
     animationLodDistance_(0.0f),
+    animationScreenSize_(0.0f),
     updateInvisible_(false),
     animationDirty_(false),
     animationOrderDirty_(false),
@@ -84,7 +92,13 @@ AnimatedModel::AnimatedModel(Context* context) :
     isMaster_(true),
     loading_(false),
     assignBonesPending_(false),
-    forceAnimationUpdate_(false)
+    forceAnimationUpdate_(false),
+    writeAllBones_(true),
+    poseValid_(false),
+    bonesMoved_(false),
+    applyingPose_(false),
+    interpolatingPose_(false),
+    animationDeferred_(false)
 {
 }
 
@@ -112,6 +126,7 @@ void AnimatedModel::RegisterObject(Context* context)
     DRY_ACCESSOR_ATTRIBUTE("Can Be Occluded", IsOccludee, SetOccludee, bool, true, AM_DEFAULT);
     DRY_ATTRIBUTE("Cast Shadows", bool, castShadows_, false, AM_DEFAULT);
     DRY_ACCESSOR_ATTRIBUTE("Update When Invisible", GetUpdateInvisible, SetUpdateInvisible, bool, false, AM_DEFAULT);
+    DRY_ACCESSOR_ATTRIBUTE("Write All Bones", GetWriteAllBones, SetWriteAllBones, bool, true, AM_DEFAULT);
     DRY_ACCESSOR_ATTRIBUTE("Draw Distance", GetDrawDistance, SetDrawDistance, float, 0.0f, AM_DEFAULT);
     DRY_ACCESSOR_ATTRIBUTE("Shadow Distance", GetShadowDistance, SetShadowDistance, float, 0.0f, AM_DEFAULT);
     DRY_ACCESSOR_ATTRIBUTE("LOD Bias", GetLodBias, SetLodBias, float, 1.0f, AM_DEFAULT);
@@ -175,6 +190,8 @@ void AnimatedModel::ProcessRayQuery(const RayOctreeQuery& query, PODVector<RayQu
 
     const Vector<Bone>& bones = skeleton_.GetBones();
     Sphere boneSphere;
+    // Bone nodes may not have been written, in which case only the evaluated pose is up to date
+    const bool usePose = !writeAllBones_ && poseValid_ && boneTransforms_.Size() == bones.Size();
 
     for (unsigned i{ 0 }; i < bones.Size(); ++i)
     {
@@ -183,13 +200,13 @@ void AnimatedModel::ProcessRayQuery(const RayOctreeQuery& query, PODVector<RayQu
             continue;
 
         float distance;
+        const Matrix3x4 transform = usePose ? node_->GetWorldTransform() * boneTransforms_[i] : bone.node_->GetWorldTransform();
 
         // Use hitbox if available
         if (bone.collisionMask_ & BONECOLLISION_BOX)
         {
             // Do an initial crude test using the bone's AABB
             const BoundingBox& box = bone.boundingBox_;
-            const Matrix3x4& transform = bone.node_->GetWorldTransform();
             distance = query.ray_.HitDistance(box.Transformed(transform));
             if (distance >= query.maxDistance_)
                 continue;
@@ -205,7 +222,7 @@ void AnimatedModel::ProcessRayQuery(const RayOctreeQuery& query, PODVector<RayQu
         }
         else if (bone.collisionMask_ & BONECOLLISION_SPHERE)
         {
-            boneSphere.center_ = bone.node_->GetWorldPosition();
+            boneSphere.center_ = transform.Translation();
             boneSphere.radius_ = bone.radius_;
             distance = query.ray_.HitDistance(boneSphere);
             if (distance >= query.maxDistance_)
@@ -249,9 +266,10 @@ void AnimatedModel::Update(const FrameInfo& frame)
             return;
         float scale = GetWorldBoundingBox().Size().DotProduct(DOT_SCALE);
         animationLodDistance_ = frame.camera_->GetLodDistance(distance, scale, lodBias_);
+        animationScreenSize_ = frame.camera_->GetProjectedSize(distance, scale);
     }
 
-    if (animationDirty_ || animationOrderDirty_)
+    if (animationDirty_ || animationOrderDirty_ || interpolatingPose_)
         UpdateAnimation(frame);
     else if (boneBoundingBoxDirty_)
         UpdateBoneBoundingBox();
@@ -278,15 +296,20 @@ void AnimatedModel::UpdateBatches(const FrameInfo& frame)
     BoundingBox transformedBoundingBox = boundingBox_.Transformed(worldTransform);
     float scale = transformedBoundingBox.Size().DotProduct(DOT_SCALE);
     float newLodDistance = frame.camera_->GetLodDistance(distance_, scale, lodBias_);
+    float newScreenSize = frame.camera_->GetProjectedSize(distance_, scale);
 
-    // If model is rendered from several views, use the minimum LOD distance for animation LOD
+    // If model is rendered from several views, use the minimum LOD distance and maximum screen size for animation LOD
     if (frame.frameNumber_ != animationLodFrameNumber_)
     {
         animationLodDistance_ = newLodDistance;
+        animationScreenSize_ = newScreenSize;
         animationLodFrameNumber_ = frame.frameNumber_;
     }
     else
+    {
         animationLodDistance_ = Min(animationLodDistance_, newLodDistance);
+        animationScreenSize_ = Max(animationScreenSize_, newScreenSize);
+    }
 
     if (newLodDistance != lodDistance_)
     {
@@ -549,6 +572,17 @@ void AnimatedModel::SetUpdateInvisible(bool enable)
     MarkNetworkUpdate();
 }
 
+void AnimatedModel::SetWriteAllBones(bool enable)
+{
+    if (enable == writeAllBones_)
+        return;
+
+    writeAllBones_ = enable;
+    // Re-evaluate so that all bone nodes get written again
+    MarkAnimationDirty();
+    MarkNetworkUpdate();
+}
+
 
 void AnimatedModel::SetMorphWeight(unsigned index, float weight)
 {
@@ -700,6 +734,10 @@ void AnimatedModel::SetSkeleton(const Skeleton& skeleton, bool createBones)
         return;
     }
 
+    poseValid_ = false;
+    interpolatingPose_ = false;
+    boneOrder_.Clear();
+
     if (isMaster_)
     {
         // Check if bone structure has stayed compatible (reloading the model.) In that case retain the old bones and animations
@@ -908,23 +946,31 @@ void AnimatedModel::UpdateBoneBoundingBox()
 {
     if (skeleton_.GetNumBones())
     {
-        // The bone bounding box is in local space, so need the node's inverse transform
+        if (bonesMoved_)
+            CheckPose();
+
+        // The bone bounding box is in local space, so need the node's inverse transform unless the evaluated pose is valid
         boneBoundingBox_.Clear();
-        Matrix3x4 inverseNodeTransform = node_->GetWorldTransform().Inverse();
+        Matrix3x4 inverseNodeTransform;
+        if (!poseValid_)
+            inverseNodeTransform = node_->GetWorldTransform().Inverse();
 
         const Vector<Bone>& bones = skeleton_.GetBones();
-        for (Vector<Bone>::ConstIterator i = bones.Begin(); i != bones.End(); ++i)
+        for (unsigned i{ 0 }; i < bones.Size(); ++i)
         {
-            Node* boneNode = i->node_;
+            const Bone& bone = bones[i];
+            Node* boneNode = bone.node_;
             if (!boneNode)
                 continue;
 
+            const Matrix3x4 boneTransform = poseValid_ ? boneTransforms_[i] : inverseNodeTransform * boneNode->GetWorldTransform();
+
             // Use hitbox if available. If not, use only half of the sphere radius
             /// \todo The sphere radius should be multiplied with bone scale
-            if (i->collisionMask_ & BONECOLLISION_BOX)
-                boneBoundingBox_.Merge(i->boundingBox_.Transformed(inverseNodeTransform * boneNode->GetWorldTransform()));
-            else if (i->collisionMask_ & BONECOLLISION_SPHERE)
-                boneBoundingBox_.Merge(Sphere(inverseNodeTransform * boneNode->GetWorldPosition(), i->radius_ * 0.5f));
+            if (bone.collisionMask_ & BONECOLLISION_BOX)
+                boneBoundingBox_.Merge(bone.boundingBox_.Transformed(boneTransform));
+            else if (bone.collisionMask_ & BONECOLLISION_SPHERE)
+                boneBoundingBox_.Merge(Sphere(boneTransform.Translation(), bone.radius_ * 0.5f));
         }
     }
 
@@ -953,7 +999,12 @@ void AnimatedModel::OnMarkedDirty(Node* node)
         skinningDirty_ = true;
         // Bone bounding box doesn't need to be marked dirty when only the base scene node moves
         if (node != node_)
+        {
             boneBoundingBoxDirty_ = true;
+            // Check against the evaluated pose before using it, unless the pose itself is being written
+            if (!applyingPose_)
+                bonesMoved_ = true;
+        }
     }
 }
 
@@ -980,6 +1031,9 @@ void AnimatedModel::OnWorldBoundingBoxUpdate()
 void AnimatedModel::AssignBoneNodes()
 {
     assignBonesPending_ = false;
+    poseValid_ = false;
+    interpolatingPose_ = false;
+    boneOrder_.Clear();
 
     if (!node_)
         return;
@@ -1255,8 +1309,34 @@ void AnimatedModel::SetGeometryBoneMappings()
 
 void AnimatedModel::UpdateAnimation(const FrameInfo& frame)
 {
-    // If using animation LOD, accumulate time and see if it is time to update
-    if (animationLodBias_ > 0.0f && animationLodDistance_ > 0.0f)
+    auto* renderer = frame.camera_ ? GetSubsystem<Renderer>() : nullptr;
+    const AnimationLodLevel* lodLevel = nullptr;
+    float updateInterval = 0.0f;
+
+    // If using screen size based animation LOD levels, accumulate time and see if it is time to update. Interpolate the
+    // pose in between
+    if (renderer && !renderer->GetAnimationLodLevels().IsEmpty())
+    {
+        lodLevel = renderer->GetAnimationLodLevel(animationScreenSize_);
+        updateInterval = lodLevel ? lodLevel->updateInterval_ * animationLodBias_ : 0.0f;
+
+        if (updateInterval > 0.0f && animationLodTimer_ >= 0.0f)
+        {
+            animationLodTimer_ += frame.timeStep_;
+            if (animationLodTimer_ < updateInterval)
+            {
+                if (interpolatingPose_)
+                    InterpolatePose(animationLodTimer_ / updateInterval);
+                return;
+            }
+
+            animationLodTimer_ = fmodf(animationLodTimer_, updateInterval);
+        }
+        else
+            animationLodTimer_ = 0.0f;
+    }
+    // If using distance based animation LOD, accumulate time and see if it is time to update
+    else if (animationLodBias_ > 0.0f && animationLodDistance_ > 0.0f)
     {
         // Perform the first update always regardless of LOD timer
         if (animationLodTimer_ >= 0.0f)
@@ -1271,10 +1351,31 @@ void AnimatedModel::UpdateAnimation(const FrameInfo& frame)
             animationLodTimer_ = 0.0f;
     }
 
-    ApplyAnimation();
+    const unsigned maxBones = lodLevel ? lodLevel->maxBones_ : M_MAX_UNSIGNED;
+
+    // Stay within the per-frame bone budget, but do not defer the same model twice in a row. A deferred model updates
+    // on the next frame regardless of its LOD timer
+    if (renderer && isMaster_ && skeleton_.GetNumBones())
+    {
+        if (!renderer->ReserveAnimatedBones(Min(maxBones, skeleton_.GetNumBones()), animationDeferred_))
+        {
+            animationDeferred_ = true;
+            animationLodTimer_ = -1.0f;
+            return;
+        }
+
+        animationDeferred_ = false;
+    }
+
+    EvaluateAnimation(maxBones, lodLevel ? lodLevel->minWeight_ : 0.0f, updateInterval > 0.0f);
 }
 
 void AnimatedModel::ApplyAnimation()
+{
+    EvaluateAnimation(M_MAX_UNSIGNED, 0.0f, false);
+}
+
+void AnimatedModel::EvaluateAnimation(unsigned maxBones, float minWeight, bool interpolate)
 {
     // Make sure animations are in ascending priority order
     if (animationOrderDirty_)
@@ -1283,55 +1384,320 @@ void AnimatedModel::ApplyAnimation()
         animationOrderDirty_ = false;
     }
 
-    // Reset skeleton, apply all animations, calculate bones' bounding box. Make sure this is only done for the master model
+    // Evaluate the pose, calculate bones' bounding box. Make sure this is only done for the master model
     // (first AnimatedModel in a node)
     if (isMaster_)
     {
-        skeleton_.ResetSilent();
-        for (Vector<SharedPtr<AnimationState> >::Iterator i = animationStates_.Begin(); i != animationStates_.End(); ++i)
-            (*i)->Apply();
+        if (bonesMoved_)
+            CheckPose();
 
-        // Skeleton reset and animations apply the node transforms "silently" to avoid repeated marking dirty. Mark dirty now
-        node_->MarkDirty();
+        // When updating less often, go from the pose shown now to the new one over the update interval
+        if (interpolate && poseValid_ && bonePose_.Size() == skeleton_.GetNumBones())
+        {
+            startPose_ = bonePose_;
+            SamplePose(targetPose_, maxBones, minWeight);
+            interpolatingPose_ = true;
+            InterpolatePose(0.0f);
+        }
+        else
+        {
+            SamplePose(bonePose_, maxBones, minWeight);
+            interpolatingPose_ = false;
+            ApplyPose();
 
-        // Calculate new bone bounding box
-        UpdateBoneBoundingBox();
+            // Calculate new bone bounding box
+            UpdateBoneBoundingBox();
+        }
     }
 
     animationDirty_ = false;
 }
 
-void AnimatedModel::UpdateSkinning()
+void AnimatedModel::InterpolatePose(float t)
+{
+    if (bonesMoved_)
+        CheckPose();
+
+    if (!poseValid_ || startPose_.Size() != bonePose_.Size() || targetPose_.Size() != bonePose_.Size())
+    {
+        interpolatingPose_ = false;
+        return;
+    }
+
+    if (t >= 1.0f)
+    {
+        t = 1.0f;
+        interpolatingPose_ = false;
+    }
+
+    for (unsigned i{ 0 }; i < bonePose_.Size(); ++i)
+    {
+        const BonePose& start = startPose_[i];
+        const BonePose& target = targetPose_[i];
+        BonePose& pose = bonePose_[i];
+
+        pose.position_ = start.position_.Lerp(target.position_, t);
+        pose.rotation_ = start.rotation_.Nlerp(target.rotation_, t, true);
+        pose.scale_ = start.scale_.Lerp(target.scale_, t);
+    }
+
+    ApplyPose();
+    UpdateBoneBoundingBox();
+}
+
+void AnimatedModel::SamplePose(Vector<BonePose>& dest, unsigned maxBones, float minWeight)
 {
-    // Note: the model's world transform will be baked in the skin matrices
     const Vector<Bone>& bones = skeleton_.GetBones();
-    // Use model's world transform in case a bone is missing
-    const Matrix3x4& worldTransform = node_->GetWorldTransform();
+    const unsigned numBones = bones.Size();
+    if (!numBones)
+        return;
+
+    if (boneOrder_.Size() != numBones)
+        CalculateBoneOrder();
+
+    dest.Resize(numBones);
 
-    // Skinning with global matrices only
-    if (!geometrySkinMatrices_.Size())
+    // When limiting the number of bones, animate the ones nearest to the skeleton root
+    const unsigned char* boneMask = nullptr;
+    if (maxBones < numBones)
     {
-        for (unsigned i{ 0 }; i < bones.Size(); ++i)
+        boneLodMask_.Resize(numBones);
+        for (unsigned k{ 0 }; k < numBones; ++k)
+            boneLodMask_[boneOrder_[k]] = k < maxBones ? 1 : 0;
+
+        boneMask = &boneLodMask_[0];
+    }
+
+    // Start from the initial pose. Bones with animation disabled keep the transform of their node, which may be controlled
+    // for example by physics
+    for (unsigned i{ 0 }; i < numBones; ++i)
+    {
+        const Bone& bone = bones[i];
+        BonePose& pose = dest[i];
+
+        if (!bone.animated_ && bone.node_)
         {
-            const Bone& bone = bones[i];
-            if (bone.node_)
-                skinMatrices_[i] = bone.node_->GetWorldTransform() * bone.offsetMatrix_;
-            else
-                skinMatrices_[i] = worldTransform;
+            pose.position_ = bone.node_->GetPosition();
+            pose.rotation_ = bone.node_->GetRotation();
+            pose.scale_ = bone.node_->GetScale();
+        }
+        else
+        {
+            pose.position_ = bone.initialPosition_;
+            pose.rotation_ = bone.initialRotation_;
+            pose.scale_ = bone.initialScale_;
+        }
+    }
+
+    for (Vector<SharedPtr<AnimationState> >::Iterator i = animationStates_.Begin(); i != animationStates_.End(); ++i)
+    {
+        if ((*i)->GetWeight() >= minWeight)
+            (*i)->ApplyToPose(&dest[0], &bones[0], boneMask);
+    }
+}
+
+void AnimatedModel::ApplyPose()
+{
+    const Vector<Bone>& bones = skeleton_.GetBones();
+    const unsigned numBones = bones.Size();
+    if (!numBones || bonePose_.Size() != numBones)
+        return;
+
+    boneTransforms_.Resize(numBones);
+    boneWritten_.Resize(numBones);
+
+    // Calculate the bone transforms relative to the scene node, parents first. Bones whose node is not parented to the
+    // parent bone's node, for example after reparenting, follow the actual node hierarchy
+    Matrix3x4 inverseNodeTransform;
+    bool inverseNodeTransformValid = false;
+
+    for (unsigned k{ 0 }; k < numBones; ++k)
+    {
+        const unsigned i = boneOrder_[k];
+        const Bone& bone = bones[i];
+        const BonePose& pose = bonePose_[i];
+        const Matrix3x4 localTransform(pose.position_, pose.rotation_, pose.scale_);
+        const unsigned parentIndex = bone.parentIndex_;
+        Node* parentNode = bone.node_ ? bone.node_->GetParent() : nullptr;
+
+        if (parentIndex != i && parentIndex < numBones && (!bone.node_ || bones[parentIndex].node_ == parentNode))
+            boneTransforms_[i] = boneTransforms_[parentIndex] * localTransform;
+        else if (parentNode && parentNode != node_)
+        {
+            if (!inverseNodeTransformValid)
+            {
+                inverseNodeTransform = node_->GetWorldTransform().Inverse();
+                inverseNodeTransformValid = true;
+            }
+
+            boneTransforms_[i] = inverseNodeTransform * parentNode->GetWorldTransform() * localTransform;
+        }
+        else
+            boneTransforms_[i] = localTransform;
+    }
+
+    // Other animated models in the node skin from the bone nodes, so they all need to be written then
+    bool writeAll = writeAllBones_;
+    if (!writeAll)
+    {
+        const Vector<SharedPtr<Component> >& components = node_->GetComponents();
+        for (Vector<SharedPtr<Component> >::ConstIterator i = components.Begin(); i != components.End(); ++i)
+        {
+            if (*i != this && (*i)->GetType() == AnimatedModel::GetTypeStatic())
+            {
+                writeAll = true;
+                break;
+            }
         }
     }
-    // Skinning with per-geometry matrices
+
+    if (writeAll)
+    {
+        for (unsigned i{ 0 }; i < numBones; ++i)
+            boneWritten_[i] = bones[i].node_ ? 1 : 0;
+    }
     else
     {
-        for (unsigned i{ 0 }; i < bones.Size(); ++i)
+        // Write only the bones that are observed, having components or child nodes other than bones, and their parents.
+        // Go through the bones children first to propagate to the parents
+        for (unsigned i{ 0 }; i < numBones; ++i)
+            boneWritten_[i] = 0;
+
+        for (unsigned k{ numBones }; k-- > 0;)
         {
-            const Bone& bone = bones[i];
-            if (bone.node_)
-                skinMatrices_[i] = bone.node_->GetWorldTransform() * bone.offsetMatrix_;
-            else
-                skinMatrices_[i] = worldTransform;
+            const unsigned i = boneOrder_[k];
+            Node* boneNode = bones[i].node_;
+            if (!boneNode)
+                continue;
+
+            if (boneNode->GetNumComponents() || boneNode->GetNumChildren() > boneChildCounts_[i])
+                boneWritten_[i] = 1;
+
+            const unsigned parentIndex = bones[i].parentIndex_;
+            if (boneWritten_[i] && parentIndex != i && parentIndex < numBones && bones[parentIndex].node_)
+                boneWritten_[parentIndex] = 1;
+        }
+    }
+
+    for (unsigned i{ 0 }; i < numBones; ++i)
+    {
+        const Bone& bone = bones[i];
+        if (boneWritten_[i] && bone.animated_)
+        {
+            const BonePose& pose = bonePose_[i];
+            bone.node_->SetTransformSilent(pose.position_, pose.rotation_, pose.scale_);
+        }
+    }
+
+    // The pose is written "silently" to avoid repeated marking dirty. Mark dirty now. Bone nodes which have not been read
+    // since are still dirty, so marking does not go through them again
+    applyingPose_ = true;
+    node_->MarkDirty();
+    applyingPose_ = false;
 
-            // Copy the skin matrix to per-geometry matrices as needed
+    poseValid_ = true;
+    bonesMoved_ = false;
+    skinningDirty_ = true;
+}
+
+void AnimatedModel::CalculateBoneOrder()
+{
+    const Vector<Bone>& bones = skeleton_.GetBones();
+    const unsigned numBones = bones.Size();
+
+    boneOrder_.Clear();
+    boneChildCounts_.Resize(numBones);
+
+    // Depth of each ordered bone, starting from 1 for the root
+    PODVector<unsigned> ordered(numBones);
+    for (unsigned i{ 0 }; i < numBones; ++i)
+    {
+        ordered[i] = 0;
+        boneChildCounts_[i] = 0;
+    }
+
+    for (unsigned i{ 0 }; i < numBones; ++i)
+    {
+        const unsigned parentIndex = bones[i].parentIndex_;
+        if (parentIndex != i && parentIndex < numBones && bones[i].node_ && bones[parentIndex].node_ &&
+            bones[i].node_->GetParent() == bones[parentIndex].node_)
+            ++boneChildCounts_[parentIndex];
+    }
+
+    // Add the bones one depth level at a time, so that the order also goes from the root toward the leaf bones for
+    // animation LOD. Bones in a broken hierarchy go last
+    bool added = true;
+    for (unsigned depth{ 1 }; added && boneOrder_.Size() < numBones; ++depth)
+    {
+        added = false;
+
+        for (unsigned i{ 0 }; i < numBones; ++i)
+        {
+            const unsigned parentIndex = bones[i].parentIndex_;
+            if (!ordered[i] && (parentIndex == i || parentIndex >= numBones || (ordered[parentIndex] && ordered[parentIndex] < depth)))
+            {
+                boneOrder_.Push(i);
+                ordered[i] = depth;
+                added = true;
+            }
+        }
+    }
+
+    for (unsigned i{ 0 }; i < numBones; ++i)
+    {
+        if (!ordered[i])
+            boneOrder_.Push(i);
+    }
+}
+
+void AnimatedModel::CheckPose()
+{
+    bonesMoved_ = false;
+
+    if (!poseValid_)
+        return;
+
+    const Vector<Bone>& bones = skeleton_.GetBones();
+    for (unsigned i{ 0 }; i < boneWritten_.Size() && i < bones.Size(); ++i)
+    {
+        Node* boneNode = bones[i].node_;
+        if (!boneWritten_[i] || !boneNode)
+            continue;
+
+        const BonePose& pose = bonePose_[i];
+        if (boneNode->GetPosition() != pose.position_ || boneNode->GetRotation() != pose.rotation_ ||
+            boneNode->GetScale() != pose.scale_)
+        {
+            poseValid_ = false;
+            return;
+        }
+    }
+}
+
+void AnimatedModel::UpdateSkinning()
+{
+    if (bonesMoved_)
+        CheckPose();
+
+    // Note: the model's world transform will be baked in the skin matrices
+    const Vector<Bone>& bones = skeleton_.GetBones();
+    // Use model's world transform in case a bone is missing
+    const Matrix3x4& worldTransform = node_->GetWorldTransform();
+
+    for (unsigned i{ 0 }; i < bones.Size(); ++i)
+    {
+        const Bone& bone = bones[i];
+        if (!bone.node_)
+            skinMatrices_[i] = worldTransform;
+        // Skin from the evaluated pose when valid, as the bone nodes are not necessarily written
+        else if (poseValid_)
+            skinMatrices_[i] = worldTransform * boneTransforms_[i] * bone.offsetMatrix_;
+        else
+            skinMatrices_[i] = bone.node_->GetWorldTransform() * bone.offsetMatrix_;
+
+        // Copy the skin matrix to per-geometry matrices as needed
+        if (!geometrySkinMatrices_.IsEmpty())
+        {
             for (unsigned j{ 0 }; j < geometrySkinMatrixPtrs_[i].Size(); ++j)
                 *geometrySkinMatrixPtrs_[i][j] = skinMatrices_[i];
         }
@@ -1340,6 +1706,112 @@ void AnimatedModel::UpdateSkinning()
     skinningDirty_ = false;
 }
 
+/// Vertex range of a morph vertex buffer to update on a worker thread.
+struct MorphUpdateTask
+{
+    /// Morph vertex buffer index.
+    unsigned bufferIndex_;
+    /// Locked morph range of the vertex buffer.
+    void* destVertexData_;
+    /// First vertex to update, relative to the morph range.
+    unsigned start_;
+    /// End of the vertices to update, relative to the morph range.
+    unsigned end_;
+};
+
+/// Minimum number of vertices per morph update task.
+static const unsigned MIN_MORPH_TASK_VERTICES = 2048;
+
+/// Number of summed morph delta planes: x, y and z of position, normal and tangent.
+static const unsigned NUM_MORPH_DELTA_PLANES = 9;
+
+/// Morphed vertex elements in delta plane order.
+static const VertexMask MORPH_ELEMENTS[] = { MASK_POSITION, MASK_NORMAL, MASK_TANGENT };
+
+/// Add weighted morph deltas to sums.
+static void AccumulateMorphDeltas(float* dest, const float* src, float weight, unsigned count)
+{
+    unsigned i{ 0 };
+
+#ifdef DRY_SSE
+    const __m128 weights = _mm_set1_ps(weight);
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(dest + i), _mm_mul_ps(_mm_loadu_ps(src + i), weights)));
+#endif
+
+    for (; i < count; ++i)
+        dest[i] += src[i] * weight;
+}
+
+/// Add the weighted dense deltas of a morph within a vertex range to the delta sums.
+static void AccumulateDenseMorph(float* sums, unsigned morphRangeStart, unsigned morphRangeCount, const VertexBufferMorph& morph,
+    float weight, unsigned start, unsigned end)
+{
+    // Deltas starting before the morph range are invalid and wrap around to be skipped
+    const unsigned first = morph.deltaStart_ - morphRangeStart;
+    const unsigned rangeStart = Max(first, start);
+    const unsigned rangeEnd = Min(first + morph.deltaCount_, end);
+    if (first >= morphRangeCount || rangeStart >= rangeEnd)
+        return;
+
+    const float* deltas = morph.deltas_.Get() + (rangeStart - first);
+
+    for (unsigned i{ 0 }; i < 3; ++i)
+    {
+        if (!(morph.elementMask_ & MORPH_ELEMENTS[i]))
+            continue;
+
+        for (unsigned j{ 0 }; j < 3; ++j)
+        {
+            AccumulateMorphDeltas(sums + (i * 3 + j) * morphRangeCount + rangeStart, deltas, weight, rangeEnd - rangeStart);
+            deltas += morph.deltaCount_;
+        }
+    }
+}
+
+/// Add the weighted packed deltas of a morph within a vertex range to the delta sums.
+static void AccumulatePackedMorph(float* sums, unsigned morphRangeStart, unsigned morphRangeCount, const VertexBufferMorph& morph,
+    float weight, unsigned start, unsigned end)
+{
+    const unsigned char* srcData = morph.morphData_;
+
+    for (unsigned i{ 0 }; i < morph.vertexCount_; ++i)
+    {
+        const unsigned vertexIndex = *((const unsigned*)srcData) - morphRangeStart;
+        srcData += sizeof(unsigned);
+
+        for (unsigned j{ 0 }; j < 3; ++j)
+        {
+            if (!(morph.elementMask_ & MORPH_ELEMENTS[j]))
+                continue;
+
+            if (vertexIndex >= start && vertexIndex < end)
+            {
+                const auto* src = (const float*)srcData;
+                sums[(j * 3) * morphRangeCount + vertexIndex] += src[0] * weight;
+                sums[(j * 3 + 1) * morphRangeCount + vertexIndex] += src[1] * weight;
+                sums[(j * 3 + 2) * morphRangeCount + vertexIndex] += src[2] * weight;
+            }
+
+            srcData += 3 * sizeof(float);
+        }
+    }
+}
+
+/// Morph update work function.
+static void ApplyMorphsWork(const WorkItem* item, unsigned threadIndex)
+{
+    auto* model = reinterpret_cast<AnimatedModel*>(item->aux_);
+    auto* start = reinterpret_cast<MorphUpdateTask*>(item->start_);
+    auto* end = reinterpret_cast<MorphUpdateTask*>(item->end_);
+
+    while (start != end)
+    {
+        model->ApplyMorphs(start->bufferIndex_, start->destVertexData_, start->start_, start->end_);
+        ++start;
+    }
+}
+
 void AnimatedModel::UpdateMorphs()
 {
     auto* graphics = GetSubsystem<Graphics>();
@@ -1348,32 +1820,49 @@ void AnimatedModel::UpdateMorphs()
 
     if (morphs_.Size())
     {
-        // Reset the morph data range from all morphable vertex buffers, then apply morphs
+        DRY_PROFILE(UpdateMorphs);
+
+        // Large morph ranges are split across the work queue by vertex range
+        auto* queue = GetSubsystem<WorkQueue>();
+        const unsigned numThreads = queue && Thread::IsMainThread() ? queue->GetNumThreads() + 1 : 1;
+
         for (unsigned i{ 0 }; i < morphVertexBuffers_.Size(); ++i)
         {
             VertexBuffer* buffer = morphVertexBuffers_[i];
             if (buffer)
             {
-                VertexBuffer* originalBuffer = model_->GetVertexBuffers()[i];
                 unsigned morphStart = model_->GetMorphRangeStart(i);
                 unsigned morphCount = model_->GetMorphRangeCount(i);
 
                 void* dest = buffer->Lock(morphStart, morphCount);
                 if (dest)
                 {
-                    // Reset morph range by copying data from the original vertex buffer
-                    CopyMorphVertices(dest, originalBuffer->GetShadowData() + morphStart * originalBuffer->GetVertexSize(),
-                        morphCount, buffer, originalBuffer);
+                    morphDeltaSums_.Resize(morphCount * NUM_MORPH_DELTA_PLANES);
 
-                    for (unsigned j{ 0 }; j < morphs_.Size(); ++j)
+                    const unsigned numTasks = Clamp(morphCount / MIN_MORPH_TASK_VERTICES, 1u, numThreads);
+                    if (numTasks > 1)
                     {
-                        if (morphs_[j].weight_ != 0.0f)
+                        PODVector<MorphUpdateTask> tasks(numTasks);
+                        for (unsigned j{ 0 }; j < numTasks; ++j)
                         {
-                            HashMap<unsigned, VertexBufferMorph>::Iterator k = morphs_[j].buffers_.Find(i);
-                            if (k != morphs_[j].buffers_.End())
-                                ApplyMorph(buffer, dest, morphStart, k->second_, morphs_[j].weight_);
+                            tasks[j].bufferIndex_ = i;
+                            tasks[j].destVertexData_ = dest;
+                            tasks[j].start_ = morphCount * j / numTasks;
+                            tasks[j].end_ = morphCount * (j + 1) / numTasks;
+
+                            SharedPtr<WorkItem> item = queue->GetFreeItem();
+                            item->priority_ = M_MAX_UNSIGNED;
+                            item->workFunction_ = ApplyMorphsWork;
+                            item->aux_ = this;
+                            item->start_ = &tasks[j];
+                            item->end_ = &tasks[j] + 1;
+                            queue->AddWorkItem(item);
                         }
+
+                        queue->Complete(M_MAX_UNSIGNED);
                     }
+                    else
+                        ApplyMorphs(i, dest, 0, morphCount);
 
                     buffer->Unlock();
                 }
@@ -1384,49 +1873,68 @@ void AnimatedModel::UpdateMorphs()
     morphsDirty_ = false;
 }
 
-void AnimatedModel::ApplyMorph(VertexBuffer* buffer, void* destVertexData, unsigned morphRangeStart, const VertexBufferMorph& morph,
-    float weight)
+void AnimatedModel::ApplyMorphs(unsigned bufferIndex, void* destVertexData, unsigned start, unsigned end)
 {
-    const VertexMaskFlags elementMask = morph.elementMask_ & buffer->GetElementMask();
-    unsigned vertexCount = morph.vertexCount_;
-    unsigned normalOffset = buffer->GetElementOffset(SEM_NORMAL);
-    unsigned tangentOffset = buffer->GetElementOffset(SEM_TANGENT);
-    unsigned vertexSize = buffer->GetVertexSize();
-
-    unsigned char* srcData = morph.morphData_;
+    VertexBuffer* buffer = morphVertexBuffers_[bufferIndex];
+    VertexBuffer* originalBuffer = model_->GetVertexBuffers()[bufferIndex];
+    const unsigned morphStart = model_->GetMorphRangeStart(bufferIndex);
+    const unsigned morphCount = model_->GetMorphRangeCount(bufferIndex);
+    const unsigned vertexSize = buffer->GetVertexSize();
     auto* destData = (unsigned char*)destVertexData;
 
-    while (vertexCount--)
+    // Reset the vertex range by copying data from the original vertex buffer
+    CopyMorphVertices(destData + start * vertexSize, originalBuffer->GetShadowData() + (morphStart + start) * originalBuffer->GetVertexSize(),
+        end - start, buffer, originalBuffer);
+
+    // Sum the weighted deltas of all morphs first, so that each vertex is written once
+    float* sums = &morphDeltaSums_[0];
+    for (unsigned i{ 0 }; i < NUM_MORPH_DELTA_PLANES; ++i)
+        memset(sums + i * morphCount + start, 0, (end - start) * sizeof(float));
+
+    VertexMaskFlags elementMask = MASK_NONE;
+    for (unsigned i{ 0 }; i < morphs_.Size(); ++i)
     {
-        unsigned vertexIndex = *((unsigned*)srcData) - morphRangeStart;
-        srcData += sizeof(unsigned);
+        if (morphs_[i].weight_ == 0.0f)
+            continue;
 
-        if (elementMask & MASK_POSITION)
-        {
-            auto* dest = (float*)(destData + vertexIndex * vertexSize);
-            auto* src = (float*)srcData;
-            dest[0] += src[0] * weight;
-            dest[1] += src[1] * weight;
-            dest[2] += src[2] * weight;
-            srcData += 3 * sizeof(float);
-        }
-        if (elementMask & MASK_NORMAL)
-        {
-            auto* dest = (float*)(destData + vertexIndex * vertexSize + normalOffset);
-            auto* src = (float*)srcData;
-            dest[0] += src[0] * weight;
-            dest[1] += src[1] * weight;
-            dest[2] += src[2] * weight;
-            srcData += 3 * sizeof(float);
-        }
-        if (elementMask & MASK_TANGENT)
+        HashMap<unsigned, VertexBufferMorph>::ConstIterator j = morphs_[i].buffers_.Find(bufferIndex);
+        if (j == morphs_[i].buffers_.End())
+            continue;
+
+        const VertexBufferMorph& morph = j->second_;
+        elementMask |= morph.elementMask_;
+
+        if (morph.deltas_)
+            AccumulateDenseMorph(sums, morphStart, morphCount, morph, morphs_[i].weight_, start, end);
+        else
+            AccumulatePackedMorph(sums, morphStart, morphCount, morph, morphs_[i].weight_, start, end);
+    }
+
+    elementMask &= buffer->GetElementMask();
+    if (!elementMask)
+        return;
+
+    const unsigned offsets[] = {
+        buffer->GetElementOffset(SEM_POSITION),
+        buffer->GetElementOffset(SEM_NORMAL),
+        buffer->GetElementOffset(SEM_TANGENT)
+    };
+
+    for (unsigned i{ 0 }; i < 3; ++i)
+    {
+        if (!(elementMask & MORPH_ELEMENTS[i]))
+            continue;
+
+        const float* x = sums + (i * 3) * morphCount;
+        const float* y = x + morphCount;
+        const float* z = y + morphCount;
+
+        for (unsigned j{ start }; j < end; ++j)
         {
-            auto* dest = (float*)(destData + vertexIndex * vertexSize + tangentOffset);
-            auto* src = (float*)srcData;
-            dest[0] += src[0] * weight;
-            dest[1] += src[1] * weight;
-            dest[2] += src[2] * weight;
-            srcData += 3 * sizeof(float);
+            auto* dest = (float*)(destData + j * vertexSize + offsets[i]);
+            dest[0] += x[j];
+            dest[1] += y[j];
+            dest[2] += z[j];
         }
     }
 }
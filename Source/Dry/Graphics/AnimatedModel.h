@@ -89,6 +89,8 @@ public:
     void SetAnimationLodBias(float bias);
     /// Set whether to update animation and the bounding box when not visible. Recommended to enable for physically controlled models like ragdolls.
     void SetUpdateInvisible(bool enable);
+    /// Set whether to write the animation pose to all bone scene nodes. When disabled, only bones with components or child nodes of their own, such as attachments, and their parent bones are written. Skinning uses the evaluated pose in both cases.
+    void SetWriteAllBones(bool enable);
     /// Set vertex morph weight by index.
     void SetMorphWeight(unsigned index, float weight);
     /// Set vertex morph weight by name.
@@ -99,6 +101,8 @@ public:
     void ResetMorphWeights();
     /// Apply all animation states to nodes.
     void ApplyAnimation();
+    /// Reset a vertex range of a morph vertex buffer and apply the vertex morphs to it. The range is relative to the buffer's morph range. Called from worker threads during the morph update.
+    void ApplyMorphs(unsigned bufferIndex, void* destVertexData, unsigned start, unsigned end);
 
     /// Return skeleton.
     Skeleton& GetSkeleton() { return skeleton_; }
@@ -124,6 +128,9 @@ public:
     /// Return whether to update animation when not visible.
     bool GetUpdateInvisible() const { return updateInvisible_; }
 
+    /// Return whether to write the animation pose to all bone scene nodes.
+    bool GetWriteAllBones() const { return writeAllBones_; }
+
     /// Return all vertex morphs.
     const Vector<ModelMorph>& GetMorphs() const { return morphs_; }
 
@@ -202,11 +209,20 @@ private:
     void UpdateAnimation(const FrameInfo& frame);
     /// Recalculate skinning.
     void UpdateSkinning();
+    /// Evaluate the animation states, animating at most a number of bones and leaving out states with less weight. Optionally interpolate to the new pose until the next update.
+    void EvaluateAnimation(unsigned maxBones, float minWeight, bool interpolate);
+    /// Sample and blend the animation states into a local pose.
+    void SamplePose(Vector<BonePose>& dest, unsigned maxBones, float minWeight);
+    /// Interpolate the pose between the last two updates and apply it.
+    void InterpolatePose(float t);
+    /// Calculate the bone transforms from the local pose and write the pose to the bone nodes. Master model only.
+    void ApplyPose();
+    /// Calculate the parent-first bone evaluation order.
+    void CalculateBoneOrder();
+    /// Invalidate the evaluated pose if bone nodes have been moved from outside the animation, for example by IK or physics.
+    void CheckPose();
     /// Reapply all vertex morphs.
     void UpdateMorphs();
-    /// Apply a vertex morph.
-    void ApplyMorph
-        (VertexBuffer* buffer, void* destVertexData, unsigned morphRangeStart, const VertexBufferMorph& morph, float weight);
     /// Handle model reload finished.
     void HandleModelReloadFinished(StringHash eventType, VariantMap& eventData);
 
@@ -220,6 +236,24 @@ private:
     Vector<SharedPtr<AnimationState> > animationStates_;
     /// Skinning matrices.
     PODVector<Matrix3x4> skinMatrices_;
+    /// Evaluated local pose of the bones.
+    Vector<BonePose> bonePose_;
+    /// Evaluated bone transforms relative to the scene node.
+    PODVector<Matrix3x4> boneTransforms_;
+    /// Bone indices in parent-first order.
+    PODVector<unsigned> boneOrder_;
+    /// Number of child bone nodes per bone.
+    PODVector<unsigned> boneChildCounts_;
+    /// Per-bone flags of the pose having been written to the bone node.
+    PODVector<unsigned char> boneWritten_;
+    /// Pose shown at the last update, when interpolating between updates.
+    Vector<BonePose> startPose_;
+    /// Pose sampled at the last update, when interpolating between updates.
+    Vector<BonePose> targetPose_;
+    /// Per-bone flags of being animated at the current animation LOD level.
+    PODVector<unsigned char> boneLodMask_;
+    /// Summed morph deltas of the morph range being updated, as planes of x, y and z components of positions, normals and tangents.
+    PODVector<float> morphDeltaSums_;
     /// Mapping of subgeometry bone indices, used if more bones than skinning shader can manage.
     Vector<PODVector<unsigned> > geometryBoneMappings_;
     /// Subgeometry skinning matrices, used if more bones than skinning shader can manage.
@@ -240,6 +274,8 @@ private:
     float animationLodTimer_;
     /// Animation LOD distance, the minimum of all LOD view distances last frame.
     float animationLodDistance_;
+    /// Projected height as a fraction of the view height, the maximum of all views last frame.
+    float animationScreenSize_;
     /// Update animation when invisible flag.
     bool updateInvisible_;
     /// Animation dirty flag.
@@ -260,6 +296,18 @@ private:
     bool assignBonesPending_;
     /// Force animation update after becoming visible flag.
     bool forceAnimationUpdate_;
+    /// Write animation pose to all bone nodes flag.
+    bool writeAllBones_;
+    /// Evaluated pose matches the bone nodes flag.
+    bool poseValid_;
+    /// Bone nodes dirtied outside pose evaluation flag.
+    bool bonesMoved_;
+    /// Pose being written to the bone nodes flag.
+    bool applyingPose_;
+    /// Interpolating the pose between updates flag.
+    bool interpolatingPose_;
+    /// Update deferred by the animation bone budget flag.
+    bool animationDeferred_;
 };
 
 }
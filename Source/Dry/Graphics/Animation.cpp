@@ -50,8 +50,247 @@ inline bool CompareKeyFrames(AnimationKeyFrame& lhs, AnimationKeyFrame& rhs)
     return lhs.time_ < rhs.time_;
 }
 
+static const float SQRT_HALF = 0.70710678f;
+
+static bool CanInterpolateKeyFrames(const Vector<AnimationKeyFrame>& keyFrames, unsigned first, unsigned last,
+    AnimationChannelFlags channelMask, float positionTolerance, float rotationTolerance, float scaleTolerance)
+{
+    const AnimationKeyFrame& start = keyFrames[first];
+    const AnimationKeyFrame& end = keyFrames[last];
+    const float timeInterval = end.time_ - start.time_;
+
+    for (unsigned i{ first + 1 }; i < last; ++i)
+    {
+        const AnimationKeyFrame& keyFrame = keyFrames[i];
+        const float t = timeInterval > 0.0f ? (keyFrame.time_ - start.time_) / timeInterval : 1.0f;
+
+        if ((channelMask & CHANNEL_POSITION) &&
+            (start.position_.Lerp(end.position_, t) - keyFrame.position_).Length() > positionTolerance)
+            return false;
+        if ((channelMask & CHANNEL_ROTATION) &&
+            2.0f * Acos(Abs(start.rotation_.Slerp(end.rotation_, t).DotProduct(keyFrame.rotation_))) > rotationTolerance)
+            return false;
+        if ((channelMask & CHANNEL_SCALE) &&
+            (start.scale_.Lerp(end.scale_, t) - keyFrame.scale_).Length() > scaleTolerance)
+            return false;
+    }
+
+    return true;
+}
+
+static unsigned short QuantizeUnit(float value, float min, float range)
+{
+    return range > 0.0f ? (unsigned short)(Clamp((value - min) / range, 0.0f, 1.0f) * 65535.0f + 0.5f) : 0;
+}
+
+static float DequantizeUnit(unsigned short value, float min, float range)
+{
+    return min + value * range / 65535.0f;
+}
+
+static void QuantizeVector3(unsigned short* dest, const Vector3& value, const Vector3& min, const Vector3& range)
+{
+    dest[0] = QuantizeUnit(value.x_, min.x_, range.x_);
+    dest[1] = QuantizeUnit(value.y_, min.y_, range.y_);
+    dest[2] = QuantizeUnit(value.z_, min.z_, range.z_);
+}
+
+static Vector3 DequantizeVector3(const unsigned short* value, const Vector3& min, const Vector3& range)
+{
+    return Vector3(DequantizeUnit(value[0], min.x_, range.x_), DequantizeUnit(value[1], min.y_, range.y_),
+        DequantizeUnit(value[2], min.z_, range.z_));
+}
+
+static void QuantizeRotation(unsigned short* dest, const Quaternion& rotation)
+{
+    // Smallest three: q and -q are the same rotation, so the largest component can be made positive and left out. The
+    // others are then within +-sqrt(1/2) and stored with 15 bits each, after the 2-bit index of the largest
+    const Quaternion normalized = rotation.Normalized();
+    const float components[4] = { normalized.w_, normalized.x_, normalized.y_, normalized.z_ };
+
+    unsigned largest{ 0 };
+    for (unsigned i{ 1 }; i < 4; ++i)
+    {
+        if (Abs(components[i]) > Abs(components[largest]))
+            largest = i;
+    }
+
+    const float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+    unsigned long long packed = largest;
+    for (unsigned i{ 0 }; i < 4; ++i)
+    {
+        if (i == largest)
+            continue;
+
+        const float unit = Clamp(components[i] * sign / SQRT_HALF * 0.5f + 0.5f, 0.0f, 1.0f);
+        packed = (packed << 15u) | (unsigned long long)(unit * 32767.0f + 0.5f);
+    }
+
+    dest[0] = (unsigned short)(packed >> 32u);
+    dest[1] = (unsigned short)(packed >> 16u);
+    dest[2] = (unsigned short)packed;
+}
+
+static Quaternion DequantizeRotation(const unsigned short* value)
+{
+    const unsigned long long packed = (unsigned long long)value[0] << 32u | (unsigned long long)value[1] << 16u | value[2];
+
+    const unsigned largest = (unsigned)(packed >> 45u) & 3u;
+    float components[4];
+    float sumSquares{ 0.0f };
+    unsigned shift{ 30 };
+
+    for (unsigned i{ 0 }; i < 4; ++i)
+    {
+        if (i == largest)
+            continue;
+
+        const float unit = ((packed >> shift) & 0x7fffu) / 32767.0f;
+        components[i] = (unit * 2.0f - 1.0f) * SQRT_HALF;
+        sumSquares += components[i] * components[i];
+        shift -= 15;
+    }
+
+    components[largest] = sqrtf(Max(1.0f - sumSquares, 0.0f));
+    return Quaternion(components[0], components[1], components[2], components[3]);
+}
+
+static void PackKeyFrames(const AnimationTrack& track, PODVector<AnimationPackedKeyFrame>& packedKeyFrames,
+    AnimationPackedRanges& ranges)
+{
+    const Vector<AnimationKeyFrame>& keyFrames = track.keyFrames_;
+    packedKeyFrames.Resize(keyFrames.Size());
+    if (keyFrames.IsEmpty())
+        return;
+
+    Vector3 maxPosition{ keyFrames.Front().position_ };
+    Vector3 maxScale{ keyFrames.Front().scale_ };
+    ranges.minTime_ = keyFrames.Front().time_;
+    ranges.timeRange_ = keyFrames.Back().time_ - ranges.minTime_;
+    ranges.minPosition_ = maxPosition;
+    ranges.minScale_ = maxScale;
+
+    for (unsigned i{ 1 }; i < keyFrames.Size(); ++i)
+    {
+        ranges.minPosition_ = VectorMin(ranges.minPosition_, keyFrames[i].position_);
+        maxPosition = VectorMax(maxPosition, keyFrames[i].position_);
+        ranges.minScale_ = VectorMin(ranges.minScale_, keyFrames[i].scale_);
+        maxScale = VectorMax(maxScale, keyFrames[i].scale_);
+    }
+
+    ranges.positionRange_ = maxPosition - ranges.minPosition_;
+    ranges.scaleRange_ = maxScale - ranges.minScale_;
+
+    for (unsigned i{ 0 }; i < keyFrames.Size(); ++i)
+    {
+        const AnimationKeyFrame& keyFrame = keyFrames[i];
+        AnimationPackedKeyFrame& packed = packedKeyFrames[i];
+        packed = AnimationPackedKeyFrame();
+        packed.time_ = QuantizeUnit(keyFrame.time_, ranges.minTime_, ranges.timeRange_);
+        if (track.channelMask_ & CHANNEL_POSITION)
+            QuantizeVector3(packed.position_, keyFrame.position_, ranges.minPosition_, ranges.positionRange_);
+        if (track.channelMask_ & CHANNEL_ROTATION)
+            QuantizeRotation(packed.rotation_, keyFrame.rotation_);
+        if (track.channelMask_ & CHANNEL_SCALE)
+            QuantizeVector3(packed.scale_, keyFrame.scale_, ranges.minScale_, ranges.scaleRange_);
+    }
+}
+
+static void UnpackKeyFrame(const AnimationPackedKeyFrame& packed, const AnimationPackedRanges& ranges,
+    AnimationChannelFlags channelMask, AnimationKeyFrame& keyFrame)
+{
+    keyFrame.time_ = DequantizeUnit(packed.time_, ranges.minTime_, ranges.timeRange_);
+    if (channelMask & CHANNEL_POSITION)
+        keyFrame.position_ = DequantizeVector3(packed.position_, ranges.minPosition_, ranges.positionRange_);
+    if (channelMask & CHANNEL_ROTATION)
+        keyFrame.rotation_ = DequantizeRotation(packed.rotation_);
+    if (channelMask & CHANNEL_SCALE)
+        keyFrame.scale_ = DequantizeVector3(packed.scale_, ranges.minScale_, ranges.scaleRange_);
+}
+
+static void WriteCompressedKeyFrames(Serializer& dest, const AnimationTrack& track)
+{
+    // Packed tracks are written back as they are, so that saving a loaded compressed animation does not lose precision
+    PODVector<AnimationPackedKeyFrame> packedKeyFrames;
+    AnimationPackedRanges ranges;
+    if (track.IsPacked())
+    {
+        packedKeyFrames = track.packedKeyFrames_;
+        ranges = track.packedRanges_;
+    }
+    else
+        PackKeyFrames(track, packedKeyFrames, ranges);
+
+    if (packedKeyFrames.IsEmpty())
+        return;
+
+    // Write the value ranges first, then the keyframes interleaved in time order
+    dest.WriteFloat(ranges.minTime_);
+    dest.WriteFloat(ranges.timeRange_);
+    if (track.channelMask_ & CHANNEL_POSITION)
+    {
+        dest.WriteVector3(ranges.minPosition_);
+        dest.WriteVector3(ranges.positionRange_);
+    }
+    if (track.channelMask_ & CHANNEL_SCALE)
+    {
+        dest.WriteVector3(ranges.minScale_);
+        dest.WriteVector3(ranges.scaleRange_);
+    }
+
+    for (unsigned i{ 0 }; i < packedKeyFrames.Size(); ++i)
+    {
+        const AnimationPackedKeyFrame& packed = packedKeyFrames[i];
+        dest.WriteUShort(packed.time_);
+        if (track.channelMask_ & CHANNEL_POSITION)
+            dest.Write(packed.position_, sizeof packed.position_);
+        if (track.channelMask_ & CHANNEL_ROTATION)
+            dest.Write(packed.rotation_, sizeof packed.rotation_);
+        if (track.channelMask_ & CHANNEL_SCALE)
+            dest.Write(packed.scale_, sizeof packed.scale_);
+    }
+}
+
+static void ReadCompressedKeyFrames(Deserializer& source, AnimationTrack& track, unsigned numKeyFrames)
+{
+    PODVector<AnimationPackedKeyFrame>& packedKeyFrames = track.packedKeyFrames_;
+    AnimationPackedRanges& ranges = track.packedRanges_;
+    packedKeyFrames.Resize(numKeyFrames);
+    if (!numKeyFrames)
+        return;
+
+    ranges = AnimationPackedRanges();
+    ranges.minTime_ = source.ReadFloat();
+    ranges.timeRange_ = source.ReadFloat();
+    if (track.channelMask_ & CHANNEL_POSITION)
+    {
+        ranges.minPosition_ = source.ReadVector3();
+        ranges.positionRange_ = source.ReadVector3();
+    }
+    if (track.channelMask_ & CHANNEL_SCALE)
+    {
+        ranges.minScale_ = source.ReadVector3();
+        ranges.scaleRange_ = source.ReadVector3();
+    }
+
+    for (unsigned i{ 0 }; i < numKeyFrames; ++i)
+    {
+        AnimationPackedKeyFrame& packed = packedKeyFrames[i];
+        packed = AnimationPackedKeyFrame();
+        packed.time_ = source.ReadUShort();
+        if (track.channelMask_ & CHANNEL_POSITION)
+            source.Read(packed.position_, sizeof packed.position_);
+        if (track.channelMask_ & CHANNEL_ROTATION)
+            source.Read(packed.rotation_, sizeof packed.rotation_);
+        if (track.channelMask_ & CHANNEL_SCALE)
+            source.Read(packed.scale_, sizeof packed.scale_);
+    }
+}
+
 void AnimationTrack::SetKeyFrame(unsigned index, const AnimationKeyFrame& keyFrame)
 {
+    Unpack();
+
     if (index < keyFrames_.Size())
     {
         keyFrames_[index] = keyFrame;
@@ -63,6 +302,8 @@ void AnimationTrack::SetKeyFrame(unsigned index, const AnimationKeyFrame& keyFra
 
 void AnimationTrack::AddKeyFrame(const AnimationKeyFrame& keyFrame)
 {
+    Unpack();
+
     bool needSort = keyFrames_.Size() ? keyFrames_.Back().time_ > keyFrame.time_ : false;
     keyFrames_.Push(keyFrame);
     if (needSort)
@@ -71,45 +312,199 @@ void AnimationTrack::AddKeyFrame(const AnimationKeyFrame& keyFrame)
 
 void AnimationTrack::InsertKeyFrame(unsigned index, const AnimationKeyFrame& keyFrame)
 {
+    Unpack();
     keyFrames_.Insert(index, keyFrame);
     Dry::Sort(keyFrames_.Begin(), keyFrames_.End(), CompareKeyFrames);
 }
 
 void AnimationTrack::RemoveKeyFrame(unsigned index)
 {
+    Unpack();
     keyFrames_.Erase(index);
 }
 
 void AnimationTrack::RemoveAllKeyFrames()
 {
     keyFrames_.Clear();
+    packedKeyFrames_.Clear();
+}
+
+unsigned AnimationTrack::ReduceKeyFrames(float positionTolerance, float rotationTolerance, float scaleTolerance)
+{
+    Unpack();
+
+    const unsigned numKeyFrames = keyFrames_.Size();
+    if (numKeyFrames < 2)
+        return 0;
+
+    Vector<AnimationKeyFrame> reduced;
+    reduced.Push(keyFrames_.Front());
+    unsigned lastKept{ 0 };
+
+    // Keep a keyframe when leaving it out would take interpolation from the last kept keyframe out of tolerance
+    for (unsigned i{ 1 }; i < numKeyFrames - 1; ++i)
+    {
+        if (!CanInterpolateKeyFrames(keyFrames_, lastKept, i + 1, channelMask_, positionTolerance, rotationTolerance, scaleTolerance))
+        {
+            reduced.Push(keyFrames_[i]);
+            lastKept = i;
+        }
+    }
+
+    // A track that stays constant needs only one keyframe
+    const AnimationKeyFrame& first = keyFrames_.Front();
+    const AnimationKeyFrame& last = keyFrames_.Back();
+    const bool constant = reduced.Size() == 1 &&
+        (!(channelMask_ & CHANNEL_POSITION) || (last.position_ - first.position_).Length() <= positionTolerance) &&
+        (!(channelMask_ & CHANNEL_ROTATION) || 2.0f * Acos(Abs(last.rotation_.DotProduct(first.rotation_))) <= rotationTolerance) &&
+        (!(channelMask_ & CHANNEL_SCALE) || (last.scale_ - first.scale_).Length() <= scaleTolerance);
+
+    if (!constant)
+        reduced.Push(last);
+
+    keyFrames_ = reduced;
+    return numKeyFrames - keyFrames_.Size();
+}
+
+void AnimationTrack::Unpack()
+{
+    if (!IsPacked())
+        return;
+
+    keyFrames_.Clear();
+    keyFrames_.Resize(packedKeyFrames_.Size());
+    for (unsigned i{ 0 }; i < packedKeyFrames_.Size(); ++i)
+        UnpackKeyFrame(packedKeyFrames_[i], packedRanges_, channelMask_, keyFrames_[i]);
+
+    packedKeyFrames_.Clear();
+    packedKeyFrames_.Compact();
 }
 
 AnimationKeyFrame* AnimationTrack::GetKeyFrame(unsigned index)
 {
+    Unpack();
+
     return index < keyFrames_.Size() ? &keyFrames_[index] : nullptr;
 }
 
+float AnimationTrack::GetKeyFrameTime(unsigned index) const
+{
+    if (IsPacked())
+        return DequantizeUnit(packedKeyFrames_[index].time_, packedRanges_.minTime_, packedRanges_.timeRange_);
+    else
+        return keyFrames_[index].time_;
+}
+
 void AnimationTrack::GetKeyFrameIndex(float time, unsigned& index) const
 {
+    const unsigned numKeyFrames = GetNumKeyFrames();
+
     if (time < 0.0f)
         time = 0.0f;
 
-    if (index >= keyFrames_.Size())
-        index = keyFrames_.Size() - 1;
+    if (index >= numKeyFrames)
+        index = numKeyFrames - 1;
+
+    // During playback the time advances at most a keyframe or so at a time. After a seek, search instead of stepping
+    if ((index && time < GetKeyFrameTime(index - 1)) || (index + 2 < numKeyFrames && time >= GetKeyFrameTime(index + 2)))
+    {
+        unsigned low{ 0 };
+        unsigned high = numKeyFrames;
+        while (high - low > 1)
+        {
+            const unsigned middle = (low + high) / 2;
+            if (time >= GetKeyFrameTime(middle))
+                low = middle;
+            else
+                high = middle;
+        }
+
+        index = low;
+        return;
+    }
 
     // Check for being too far ahead
-    while (index && time < keyFrames_[index].time_)
+    while (index && time < GetKeyFrameTime(index))
         --index;
 
     // Check for being too far behind
-    while (index < keyFrames_.Size() - 1 && time >= keyFrames_[index + 1].time_)
+    while (index < numKeyFrames - 1 && time >= GetKeyFrameTime(index + 1))
         ++index;
 }
 
+bool AnimationTrack::Sample(float time, float length, bool looped, unsigned& index, Vector3& position, Quaternion& rotation,
+    Vector3& scale) const
+{
+    const unsigned numKeyFrames = GetNumKeyFrames();
+    if (!numKeyFrames)
+        return false;
+
+    GetKeyFrameIndex(time, index);
+
+    // Check if next frame to interpolate to is valid, or if wrapping is needed (looping animation only)
+    unsigned nextIndex = index + 1;
+    bool interpolate = true;
+    if (nextIndex >= numKeyFrames)
+    {
+        if (!looped)
+        {
+            nextIndex = index;
+            interpolate = false;
+        }
+        else
+            nextIndex = 0;
+    }
+
+    // Of packed keyframes only the two that are interpolated are decoded
+    AnimationKeyFrame unpacked[2];
+    const AnimationKeyFrame* keyFrame;
+    const AnimationKeyFrame* nextKeyFrame;
+    if (IsPacked())
+    {
+        UnpackKeyFrame(packedKeyFrames_[index], packedRanges_, channelMask_, unpacked[0]);
+        if (interpolate)
+            UnpackKeyFrame(packedKeyFrames_[nextIndex], packedRanges_, channelMask_, unpacked[1]);
+
+        keyFrame = &unpacked[0];
+        nextKeyFrame = &unpacked[1];
+    }
+    else
+    {
+        keyFrame = &keyFrames_[index];
+        nextKeyFrame = &keyFrames_[nextIndex];
+    }
+
+    if (!interpolate)
+    {
+        if (channelMask_ & CHANNEL_POSITION)
+            position = keyFrame->position_;
+        if (channelMask_ & CHANNEL_ROTATION)
+            rotation = keyFrame->rotation_;
+        if (channelMask_ & CHANNEL_SCALE)
+            scale = keyFrame->scale_;
+
+        return true;
+    }
+
+    float timeInterval = nextKeyFrame->time_ - keyFrame->time_;
+    if (timeInterval < 0.0f)
+        timeInterval += length;
+    const float t = timeInterval > 0.0f ? (time - keyFrame->time_) / timeInterval : 1.0f;
+
+    if (channelMask_ & CHANNEL_POSITION)
+        position = keyFrame->position_.Lerp(nextKeyFrame->position_, t);
+    if (channelMask_ & CHANNEL_ROTATION)
+        rotation = keyFrame->rotation_.Slerp(nextKeyFrame->rotation_, t);
+    if (channelMask_ & CHANNEL_SCALE)
+        scale = keyFrame->scale_.Lerp(nextKeyFrame->scale_, t);
+
+    return true;
+}
+
 Animation::Animation(Context* context) :
     ResourceWithMetadata(context),
-    length_(0.f)
+    length_(0.f),
+    compressed_(false)
 {
 }
 
@@ -125,12 +520,15 @@ bool Animation::BeginLoad(Deserializer& source)
     unsigned memoryUse = sizeof(Animation);
 
     // Check ID
-    if (source.ReadFileID() != "UANI")
+    const String fileID = source.ReadFileID();
+    if (fileID != "UANI" && fileID != "UANC")
     {
         DRY_LOGERROR(source.GetName() + " is not a valid animation file");
         return false;
     }
 
+    compressed_ = fileID == "UANC";
+
     // Read name and length
     animationName_ = source.ReadString();
     animationNameHash_ = animationName_;
@@ -147,6 +545,15 @@ bool Animation::BeginLoad(Deserializer& source)
         newTrack->channelMask_ = AnimationChannelFlags(source.ReadUByte());
 
         unsigned keyFrames = source.ReadUInt();
+
+        // Compressed keyframes stay packed and are sampled directly
+        if (compressed_)
+        {
+            ReadCompressedKeyFrames(source, *newTrack, keyFrames);
+            memoryUse += keyFrames * sizeof(AnimationPackedKeyFrame);
+            continue;
+        }
+
         newTrack->keyFrames_.Resize(keyFrames);
         memoryUse += keyFrames * sizeof(AnimationKeyFrame);
 
@@ -225,7 +632,7 @@ bool Animation::BeginLoad(Deserializer& source)
 bool Animation::Save(Serializer& dest) const
 {
     // Write ID, name and length
-    dest.WriteFileID("UANI");
+    dest.WriteFileID(compressed_ ? "UANC" : "UANI");
     dest.WriteString(animationName_);
     dest.WriteFloat(length_);
 
@@ -236,12 +643,27 @@ bool Animation::Save(Serializer& dest) const
         const AnimationTrack& track = i->second_;
         dest.WriteString(track.name_);
         dest.WriteUByte(track.channelMask_);
-        dest.WriteUInt(track.keyFrames_.Size());
+        dest.WriteUInt(track.GetNumKeyFrames());
+
+        if (compressed_)
+        {
+            WriteCompressedKeyFrames(dest, track);
+            continue;
+        }
+
+        // Write keyframes of the track, decoding them first if packed
+        AnimationTrack unpacked;
+        const Vector<AnimationKeyFrame>* keyFrames = &track.keyFrames_;
+        if (track.IsPacked())
+        {
+            unpacked = track;
+            unpacked.Unpack();
+            keyFrames = &unpacked.keyFrames_;
+        }
 
-        // Write keyframes of the track
-        for (unsigned j{ 0 }; j < track.keyFrames_.Size(); ++j)
+        for (unsigned j{ 0 }; j < keyFrames->Size(); ++j)
         {
-            const AnimationKeyFrame& keyFrame = track.keyFrames_[j];
+            const AnimationKeyFrame& keyFrame = keyFrames->At(j);
             dest.WriteFloat(keyFrame.time_);
             if (track.channelMask_ & CHANNEL_POSITION)
                 dest.WriteVector3(keyFrame.position_);
@@ -282,6 +704,30 @@ bool Animation::Save(Serializer& dest) const
     return true;
 }
 
+void Animation::SetCompressed(bool enable)
+{
+    compressed_ = enable;
+}
+
+unsigned Animation::ReduceKeyFrames(float positionTolerance, float rotationTolerance, float scaleTolerance)
+{
+    unsigned removed{ 0 };
+    unsigned keyFrameMemoryBefore{ 0 };
+    unsigned keyFrameMemoryAfter{ 0 };
+    for (HashMap<StringHash, AnimationTrack>::Iterator i = tracks_.Begin(); i != tracks_.End(); ++i)
+    {
+        AnimationTrack& track = i->second_;
+        keyFrameMemoryBefore += track.packedKeyFrames_.Size() * sizeof(AnimationPackedKeyFrame) +
+            track.keyFrames_.Size() * sizeof(AnimationKeyFrame);
+        removed += track.ReduceKeyFrames(positionTolerance, rotationTolerance, scaleTolerance);
+        keyFrameMemoryAfter += track.keyFrames_.Size() * sizeof(AnimationKeyFrame);
+    }
+
+    // Reducing unpacks the tracks, so the memory use may also grow
+    SetMemoryUse(Max(GetMemoryUse() + keyFrameMemoryAfter, keyFrameMemoryBefore) - keyFrameMemoryBefore);
+    return removed;
+}
+
 void Animation::SetAnimationName(const String& name)
 {
     animationName_ = name;
@@ -376,6 +822,7 @@ SharedPtr<Animation> Animation::Clone(const String& cloneName) const
     ret->length_ = length_;
     ret->tracks_ = tracks_;
     ret->triggers_ = triggers_;
+    ret->compressed_ = compressed_;
     ret->CopyMetadata(*this);
     ret->SetMemoryUse(GetMemoryUse());
 
@@ -27,6 +27,7 @@
 
 #include "../Container/FlagSet.h"
 #include "../Container/Ptr.h"
+#include "../Container/Vector.h"
 #include "../Math/Quaternion.h"
 #include "../Math/Vector3.h"
 #include "../Resource/Resource.h"
@@ -43,6 +44,13 @@ enum AnimationChannel : unsigned char
 };
 DRY_FLAGSET(AnimationChannel, AnimationChannelFlags);
 
+/// Default position error tolerance of animation keyframe reduction.
+static const float DEFAULT_ANIMATION_POSITION_TOLERANCE = 0.0005f;
+/// Default rotation error tolerance of animation keyframe reduction, in degrees.
+static const float DEFAULT_ANIMATION_ROTATION_TOLERANCE = 0.05f;
+/// Default scale error tolerance of animation keyframe reduction.
+static const float DEFAULT_ANIMATION_SCALE_TOLERANCE = 0.0005f;
+
 /// Skeletal animation keyframe.
 struct AnimationKeyFrame
 {
@@ -63,7 +71,37 @@ struct AnimationKeyFrame
     Vector3 scale_;
 };
 
-/// Skeletal animation track, stores keyframes of a single bone.
+/// Quantized skeletal animation keyframe of a compressed animation. Times, positions and scales are 16-bit values within the track's ranges.
+struct AnimationPackedKeyFrame
+{
+    /// Quantized time.
+    unsigned short time_;
+    /// Quantized position.
+    unsigned short position_[3];
+    /// Smallest-three rotation: the 2-bit index of the left out component followed by the other three in 15 bits each.
+    unsigned short rotation_[3];
+    /// Quantized scale.
+    unsigned short scale_[3];
+};
+
+/// Value ranges of the packed keyframes of a compressed animation track.
+struct AnimationPackedRanges
+{
+    /// Time of the first keyframe.
+    float minTime_{};
+    /// Time span of the keyframes.
+    float timeRange_{};
+    /// Minimum position.
+    Vector3 minPosition_;
+    /// Position span.
+    Vector3 positionRange_;
+    /// Minimum scale.
+    Vector3 minScale_;
+    /// Scale span.
+    Vector3 scaleRange_;
+};
+
+/// Skeletal animation track, stores keyframes of a single bone. Tracks of compressed animations keep their keyframes packed and are sampled from them; modifying or accessing a keyframe unpacks the track.
 struct DRY_API AnimationTrack
 {
     /// Construct.
@@ -81,13 +119,24 @@ struct DRY_API AnimationTrack
     void RemoveKeyFrame(unsigned index);
     /// Remove all keyframes.
     void RemoveAllKeyFrames();
+    /// Remove keyframes that interpolation between their neighbours reproduces within the tolerances. Rotation tolerance is in degrees. Return number of keyframes removed.
+    unsigned ReduceKeyFrames(float positionTolerance, float rotationTolerance, float scaleTolerance);
 
-    /// Return keyframe at index, or null if not found.
+    /// Decode packed keyframes to full precision.
+    void Unpack();
+
+    /// Return keyframe at index, or null if not found. Unpacks the track.
     AnimationKeyFrame* GetKeyFrame(unsigned index);
     /// Return number of keyframes.
-    unsigned GetNumKeyFrames() const { return keyFrames_.Size(); }
+    unsigned GetNumKeyFrames() const { return IsPacked() ? packedKeyFrames_.Size() : keyFrames_.Size(); }
+    /// Return time of keyframe at index.
+    float GetKeyFrameTime(unsigned index) const;
     /// Return keyframe index based on time and previous index.
     void GetKeyFrameIndex(float time, unsigned& index) const;
+    /// Sample the channels of the track at a time, interpolating from the keyframe found from the previous index. Channels not in the track are left unchanged. Return false if there are no keyframes.
+    bool Sample(float time, float length, bool looped, unsigned& index, Vector3& position, Quaternion& rotation, Vector3& scale) const;
+    /// Return whether keyframes are packed.
+    bool IsPacked() const { return !packedKeyFrames_.IsEmpty(); }
 
     /// Bone or scene node name.
     String name_;
@@ -95,8 +144,12 @@ struct DRY_API AnimationTrack
     StringHash nameHash_;
     /// Bitmask of included data (position, rotation, scale.)
     AnimationChannelFlags channelMask_{};
-    /// Keyframes.
+    /// Keyframes. Empty while the track is packed.
     Vector<AnimationKeyFrame> keyFrames_;
+    /// Packed keyframes in time order.
+    PODVector<AnimationPackedKeyFrame> packedKeyFrames_;
+    /// Value ranges of the packed keyframes.
+    AnimationPackedRanges packedRanges_;
 };
 
 /// %Animation trigger point.
@@ -131,6 +184,11 @@ public:
     bool BeginLoad(Deserializer& source) override;
     /// Save resource. Return true if successful.
     bool Save(Serializer& dest) const override;
+    /// Set whether to save in the compressed format, with quantized keyframes. Loading a compressed animation enables this and keeps its keyframes packed.
+    void SetCompressed(bool enable);
+    /// Reduce keyframes of all tracks within the error tolerances. Rotation tolerance is in degrees. Return number of keyframes removed.
+    unsigned ReduceKeyFrames(float positionTolerance = DEFAULT_ANIMATION_POSITION_TOLERANCE,
+        float rotationTolerance = DEFAULT_ANIMATION_ROTATION_TOLERANCE, float scaleTolerance = DEFAULT_ANIMATION_SCALE_TOLERANCE);
 
     /// Set animation name.
     void SetAnimationName(const String& name);
@@ -166,6 +224,9 @@ public:
     /// Return animation length.
     float GetLength() const { return length_; }
 
+    /// Return whether saves in the compressed format.
+    bool IsCompressed() const { return compressed_; }
+
     /// Return all animation tracks.
     const HashMap<StringHash, AnimationTrack>& GetTracks() const { return tracks_; }
 
@@ -200,6 +261,8 @@ private:
     HashMap<StringHash, AnimationTrack> tracks_;
     /// Animation trigger points.
     Vector<AnimationTriggerPoint> triggers_;
+    /// Compressed format flag.
+    bool compressed_;
 };
 
 }
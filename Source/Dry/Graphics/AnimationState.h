@@ -38,6 +38,7 @@ class Serializer;
 class Skeleton;
 struct AnimationTrack;
 struct Bone;
+struct BonePose;
 
 /// %Animation blending mode.
 enum AnimationBlendMode
@@ -147,6 +148,8 @@ public:
 
     /// Apply the animation at the current time position.
     void Apply();
+    /// Blend the animation at the current time position into a local pose that is indexed like the bones of the model's skeleton. Bones can be left out with a per-bone mask. Model mode only.
+    void ApplyToPose(BonePose* pose, const Bone* bones, const unsigned char* boneMask = nullptr);
 
 private:
     /// Apply animation to a skeleton. Transform changes are applied silently, so the model needs to dirty its root model afterward.
@@ -155,6 +158,8 @@ private:
     void ApplyToNodes();
     /// Apply track.
     void ApplyTrack(AnimationStateTrack& stateTrack, float weight, bool silent);
+    /// Sample a track and blend it into a local transform. Return false if the track has no keyframes.
+    bool BlendTrack(AnimationStateTrack& stateTrack, float weight, Vector3& position, Quaternion& rotation, Vector3& scale);
 
     /// Animated model (model mode.)
     WeakPtr<AnimatedModel> model_;
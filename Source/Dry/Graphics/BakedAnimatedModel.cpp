@@ -0,0 +1,137 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+// Copyright (c) 2020-2023 LucKey Productions.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Core/Context.h"
+#include "../Graphics/BakedAnimatedModel.h"
+#include "../Graphics/BakedAnimation.h"
+#include "../Graphics/Renderer.h"
+#include "../IO/Log.h"
+#include "../Resource/ResourceCache.h"
+#include "../Scene/Node.h"
+
+#include "../DebugNew.h"
+
+namespace Dry
+{
+
+extern const char* DRY_GEOMETRY_CATEGORY;
+
+static bool extraElementsWarningDisplayed = false;
+
+BakedAnimatedModel::BakedAnimatedModel(Context* context) :
+    StaticModel(context),
+    instancingData_(MAX_EXTRA_INSTANCING_BUFFER_ELEMENTS),
+    timeOffset_(0.0f),
+    speed_(1.0f)
+{
+    for (unsigned i{ 0 }; i < instancingData_.Size(); ++i)
+        instancingData_[i] = Vector4::ZERO;
+
+    instancingData_[0] = Vector4(timeOffset_, speed_, 0.0f, 0.0f);
+}
+
+BakedAnimatedModel::~BakedAnimatedModel() = default;
+
+void BakedAnimatedModel::RegisterObject(Context* context)
+{
+    context->RegisterFactory<BakedAnimatedModel>(DRY_GEOMETRY_CATEGORY);
+
+    DRY_COPY_BASE_ATTRIBUTES(StaticModel);
+    DRY_MIXED_ACCESSOR_ATTRIBUTE("Baked Animation", GetBakedAnimationAttr, SetBakedAnimationAttr, ResourceRef,
+        ResourceRef(BakedAnimation::GetTypeStatic()), AM_DEFAULT);
+    DRY_ACCESSOR_ATTRIBUTE("Time Offset", GetTimeOffset, SetTimeOffset, float, 0.0f, AM_DEFAULT);
+    DRY_ACCESSOR_ATTRIBUTE("Speed", GetSpeed, SetSpeed, float, 1.0f, AM_DEFAULT);
+}
+
+void BakedAnimatedModel::UpdateBatches(const FrameInfo& frame)
+{
+    StaticModel::UpdateBatches(frame);
+
+    for (unsigned i{ 0 }; i < batches_.Size(); ++i)
+        batches_[i].instancingData_ = &instancingData_[0];
+}
+
+void BakedAnimatedModel::SetBakedAnimation(BakedAnimation* animation)
+{
+    if (animation == bakedAnimation_)
+        return;
+
+    bakedAnimation_ = animation;
+    OnMarkedDirty(node_);
+    MarkNetworkUpdate();
+}
+
+void BakedAnimatedModel::SetTimeOffset(float offset)
+{
+    timeOffset_ = offset;
+    instancingData_[0].x_ = timeOffset_;
+    MarkNetworkUpdate();
+}
+
+void BakedAnimatedModel::SetSpeed(float speed)
+{
+    speed_ = speed;
+    instancingData_[0].y_ = speed_;
+    MarkNetworkUpdate();
+}
+
+void BakedAnimatedModel::SetBakedAnimationAttr(const ResourceRef& value)
+{
+    auto* cache = GetSubsystem<ResourceCache>();
+    SetBakedAnimation(cache->GetResource<BakedAnimation>(value.name_));
+}
+
+ResourceRef BakedAnimatedModel::GetBakedAnimationAttr() const
+{
+    return GetResourceRef(bakedAnimation_, BakedAnimation::GetTypeStatic());
+}
+
+void BakedAnimatedModel::OnSceneSet(Scene* scene)
+{
+    Drawable::OnSceneSet(scene);
+
+    // The playback parameters are read from the first extra instancing buffer element. Instanced models would freeze
+    // without it, but it is a renderer-wide setting, so only warn
+    auto* renderer = GetSubsystem<Renderer>();
+    if (scene && renderer && renderer->GetDynamicInstancing() && renderer->GetNumExtraInstancingBufferElements() < 1 &&
+        !extraElementsWarningDisplayed)
+    {
+        DRY_LOGWARNING("BakedAnimatedModel needs at least one extra instancing buffer element for instanced playback, "
+            "see Renderer::SetNumExtraInstancingBufferElements()");
+        extraElementsWarningDisplayed = true;
+    }
+}
+
+void BakedAnimatedModel::OnWorldBoundingBoxUpdate()
+{
+    // The baked bounding box covers all frames of the animation
+    if (bakedAnimation_ && bakedAnimation_->GetBoundingBox().Defined())
+        worldBoundingBox_ = bakedAnimation_->GetBoundingBox().Transformed(node_->GetWorldTransform());
+    else
+        StaticModel::OnWorldBoundingBoxUpdate();
+}
+
+}
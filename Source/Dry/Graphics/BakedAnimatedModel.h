@@ -0,0 +1,90 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+// Copyright (c) 2020-2023 LucKey Productions.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Graphics/StaticModel.h"
+
+namespace Dry
+{
+
+class BakedAnimation;
+
+/// Skinned model that plays a baked animation on the GPU. There are no bone scene nodes and no per-frame animation work on the CPU, so models sharing the geometry and material draw as one instanced call. The time offset and speed are passed as the first extra instancing buffer element, so Renderer::SetNumExtraInstancingBufferElements() must be set to at least 1 for instanced playback.
+class DRY_API BakedAnimatedModel : public StaticModel
+{
+    DRY_OBJECT(BakedAnimatedModel, StaticModel);
+
+public:
+    /// Construct.
+    explicit BakedAnimatedModel(Context* context);
+    /// Destruct.
+    ~BakedAnimatedModel() override;
+    /// Register object factory. StaticModel must be registered first.
+    static void RegisterObject(Context* context);
+
+    /// Calculate distance and prepare batches for rendering. May be called from worker thread(s), possibly re-entrantly.
+    void UpdateBatches(const FrameInfo& frame) override;
+
+    /// Set baked animation for the bounding box. The materials should be set up with BakedAnimation::ApplyToMaterial(). Only a named animation in the resource cache is kept when the component is saved or cloned.
+    void SetBakedAnimation(BakedAnimation* animation);
+    /// Set playback time offset in seconds.
+    void SetTimeOffset(float offset);
+    /// Set playback speed.
+    void SetSpeed(float speed);
+
+    /// Return baked animation.
+    BakedAnimation* GetBakedAnimation() const { return bakedAnimation_; }
+
+    /// Return playback time offset in seconds.
+    float GetTimeOffset() const { return timeOffset_; }
+
+    /// Return playback speed.
+    float GetSpeed() const { return speed_; }
+
+    /// Set baked animation attribute.
+    void SetBakedAnimationAttr(const ResourceRef& value);
+    /// Return baked animation attribute.
+    ResourceRef GetBakedAnimationAttr() const;
+
+protected:
+    /// Handle scene being assigned.
+    void OnSceneSet(Scene* scene) override;
+    /// Recalculate the world-space bounding box.
+    void OnWorldBoundingBoxUpdate() override;
+
+private:
+    /// Baked animation.
+    SharedPtr<BakedAnimation> bakedAnimation_;
+    /// Per-instance data: time offset and speed.
+    PODVector<Vector4> instancingData_;
+    /// Playback time offset.
+    float timeOffset_;
+    /// Playback speed.
+    float speed_;
+};
+
+}
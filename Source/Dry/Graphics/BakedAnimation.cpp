@@ -0,0 +1,329 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+// Copyright (c) 2020-2023 LucKey Productions.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Core/Context.h"
+#include "../Graphics/Animation.h"
+#include "../Graphics/BakedAnimation.h"
+#include "../Graphics/Graphics.h"
+#include "../Graphics/Material.h"
+#include "../Graphics/Model.h"
+#include "../Graphics/Texture2D.h"
+#include "../Graphics/VertexBuffer.h"
+#include "../IO/Deserializer.h"
+#include "../IO/Log.h"
+#include "../IO/Serializer.h"
+
+#include "../DebugNew.h"
+
+namespace Dry
+{
+
+/// Merge the skinned vertices of a model's vertex buffers into a bounding box.
+static void MergeSkinnedVertices(BoundingBox& box, const Model* model, const Matrix3x4* skinMatrices, unsigned numBones)
+{
+    const Vector<SharedPtr<VertexBuffer> >& buffers = model->GetVertexBuffers();
+    for (unsigned i{ 0 }; i < buffers.Size(); ++i)
+    {
+        const VertexBuffer* buffer = buffers[i];
+        const unsigned char* data = buffer ? buffer->GetShadowData() : nullptr;
+        if (!data)
+            continue;
+
+        const unsigned positionOffset = buffer->GetElementOffset(TYPE_VECTOR3, SEM_POSITION);
+        const unsigned weightsOffset = buffer->GetElementOffset(TYPE_VECTOR4, SEM_BLENDWEIGHTS);
+        const unsigned indicesOffset = buffer->GetElementOffset(TYPE_UBYTE4, SEM_BLENDINDICES);
+        if (positionOffset == M_MAX_UNSIGNED || weightsOffset == M_MAX_UNSIGNED || indicesOffset == M_MAX_UNSIGNED)
+            continue;
+
+        const unsigned vertexSize = buffer->GetVertexSize();
+        for (unsigned j{ 0 }; j < buffer->GetVertexCount(); ++j)
+        {
+            const unsigned char* vertex = data + j * vertexSize;
+            const Vector3& position = *reinterpret_cast<const Vector3*>(vertex + positionOffset);
+            const float* weights = reinterpret_cast<const float*>(vertex + weightsOffset);
+            const unsigned char* indices = vertex + indicesOffset;
+
+            Vector3 skinnedPosition{ Vector3::ZERO };
+            for (unsigned k{ 0 }; k < 4; ++k)
+            {
+                if (weights[k] > 0.0f && indices[k] < numBones)
+                    skinnedPosition += (skinMatrices[indices[k]] * position) * weights[k];
+            }
+
+            box.Merge(skinnedPosition);
+        }
+    }
+}
+
+BakedAnimation::BakedAnimation(Context* context) :
+    Resource(context),
+    numFrames_(0),
+    numBones_(0),
+    frameRate_(DEFAULT_BAKED_ANIMATION_FRAME_RATE),
+    length_(0.0f)
+{
+}
+
+BakedAnimation::~BakedAnimation() = default;
+
+void BakedAnimation::RegisterObject(Context* context)
+{
+    context->RegisterFactory<BakedAnimation>();
+}
+
+bool BakedAnimation::BeginLoad(Deserializer& source)
+{
+    // Check ID
+    if (source.ReadFileID() != "UBAK")
+    {
+        DRY_LOGERROR(source.GetName() + " is not a valid baked animation file");
+        return false;
+    }
+
+    const unsigned numFrames = source.ReadUInt();
+    const unsigned numBones = source.ReadUInt();
+    const float frameRate = source.ReadFloat();
+    const float length = source.ReadFloat();
+    const BoundingBox boundingBox = source.ReadBoundingBox();
+    if (!numFrames || !numBones || frameRate <= 0.0f || length < 0.0f)
+    {
+        DRY_LOGERROR(source.GetName() + " has no frames or bones");
+        return false;
+    }
+
+    // Check the matrix count against the rest of the file before allocating, so that a corrupt header can neither
+    // overflow the size nor request a huge allocation
+    const unsigned long long matrixDataSize = (unsigned long long)numFrames * numBones * sizeof(Matrix3x4);
+    if (matrixDataSize > source.GetSize() - source.GetPosition())
+    {
+        DRY_LOGERROR(source.GetName() + " has truncated skinning matrices");
+        return false;
+    }
+
+    const auto dataSize = (unsigned)matrixDataSize;
+    skinMatrices_.Resize(numFrames * numBones);
+    if (source.Read(&skinMatrices_[0], dataSize) != dataSize)
+    {
+        DRY_LOGERROR(source.GetName() + " has truncated skinning matrices");
+        skinMatrices_.Clear();
+        return false;
+    }
+
+    boundingBox_ = boundingBox;
+    numFrames_ = numFrames;
+    numBones_ = numBones;
+    frameRate_ = frameRate;
+    length_ = length;
+
+    SetMemoryUse(sizeof(BakedAnimation) + dataSize);
+    return true;
+}
+
+bool BakedAnimation::EndLoad()
+{
+    return CreateTexture(GetName());
+}
+
+bool BakedAnimation::Save(Serializer& dest) const
+{
+    if (skinMatrices_.IsEmpty())
+    {
+        DRY_LOGERROR("Can not save baked animation without frames");
+        return false;
+    }
+
+    dest.WriteFileID("UBAK");
+    dest.WriteUInt(numFrames_);
+    dest.WriteUInt(numBones_);
+    dest.WriteFloat(frameRate_);
+    dest.WriteFloat(length_);
+    dest.WriteBoundingBox(boundingBox_);
+    return dest.Write(&skinMatrices_[0], skinMatrices_.Size() * sizeof(Matrix3x4)) == skinMatrices_.Size() * sizeof(Matrix3x4);
+}
+
+bool BakedAnimation::Bake(Model* model, Animation* animation, float frameRate)
+{
+    if (!model || !animation || frameRate <= 0.0f)
+    {
+        DRY_LOGERROR("Null model or animation, or invalid frame rate for baking animation");
+        return false;
+    }
+
+    const Vector<Bone>& bones = model->GetSkeleton().GetBones();
+    const unsigned numBones = bones.Size();
+    if (!numBones)
+    {
+        DRY_LOGERROR("Model " + model->GetName() + " has no skeleton to bake animation for");
+        return false;
+    }
+
+    // The baked matrices are indexed by the vertex blend indices directly
+    const Vector<PODVector<unsigned> >& boneMappings = model->GetGeometryBoneMappings();
+    for (unsigned i{ 0 }; i < boneMappings.Size(); ++i)
+    {
+        if (!boneMappings[i].IsEmpty())
+        {
+            DRY_LOGERROR("Model " + model->GetName() + " uses per-geometry bone mappings, which baked animation does not support");
+            return false;
+        }
+    }
+
+    const float length = animation->GetLength();
+    const unsigned numFrames = (unsigned)Max(CeilToInt(length * frameRate), 1);
+
+    // Find the track of each bone, and an order where parents come before their children
+    PODVector<const AnimationTrack*> tracks(numBones);
+    PODVector<unsigned> order;
+    PODVector<unsigned char> ordered(numBones);
+    for (unsigned i{ 0 }; i < numBones; ++i)
+    {
+        tracks[i] = animation->GetTrack(bones[i].nameHash_);
+        ordered[i] = 0;
+    }
+
+    bool added = true;
+    while (added && order.Size() < numBones)
+    {
+        added = false;
+
+        for (unsigned i{ 0 }; i < numBones; ++i)
+        {
+            const unsigned parentIndex = bones[i].parentIndex_;
+            if (!ordered[i] && (parentIndex == i || parentIndex >= numBones || ordered[parentIndex]))
+            {
+                order.Push(i);
+                ordered[i] = 1;
+                added = true;
+            }
+        }
+    }
+
+    if (order.Size() < numBones)
+    {
+        DRY_LOGERROR("Model " + model->GetName() + " has a broken bone hierarchy");
+        return false;
+    }
+
+    // Evaluate the skinning matrices of each frame, one row per frame
+    PODVector<Matrix3x4> skinMatrices(numBones * numFrames);
+    PODVector<Matrix3x4> boneTransforms(numBones);
+    PODVector<unsigned> keyFrames(numBones);
+    for (unsigned i{ 0 }; i < numBones; ++i)
+        keyFrames[i] = 0;
+
+    BoundingBox boundingBox;
+
+    for (unsigned frame{ 0 }; frame < numFrames; ++frame)
+    {
+        const float time = Min(frame / frameRate, length);
+
+        for (unsigned k{ 0 }; k < numBones; ++k)
+        {
+            const unsigned i = order[k];
+            const Bone& bone = bones[i];
+            Vector3 position{ bone.initialPosition_ };
+            Quaternion rotation{ bone.initialRotation_ };
+            Vector3 scale{ bone.initialScale_ };
+
+            if (tracks[i])
+                tracks[i]->Sample(time, length, true, keyFrames[i], position, rotation, scale);
+
+            const Matrix3x4 localTransform(position, rotation, scale);
+            const unsigned parentIndex = bone.parentIndex_;
+            if (parentIndex != i && parentIndex < numBones)
+                boneTransforms[i] = boneTransforms[parentIndex] * localTransform;
+            else
+                boneTransforms[i] = localTransform;
+        }
+
+        Matrix3x4* frameMatrices = &skinMatrices[frame * numBones];
+        for (unsigned i{ 0 }; i < numBones; ++i)
+            frameMatrices[i] = boneTransforms[i] * bones[i].offsetMatrix_;
+
+        MergeSkinnedVertices(boundingBox, model, frameMatrices, numBones);
+    }
+
+    // Without shadowed vertex data, fall back to the bind pose bounding box
+    if (!boundingBox.Defined())
+        boundingBox = model->GetBoundingBox();
+
+    skinMatrices_.Swap(skinMatrices);
+    boundingBox_ = boundingBox;
+    numFrames_ = numFrames;
+    numBones_ = numBones;
+    frameRate_ = frameRate;
+    length_ = length;
+    SetMemoryUse(sizeof(BakedAnimation) + skinMatrices_.Size() * sizeof(Matrix3x4));
+
+    if (!CreateTexture(animation->GetName() + "_Baked"))
+        return false;
+
+    DRY_LOGDEBUGF("Baked animation %s into %u frames of %u bones", animation->GetName().CString(), numFrames, numBones);
+    return true;
+}
+
+bool BakedAnimation::CreateTexture(const String& name)
+{
+    texture_.Reset();
+    if (!GetSubsystem<Graphics>())
+        return true;
+
+    // Each matrix is stored as three RGBA texels, the same layout as the skinning matrix shader uniforms
+    SharedPtr<Texture2D> texture(new Texture2D(context_));
+    texture->SetName(name);
+    texture->SetNumLevels(1);
+    texture->SetFilterMode(FILTER_NEAREST);
+    texture->SetAddressMode(COORD_U, ADDRESS_CLAMP);
+    texture->SetAddressMode(COORD_V, ADDRESS_CLAMP);
+    if (!texture->SetSize(numBones_ * 3, numFrames_, Graphics::GetRGBAFloat32Format(), TEXTURE_STATIC) ||
+        !texture->SetData(0, 0, 0, numBones_ * 3, numFrames_, &skinMatrices_[0]))
+    {
+        DRY_LOGERROR("Failed to create baked animation texture " + name);
+        return false;
+    }
+
+    texture_ = texture;
+    return true;
+}
+
+void BakedAnimation::ApplyToMaterial(Material* material) const
+{
+    if (!material || !texture_)
+        return;
+
+#ifdef DESKTOP_GRAPHICS
+    material->SetTexture(TU_SKINMAP, texture_);
+#endif
+    // The last frame interpolates back to the first over the rest of the animation length, so loops keep its period
+    const float loopLength = length_ > 0.0f ? length_ : numFrames_ / frameRate_;
+    material->SetShaderParameter("VertexAnimParams", Vector4((float)numFrames_, frameRate_, loopLength, 0.0f));
+
+    const String& defines = material->GetVertexShaderDefines();
+    if (!defines.Split(' ').Contains("VERTEXANIM"))
+        material->SetVertexShaderDefines(defines.IsEmpty() ? String("VERTEXANIM") : defines + " VERTEXANIM");
+}
+
+}
@@ -0,0 +1,107 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+// Copyright (c) 2020-2023 LucKey Productions.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Math/BoundingBox.h"
+#include "../Math/Matrix3x4.h"
+#include "../Resource/Resource.h"
+
+namespace Dry
+{
+
+class Animation;
+class Material;
+class Model;
+class Texture2D;
+
+/// Default sampling rate of baked animations, in frames per second.
+static const float DEFAULT_BAKED_ANIMATION_FRAME_RATE = 30.0f;
+
+/// %Animation baked into a texture of skinning matrices, one row per frame. Played on the GPU by BakedAnimatedModel without a skeleton of scene nodes. Requires OpenGL 3 and float textures.
+class DRY_API BakedAnimation : public Resource
+{
+    DRY_OBJECT(BakedAnimation, Resource);
+
+public:
+    /// Construct.
+    explicit BakedAnimation(Context* context);
+    /// Destruct.
+    ~BakedAnimation() override;
+    /// Register object factory.
+    static void RegisterObject(Context* context);
+
+    /// Load resource from stream. May be called from a worker thread. Return true if successful.
+    bool BeginLoad(Deserializer& source) override;
+    /// Finish resource loading. Always called from the main thread. Return true if successful.
+    bool EndLoad() override;
+    /// Save resource. Return true if successful.
+    bool Save(Serializer& dest) const override;
+
+    /// Bake a looping animation played on a skinned model. Models with per-geometry bone mappings are not supported. Return true if successful.
+    bool Bake(Model* model, Animation* animation, float frameRate = DEFAULT_BAKED_ANIMATION_FRAME_RATE);
+    /// Set up a material for playing the animation: assign the texture to the skin texture unit and the playback parameters, and add the VERTEXANIM vertex shader define. All models using the material play this animation.
+    void ApplyToMaterial(Material* material) const;
+
+    /// Return the texture of skinning matrices.
+    Texture2D* GetTexture() const { return texture_; }
+
+    /// Return number of frames.
+    unsigned GetNumFrames() const { return numFrames_; }
+
+    /// Return number of bones.
+    unsigned GetNumBones() const { return numBones_; }
+
+    /// Return sampling rate in frames per second.
+    float GetFrameRate() const { return frameRate_; }
+
+    /// Return length of the source animation, which is the loop period.
+    float GetLength() const { return length_; }
+
+    /// Return bounding box of the model over all frames, in model space.
+    const BoundingBox& GetBoundingBox() const { return boundingBox_; }
+
+private:
+    /// Create the texture from the skinning matrices. Without graphics, leave it null. Return true if successful.
+    bool CreateTexture(const String& name);
+
+    /// Texture of skinning matrices.
+    SharedPtr<Texture2D> texture_;
+    /// Skinning matrices of all frames, one row of bones per frame. Kept for saving.
+    PODVector<Matrix3x4> skinMatrices_;
+    /// Bounding box over all frames.
+    BoundingBox boundingBox_;
+    /// Number of frames.
+    unsigned numFrames_;
+    /// Number of bones.
+    unsigned numBones_;
+    /// Sampling rate.
+    float frameRate_;
+    /// Length of the source animation.
+    float length_;
+};
+
+}
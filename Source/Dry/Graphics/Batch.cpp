@@ -160,9 +160,80 @@ void CalculateSpotMatrix(Matrix4& dest, Light* light)
     dest = texAdjust * spotProj * spotView;
 }
 
+void Batch::CalculatePipelineState(Graphics* graphics, Camera* camera, bool reverseCulling)
+{
+    PipelineStateDesc desc;
+    pipelineState_ = GetPipelineStateDesc(desc, camera, reverseCulling) ? graphics->GetPipelineState(desc) : nullptr;
+    pipelineReverseCulling_ = reverseCulling;
+}
+
+bool Batch::GetPipelineStateDesc(PipelineStateDesc& desc, Camera* camera, bool reverseCulling) const
+{
+    if (!pass_ || !material_)
+        return false;
+
+    desc.vertexShader_ = vertexShader_;
+    desc.pixelShader_ = pixelShader_;
+
+    desc.vertexLayoutHash_ = geometryType_ == GEOM_INSTANCED || geometryType_ == GEOM_SKINNED_INSTANCED ? 1u : 0u;
+    if (geometry_)
+    {
+        for (unsigned i{ 0 }; i < geometry_->GetNumVertexBuffers(); ++i)
+        {
+            VertexBuffer* buffer = geometry_->GetVertexBuffer(i);
+            if (buffer)
+                CombineHash(desc.vertexLayoutHash_, MakeHash(buffer->GetBufferHash(i)));
+        }
+    }
+
+    desc.blendMode_ = pass_->GetBlendMode();
+    // Turn additive blending into subtract if the light is negative
+    Light* light = lightQueue_ ? lightQueue_->light_ : nullptr;
+    if (light && light->IsNegative())
+    {
+        if (desc.blendMode_ == BLEND_ADD)
+            desc.blendMode_ = BLEND_SUBTRACT;
+        else if (desc.blendMode_ == BLEND_ADDALPHA)
+            desc.blendMode_ = BLEND_SUBTRACTALPHA;
+    }
+    desc.alphaToCoverage_ = pass_->GetAlphaToCoverage() || material_->GetAlphaToCoverage();
+    desc.lineAntiAlias_ = material_->GetLineAntiAlias();
+
+    bool isShadowPass = pass_->GetIndex() == Technique::shadowPassIndex;
+    desc.cullMode_ = pass_->GetCullMode();
+    // Get cull mode from material if pass doesn't override it
+    if (desc.cullMode_ == MAX_CULLMODES)
+        desc.cullMode_ = isShadowPass ? material_->GetShadowCullMode() : material_->GetCullMode();
+    // Check whether the camera reverses culling due to vertical flipping or reflection
+    if (reverseCulling)
+    {
+        if (desc.cullMode_ == CULL_CW)
+            desc.cullMode_ = CULL_CCW;
+        else if (desc.cullMode_ == CULL_CCW)
+            desc.cullMode_ = CULL_CW;
+    }
+
+    // Shadow passes leave the depth bias to the shadow map rendering
+    if (!isShadowPass)
+    {
+        const BiasParameters& depthBias = material_->GetDepthBias();
+        desc.hasDepthBias_ = true;
+        desc.constantDepthBias_ = depthBias.constantBias_;
+        desc.slopeScaledDepthBias_ = depthBias.slopeScaledBias_;
+    }
+
+    // Use the "least filled" fill mode combined from camera & material
+    desc.fillMode_ = (FillMode)(Max(camera ? camera->GetFillMode() : FILL_SOLID, material_->GetFillMode()));
+    desc.depthTestMode_ = pass_->GetDepthTestMode();
+    desc.depthWrite_ = pass_->GetDepthWrite();
+
+    return true;
+}
+
 void Batch::CalculateSortKey()
 {
-    auto shaderID = (unsigned)(
+    // Prefer the pipeline state ID, which also covers the shaders, so that batches sharing all renderstates sort together
+    auto shaderID = pipelineState_ ? pipelineState_->GetID() & 0x7fffu : (unsigned)(
         ((*((unsigned*)&vertexShader_) / sizeof(ShaderVariation)) + (*((unsigned*)&pixelShader_) / sizeof(ShaderVariation))) &
         0x7fffu);
     if (!isBase_)
@@ -183,46 +254,28 @@ void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool all
 
     Graphics* graphics = view->GetGraphics();
     Renderer* renderer = view->GetRenderer();
-    Node* cameraNode = camera ? camera->GetNode() : nullptr;
     Light* light = lightQueue_ ? lightQueue_->light_ : nullptr;
     Texture2D* shadowMap = lightQueue_ ? lightQueue_->shadowMap_ : nullptr;
 
-    // Set shaders first. The available shader parameters and their register/uniform positions depend on the currently set shaders
-    graphics->SetShaders(vertexShader_, pixelShader_);
-
-    // Set pass / material-specific renderstates
-    if (pass_ && material_)
+    // Set shaders first. The available shader parameters and their register/uniform positions depend on the currently set shaders.
+    // Batches that were not queued by the view, or were queued for a different culling direction, resolve their
+    // pipeline state here
+    const bool reverseCulling = camera && camera->GetReverseCulling();
+    PipelineState* pipelineState = pipelineState_;
+    if (!pipelineState || pipelineReverseCulling_ != reverseCulling)
     {
-        BlendMode blend = pass_->GetBlendMode();
-        // Turn additive blending into subtract if the light is negative
-        if (light && light->IsNegative())
-        {
-            if (blend == BLEND_ADD)
-                blend = BLEND_SUBTRACT;
-            else if (blend == BLEND_ADDALPHA)
-                blend = BLEND_SUBTRACTALPHA;
-        }
-        graphics->SetBlendMode(blend, pass_->GetAlphaToCoverage() || material_->GetAlphaToCoverage());
-        graphics->SetLineAntiAlias(material_->GetLineAntiAlias());
-
-        bool isShadowPass = pass_->GetIndex() == Technique::shadowPassIndex;
-        CullMode effectiveCullMode = pass_->GetCullMode();
-        // Get cull mode from material if pass doesn't override it
-        if (effectiveCullMode == MAX_CULLMODES)
-            effectiveCullMode = isShadowPass ? material_->GetShadowCullMode() : material_->GetCullMode();
-
-        renderer->SetCullMode(effectiveCullMode, camera);
-        if (!isShadowPass)
-        {
-            const BiasParameters& depthBias = material_->GetDepthBias();
-            graphics->SetDepthBias(depthBias.constantBias_, depthBias.slopeScaledBias_);
-        }
+        PipelineStateDesc desc;
+        pipelineState = GetPipelineStateDesc(desc, camera, reverseCulling) ? graphics->GetPipelineState(desc) : nullptr;
+    }
 
-        // Use the "least filled" fill mode combined from camera & material
-        graphics->SetFillMode((FillMode)(Max(camera->GetFillMode(), material_->GetFillMode())));
-        graphics->SetDepthTest(pass_->GetDepthTestMode());
-        graphics->SetDepthWrite(pass_->GetDepthWrite() && allowDepthWrite);
+    if (pipelineState)
+    {
+        graphics->SetPipelineState(pipelineState);
+        if (!allowDepthWrite)
+            graphics->SetDepthWrite(false);
     }
+    else
+        graphics->SetShaders(vertexShader_, pixelShader_);
 
     // Set global (per-frame) shader parameters
     if (graphics->NeedParameterUpdate(SP_FRAME, nullptr))
@@ -241,25 +294,8 @@ void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool all
     }
 
     // Set model or skinning transforms
-    if (setModelTransform && graphics->NeedParameterUpdate(SP_OBJECT, worldTransform_))
-    {
-        if (geometryType_ == GEOM_SKINNED)
-        {
-            graphics->SetShaderParameter(VSP_SKINMATRICES, reinterpret_cast<const float*>(worldTransform_),
-                12 * numWorldTransforms_);
-        }
-        else
-            graphics->SetShaderParameter(VSP_MODEL, *worldTransform_);
-
-        // Set the orientation for billboards, either from the object itself or from the camera
-        if (geometryType_ == GEOM_BILLBOARD)
-        {
-            if (numWorldTransforms_ > 1)
-                graphics->SetShaderParameter(VSP_BILLBOARDROT, worldTransform_[1].RotationMatrix());
-            else
-                graphics->SetShaderParameter(VSP_BILLBOARDROT, cameraNode->GetWorldRotation().RotationMatrix());
-        }
-    }
+    if (setModelTransform)
+        PrepareTransforms(graphics, camera);
 
     // Set zone-related shader parameters
     BlendMode blend = graphics->GetBlendMode();
@@ -427,21 +463,23 @@ void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool all
             if (shadowMap)
             {
                 {
-                    // Calculate point light shadow sampling offsets (unrolled cube map)
-                    auto faceWidth = (unsigned)(shadowMap->GetWidth() / 2);
-                    auto faceHeight = (unsigned)(shadowMap->GetHeight() / 3);
+                    // Calculate point light shadow sampling offsets (unrolled cube map). The faces may be a tile of a
+                    // shadow atlas, so take their size and place from the first face's viewport
+                    const IntRect& faceRect = lightQueue_->shadowSplits_[0].shadowViewport_;
+                    auto faceWidth = (unsigned)faceRect.Width();
+                    auto faceHeight = (unsigned)faceRect.Height();
                     auto width = (float)shadowMap->GetWidth();
                     auto height = (float)shadowMap->GetHeight();
 #ifdef DRY_OPENGL
                     float mulX = (float)(faceWidth - 3) / width;
                     float mulY = (float)(faceHeight - 3) / height;
-                    float addX = 1.5f / width;
-                    float addY = 1.5f / height;
+                    float addX = ((float)faceRect.left_ + 1.5f) / width;
+                    float addY = (height - (float)(faceRect.top_ + 3 * faceHeight) + 1.5f) / height;
 #else
                     float mulX = (float)(faceWidth - 4) / width;
                     float mulY = (float)(faceHeight - 4) / height;
-                    float addX = 2.5f / width;
-                    float addY = 2.5f / height;
+                    float addX = ((float)faceRect.left_ + 2.5f) / width;
+                    float addY = ((float)faceRect.top_ + 2.5f) / height;
 #endif
                     // If using 4 shadow samples, offset the position diagonally by half pixel
                     if (renderer->GetShadowQuality() == SHADOWQUALITY_PCF_16BIT || renderer->GetShadowQuality() == SHADOWQUALITY_PCF_24BIT)
@@ -450,6 +488,7 @@ void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool all
                         addY -= 0.5f / height;
                     }
                     graphics->SetShaderParameter(PSP_SHADOWCUBEADJUST, Vector4(mulX, mulY, addX, addY));
+                    graphics->SetShaderParameter(PSP_SHADOWCUBEFACESCALE, Vector2(2.0f * faceWidth / width, 3.0f * faceHeight / height));
                 }
 
                 {
@@ -632,6 +671,37 @@ void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool all
             graphics->SetTexture(TU_LIGHTSHAPE, shapeTexture);
         }
     }
+    // Set light cluster textures to the units of the unused light textures
+    else if (view->GetLightClusters() && graphics->HasShaderParameter(PSP_CLUSTERPARAMS))
+    {
+        LightClusters* clusters = view->GetLightClusters();
+        graphics->SetTexture(TU_LIGHTRAMP, clusters->GetLightTexture());
+        graphics->SetTexture(TU_LIGHTSHAPE, clusters->GetGridTexture());
+        graphics->SetTexture(TU_SHADOWMAP, clusters->GetIndexTexture());
+    }
+}
+
+void Batch::PrepareTransforms(Graphics* graphics, Camera* camera) const
+{
+    if (!graphics->NeedParameterUpdate(SP_OBJECT, worldTransform_))
+        return;
+
+    if (geometryType_ == GEOM_SKINNED)
+    {
+        graphics->SetShaderParameter(VSP_SKINMATRICES, reinterpret_cast<const float*>(worldTransform_),
+            12 * numWorldTransforms_);
+    }
+    else
+        graphics->SetShaderParameter(VSP_MODEL, *worldTransform_);
+
+    // Set the orientation for billboards, either from the object itself or from the camera
+    if (geometryType_ == GEOM_BILLBOARD)
+    {
+        if (numWorldTransforms_ > 1)
+            graphics->SetShaderParameter(VSP_BILLBOARDROT, worldTransform_[1].RotationMatrix());
+        else
+            graphics->SetShaderParameter(VSP_BILLBOARDROT, camera->GetNode()->GetWorldRotation().RotationMatrix());
+    }
 }
 
 void Batch::Draw(View* view, Camera* camera, bool allowDepthWrite) const
@@ -644,26 +714,45 @@ void Batch::Draw(View* view, Camera* camera, bool allowDepthWrite) const
 }
 
 void BatchGroup::SetInstancingData(void* lockedData, unsigned stride, unsigned& freeIndex)
+{
+    ReserveInstancingData(freeIndex);
+    FillInstancingData(lockedData, stride);
+}
+
+void BatchGroup::ReserveInstancingData(unsigned& freeIndex)
 {
     // Do not use up buffer space if not going to draw as instanced
-    if (geometryType_ != GEOM_INSTANCED)
+    if (geometryType_ != GEOM_INSTANCED && geometryType_ != GEOM_SKINNED_INSTANCED)
         return;
 
     startIndex_ = freeIndex;
+    freeIndex += instances_.Size();
+}
+
+void BatchGroup::FillInstancingData(void* lockedData, unsigned stride) const
+{
+    if (startIndex_ == M_MAX_UNSIGNED)
+        return;
+
     unsigned char* buffer = static_cast<unsigned char*>(lockedData) + startIndex_ * stride;
 
     for (unsigned i{ 0 }; i < instances_.Size(); ++i)
     {
         const InstanceData& instance = instances_[i];
 
-        memcpy(buffer, instance.worldTransform_, sizeof(Matrix3x4));
+        // Skinned instances only need the location of their skinning matrices in the bone texture
+        if (geometryType_ == GEOM_SKINNED_INSTANCED)
+        {
+            memset(buffer, 0, sizeof(Matrix3x4));
+            *reinterpret_cast<float*>(buffer) = (float)instance.skinOffset_;
+        }
+        else
+            memcpy(buffer, instance.worldTransform_, sizeof(Matrix3x4));
         if (instance.instancingData_)
             memcpy(buffer + sizeof(Matrix3x4), instance.instancingData_, stride - sizeof(Matrix3x4));
 
         buffer += stride;
     }
-
-    freeIndex += instances_.Size();
 }
 
 void BatchGroup::Draw(View* view, Camera* camera, bool allowDepthWrite) const
@@ -675,8 +764,16 @@ void BatchGroup::Draw(View* view, Camera* camera, bool allowDepthWrite) const
     {
         // Draw as individual objects if instancing not supported or could not fill the instancing buffer
         VertexBuffer* instanceBuffer = renderer->GetInstancingBuffer();
-        if (!instanceBuffer || geometryType_ != GEOM_INSTANCED || startIndex_ == M_MAX_UNSIGNED)
+        if (!instanceBuffer || (geometryType_ != GEOM_INSTANCED && geometryType_ != GEOM_SKINNED_INSTANCED) ||
+            startIndex_ == M_MAX_UNSIGNED || (geometryType_ == GEOM_SKINNED_INSTANCED && !renderer->GetSkinTexture()))
         {
+            // Skinned instances need their skinning matrices as shader parameters when not drawn instanced
+            if (geometryType_ == GEOM_SKINNED_INSTANCED)
+            {
+                DrawSkinnedInstances(view, camera, allowDepthWrite);
+                return;
+            }
+
             Batch::Prepare(view, camera, false, allowDepthWrite);
 
             graphics->SetIndexBuffer(geometry_->GetIndexBuffer());
@@ -694,6 +791,10 @@ void BatchGroup::Draw(View* view, Camera* camera, bool allowDepthWrite) const
         else
         {
             Batch::Prepare(view, camera, false, allowDepthWrite);
+#ifndef GL_ES_VERSION_2_0
+            if (geometryType_ == GEOM_SKINNED_INSTANCED)
+                graphics->SetTexture(TU_SKINMAP, renderer->GetSkinTexture());
+#endif
 
             // Get the geometry vertex buffers, then add the instancing stream buffer
             // Hack: use a const_cast to avoid dynamic allocation of new temp vectors
@@ -712,6 +813,96 @@ void BatchGroup::Draw(View* view, Camera* camera, bool allowDepthWrite) const
     }
 }
 
+void BatchGroup::DrawSkinnedInstances(View* view, Camera* camera, bool allowDepthWrite) const
+{
+    if (!skinnedVertexShader_ || !skinnedPixelShader_)
+        return;
+
+    Graphics* graphics = view->GetGraphics();
+
+    // Draw each instance as a skinned batch, using the whole matrix palette the instance refers to
+    Batch batch(*this);
+    batch.geometryType_ = GEOM_SKINNED;
+    batch.pass_ = skinnedPass_;
+    batch.vertexShader_ = skinnedVertexShader_;
+    batch.pixelShader_ = skinnedPixelShader_;
+    batch.pipelineState_ = nullptr;
+
+    for (unsigned i{ 0 }; i < instances_.Size(); ++i)
+    {
+        batch.worldTransform_ = instances_[i].worldTransform_;
+        if (!i)
+            batch.Prepare(view, camera, true, allowDepthWrite);
+        else
+            batch.PrepareTransforms(graphics, camera);
+
+        geometry_->Draw(graphics);
+    }
+}
+
+bool BatchGroup::IsCombinable(const BatchGroup& rhs) const
+{
+    if (geometryType_ != GEOM_INSTANCED || rhs.geometryType_ != GEOM_INSTANCED || startIndex_ == M_MAX_UNSIGNED ||
+        rhs.startIndex_ == M_MAX_UNSIGNED || instances_.IsEmpty() || rhs.instances_.IsEmpty())
+        return false;
+
+    if (pass_ != rhs.pass_ || material_ != rhs.material_ || vertexShader_ != rhs.vertexShader_ ||
+        pixelShader_ != rhs.pixelShader_ || zone_ != rhs.zone_ || lightQueue_ != rhs.lightQueue_ || lightMask_ != rhs.lightMask_ ||
+        isBase_ != rhs.isBase_)
+        return false;
+
+    return geometry_->GetPrimitiveType() == rhs.geometry_->GetPrimitiveType() &&
+           geometry_->GetIndexBuffer() == rhs.geometry_->GetIndexBuffer() &&
+           geometry_->GetVertexBuffers() == rhs.geometry_->GetVertexBuffers() && !geometry_->IsEmpty() &&
+           !rhs.geometry_->IsEmpty();
+}
+
+void BatchGroup::DrawCombined(View* view, Camera* camera, bool allowDepthWrite, BatchGroup* const* groups, unsigned numGroups)
+{
+    Graphics* graphics = view->GetGraphics();
+
+    auto* commands = static_cast<IndirectDrawCommand*>(graphics->ReserveScratchBuffer(numGroups * sizeof(IndirectDrawCommand)));
+    if (!commands)
+    {
+        for (unsigned i{ 0 }; i < numGroups; ++i)
+            groups[i]->Draw(view, camera, allowDepthWrite);
+        return;
+    }
+
+    // The instance data of each group is found through the base instance
+    for (unsigned i{ 0 }; i < numGroups; ++i)
+    {
+        const BatchGroup* group = groups[i];
+        IndirectDrawCommand& command = commands[i];
+        command.indexCount_ = group->geometry_->GetIndexCount();
+        command.instanceCount_ = group->instances_.Size();
+        command.indexStart_ = group->geometry_->GetIndexStart();
+        command.baseVertex_ = 0;
+        command.baseInstance_ = group->startIndex_;
+    }
+
+    groups[0]->DrawIndirect(view, camera, allowDepthWrite, commands, numGroups);
+    graphics->FreeScratchBuffer(commands);
+}
+
+void BatchGroup::DrawIndirect(View* view, Camera* camera, bool allowDepthWrite, const IndirectDrawCommand* commands,
+    unsigned count) const
+{
+    Graphics* graphics = view->GetGraphics();
+
+    Batch::Prepare(view, camera, false, allowDepthWrite);
+
+    // Hack: use a const_cast to avoid dynamic allocation of new temp vectors
+    auto& vertexBuffers = const_cast<Vector<SharedPtr<VertexBuffer> >&>(geometry_->GetVertexBuffers());
+    vertexBuffers.Push(SharedPtr<VertexBuffer>(view->GetRenderer()->GetInstancingBuffer()));
+
+    graphics->SetIndexBuffer(geometry_->GetIndexBuffer());
+    graphics->SetVertexBuffers(vertexBuffers, 0);
+    graphics->MultiDrawIndirect(geometry_->GetPrimitiveType(), commands, count);
+
+    vertexBuffers.Pop();
+}
+
 unsigned BatchGroupKey::ToHash() const
 {
     return (unsigned)((size_t)zone_ / sizeof(Zone) + (size_t)lightQueue_ / sizeof(LightBatchQueue) + (size_t)pass_ / sizeof(Pass) +
@@ -723,6 +914,9 @@ void BatchQueue::Clear(int maxSortedInstances)
     batches_.Clear();
     sortedBatches_.Clear();
     batchGroups_.Clear();
+    commands_.Clear();
+    indirectCommands_.Clear();
+    recorded_ = false;
     maxSortedInstances_ = (unsigned)maxSortedInstances;
 }
 
@@ -846,6 +1040,102 @@ void BatchQueue::SetInstancingData(void* lockedData, unsigned stride, unsigned&
         i->second_.SetInstancingData(lockedData, stride, freeIndex);
 }
 
+void BatchQueue::ReserveInstancingData(unsigned& freeIndex)
+{
+    for (HashMap<BatchGroupKey, BatchGroup>::Iterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
+        i->second_.ReserveInstancingData(freeIndex);
+}
+
+void BatchQueue::FillInstancingData(void* lockedData, unsigned stride) const
+{
+    for (HashMap<BatchGroupKey, BatchGroup>::ConstIterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
+        i->second_.FillInstancingData(lockedData, stride);
+}
+
+/// Return the render state changes between two consecutive batches.
+static unsigned char GetDrawCommandChanges(const Batch* previous, const Batch* batch)
+{
+    if (!previous)
+        return DCC_ALL;
+
+    unsigned char changes = DCC_NONE;
+    if (batch->vertexShader_ != previous->vertexShader_ || batch->pixelShader_ != previous->pixelShader_)
+        changes |= DCC_SHADERS;
+    if (batch->pass_ != previous->pass_ || batch->material_ != previous->material_ || batch->pipelineState_ != previous->pipelineState_)
+        changes |= DCC_MATERIAL;
+    if (batch->zone_ != previous->zone_)
+        changes |= DCC_ZONE;
+    if (batch->lightQueue_ != previous->lightQueue_)
+        changes |= DCC_LIGHT;
+
+    return changes;
+}
+
+void BatchQueue::Record(bool combineGroups)
+{
+    commands_.Clear();
+    indirectCommands_.Clear();
+
+    const Batch* previous = nullptr;
+    DrawCommand command;
+
+    // Instanced draw calls go first, same as when drawing without recording
+    for (unsigned i{ 0 }; i < sortedBatchGroups_.Size();)
+    {
+        const BatchGroup* group = sortedBatchGroups_[i];
+
+        unsigned end = i + 1;
+        if (combineGroups)
+        {
+            while (end < sortedBatchGroups_.Size() && group->IsCombinable(*sortedBatchGroups_[end]))
+                ++end;
+        }
+
+        command.batch_ = group;
+        command.changes_ = GetDrawCommandChanges(previous, group);
+        command.indirectStart_ = indirectCommands_.Size();
+        command.indirectCount_ = 0;
+
+        if (end - i > 1)
+        {
+            command.type_ = DCMD_COMBINED;
+            command.indirectCount_ = end - i;
+
+            for (unsigned j{ i }; j < end; ++j)
+            {
+                const BatchGroup* combined = sortedBatchGroups_[j];
+                IndirectDrawCommand indirect;
+                indirect.indexCount_ = combined->geometry_->GetIndexCount();
+                indirect.instanceCount_ = combined->instances_.Size();
+                indirect.indexStart_ = combined->geometry_->GetIndexStart();
+                indirect.baseVertex_ = 0;
+                indirect.baseInstance_ = combined->startIndex_;
+                indirectCommands_.Push(indirect);
+            }
+        }
+        else
+            command.type_ = DCMD_GROUP;
+
+        commands_.Push(command);
+        previous = group;
+        i = end;
+    }
+
+    command.type_ = DCMD_BATCH;
+    command.indirectCount_ = 0;
+
+    for (unsigned i{ 0 }; i < sortedBatches_.Size(); ++i)
+    {
+        const Batch* batch = sortedBatches_[i];
+        command.batch_ = batch;
+        command.changes_ = GetDrawCommandChanges(previous, batch);
+        commands_.Push(command);
+        previous = batch;
+    }
+
+    recorded_ = true;
+}
+
 void BatchQueue::Draw(View* view, Camera* camera, bool markToStencil, bool usingLightOptimization, bool allowDepthWrite) const
 {
     Graphics* graphics = view->GetGraphics();
@@ -861,14 +1151,82 @@ void BatchQueue::Draw(View* view, Camera* camera, bool markToStencil, bool using
             graphics->SetStencilTest(false);
     }
 
-    // Instanced
-    for (PODVector<BatchGroup*>::ConstIterator i = sortedBatchGroups_.Begin(); i != sortedBatchGroups_.End(); ++i)
+    // Replay the recorded draw calls, skipping the batch preparation when the render state does not change
+    if (recorded_)
     {
-        BatchGroup* group = *i;
+        // A batch that was not drawn left the render state unprepared
+        bool statePrepared = false;
+
+        for (PODVector<DrawCommand>::ConstIterator i = commands_.Begin(); i != commands_.End(); ++i)
+        {
+            const Batch* batch = i->batch_;
+            if (markToStencil)
+                graphics->SetStencilTest(true, CMP_ALWAYS, OP_REF, OP_KEEP, OP_KEEP, batch->lightMask_);
+
+            switch (i->type_)
+            {
+            case DCMD_COMBINED:
+                static_cast<const BatchGroup*>(batch)->DrawIndirect(view, camera, allowDepthWrite,
+                    &indirectCommands_[i->indirectStart_], i->indirectCount_);
+                statePrepared = true;
+                break;
+
+            case DCMD_GROUP:
+                static_cast<const BatchGroup*>(batch)->Draw(view, camera, allowDepthWrite);
+                statePrepared = !batch->geometry_->IsEmpty();
+                break;
+
+            case DCMD_BATCH:
+                if (!usingLightOptimization)
+                {
+                    // If drawing an alpha batch, we can optimize fillrate by scissor test
+                    if (!batch->isBase_ && batch->lightQueue_)
+                        renderer->OptimizeLightByScissor(batch->lightQueue_->light_, camera);
+                    else
+                        graphics->SetScissorTest(false);
+                }
+
+                if (batch->geometry_->IsEmpty())
+                {
+                    statePrepared = false;
+                    break;
+                }
+
+                if (i->changes_ || !statePrepared)
+                    batch->Prepare(view, camera, true, allowDepthWrite);
+                else
+                    batch->PrepareTransforms(graphics, camera);
+
+                batch->geometry_->Draw(graphics);
+                statePrepared = true;
+                break;
+            }
+        }
+
+        return;
+    }
+
+    // Instanced. Adjacent groups that only differ by geometry are combined when multi-draw indirect is in use
+    const bool combineGroups = renderer->UseMultiDrawIndirect();
+    for (unsigned i{ 0 }; i < sortedBatchGroups_.Size();)
+    {
+        BatchGroup* group = sortedBatchGroups_[i];
         if (markToStencil)
             graphics->SetStencilTest(true, CMP_ALWAYS, OP_REF, OP_KEEP, OP_KEEP, group->lightMask_);
 
-        group->Draw(view, camera, allowDepthWrite);
+        unsigned end = i + 1;
+        if (combineGroups)
+        {
+            while (end < sortedBatchGroups_.Size() && group->IsCombinable(*sortedBatchGroups_[end]))
+                ++end;
+        }
+
+        if (end - i > 1)
+            BatchGroup::DrawCombined(view, camera, allowDepthWrite, &sortedBatchGroups_[i], end - i);
+        else
+            group->Draw(view, camera, allowDepthWrite);
+
+        i = end;
     }
     // Non-instanced
     for (PODVector<Batch*>::ConstIterator i = sortedBatches_.Begin(); i != sortedBatches_.End(); ++i)
@@ -895,7 +1253,7 @@ unsigned BatchQueue::GetNumInstances() const
 
     for (HashMap<BatchGroupKey, BatchGroup>::ConstIterator i = batchGroups_.Begin(); i != batchGroups_.End(); ++i)
     {
-        if (i->second_.geometryType_ == GEOM_INSTANCED)
+        if (i->second_.geometryType_ == GEOM_INSTANCED || i->second_.geometryType_ == GEOM_SKINNED_INSTANCED)
             total += i->second_.instances_.Size();
     }
 
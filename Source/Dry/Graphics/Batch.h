@@ -36,16 +36,20 @@ namespace Dry
 class Camera;
 class Drawable;
 class Geometry;
+class Graphics;
 class Light;
 class Material;
 class Matrix3x4;
 class Pass;
+class PipelineState;
 class ShaderVariation;
 class Texture2D;
 class VertexBuffer;
 class View;
 class Zone;
 struct LightBatchQueue;
+struct PipelineStateDesc;
+struct ShadowAtlasTile;
 
 /// Queued 3D geometry draw call.
 struct Batch
@@ -68,10 +72,16 @@ struct Batch
     {
     }
 
-    /// Calculate state sorting key, which consists of base pass flag, light, pass and geometry.
+    /// Resolve the pipeline state object for the shaders and pass, with culling reversed as it will be when the camera renders. Call after the shaders have been set and before calculating the sort key.
+    void CalculatePipelineState(Graphics* graphics, Camera* camera, bool reverseCulling);
+    /// Fill a pipeline state description from the shaders, pass and material. Return false if there is no pass or material to take renderstates from.
+    bool GetPipelineStateDesc(PipelineStateDesc& desc, Camera* camera, bool reverseCulling) const;
+    /// Calculate state sorting key, which consists of base pass flag, light, pipeline state, material and geometry.
     void CalculateSortKey();
     /// Prepare for rendering.
     void Prepare(View* view, Camera* camera, bool setModelTransform, bool allowDepthWrite) const;
+    /// Set model or skinning transforms.
+    void PrepareTransforms(Graphics* graphics, Camera* camera) const;
     /// Prepare and draw.
     void Draw(View* view, Camera* camera, bool allowDepthWrite) const;
 
@@ -105,6 +115,10 @@ struct Batch
     ShaderVariation* vertexShader_{};
     /// Pixel shader.
     ShaderVariation* pixelShader_{};
+    /// Pipeline state object. Null when renderstates are set individually.
+    PipelineState* pipelineState_{};
+    /// Whether the pipeline state object has culling reversed.
+    bool pipelineReverseCulling_{};
     /// %Geometry type.
     GeometryType geometryType_{};
 };
@@ -129,6 +143,8 @@ struct InstanceData
     const void* instancingData_{};
     /// Distance from camera.
     float distance_{};
+    /// Texel offset of the skinning matrices in the bone texture. Only used for skinned instances, which refer to their whole skinning matrix palette through the world transform.
+    unsigned skinOffset_{};
 };
 
 /// Instanced 3D geometry draw call.
@@ -157,6 +173,14 @@ struct BatchGroup : public Batch
         newInstance.distance_ = batch.distance_;
         newInstance.instancingData_ = batch.instancingData_;
 
+        // A skinned instance uses all the transforms as its skinning matrices
+        if (batch.geometryType_ == GEOM_SKINNED_INSTANCED)
+        {
+            newInstance.worldTransform_ = batch.worldTransform_;
+            instances_.Push(newInstance);
+            return;
+        }
+
         for (unsigned i{ 0 }; i < batch.numWorldTransforms_; ++i)
         {
             newInstance.worldTransform_ = &batch.worldTransform_[i];
@@ -166,13 +190,31 @@ struct BatchGroup : public Batch
 
     /// Pre-set the instance data. Buffer must be big enough to hold all data.
     void SetInstancingData(void* lockedData, unsigned stride, unsigned& freeIndex);
+    /// Reserve space for the instance data.
+    void ReserveInstancingData(unsigned& freeIndex);
+    /// Copy the instance data to the reserved space.
+    void FillInstancingData(void* lockedData, unsigned stride) const;
     /// Prepare and draw.
     void Draw(View* view, Camera* camera, bool allowDepthWrite) const;
+    /// Return whether another group only differs by geometry in the same buffers, so that both can be drawn with one multi-draw indirect call.
+    bool IsCombinable(const BatchGroup& rhs) const;
+    /// Prepare and draw groups that are combinable with the first one as one multi-draw indirect call.
+    static void DrawCombined(View* view, Camera* camera, bool allowDepthWrite, BatchGroup* const* groups, unsigned numGroups);
+    /// Prepare and draw with multi-draw indirect commands for this and the following combinable groups.
+    void DrawIndirect(View* view, Camera* camera, bool allowDepthWrite, const IndirectDrawCommand* commands, unsigned count) const;
+    /// Prepare and draw skinned instances one by one with their own skinning matrices.
+    void DrawSkinnedInstances(View* view, Camera* camera, bool allowDepthWrite) const;
 
     /// Instance data.
     PODVector<InstanceData> instances_;
     /// Instance stream start index, or M_MAX_UNSIGNED if transforms not pre-set.
     unsigned startIndex_;
+    /// Pass for drawing skinned instances one by one.
+    Pass* skinnedPass_{};
+    /// Vertex shader for drawing skinned instances one by one.
+    ShaderVariation* skinnedVertexShader_{};
+    /// Pixel shader for drawing skinned instances one by one.
+    ShaderVariation* skinnedPixelShader_{};
 };
 
 /// Instanced draw call grouping key.
@@ -223,6 +265,40 @@ struct BatchGroupKey
     unsigned ToHash() const;
 };
 
+/// Recorded draw call type.
+enum DrawCommandType : unsigned char
+{
+    DCMD_BATCH = 0,
+    DCMD_GROUP,
+    DCMD_COMBINED
+};
+
+/// Render state changes of a recorded draw call relative to the previous one.
+enum DrawCommandChange : unsigned char
+{
+    DCC_NONE = 0x0,
+    DCC_SHADERS = 0x1,
+    DCC_MATERIAL = 0x2,
+    DCC_ZONE = 0x4,
+    DCC_LIGHT = 0x8,
+    DCC_ALL = 0xf
+};
+
+/// Draw call recorded from a batch queue: what to draw and which render state changed from the previous call. Replayed on the main thread, which still sets the shader parameters and renderstates of changed calls.
+struct DrawCommand
+{
+    /// Batch, or the first batch group when combined.
+    const Batch* batch_;
+    /// Start of the multi-draw indirect commands when combined.
+    unsigned indirectStart_;
+    /// Number of combined batch groups.
+    unsigned indirectCount_;
+    /// Type.
+    DrawCommandType type_;
+    /// Render state changes. Batch preparation is skipped when none.
+    unsigned char changes_;
+};
+
 /// Queue that contains both instanced and non-instanced draw calls.
 struct BatchQueue
 {
@@ -237,6 +313,12 @@ public:
     void SortFrontToBack2Pass(PODVector<Batch*>& batches);
     /// Pre-set instance data of all groups. The vertex buffer must be big enough to hold all data.
     void SetInstancingData(void* lockedData, unsigned stride, unsigned& freeIndex);
+    /// Reserve space for the instance data of all groups.
+    void ReserveInstancingData(unsigned& freeIndex);
+    /// Copy the instance data of all groups to their reserved space. Can be called from a worker thread.
+    void FillInstancingData(void* lockedData, unsigned stride) const;
+    /// Record the sorted draw calls and the state changes between them for Draw() to replay. Combine groups into multi-draw indirect calls if requested. Shader parameters and renderstates are not recorded; Draw() sets them when the state changes. Can be called from a worker thread.
+    void Record(bool combineGroups);
     /// Draw.
     void Draw(View* view, Camera* camera, bool markToStencil, bool usingLightOptimization, bool allowDepthWrite) const;
     /// Return the combined amount of instances.
@@ -260,6 +342,12 @@ public:
     PODVector<Batch*> sortedBatches_;
     /// Sorted instanced draw calls.
     PODVector<BatchGroup*> sortedBatchGroups_;
+    /// Recorded draw calls.
+    PODVector<DrawCommand> commands_;
+    /// Multi-draw indirect commands of the recorded draw calls.
+    PODVector<IndirectDrawCommand> indirectCommands_;
+    /// Whether the draw calls have been recorded since clearing.
+    bool recorded_{};
     /// Maximum sorted instances.
     unsigned maxSortedInstances_;
     /// Whether the pass command contains extra shader defines.
@@ -281,8 +369,12 @@ struct ShadowBatchQueue
     Camera* shadowCamera_{};
     /// Shadow map viewport.
     IntRect shadowViewport_;
-    /// Shadow caster draw calls.
+    /// Shadow caster draw calls. Only the static shadow casters when rendering to a shadow atlas tile.
     BatchQueue shadowBatches_;
+    /// Dynamic shadow caster draw calls when rendering to a shadow atlas tile.
+    BatchQueue dynamicShadowBatches_;
+    /// Hash of the static shadow casters and shadow camera when rendering to a shadow atlas tile.
+    unsigned staticHash_{};
     /// Directional light cascade near split distance.
     float nearSplit_{};
     /// Directional light cascade far split distance.
@@ -298,6 +390,8 @@ struct LightBatchQueue
     bool negative_;
     /// Shadow map depth texture.
     Texture2D* shadowMap_;
+    /// Shadow atlas tile if the shadow map is the shadow atlas.
+    ShadowAtlasTile* shadowTile_;
     /// Lit geometry draw calls, base (replace blend mode)
     BatchQueue litBaseBatches_;
     /// Lit geometry draw calls, non-base (additive)
@@ -531,6 +531,14 @@ float Camera::GetLodDistance(float distance, float scale, float bias) const
         return orthoSize_ / d;
 }
 
+float Camera::GetProjectedSize(float distance, float size) const
+{
+    if (!orthographic_)
+        return size * zoom_ / Max(2.0f * distance * Tan(fov_ * 0.5f), M_EPSILON);
+    else
+        return size * zoom_ / Max(orthoSize_, M_EPSILON);
+}
+
 Quaternion Camera::GetFaceCameraRotation(const Vector3& position, const Quaternion& rotation, FaceCameraMode mode, float minAngle)
 {
     if (!node_)
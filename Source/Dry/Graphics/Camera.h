@@ -200,6 +200,8 @@ public:
     float GetDistanceSquared(const Vector3& worldPos) const;
     /// Return a scene node's LOD scaled distance.
     float GetLodDistance(float distance, float scale, float bias) const;
+    /// Return the projected size of an object at a distance, as a fraction of the view height.
+    float GetProjectedSize(float distance, float size) const;
     /// Return a world rotation for facing a camera on certain axes based on the existing world rotation.
     Quaternion GetFaceCameraRotation(const Vector3& position, const Quaternion& rotation, FaceCameraMode mode, float minAngle = 0.0f);
     /// Get effective world transform for matrix and frustum calculations including reflection but excluding node scaling.
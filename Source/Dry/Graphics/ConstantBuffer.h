@@ -55,6 +55,8 @@ public:
     void SetVector3ArrayParameter(unsigned offset, unsigned rows, const void* data);
     /// Apply to GPU.
     void Apply();
+    /// Record that the data was copied into the uniform ring buffer at an offset and clear the dirty flag. Used only on OpenGL.
+    void SetRingCopy(unsigned offset, unsigned frame);
 
     /// Return size.
     unsigned GetSize() const { return size_; }
@@ -62,11 +64,24 @@ public:
     /// Return whether has unapplied data.
     bool IsDirty() const { return dirty_; }
 
+    /// Return shadow data.
+    const unsigned char* GetShadowData() const { return shadowData_.Get(); }
+
+    /// Return offset of the data copy in the uniform ring buffer. Used only on OpenGL.
+    unsigned GetRingOffset() const { return ringOffset_; }
+
+    /// Return ring frame number of the data copy in the uniform ring buffer, or 0 if the buffer's own storage is up to date. Used only on OpenGL.
+    unsigned GetRingFrame() const { return ringFrame_; }
+
 private:
     /// Shadow data.
     SharedArrayPtr<unsigned char> shadowData_;
     /// Buffer byte size.
     unsigned size_{};
+    /// Offset of the data copy in the uniform ring buffer.
+    unsigned ringOffset_{};
+    /// Ring frame number of the data copy in the uniform ring buffer.
+    unsigned ringFrame_{};
     /// Dirty flag.
     bool dirty_{};
 };
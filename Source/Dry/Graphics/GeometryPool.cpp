@@ -0,0 +1,356 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+// Copyright (c) 2020-2023 LucKey Productions.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Core/Context.h"
+#include "../Core/Thread.h"
+#include "../Graphics/Geometry.h"
+#include "../Graphics/GeometryPool.h"
+#include "../Graphics/GraphicsEvents.h"
+#include "../Graphics/IndexBuffer.h"
+#include "../Graphics/VertexBuffer.h"
+#include "../IO/Log.h"
+
+#include "../DebugNew.h"
+
+namespace Dry
+{
+
+static void SetEntrySource(GeometryPoolEntry& entry, Geometry* geometry)
+{
+    VertexBuffer* vertexBuffer = geometry->GetNumVertexBuffers() ? geometry->GetVertexBuffer(0) : nullptr;
+    IndexBuffer* indexBuffer = geometry->GetIndexBuffer();
+
+    entry.source_ = geometry;
+    entry.vertexBuffer_ = vertexBuffer;
+    entry.indexBuffer_ = indexBuffer;
+    entry.vertexVersion_ = vertexBuffer ? vertexBuffer->GetDataVersion() : 0;
+    entry.indexVersion_ = indexBuffer ? indexBuffer->GetDataVersion() : 0;
+    entry.numVertexBuffers_ = geometry->GetNumVertexBuffers();
+    entry.indexStart_ = geometry->GetIndexStart();
+    entry.indexCount_ = geometry->GetIndexCount();
+}
+
+static bool IsEntryCurrent(const GeometryPoolEntry& entry, Geometry* geometry)
+{
+    if (entry.source_.Expired())
+        return false;
+
+    VertexBuffer* vertexBuffer = geometry->GetNumVertexBuffers() ? geometry->GetVertexBuffer(0) : nullptr;
+    IndexBuffer* indexBuffer = geometry->GetIndexBuffer();
+
+    return entry.vertexBuffer_.Get() == vertexBuffer && entry.indexBuffer_.Get() == indexBuffer &&
+        (!vertexBuffer || entry.vertexVersion_ == vertexBuffer->GetDataVersion()) &&
+        (!indexBuffer || entry.indexVersion_ == indexBuffer->GetDataVersion()) &&
+        entry.numVertexBuffers_ == geometry->GetNumVertexBuffers() && entry.indexStart_ == geometry->GetIndexStart() &&
+        entry.indexCount_ == geometry->GetIndexCount();
+}
+
+/// Allocate a range from the free ranges, or from the end of the used range. Return false if there is no room.
+static bool AllocateRange(PODVector<GeometryPoolRange>& freeRanges, unsigned& used, unsigned capacity, unsigned count,
+    unsigned& start)
+{
+    for (unsigned i{ 0 }; i < freeRanges.Size(); ++i)
+    {
+        GeometryPoolRange& range = freeRanges[i];
+        if (range.count_ < count)
+            continue;
+
+        start = range.start_;
+        range.start_ += count;
+        range.count_ -= count;
+        if (!range.count_)
+            freeRanges.Erase(i);
+
+        return true;
+    }
+
+    if (used + count > capacity)
+        return false;
+
+    start = used;
+    used += count;
+    return true;
+}
+
+/// Return a range to the free ranges, merging it with its neighbours and shrinking the used range if it is at the end.
+static void FreeRange(PODVector<GeometryPoolRange>& freeRanges, unsigned& used, unsigned start, unsigned count)
+{
+    if (!count)
+        return;
+
+    unsigned i{ 0 };
+    while (i < freeRanges.Size() && freeRanges[i].start_ < start)
+        ++i;
+
+    GeometryPoolRange range{ start, count };
+    // Merge with the following range
+    if (i < freeRanges.Size() && range.start_ + range.count_ == freeRanges[i].start_)
+    {
+        range.count_ += freeRanges[i].count_;
+        freeRanges.Erase(i);
+    }
+    // Merge with the preceding range
+    if (i > 0 && freeRanges[i - 1].start_ + freeRanges[i - 1].count_ == range.start_)
+    {
+        --i;
+        range.start_ = freeRanges[i].start_;
+        range.count_ += freeRanges[i].count_;
+        freeRanges.Erase(i);
+    }
+
+    if (range.start_ + range.count_ == used)
+        used = range.start_;
+    else
+        freeRanges.Insert(i, range);
+}
+
+GeometryPool::GeometryPool(Context* context) :
+    Object(context),
+    bufferVertices_(DEFAULT_GEOMETRY_POOL_VERTICES),
+    bufferIndices_(DEFAULT_GEOMETRY_POOL_INDICES)
+{
+    SubscribeToEvent(E_DEVICERESET, DRY_HANDLER(GeometryPool, HandleDeviceReset));
+}
+
+GeometryPool::~GeometryPool() = default;
+
+Geometry* GeometryPool::GetPooledGeometry(Geometry* geometry)
+{
+    if (!geometry)
+        return nullptr;
+
+    MutexLock lock(poolMutex_);
+
+    HashMap<Geometry*, GeometryPoolEntry>::Iterator i = entries_.Find(geometry);
+    // A new geometry may have taken the address of a destroyed one, or the source data may have been rewritten
+    if (i != entries_.End() && IsEntryCurrent(i->second_, geometry))
+        return i->second_.pooled_ ? i->second_.pooled_.Get() : geometry;
+
+    // The shared buffers can only be updated on the main thread
+    if (!Thread::IsMainThread())
+        return geometry;
+
+    if (i != entries_.End())
+        RemoveEntry(i);
+
+    // Remember also the geometries that can not be pooled, to not check them again
+    GeometryPoolEntry* entry = AddGeometry(geometry);
+    if (!entry)
+    {
+        SetEntrySource(entries_[geometry], geometry);
+        return geometry;
+    }
+
+    return entry->pooled_;
+}
+
+void GeometryPool::RemoveGeometry(Geometry* geometry)
+{
+    MutexLock lock(poolMutex_);
+
+    HashMap<Geometry*, GeometryPoolEntry>::Iterator i = entries_.Find(geometry);
+    if (i != entries_.End())
+        RemoveEntry(i);
+}
+
+void GeometryPool::Cleanup()
+{
+    MutexLock lock(poolMutex_);
+
+    for (HashMap<Geometry*, GeometryPoolEntry>::Iterator i = entries_.Begin(); i != entries_.End();)
+    {
+        HashMap<Geometry*, GeometryPoolEntry>::Iterator current = i++;
+        if (current->second_.source_.Expired())
+            RemoveEntry(current);
+    }
+}
+
+void GeometryPool::Clear()
+{
+    MutexLock lock(poolMutex_);
+
+    entries_.Clear();
+    buffers_.Clear();
+}
+
+void GeometryPool::SetBufferSize(unsigned vertices, unsigned indices)
+{
+    MutexLock lock(poolMutex_);
+
+    bufferVertices_ = Max(vertices, 1u);
+    bufferIndices_ = Max(indices, 1u);
+}
+
+unsigned GeometryPool::GetNumBuffers() const
+{
+    MutexLock lock(poolMutex_);
+    return buffers_.Size();
+}
+
+unsigned GeometryPool::GetNumGeometries() const
+{
+    MutexLock lock(poolMutex_);
+
+    unsigned num{ 0 };
+    for (unsigned i{ 0 }; i < buffers_.Size(); ++i)
+        num += buffers_[i]->numGeometries_;
+
+    return num;
+}
+
+GeometryPoolEntry* GeometryPool::AddGeometry(Geometry* geometry)
+{
+    if (geometry->GetNumVertexBuffers() != 1 || !geometry->GetIndexCount())
+        return nullptr;
+
+    VertexBuffer* sourceVertices = geometry->GetVertexBuffer(0);
+    IndexBuffer* sourceIndices = geometry->GetIndexBuffer();
+    if (!sourceVertices || !sourceIndices || !sourceVertices->GetShadowData() || !sourceIndices->GetShadowData())
+        return nullptr;
+
+    const unsigned indexStart = geometry->GetIndexStart();
+    const unsigned indexCount = geometry->GetIndexCount();
+    if (indexStart + indexCount > sourceIndices->GetIndexCount())
+        return nullptr;
+
+    // Read the indices and find the vertex range they use, as the draw range is not necessarily exact
+    PODVector<unsigned> indices(indexCount);
+    const unsigned char* indexData = sourceIndices->GetShadowData() + indexStart * sourceIndices->GetIndexSize();
+    unsigned minVertex = M_MAX_UNSIGNED;
+    unsigned maxVertex = 0;
+
+    for (unsigned i{ 0 }; i < indexCount; ++i)
+    {
+        if (sourceIndices->GetIndexSize() == sizeof(unsigned))
+            indices[i] = reinterpret_cast<const unsigned*>(indexData)[i];
+        else
+            indices[i] = reinterpret_cast<const unsigned short*>(indexData)[i];
+
+        minVertex = Min(minVertex, indices[i]);
+        maxVertex = Max(maxVertex, indices[i]);
+    }
+
+    if (maxVertex >= sourceVertices->GetVertexCount())
+        return nullptr;
+
+    const unsigned vertexCount = maxVertex - minVertex + 1;
+
+    // Find a shared buffer with the same vertex layout and room to spare
+    GeometryPoolBuffer* buffer = nullptr;
+    unsigned poolVertexStart{ 0 };
+    unsigned poolIndexStart{ 0 };
+    for (unsigned i{ 0 }; i < buffers_.Size(); ++i)
+    {
+        GeometryPoolBuffer* candidate = buffers_[i];
+        if (candidate->vertexBuffer_->GetElements() != sourceVertices->GetElements() ||
+            !AllocateRange(candidate->freeVertices_, candidate->usedVertices_, candidate->vertexBuffer_->GetVertexCount(),
+                vertexCount, poolVertexStart))
+            continue;
+
+        if (!AllocateRange(candidate->freeIndices_, candidate->usedIndices_, candidate->indexBuffer_->GetIndexCount(),
+                indexCount, poolIndexStart))
+        {
+            FreeRange(candidate->freeVertices_, candidate->usedVertices_, poolVertexStart, vertexCount);
+            continue;
+        }
+
+        buffer = candidate;
+        break;
+    }
+
+    if (!buffer)
+    {
+        SharedPtr<GeometryPoolBuffer> newBuffer(new GeometryPoolBuffer());
+        newBuffer->vertexBuffer_ = new VertexBuffer(context_);
+        newBuffer->indexBuffer_ = new IndexBuffer(context_);
+
+        if (!newBuffer->vertexBuffer_->SetSize(Max(bufferVertices_, vertexCount), sourceVertices->GetElements()) ||
+            !newBuffer->indexBuffer_->SetSize(Max(bufferIndices_, indexCount), true))
+            return nullptr;
+
+        buffers_.Push(newBuffer);
+        buffer = newBuffer;
+        AllocateRange(buffer->freeVertices_, buffer->usedVertices_, buffer->vertexBuffer_->GetVertexCount(), vertexCount,
+            poolVertexStart);
+        AllocateRange(buffer->freeIndices_, buffer->usedIndices_, buffer->indexBuffer_->GetIndexCount(), indexCount, poolIndexStart);
+
+        DRY_LOGDEBUGF("Created geometry pool buffer for %u vertices of %u bytes", newBuffer->vertexBuffer_->GetVertexCount(),
+                      newBuffer->vertexBuffer_->GetVertexSize());
+    }
+
+    // Rebase the indices to the vertices' place in the shared buffer
+    for (unsigned i{ 0 }; i < indexCount; ++i)
+        indices[i] = indices[i] - minVertex + poolVertexStart;
+
+    const unsigned vertexSize = sourceVertices->GetVertexSize();
+    if (!buffer->vertexBuffer_->SetDataRange(sourceVertices->GetShadowData() + minVertex * vertexSize, poolVertexStart, vertexCount) ||
+        !buffer->indexBuffer_->SetDataRange(&indices[0], poolIndexStart, indexCount))
+    {
+        FreeRange(buffer->freeVertices_, buffer->usedVertices_, poolVertexStart, vertexCount);
+        FreeRange(buffer->freeIndices_, buffer->usedIndices_, poolIndexStart, indexCount);
+        return nullptr;
+    }
+
+    SharedPtr<Geometry> pooled(new Geometry(context_));
+    pooled->SetVertexBuffer(0, buffer->vertexBuffer_);
+    pooled->SetIndexBuffer(buffer->indexBuffer_);
+    pooled->SetDrawRange(geometry->GetPrimitiveType(), poolIndexStart, indexCount, poolVertexStart, vertexCount, false);
+    pooled->SetLodDistance(geometry->GetLodDistance());
+
+    ++buffer->numGeometries_;
+
+    GeometryPoolEntry& entry = entries_[geometry];
+    SetEntrySource(entry, geometry);
+    entry.pooled_ = pooled;
+    entry.buffer_ = buffer;
+    return &entry;
+}
+
+void GeometryPool::RemoveEntry(HashMap<Geometry*, GeometryPoolEntry>::Iterator i)
+{
+    GeometryPoolBuffer* buffer = i->second_.buffer_;
+    if (buffer)
+    {
+        if (!--buffer->numGeometries_)
+            buffers_.Remove(SharedPtr<GeometryPoolBuffer>(buffer));
+        else
+        {
+            // Let later copies reuse the space
+            Geometry* pooled = i->second_.pooled_;
+            FreeRange(buffer->freeVertices_, buffer->usedVertices_, pooled->GetVertexStart(), pooled->GetVertexCount());
+            FreeRange(buffer->freeIndices_, buffer->usedIndices_, pooled->GetIndexStart(), pooled->GetIndexCount());
+        }
+    }
+
+    entries_.Erase(i);
+}
+
+void GeometryPool::HandleDeviceReset(StringHash /*eventType*/, VariantMap& /*eventData*/)
+{
+    // Copy the geometries again on demand
+    Clear();
+}
+
+}
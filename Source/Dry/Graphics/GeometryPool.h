@@ -0,0 +1,151 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+// Copyright (c) 2020-2023 LucKey Productions.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+/// \file
+
+#pragma once
+
+#include "../Container/HashMap.h"
+#include "../Core/Mutex.h"
+#include "../Core/Object.h"
+#include "../Graphics/GraphicsDefs.h"
+
+namespace Dry
+{
+
+class Geometry;
+class IndexBuffer;
+class VertexBuffer;
+
+/// Default vertex capacity of a geometry pool buffer.
+static const unsigned DEFAULT_GEOMETRY_POOL_VERTICES = 1024 * 1024;
+/// Default index capacity of a geometry pool buffer.
+static const unsigned DEFAULT_GEOMETRY_POOL_INDICES = 4 * 1024 * 1024;
+
+/// Free range of vertices or indices in a geometry pool buffer.
+struct GeometryPoolRange
+{
+    /// First vertex or index.
+    unsigned start_;
+    /// Number of vertices or indices.
+    unsigned count_;
+};
+
+/// Shared vertex and index buffer of a geometry pool.
+struct GeometryPoolBuffer : public RefCounted
+{
+    /// Vertex buffer.
+    SharedPtr<VertexBuffer> vertexBuffer_;
+    /// Index buffer with 32-bit indices.
+    SharedPtr<IndexBuffer> indexBuffer_;
+    /// Number of vertices in use.
+    unsigned usedVertices_{};
+    /// Number of indices in use.
+    unsigned usedIndices_{};
+    /// Free vertex ranges below the used vertex count, sorted by start.
+    PODVector<GeometryPoolRange> freeVertices_;
+    /// Free index ranges below the used index count, sorted by start.
+    PODVector<GeometryPoolRange> freeIndices_;
+    /// Number of live pooled geometries.
+    unsigned numGeometries_{};
+};
+
+/// Pooled copy of a geometry.
+struct GeometryPoolEntry
+{
+    /// Source geometry.
+    WeakPtr<Geometry> source_;
+    /// Copy in the shared buffers.
+    SharedPtr<Geometry> pooled_;
+    /// Shared buffer holding the copy.
+    SharedPtr<GeometryPoolBuffer> buffer_;
+    /// Source vertex buffer when the entry was made.
+    WeakPtr<VertexBuffer> vertexBuffer_;
+    /// Source index buffer when the entry was made.
+    WeakPtr<IndexBuffer> indexBuffer_;
+    /// Source vertex buffer data version when the entry was made.
+    unsigned vertexVersion_{};
+    /// Source index buffer data version when the entry was made.
+    unsigned indexVersion_{};
+    /// Source number of vertex buffers when the entry was made.
+    unsigned numVertexBuffers_{};
+    /// Source index start when the entry was made.
+    unsigned indexStart_{};
+    /// Source index count when the entry was made.
+    unsigned indexCount_{};
+};
+
+/// %Geometry pool. Copies static geometries with the same vertex layout into shared vertex and index buffers, so that draws of different geometries can be combined into multi-draw indirect calls. Copies are made again when the source buffers change. The space of released copies is reused, and a shared buffer is released with its last geometry.
+class DRY_API GeometryPool : public Object
+{
+    DRY_OBJECT(GeometryPool, Object);
+
+public:
+    /// Construct.
+    explicit GeometryPool(Context* context);
+    /// Destruct.
+    ~GeometryPool() override;
+
+    /// Return the pooled copy of a geometry, copying it on first use or after its buffers or draw range have changed. Return the geometry itself if it can not be pooled: it needs one shadowed vertex buffer and a shadowed index buffer. New copies are only made on the main thread.
+    Geometry* GetPooledGeometry(Geometry* geometry);
+    /// Forget the pooled copy of a geometry, for example after its data has changed.
+    void RemoveGeometry(Geometry* geometry);
+    /// Release the copies of destroyed geometries and the shared buffers left empty.
+    void Cleanup();
+    /// Release all copies and shared buffers.
+    void Clear();
+    /// Set vertex and index capacity of new shared buffers. Larger geometries get a buffer of their own size.
+    void SetBufferSize(unsigned vertices, unsigned indices);
+
+    /// Return vertex capacity of new shared buffers.
+    unsigned GetBufferVertices() const { return bufferVertices_; }
+
+    /// Return index capacity of new shared buffers.
+    unsigned GetBufferIndices() const { return bufferIndices_; }
+
+    /// Return number of shared buffers.
+    unsigned GetNumBuffers() const;
+    /// Return number of pooled geometries.
+    unsigned GetNumGeometries() const;
+
+private:
+    /// Copy a geometry into a shared buffer. Return null on failure.
+    GeometryPoolEntry* AddGeometry(Geometry* geometry);
+    /// Release an entry.
+    void RemoveEntry(HashMap<Geometry*, GeometryPoolEntry>::Iterator i);
+    /// Handle device reset. The shared buffers are not shadowed, so their contents are lost.
+    void HandleDeviceReset(StringHash eventType, VariantMap& eventData);
+
+    /// Mutex for the entries and buffers.
+    mutable Mutex poolMutex_;
+    /// Pooled copies by source geometry.
+    HashMap<Geometry*, GeometryPoolEntry> entries_;
+    /// Shared buffers.
+    Vector<SharedPtr<GeometryPoolBuffer> > buffers_;
+    /// Vertex capacity of new shared buffers.
+    unsigned bufferVertices_;
+    /// Index capacity of new shared buffers.
+    unsigned bufferIndices_;
+};
+
+}
@@ -27,6 +27,8 @@
 #include "../Graphics/AnimatedModel.h"
 #include "../Graphics/Animation.h"
 #include "../Graphics/AnimationController.h"
+#include "../Graphics/BakedAnimatedModel.h"
+#include "../Graphics/BakedAnimation.h"
 #include "../Graphics/Camera.h"
 #include "../Graphics/CustomGeometry.h"
 #include "../Graphics/DebugRenderer.h"
@@ -43,6 +45,8 @@
 #include "../Graphics/ShaderPrecache.h"
 #include "../Graphics/Skybox.h"
 #include "../Graphics/StaticModelGroup.h"
+#include "../Graphics/StreamingTerrain.h"
+#include "../Graphics/StreamingTerrainBlock.h"
 #include "../Graphics/Technique.h"
 #include "../Graphics/Terrain.h"
 #include "../Graphics/TerrainPatch.h"
@@ -61,6 +65,9 @@
 namespace Dry
 {
 
+/// Number of frames an unused pipeline state object is kept.
+static const unsigned PIPELINE_STATE_MAX_AGE = 300;
+
 void Graphics::SetExternalWindow(void* window)
 {
     if (!window_)
@@ -315,11 +322,11 @@ void Graphics::EndDumpShaders()
     shaderPrecache_.Reset();
 }
 
-void Graphics::PrecacheShaders(Deserializer& source)
+void Graphics::PrecacheShaders(Deserializer& source, bool async)
 {
     DRY_PROFILE(PrecacheShaders);
 
-    ShaderPrecache::LoadShaders(this, source);
+    ShaderPrecache::LoadShaders(this, source, async);
 }
 
 void Graphics::SetShaderCacheDir(const String& path)
@@ -329,6 +336,86 @@ void Graphics::SetShaderCacheDir(const String& path)
         shaderCacheDir_ = AddTrailingSlash(trimmedPath);
 }
 
+void Graphics::SetAsyncShaders(bool enable)
+{
+    asyncShaders_ = enable;
+}
+
+PipelineState* Graphics::GetPipelineState(const PipelineStateDesc& desc)
+{
+    HashMap<PipelineStateDesc, SharedPtr<PipelineState> >::ConstIterator i = pipelineStates_.Find(desc);
+    if (i != pipelineStates_.End())
+    {
+        i->second_->SetLastUseFrame(pipelineStateFrame_);
+        return i->second_;
+    }
+
+    SharedPtr<PipelineState> state(new PipelineState(desc, nextPipelineStateID_++));
+    state->SetLastUseFrame(pipelineStateFrame_);
+    pipelineStates_[desc] = state;
+    return state;
+}
+
+void Graphics::SetPipelineState(PipelineState* state)
+{
+    if (!state || state == pipelineState_)
+        return;
+
+    // The individual setters compare against the current state, so only what differs reaches the API
+    const PipelineStateDesc& desc = state->GetDesc();
+    SetShaders(desc.vertexShader_, desc.pixelShader_);
+    SetBlendMode(desc.blendMode_, desc.alphaToCoverage_);
+    SetDepthTest(desc.depthTestMode_);
+    SetDepthWrite(desc.depthWrite_);
+    SetCullMode(desc.cullMode_);
+    SetFillMode(desc.fillMode_);
+    SetLineAntiAlias(desc.lineAntiAlias_);
+
+    if (desc.hasDepthBias_)
+        SetDepthBias(desc.constantDepthBias_, desc.slopeScaledDepthBias_);
+
+    if (desc.hasStencil_)
+    {
+        SetStencilTest(desc.stencilTest_, desc.stencilTestMode_, desc.stencilPass_, desc.stencilFail_, desc.stencilZFail_,
+            desc.stencilRef_, desc.stencilCompareMask_, desc.stencilWriteMask_);
+    }
+
+    pipelineState_ = state;
+}
+
+void Graphics::CleanupPipelineStates(ShaderVariation* variation)
+{
+    for (HashMap<PipelineStateDesc, SharedPtr<PipelineState> >::Iterator i = pipelineStates_.Begin(); i != pipelineStates_.End();)
+    {
+        if (i->first_.vertexShader_ == variation || i->first_.pixelShader_ == variation)
+        {
+            if (i->second_ == pipelineState_)
+                pipelineState_ = nullptr;
+            i = pipelineStates_.Erase(i);
+        }
+        else
+            ++i;
+    }
+}
+
+void Graphics::CleanupPipelineStates()
+{
+    // Batches resolve their pipeline states every frame, so states that went unused are no longer referenced
+    for (HashMap<PipelineStateDesc, SharedPtr<PipelineState> >::Iterator i = pipelineStates_.Begin(); i != pipelineStates_.End();)
+    {
+        if (pipelineStateFrame_ - i->second_->GetLastUseFrame() > PIPELINE_STATE_MAX_AGE)
+        {
+            if (i->second_ == pipelineState_)
+                pipelineState_ = nullptr;
+            i = pipelineStates_.Erase(i);
+        }
+        else
+            ++i;
+    }
+
+    ++pipelineStateFrame_;
+}
+
 void Graphics::AddGPUObject(GPUObject* object)
 {
     MutexLock lock(gpuObjectMutex_);
@@ -437,6 +524,7 @@ void Graphics::CreateWindowIcon()
 void RegisterGraphicsLibrary(Context* context)
 {
     Animation::RegisterObject(context);
+    BakedAnimation::RegisterObject(context);
     Material::RegisterObject(context);
     Model::RegisterObject(context);
     Shader::RegisterObject(context);
@@ -451,6 +539,7 @@ void RegisterGraphicsLibrary(Context* context)
     ReflectionProbe::RegisterObject(context);
     StaticModel::RegisterObject(context);
     StaticModelGroup::RegisterObject(context);
+    BakedAnimatedModel::RegisterObject(context);
     Skybox::RegisterObject(context);
     AnimatedModel::RegisterObject(context);
     AnimationController::RegisterObject(context);
@@ -462,6 +551,8 @@ void RegisterGraphicsLibrary(Context* context)
     DecalSet::RegisterObject(context);
     Terrain::RegisterObject(context);
     TerrainPatch::RegisterObject(context);
+    StreamingTerrain::RegisterObject(context);
+    StreamingTerrainBlock::RegisterObject(context);
     DebugRenderer::RegisterObject(context);
     Octree::RegisterObject(context);
     Zone::RegisterObject(context);
@@ -28,6 +28,7 @@
 #include "../Core/Mutex.h"
 #include "../Core/Object.h"
 #include "../Graphics/GraphicsDefs.h"
+#include "../Graphics/PipelineState.h"
 #include "../Graphics/ShaderVariation.h"
 #include "../Math/Color.h"
 #include "../Math/Plane.h"
@@ -61,6 +62,9 @@ class VertexDeclaration;
 
 struct ShaderParameter;
 
+/// Default size of the uniform ring buffer in bytes.
+static const unsigned DEFAULT_UNIFORM_RING_SIZE = 6 * 1024 * 1024;
+
 /// CPU-side scratch buffer for vertex data updates.
 struct ScratchBuffer
 {
@@ -133,6 +137,8 @@ public:
     bool ResolveToTexture(Texture2D* texture);
     /// Resolve a multisampled cube texture on itself.
     bool ResolveToTexture(TextureCube* texture);
+    /// Copy a rectangle of a depth texture to the same place in another depth texture of the same format. Requires OpenGL 3.
+    bool CopyDepthRect(Texture2D* source, Texture2D* destination, const IntRect& rect);
     /// Draw non-indexed geometry.
     void Draw(PrimitiveType type, unsigned vertexStart, unsigned vertexCount);
     /// Draw indexed geometry.
@@ -145,6 +151,8 @@ public:
     /// Draw indexed, instanced geometry with vertex index offset.
     void DrawInstanced(PrimitiveType type, unsigned indexStart, unsigned indexCount, unsigned baseVertexIndex, unsigned minVertex,
         unsigned vertexCount, unsigned instanceCount);
+    /// Draw several ranges of the current index buffer with one multi-draw indirect call. An instancing vertex buffer must be set with zero instance offset; each command's base instance locates its instance data. Requires multi-draw indirect support.
+    void MultiDrawIndirect(PrimitiveType type, const IndirectDrawCommand* commands, unsigned count);
     /// Set vertex buffer.
     void SetVertexBuffer(VertexBuffer* buffer);
     /// Set multiple vertex buffers.
@@ -241,6 +249,10 @@ public:
     void SetStencilTest
         (bool enable, CompareMode mode = CMP_ALWAYS, StencilOp pass = OP_KEEP, StencilOp fail = OP_KEEP, StencilOp zFail = OP_KEEP,
             unsigned stencilRef = 0, unsigned compareMask = M_MAX_UNSIGNED, unsigned writeMask = M_MAX_UNSIGNED);
+    /// Return the pipeline state object for a description, creating it on first use.
+    PipelineState* GetPipelineState(const PipelineStateDesc& desc);
+    /// Set shaders and renderstates from a pipeline state object. Only the states that differ from the current ones are applied.
+    void SetPipelineState(PipelineState* state);
     /// Set a custom clipping plane. The plane is specified in world space, but is dependent on the view and projection matrices.
     void SetClipPlane(bool enable, const Plane& clipPlane = Plane::XZ, const Matrix3x4& view = Matrix3x4::IDENTITY,
         const Matrix4& projection = Matrix4::IDENTITY);
@@ -248,10 +260,14 @@ public:
     void BeginDumpShaders(const String& fileName);
     /// End dumping shader variations names.
     void EndDumpShaders();
-    /// Precache shader variations from an XML file generated with BeginDumpShaders().
-    void PrecacheShaders(Deserializer& source);
-    /// Set shader cache directory, Direct3D only. This can either be an absolute path or a path within the resource system.
+    /// Precache shader variations from an XML file generated with BeginDumpShaders(). With async, programs missing from the program binary cache are linked on a shared context in a background thread instead of stalling the caller.
+    void PrecacheShaders(Deserializer& source, bool async = false);
+    /// Set shader cache directory. On OpenGL it holds the program binary cache. This can either be an absolute path or a path within the resource system.
     void SetShaderCacheDir(const String& path);
+    /// Set whether new shader programs are compiled and linked in the background where supported. Check IsShaderProgramReady() before drawing to avoid stalling on them.
+    void SetAsyncShaders(bool enable);
+    /// Set size in bytes of the ring buffer that constant buffer data is streamed through on OpenGL 3, split between three frames in flight. 0 uploads each constant buffer separately. Default 6 MB.
+    void SetUniformRingSize(unsigned size);
 
     /// Return whether rendering initialized.
     bool IsInitialized() const;
@@ -338,6 +354,10 @@ public:
     bool GetSRGBSupport() const { return sRGBSupport_; }
     /// Return whether sRGB conversion on rendertarget writing is supported.
     bool GetSRGBWriteSupport() const { return sRGBWriteSupport_; }
+    /// Return whether the driver compiles and links shaders in parallel (KHR/ARB_parallel_shader_compile).
+    bool GetParallelShaderCompileSupport() const { return parallelShaderCompileSupport_; }
+    /// Return whether multi-draw indirect with base instances is supported (OpenGL 4.3.)
+    bool GetMultiDrawIndirectSupport() const { return multiDrawIndirectSupport_; }
 
     /// Return supported fullscreen resolutions (third component is refreshRate). Will be empty if listing the resolutions is not supported on the platform (e.g. Web).
     PODVector<IntVector3> GetResolutions(int monitor) const;
@@ -433,8 +453,20 @@ public:
     unsigned GetStencilWriteMask() const { return stencilWriteMask_; }
     /// Return whether a custom clipping plane is in use.
     bool GetUseClipPlane() const { return useClipPlane_; }
-    /// Return shader cache directory, Direct3D only.
+    /// Return shader cache directory.
     const String& GetShaderCacheDir() const { return shaderCacheDir_; }
+    /// Return whether new shader programs are compiled and linked in the background.
+    bool GetAsyncShaders() const { return asyncShaders_; }
+    /// Return size of the uniform ring buffer in bytes.
+    unsigned GetUniformRingSize() const { return uniformRingSize_; }
+    /// Return whether the program for a vertex and pixel shader pair can be used without stalling. Begins compiling it in the background when asynchronous shaders are enabled, otherwise always true.
+    bool IsShaderProgramReady(ShaderVariation* vs, ShaderVariation* ps);
+    /// Return number of shader programs being compiled and linked in the background.
+    unsigned GetNumPendingShaderPrograms() const;
+    /// Return pipeline state in use. Null if shaders or renderstates have been set individually since.
+    PipelineState* GetCurrentPipelineState() const { return pipelineState_; }
+    /// Return number of cached pipeline state objects.
+    unsigned GetNumPipelineStates() const { return pipelineStates_.Size(); }
     /// Return current rendertarget width and height.
     IntVector2 GetRenderTargetDimensions() const;
 
@@ -462,6 +494,10 @@ public:
     void CleanupScratchBuffers();
     /// Clean up shader parameters when a shader variation is released or destroyed.
     void CleanupShaderPrograms(ShaderVariation* variation);
+    /// Clean up pipeline state objects using a shader variation that is released or destroyed.
+    void CleanupPipelineStates(ShaderVariation* variation);
+    /// Clean up pipeline state objects that have not been used for a while, and advance the pipeline state frame number.
+    void CleanupPipelineStates();
     /// Clean up a render surface from all FBOs. Used only on OpenGL.
     void CleanupRenderSurface(RenderSurface* surface);
     /// Get or create a constant buffer. Will be shared between shaders if possible.
@@ -542,6 +578,20 @@ private:
     void ResetStreamFrequencies();
     /// Check supported rendering features.
     void CheckFeatureSupport();
+    /// Finish linking a shader program compiled in the background. Used only on OpenGL.
+    void FinishShaderProgram(ShaderProgram* program);
+    /// Finish the shader programs whose background compile is complete. Used only on OpenGL.
+    void UpdatePendingShaderPrograms();
+    /// Finish a shader program linked by the program binary thread, logging and remembering a failure. Used only on OpenGL.
+    void FinishProgramBinary(ShaderVariation* vs, ShaderVariation* ps, const String& fileName);
+    /// Create the uniform ring buffer. Used only on OpenGL.
+    void CreateUniformRing();
+    /// Release the uniform ring buffer. Used only on OpenGL.
+    void ReleaseUniformRing();
+    /// Move the uniform ring buffer to the next frame's part, waiting for the GPU if it still uses it. Used only on OpenGL.
+    void BeginUniformRingFrame();
+    /// Copy changed constant buffers into the uniform ring buffer and bind their ranges. Used only on OpenGL.
+    void ApplyUniformRing();
     /// Reset cached rendering state.
     void ResetCachedState();
     /// Initialize texture unit mappings.
@@ -635,6 +685,10 @@ private:
     bool sRGBSupport_{};
     /// sRGB conversion on write support flag.
     bool sRGBWriteSupport_{};
+    /// Parallel shader compile support flag.
+    bool parallelShaderCompileSupport_{};
+    /// Multi-draw indirect support flag.
+    bool multiDrawIndirectSupport_{};
     /// Number of primitives this frame.
     unsigned numPrimitives_{};
     /// Number of batches this frame.
@@ -725,8 +779,12 @@ private:
     const void* shaderParameterSources_[MAX_SHADER_PARAMETER_GROUPS]{};
     /// Base directory for shaders.
     String shaderPath_;
-    /// Cache directory for Direct3D binary shaders.
+    /// Cache directory for binary shaders.
     String shaderCacheDir_;
+    /// Asynchronous shader compile flag.
+    bool asyncShaders_{};
+    /// Uniform ring buffer size.
+    unsigned uniformRingSize_{ DEFAULT_UNIFORM_RING_SIZE };
     /// File extension for shaders.
     String shaderExtension_;
     /// Last used shader in shader variation query.
@@ -735,6 +793,14 @@ private:
     mutable String lastShaderName_;
     /// Shader precache utility.
     SharedPtr<ShaderPrecache> shaderPrecache_;
+    /// Cached pipeline state objects.
+    HashMap<PipelineStateDesc, SharedPtr<PipelineState> > pipelineStates_;
+    /// Pipeline state in use.
+    PipelineState* pipelineState_{};
+    /// Next pipeline state object ID.
+    unsigned nextPipelineStateID_{ 1 };
+    /// Frame number for pipeline state use tracking.
+    unsigned pipelineStateFrame_{};
     /// Allowed screen orientations.
     String orientations_;
     /// Graphics API name.
@@ -78,6 +78,7 @@ extern DRY_API const StringHash PSP_MATSPECCOLOR("MatSpecColor");
 extern DRY_API const StringHash PSP_NEARCLIP("NearClipPS");
 extern DRY_API const StringHash PSP_FARCLIP("FarClipPS");
 extern DRY_API const StringHash PSP_SHADOWCUBEADJUST("ShadowCubeAdjust");
+extern DRY_API const StringHash PSP_SHADOWCUBEFACESCALE("ShadowCubeFaceScale");
 extern DRY_API const StringHash PSP_SHADOWDEPTHFADE("ShadowDepthFade");
 extern DRY_API const StringHash PSP_SHADOWINTENSITY("ShadowIntensity");
 extern DRY_API const StringHash PSP_SHADOWMAPINVSIZE("ShadowMapInvSize");
@@ -90,6 +91,7 @@ extern DRY_API const StringHash PSP_LIGHTRAD("LightRad");
 extern DRY_API const StringHash PSP_LIGHTLENGTH("LightLength");
 extern DRY_API const StringHash PSP_ZONEMIN("ZoneMin");
 extern DRY_API const StringHash PSP_ZONEMAX("ZoneMax");
+extern DRY_API const StringHash PSP_CLUSTERPARAMS("ClusterParams");
 
 extern DRY_API const Vector3 DOT_SCALE(1 / 3.0f, 1 / 3.0f, 1 / 3.0f);
 
@@ -119,7 +121,8 @@ extern DRY_API const unsigned ELEMENT_TYPESIZES[] =
     3 * sizeof(float),
     4 * sizeof(float),
     sizeof(unsigned),
-    sizeof(unsigned)
+    sizeof(unsigned),
+    2 * sizeof(unsigned short)
 };
 
 
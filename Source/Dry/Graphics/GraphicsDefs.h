@@ -62,9 +62,10 @@ enum GeometryType
     GEOM_DIRBILLBOARD = 4,
     GEOM_TRAIL_FACE_CAMERA = 5,
     GEOM_TRAIL_BONE = 6,
-    MAX_GEOMETRYTYPES = 7,
+    GEOM_SKINNED_INSTANCED = 7,
+    MAX_GEOMETRYTYPES = 8,
     // This is not a real geometry type for VS, but used to mark objects that do not desire to be instanced
-    GEOM_STATIC_NOINSTANCING = 7,
+    GEOM_STATIC_NOINSTANCING = 8,
 };
 
 /// Blending mode.
@@ -162,6 +163,7 @@ enum VertexElementType
     TYPE_VECTOR4,
     TYPE_UBYTE4,
     TYPE_UBYTE4_NORM,
+    TYPE_HALF2,
     MAX_VERTEX_ELEMENT_TYPES
 };
 
@@ -221,6 +223,21 @@ struct DRY_API VertexElement
     unsigned offset_;
 };
 
+/// Indexed draw command of a multi-draw indirect call. Laid out as the GPU reads it.
+struct IndirectDrawCommand
+{
+    /// Number of indices.
+    unsigned indexCount_;
+    /// Number of instances.
+    unsigned instanceCount_;
+    /// First index.
+    unsigned indexStart_;
+    /// Value added to the indices.
+    int baseVertex_;
+    /// First instance in the instancing vertex buffer.
+    unsigned baseInstance_;
+};
+
 /// Sizes of vertex element types.
 extern DRY_API const unsigned ELEMENT_TYPESIZES[];
 
@@ -339,8 +356,9 @@ enum TextureUnit
     TU_DEPTHBUFFER = 13,
     TU_LIGHTBUFFER = 14,
     TU_ZONE = 15,
+    TU_SKINMAP = 16,
     MAX_MATERIAL_TEXTURE_UNITS = 8,
-    MAX_TEXTURE_UNITS = 16
+    MAX_TEXTURE_UNITS = 17
 #else
     TU_LIGHTRAMP = 5,
     TU_LIGHTSHAPE = 6,
@@ -418,6 +436,7 @@ extern DRY_API const StringHash PSP_MATSPECCOLOR;
 extern DRY_API const StringHash PSP_NEARCLIP;
 extern DRY_API const StringHash PSP_FARCLIP;
 extern DRY_API const StringHash PSP_SHADOWCUBEADJUST;
+extern DRY_API const StringHash PSP_SHADOWCUBEFACESCALE;
 extern DRY_API const StringHash PSP_SHADOWDEPTHFADE;
 extern DRY_API const StringHash PSP_SHADOWINTENSITY;
 extern DRY_API const StringHash PSP_SHADOWMAPINVSIZE;
@@ -430,6 +449,7 @@ extern DRY_API const StringHash PSP_LIGHTRAD;
 extern DRY_API const StringHash PSP_LIGHTLENGTH;
 extern DRY_API const StringHash PSP_ZONEMIN;
 extern DRY_API const StringHash PSP_ZONEMAX;
+extern DRY_API const StringHash PSP_CLUSTERPARAMS;
 
 // Scale calculation from bounding box diagonal.
 extern DRY_API const Vector3 DOT_SCALE;
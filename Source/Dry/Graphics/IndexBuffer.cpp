@@ -39,6 +39,7 @@ IndexBuffer::IndexBuffer(Context* context, bool forceHeadless) :
     GPUObject(forceHeadless ? nullptr : GetSubsystem<Graphics>()),
     indexCount_(0),
     indexSize_(0),
+    dataVersion_(0),
     lockState_(LOCK_NONE),
     lockStart_(0),
     lockCount_(0),
@@ -81,6 +82,7 @@ bool IndexBuffer::SetSize(unsigned indexCount, bool largeIndices, bool dynamic)
     indexCount_ = indexCount;
     indexSize_ = (unsigned)(largeIndices ? sizeof(unsigned) : sizeof(unsigned short));
     dynamic_ = dynamic;
+    ++dataVersion_;
 
     if (shadowed_ && indexCount_ && indexSize_)
         shadowData_ = new unsigned char[indexCount_ * indexSize_];
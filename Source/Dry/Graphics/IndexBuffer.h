@@ -86,6 +86,9 @@ public:
     /// Return shared array pointer to the CPU memory shadow data.
     SharedArrayPtr<unsigned char> GetShadowDataShared() const { return shadowData_; }
 
+    /// Return data version, which changes whenever the data or size is set.
+    unsigned GetDataVersion() const { return dataVersion_; }
+
 private:
     /// Create buffer.
     bool Create();
@@ -102,6 +105,8 @@ private:
     unsigned indexCount_;
     /// Index size.
     unsigned indexSize_;
+    /// Data version.
+    unsigned dataVersion_;
     /// Buffer locking state.
     LockState lockState_;
     /// Lock start vertex.
@@ -0,0 +1,380 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+// Copyright (c) 2020-2023 LucKey Productions.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Core/Context.h"
+#include "../Core/Profiler.h"
+#include "../Core/WorkQueue.h"
+#include "../Graphics/Camera.h"
+#include "../Graphics/Graphics.h"
+#include "../Graphics/Light.h"
+#include "../Graphics/LightClusters.h"
+#include "../Graphics/Texture2D.h"
+#include "../IO/Log.h"
+#include "../Scene/Node.h"
+
+#ifdef DRY_SSE
+#include <xmmintrin.h>
+#endif
+
+#include "../DebugNew.h"
+
+namespace Dry
+{
+
+/// Smallest near clip distance used for the depth slices, relative to the far clip distance.
+static const float MIN_CLUSTER_NEAR_RATIO = 0.0001f;
+
+void AssignLightClustersWork(const WorkItem* item, unsigned /*threadIndex*/)
+{
+    auto* clusters = reinterpret_cast<LightClusters*>(item->aux_);
+    auto* start = reinterpret_cast<LightClusterSlice*>(item->start_);
+    auto* end = reinterpret_cast<LightClusterSlice*>(item->end_);
+
+    while (start != end)
+        clusters->AssignSlice(*start++);
+}
+
+/// Return the view-space coordinate at a depth that projects to a normalized device coordinate along one axis.
+static inline float UnprojectAxis(float ndc, float depth, float scale, float depthOffset, float offset, const Matrix4& projection)
+{
+    return (ndc * (projection.m32_ * depth + projection.m33_) - depthOffset * depth - offset) / scale;
+}
+
+LightClusters::LightClusters(Context* context) :
+    Object(context),
+    numClusters_(DEFAULT_LIGHT_CLUSTERS_X, DEFAULT_LIGHT_CLUSTERS_Y, DEFAULT_LIGHT_CLUSTERS_Z),
+    numLights_(0),
+    numLightIndices_(0)
+{
+}
+
+LightClusters::~LightClusters() = default;
+
+void LightClusters::SetNumClusters(const IntVector3& num)
+{
+    numClusters_ = IntVector3(Max(num.x_, 1), Max(num.y_, 1), Max(num.z_, 1));
+}
+
+bool LightClusters::Update(Camera* camera, const PODVector<Light*>& lights, bool flipVertical)
+{
+    DRY_PROFILE(UpdateLightClusters);
+
+    if (!camera || !CreateTextures())
+        return false;
+
+    numLights_ = Min(lights.Size(), MAX_CLUSTERED_LIGHTS);
+    if (lights.Size() > MAX_CLUSTERED_LIGHTS)
+        DRY_LOGWARNINGF("Too many clustered lights, leaving out %u", lights.Size() - MAX_CLUSTERED_LIGHTS);
+
+    const Matrix3x4& view = camera->GetView();
+    projection_ = camera->GetProjection();
+    // A flipped projection mirrors the rows of clusters
+    if (flipVertical && !camera->GetFlipVertical())
+    {
+        projection_.m10_ = -projection_.m10_;
+        projection_.m11_ = -projection_.m11_;
+        projection_.m12_ = -projection_.m12_;
+        projection_.m13_ = -projection_.m13_;
+    }
+
+    // Gather the light data and the view-space bounding spheres
+    lightSpheres_.Resize(numLights_);
+    lightData_.Resize(Max(numLights_, 1u) * 4);
+
+    for (unsigned i{ 0 }; i < numLights_; ++i)
+    {
+        Light* light = lights[i];
+        Node* lightNode = light->GetNode();
+        const Vector3 position = lightNode->GetWorldPosition();
+        const Vector3 direction = lightNode->GetWorldDirection();
+        const float range = Max(light->GetRange(), M_EPSILON);
+
+        // Point lights get a cutoff below any cosine, so that the shader's spot term is always one
+        float cutoff = -2.0f;
+        float invCutoff = 1.0f;
+        Vector3 center = position;
+        float radius = range;
+
+        if (light->GetLightType() == LIGHT_SPOT)
+        {
+            const float halfFov = light->GetFov() * 0.5f;
+            cutoff = Cos(halfFov);
+            invCutoff = 1.0f / (1.0f - cutoff);
+
+            // Bound the cone: narrow cones by the sphere through the apex and base circle, wide ones by the base circle
+            const float baseRadius = range * Tan(halfFov);
+            if (baseRadius <= range)
+            {
+                radius = (range * range + baseRadius * baseRadius) / (2.0f * range);
+                center = position + direction * radius;
+            }
+            else
+            {
+                radius = baseRadius;
+                center = position + direction * range;
+            }
+        }
+
+        lightSpheres_[i] = Vector4(view * center, radius);
+
+        float fade = 1.0f;
+        const float fadeEnd = light->GetDrawDistance();
+        const float fadeStart = light->GetFadeDistance();
+        // Do fade calculation for light if both fade & draw distance defined
+        if (fadeEnd > 0.0f && fadeStart > 0.0f && fadeStart < fadeEnd)
+            fade = Min(1.0f - (light->GetDistance() - fadeStart) / (fadeEnd - fadeStart), 1.0f);
+
+        const Color color = light->GetEffectiveColor() * fade;
+        lightData_[i * 4] = Vector4(position, 1.0f / range);
+        lightData_[i * 4 + 1] = Vector4(color.r_, color.g_, color.b_, light->GetEffectiveSpecularIntensity());
+        lightData_[i * 4 + 2] = Vector4(-direction, cutoff);
+        lightData_[i * 4 + 3] = Vector4(invCutoff, 0.0f, 0.0f, 0.0f);
+    }
+
+    // Slice the depth range exponentially, so that clusters stay roughly cube-shaped
+    const float farClip = camera->GetFarClip();
+    const float nearClip = Max(camera->GetNearClip(), farClip * MIN_CLUSTER_NEAR_RATIO);
+    const float depthRatio = farClip / nearClip;
+    const auto numSlices = (unsigned)numClusters_.z_;
+    slices_.Resize(numSlices);
+
+    for (unsigned i{ 0 }; i < numSlices; ++i)
+    {
+        slices_[i].near_ = i ? nearClip * Pow(depthRatio, (float)i / numSlices) : 0.0f;
+        slices_[i].far_ = i < numSlices - 1 ? nearClip * Pow(depthRatio, (float)(i + 1) / numSlices) : farClip;
+    }
+
+    // Shaders find the slice from depth normalized by the far clip distance
+    clusterParams_ = Vector4((float)numClusters_.x_, (float)numClusters_.y_, numSlices / Ln(depthRatio), (float)numSlices);
+
+    {
+        DRY_PROFILE(AssignLightClusters);
+
+        auto* queue = GetSubsystem<WorkQueue>();
+        for (unsigned i{ 0 }; i < numSlices; ++i)
+        {
+            SharedPtr<WorkItem> item = queue->GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = AssignLightClustersWork;
+            item->aux_ = this;
+            item->start_ = &slices_[i];
+            item->end_ = &slices_[i] + 1;
+            queue->AddWorkItem(item);
+        }
+
+        queue->Complete(M_MAX_UNSIGNED);
+    }
+
+    // Combine the slices' light indices
+    const unsigned clustersPerSlice = numClusters_.x_ * numClusters_.y_;
+    gridData_.Resize(clustersPerSlice * numSlices * 2);
+    indexData_.Clear();
+    numLightIndices_ = 0;
+
+    for (unsigned i{ 0 }; i < numSlices; ++i)
+    {
+        const LightClusterSlice& slice = slices_[i];
+        unsigned sliceIndex = 0;
+
+        for (unsigned j{ 0 }; j < clustersPerSlice; ++j)
+        {
+            const unsigned count = Min(slice.clusterCounts_[j], MAX_CLUSTER_LIGHT_INDICES - numLightIndices_);
+            gridData_[(i * clustersPerSlice + j) * 2] = (float)numLightIndices_;
+            gridData_[(i * clustersPerSlice + j) * 2 + 1] = (float)count;
+
+            for (unsigned k{ 0 }; k < count; ++k)
+                indexData_.Push((float)slice.lightIndices_[sliceIndex + k]);
+
+            sliceIndex += slice.clusterCounts_[j];
+            numLightIndices_ += count;
+        }
+    }
+
+    if (numLightIndices_ == MAX_CLUSTER_LIGHT_INDICES)
+        DRY_LOGWARNING("Light cluster index limit reached, some lights are left out");
+
+    // Upload only the used rows
+    const unsigned indexRows = Max((numLightIndices_ + CLUSTER_INDEX_TEXTURE_WIDTH - 1) / CLUSTER_INDEX_TEXTURE_WIDTH, 1u);
+    indexData_.Resize(indexRows * CLUSTER_INDEX_TEXTURE_WIDTH);
+
+    return lightTexture_->SetData(0, 0, 0, 4, Max(numLights_, 1u), &lightData_[0]) &&
+        gridTexture_->SetData(0, 0, 0, clustersPerSlice, numSlices, &gridData_[0]) &&
+        indexTexture_->SetData(0, 0, 0, CLUSTER_INDEX_TEXTURE_WIDTH, indexRows, &indexData_[0]);
+}
+
+void LightClusters::AssignSlice(LightClusterSlice& slice) const
+{
+    const unsigned clustersX = numClusters_.x_;
+    const unsigned clustersY = numClusters_.y_;
+    slice.lightIndices_.Clear();
+    slice.clusterCounts_.Resize(clustersX * clustersY);
+    slice.candidates_.Clear();
+
+    // Find the lights overlapping the slice's depth range
+    for (unsigned i{ 0 }; i < numLights_; ++i)
+    {
+        const Vector4& sphere = lightSpheres_[i];
+        if (sphere.z_ + sphere.w_ >= slice.near_ && sphere.z_ - sphere.w_ <= slice.far_)
+            slice.candidates_.Push(i);
+    }
+
+    // Lay out the candidates for testing four at a time. Padding gets a negative squared radius to never pass
+    const unsigned numCandidates = slice.candidates_.Size();
+    const unsigned stride = (numCandidates + 3) & ~3u;
+    slice.candidateSpheres_.Resize(Max(stride * 4, 4u));
+    float* sphereX = &slice.candidateSpheres_[0];
+    float* sphereY = sphereX + stride;
+    float* sphereZ = sphereY + stride;
+    float* radiusSquared = sphereZ + stride;
+
+    for (unsigned i{ 0 }; i < stride; ++i)
+    {
+        if (i < numCandidates)
+        {
+            const Vector4& sphere = lightSpheres_[slice.candidates_[i]];
+            sphereX[i] = sphere.x_;
+            sphereY[i] = sphere.y_;
+            sphereZ[i] = sphere.z_;
+            radiusSquared[i] = sphere.w_ * sphere.w_;
+        }
+        else
+        {
+            sphereX[i] = sphereY[i] = sphereZ[i] = 0.0f;
+            radiusSquared[i] = -1.0f;
+        }
+    }
+
+    for (unsigned y{ 0 }; y < clustersY; ++y)
+    {
+        const float bottom = -1.0f + 2.0f * y / clustersY;
+        const float top = -1.0f + 2.0f * (y + 1) / clustersY;
+
+        for (unsigned x{ 0 }; x < clustersX; ++x)
+        {
+            unsigned& count = slice.clusterCounts_[y * clustersX + x];
+            count = 0;
+            if (!numCandidates)
+                continue;
+
+            // View-space bounding box of the cluster's part of the frustum
+            const float left = -1.0f + 2.0f * x / clustersX;
+            const float right = -1.0f + 2.0f * (x + 1) / clustersX;
+            float corners[4];
+
+            corners[0] = UnprojectAxis(left, slice.near_, projection_.m00_, projection_.m02_, projection_.m03_, projection_);
+            corners[1] = UnprojectAxis(right, slice.near_, projection_.m00_, projection_.m02_, projection_.m03_, projection_);
+            corners[2] = UnprojectAxis(left, slice.far_, projection_.m00_, projection_.m02_, projection_.m03_, projection_);
+            corners[3] = UnprojectAxis(right, slice.far_, projection_.m00_, projection_.m02_, projection_.m03_, projection_);
+            const float minX = Min(Min(corners[0], corners[1]), Min(corners[2], corners[3]));
+            const float maxX = Max(Max(corners[0], corners[1]), Max(corners[2], corners[3]));
+
+            corners[0] = UnprojectAxis(bottom, slice.near_, projection_.m11_, projection_.m12_, projection_.m13_, projection_);
+            corners[1] = UnprojectAxis(top, slice.near_, projection_.m11_, projection_.m12_, projection_.m13_, projection_);
+            corners[2] = UnprojectAxis(bottom, slice.far_, projection_.m11_, projection_.m12_, projection_.m13_, projection_);
+            corners[3] = UnprojectAxis(top, slice.far_, projection_.m11_, projection_.m12_, projection_.m13_, projection_);
+            const float minY = Min(Min(corners[0], corners[1]), Min(corners[2], corners[3]));
+            const float maxY = Max(Max(corners[0], corners[1]), Max(corners[2], corners[3]));
+
+#ifdef DRY_SSE
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 boxMinX = _mm_set1_ps(minX);
+            const __m128 boxMaxX = _mm_set1_ps(maxX);
+            const __m128 boxMinY = _mm_set1_ps(minY);
+            const __m128 boxMaxY = _mm_set1_ps(maxY);
+            const __m128 boxMinZ = _mm_set1_ps(slice.near_);
+            const __m128 boxMaxZ = _mm_set1_ps(slice.far_);
+
+            for (unsigned i{ 0 }; i < stride; i += 4)
+            {
+                // Squared distance from the sphere centers to the box
+                const __m128 centerX = _mm_loadu_ps(sphereX + i);
+                const __m128 centerY = _mm_loadu_ps(sphereY + i);
+                const __m128 centerZ = _mm_loadu_ps(sphereZ + i);
+                const __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(boxMinX, centerX), _mm_sub_ps(centerX, boxMaxX)), zero);
+                const __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(boxMinY, centerY), _mm_sub_ps(centerY, boxMaxY)), zero);
+                const __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(boxMinZ, centerZ), _mm_sub_ps(centerZ, boxMaxZ)), zero);
+                const __m128 distSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+                int mask = _mm_movemask_ps(_mm_cmple_ps(distSquared, _mm_loadu_ps(radiusSquared + i)));
+                for (unsigned j{ 0 }; mask; ++j, mask >>= 1)
+                {
+                    if (mask & 1)
+                    {
+                        slice.lightIndices_.Push(slice.candidates_[i + j]);
+                        ++count;
+                    }
+                }
+            }
+#else
+            for (unsigned i{ 0 }; i < numCandidates; ++i)
+            {
+                const float dx = Max(Max(minX - sphereX[i], sphereX[i] - maxX), 0.0f);
+                const float dy = Max(Max(minY - sphereY[i], sphereY[i] - maxY), 0.0f);
+                const float dz = Max(Max(slice.near_ - sphereZ[i], sphereZ[i] - slice.far_), 0.0f);
+                if (dx * dx + dy * dy + dz * dz <= radiusSquared[i])
+                {
+                    slice.lightIndices_.Push(slice.candidates_[i]);
+                    ++count;
+                }
+            }
+#endif
+        }
+    }
+}
+
+bool LightClusters::CreateTextures()
+{
+    const int gridWidth = numClusters_.x_ * numClusters_.y_;
+    if (lightTexture_ && gridTexture_->GetWidth() == gridWidth && gridTexture_->GetHeight() == numClusters_.z_)
+        return true;
+
+    lightTexture_ = new Texture2D(context_);
+    gridTexture_ = new Texture2D(context_);
+    indexTexture_ = new Texture2D(context_);
+
+    Texture2D* textures[] = { lightTexture_, gridTexture_, indexTexture_ };
+    for (Texture2D* texture : textures)
+    {
+        texture->SetNumLevels(1);
+        texture->SetFilterMode(FILTER_NEAREST);
+    }
+
+    if (!lightTexture_->SetSize(4, MAX_CLUSTERED_LIGHTS, Graphics::GetRGBAFloat32Format(), TEXTURE_DYNAMIC) ||
+        !gridTexture_->SetSize(gridWidth, numClusters_.z_, Graphics::GetRGFloat32Format(), TEXTURE_DYNAMIC) ||
+        !indexTexture_->SetSize(CLUSTER_INDEX_TEXTURE_WIDTH, MAX_CLUSTER_LIGHT_INDICES / CLUSTER_INDEX_TEXTURE_WIDTH,
+            Graphics::GetFloat32Format(), TEXTURE_DYNAMIC))
+    {
+        DRY_LOGERROR("Failed to create light cluster textures");
+        lightTexture_.Reset();
+        gridTexture_.Reset();
+        indexTexture_.Reset();
+        return false;
+    }
+
+    return true;
+}
+
+}
@@ -0,0 +1,142 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+// Copyright (c) 2020-2023 LucKey Productions.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Container/Ptr.h"
+#include "../Core/Object.h"
+#include "../Math/Matrix4.h"
+#include "../Math/Vector4.h"
+
+namespace Dry
+{
+
+class Camera;
+class Light;
+class Texture2D;
+
+/// Default number of light clusters along the view width.
+static const int DEFAULT_LIGHT_CLUSTERS_X = 16;
+/// Default number of light clusters along the view height.
+static const int DEFAULT_LIGHT_CLUSTERS_Y = 8;
+/// Default number of light cluster depth slices.
+static const int DEFAULT_LIGHT_CLUSTERS_Z = 24;
+/// Maximum number of clustered lights in a view.
+static const unsigned MAX_CLUSTERED_LIGHTS = 1024;
+/// Width of the cluster light index texture.
+static const unsigned CLUSTER_INDEX_TEXTURE_WIDTH = 1024;
+/// Maximum number of light indices in all clusters combined.
+static const unsigned MAX_CLUSTER_LIGHT_INDICES = CLUSTER_INDEX_TEXTURE_WIDTH * 256;
+
+/// Depth slice of the light cluster grid.
+struct LightClusterSlice
+{
+    /// View-space near depth.
+    float near_{};
+    /// View-space far depth.
+    float far_{};
+    /// Light indices of the slice's clusters, one cluster after another.
+    PODVector<unsigned> lightIndices_;
+    /// Number of light indices for each cluster of the slice.
+    PODVector<unsigned> clusterCounts_;
+    /// Lights overlapping the slice.
+    PODVector<unsigned> candidates_;
+    /// View-space bounding spheres of the overlapping lights as X, Y, Z and squared radius arrays, padded to a multiple of four.
+    PODVector<float> candidateSpheres_;
+};
+
+/// Clustered light assignment. Divides a camera's view frustum into a grid of screen tiles and exponential depth slices, and lists for each cluster the lights whose bounding sphere touches it, so that all lights can be applied in a single shader pass.
+class DRY_API LightClusters : public Object
+{
+    DRY_OBJECT(LightClusters, Object);
+
+public:
+    /// Construct.
+    explicit LightClusters(Context* context);
+    /// Destruct.
+    ~LightClusters() override;
+
+    /// Set number of clusters along the view width, height and depth.
+    void SetNumClusters(const IntVector3& num);
+    /// Assign point and spot lights to the clusters of a camera using worker threads, and upload the result to the cluster textures. Pass whether the camera's projection will be flipped vertically when rendering, so that the clusters match the screen positions. Lights beyond the maximum are left out. Return true on success.
+    bool Update(Camera* camera, const PODVector<Light*>& lights, bool flipVertical = false);
+    /// Assign lights to the clusters of one depth slice. Called from worker threads.
+    void AssignSlice(LightClusterSlice& slice) const;
+
+    /// Return number of clusters along the view width, height and depth.
+    const IntVector3& GetNumClusters() const { return numClusters_; }
+
+    /// Return number of lights in the clusters.
+    unsigned GetNumLights() const { return numLights_; }
+
+    /// Return number of light indices in all clusters combined.
+    unsigned GetNumLightIndices() const { return numLightIndices_; }
+
+    /// Return shader parameters: number of clusters horizontally and vertically, and the scale and bias that turn the logarithm of normalized depth into a depth slice.
+    const Vector4& GetClusterParams() const { return clusterParams_; }
+
+    /// Return light data texture. Each row holds one light's position, color, direction and spot cutoff.
+    Texture2D* GetLightTexture() const { return lightTexture_; }
+
+    /// Return cluster texture. Holds the offset and number of light indices of each cluster, one depth slice per row.
+    Texture2D* GetGridTexture() const { return gridTexture_; }
+
+    /// Return light index texture.
+    Texture2D* GetIndexTexture() const { return indexTexture_; }
+
+private:
+    /// Create the textures if not created yet or if the number of clusters changed. Return true on success.
+    bool CreateTextures();
+
+    /// Number of clusters along the view width, height and depth.
+    IntVector3 numClusters_;
+    /// Projection of the camera being processed.
+    Matrix4 projection_;
+    /// Shader parameters.
+    Vector4 clusterParams_;
+    /// View-space bounding sphere centers and radii of the lights.
+    PODVector<Vector4> lightSpheres_;
+    /// Light data for the light texture.
+    PODVector<Vector4> lightData_;
+    /// Offset and count pairs for the cluster texture.
+    PODVector<float> gridData_;
+    /// Combined light indices for the light index texture.
+    PODVector<float> indexData_;
+    /// Depth slices.
+    Vector<LightClusterSlice> slices_;
+    /// Light data texture.
+    SharedPtr<Texture2D> lightTexture_;
+    /// Cluster texture.
+    SharedPtr<Texture2D> gridTexture_;
+    /// Light index texture.
+    SharedPtr<Texture2D> indexTexture_;
+    /// Number of lights in the clusters.
+    unsigned numLights_;
+    /// Number of light indices in all clusters combined.
+    unsigned numLightIndices_;
+};
+
+}
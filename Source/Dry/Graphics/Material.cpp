@@ -70,6 +70,7 @@ static const char* textureUnitNames[] =
     "depth",
     "light",
     "zone",
+    "skin",
     nullptr
 #else
     "lightramp",
@@ -1183,6 +1184,21 @@ void Material::MarkForAuxView(unsigned frameNumber)
     auxViewFrameNumber_ = frameNumber;
 }
 
+void Material::UpdateTextureStreaming(float distance, float screenSize)
+{
+    UpdateStreamingDistance(distance);
+
+    for (HashMap<TextureUnit, SharedPtr<Texture> >::ConstIterator i = textures_.Begin(); i != textures_.End(); ++i)
+    {
+        Texture* texture = i->second_;
+        if (texture)
+        {
+            texture->UpdateStreamingDistance(distance);
+            texture->UpdateStreamingScreenSize(screenSize);
+        }
+    }
+}
+
 const TechniqueEntry& Material::GetTechniqueEntry(unsigned index) const
 {
     return index < techniques_.Size() ? techniques_[index] : noEntry;
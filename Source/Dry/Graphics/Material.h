@@ -184,6 +184,8 @@ public:
     void SortTechniques();
     /// Mark material for auxiliary view rendering.
     void MarkForAuxView(unsigned frameNumber);
+    /// Report the view distance and screen size in pixels the material and its textures are needed at this frame, for resource streaming.
+    void UpdateTextureStreaming(float distance, float screenSize);
 
     /// Return number of techniques.
     unsigned GetNumTechniques() const { return techniques_.Size(); }
@@ -0,0 +1,576 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+// Copyright (c) 2020-2023 LucKey Productions.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Container/Sort.h"
+#include "../Graphics/MeshOptimizer.h"
+#include "../Math/Vector3.h"
+
+#include "../DebugNew.h"
+
+namespace Dry
+{
+
+/// Modeled LRU cache size of the vertex cache optimisation.
+static const unsigned FORSYTH_CACHE_SIZE = 32;
+
+/// Vertex cache optimisation state of a vertex.
+struct ForsythVertex
+{
+    /// First index in the vertex triangle list.
+    unsigned firstTriangle_;
+    /// Number of triangles not yet added.
+    unsigned numActiveTriangles_;
+    /// Position in the modeled cache, or -1 if not in the cache.
+    int cachePosition_;
+    /// Score.
+    float score_;
+};
+
+/// Return the vertex cache optimisation score of a vertex.
+static float CalculateForsythScore(const ForsythVertex& vertex)
+{
+    // Linear-Speed Vertex Cache Optimisation by Tom Forsyth
+    const float cacheDecayPower = 1.5f;
+    const float lastTriScore = 0.75f;
+    const float valenceBoostScale = 2.0f;
+    const float valenceBoostPower = 0.5f;
+
+    if (!vertex.numActiveTriangles_)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (vertex.cachePosition_ >= 0)
+    {
+        // Vertices of the last triangle get the same score, regardless of their order within it
+        if (vertex.cachePosition_ < 3)
+            score = lastTriScore;
+        else
+            score = powf(1.0f - (vertex.cachePosition_ - 3) * (1.0f / (FORSYTH_CACHE_SIZE - 3)), cacheDecayPower);
+    }
+
+    // Bonus points for a low number of triangles still to use the vertex, to get rid of lone vertices quickly
+    return score + valenceBoostScale * powf((float)vertex.numActiveTriangles_, -valenceBoostPower);
+}
+
+/// Overdraw optimization cluster.
+struct OverdrawCluster
+{
+    /// First triangle.
+    unsigned start_;
+    /// Number of triangles.
+    unsigned count_;
+    /// Sort key. Higher is drawn first.
+    float sortKey_;
+};
+
+/// Compare overdraw clusters by sort key.
+static bool CompareOverdrawClusters(const OverdrawCluster& lhs, const OverdrawCluster& rhs)
+{
+    return lhs.sortKey_ > rhs.sortKey_;
+}
+
+VertexCacheStatistics AnalyzeVertexCache(const unsigned* indices, unsigned indexCount, unsigned vertexCount, unsigned cacheSize)
+{
+    VertexCacheStatistics stats;
+    if (!indices || !vertexCount || !cacheSize)
+        return stats;
+
+    // Timestamps of the vertices entering the FIFO cache
+    PODVector<unsigned> cacheTimes(vertexCount);
+    for (unsigned i{ 0 }; i < vertexCount; ++i)
+        cacheTimes[i] = 0;
+
+    unsigned time = cacheSize + 1;
+    for (unsigned i{ 0 }; i < indexCount; ++i)
+    {
+        const unsigned index = indices[i];
+        if (index >= vertexCount)
+            continue;
+
+        if (!cacheTimes[index])
+            ++stats.numVertices_;
+
+        if (!cacheTimes[index] || time - cacheTimes[index] > cacheSize)
+        {
+            cacheTimes[index] = time++;
+            ++stats.numMisses_;
+        }
+    }
+
+    stats.numTriangles_ = indexCount / 3;
+    return stats;
+}
+
+void OptimizeVertexCache(unsigned* indices, unsigned indexCount, unsigned vertexCount)
+{
+    const unsigned numTriangles = indexCount / 3;
+    if (!indices || numTriangles < 2 || !vertexCount)
+        return;
+
+    for (unsigned i{ 0 }; i < numTriangles * 3; ++i)
+    {
+        if (indices[i] >= vertexCount)
+            return;
+    }
+
+    // Build the triangle lists of the vertices
+    PODVector<ForsythVertex> vertices(vertexCount);
+    for (unsigned i{ 0 }; i < vertexCount; ++i)
+    {
+        vertices[i].numActiveTriangles_ = 0;
+        vertices[i].cachePosition_ = -1;
+    }
+
+    for (unsigned i{ 0 }; i < numTriangles * 3; ++i)
+        ++vertices[indices[i]].numActiveTriangles_;
+
+    unsigned firstTriangle{ 0 };
+    for (unsigned i{ 0 }; i < vertexCount; ++i)
+    {
+        vertices[i].firstTriangle_ = firstTriangle;
+        firstTriangle += vertices[i].numActiveTriangles_;
+        vertices[i].numActiveTriangles_ = 0;
+    }
+
+    PODVector<unsigned> vertexTriangles(numTriangles * 3);
+    for (unsigned i{ 0 }; i < numTriangles * 3; ++i)
+    {
+        ForsythVertex& vertex = vertices[indices[i]];
+        vertexTriangles[vertex.firstTriangle_ + vertex.numActiveTriangles_++] = i / 3;
+    }
+
+    for (unsigned i{ 0 }; i < vertexCount; ++i)
+        vertices[i].score_ = CalculateForsythScore(vertices[i]);
+
+    PODVector<float> triangleScores(numTriangles);
+    PODVector<unsigned char> triangleAdded(numTriangles);
+    for (unsigned i{ 0 }; i < numTriangles; ++i)
+    {
+        triangleScores[i] = vertices[indices[i * 3]].score_ + vertices[indices[i * 3 + 1]].score_ + vertices[indices[i * 3 + 2]].score_;
+        triangleAdded[i] = 0;
+    }
+
+    PODVector<unsigned> newIndices(numTriangles * 3);
+    PODVector<unsigned> cache;
+    PODVector<unsigned> newCache;
+    cache.Reserve(FORSYTH_CACHE_SIZE + 3);
+    newCache.Reserve(FORSYTH_CACHE_SIZE + 3);
+
+    unsigned bestTriangle = M_MAX_UNSIGNED;
+    unsigned scanStart{ 0 };
+
+    for (unsigned i{ 0 }; i < numTriangles; ++i)
+    {
+        // When no triangle of the cached vertices remains, continue from the first triangle not yet added
+        if (bestTriangle == M_MAX_UNSIGNED)
+        {
+            while (triangleAdded[scanStart])
+                ++scanStart;
+            bestTriangle = scanStart;
+        }
+
+        const unsigned* triangle = &indices[bestTriangle * 3];
+        newIndices[i * 3] = triangle[0];
+        newIndices[i * 3 + 1] = triangle[1];
+        newIndices[i * 3 + 2] = triangle[2];
+        triangleAdded[bestTriangle] = 1;
+
+        // Remove the triangle from its vertices' active triangles and move the vertices to the front of the cache
+        newCache.Clear();
+        for (unsigned j{ 0 }; j < 3; ++j)
+        {
+            ForsythVertex& vertex = vertices[triangle[j]];
+            unsigned* begin = &vertexTriangles[vertex.firstTriangle_];
+            for (unsigned k{ 0 }; k < vertex.numActiveTriangles_; ++k)
+            {
+                if (begin[k] == bestTriangle)
+                {
+                    begin[k] = begin[--vertex.numActiveTriangles_];
+                    break;
+                }
+            }
+
+            if (!newCache.Contains(triangle[j]))
+                newCache.Push(triangle[j]);
+        }
+
+        for (unsigned j{ 0 }; j < cache.Size(); ++j)
+        {
+            if (!newCache.Contains(cache[j]))
+                newCache.Push(cache[j]);
+        }
+
+        // Vertices pushed out of the cache lose their cache score
+        for (unsigned j{ FORSYTH_CACHE_SIZE }; j < newCache.Size(); ++j)
+        {
+            ForsythVertex& vertex = vertices[newCache[j]];
+            vertex.cachePosition_ = -1;
+            vertex.score_ = CalculateForsythScore(vertex);
+        }
+
+        if (newCache.Size() > FORSYTH_CACHE_SIZE)
+        {
+            for (unsigned j{ FORSYTH_CACHE_SIZE }; j < newCache.Size(); ++j)
+            {
+                const ForsythVertex& vertex = vertices[newCache[j]];
+                for (unsigned k{ 0 }; k < vertex.numActiveTriangles_; ++k)
+                {
+                    const unsigned t = vertexTriangles[vertex.firstTriangle_ + k];
+                    triangleScores[t] = vertices[indices[t * 3]].score_ + vertices[indices[t * 3 + 1]].score_ +
+                        vertices[indices[t * 3 + 2]].score_;
+                }
+            }
+
+            newCache.Resize(FORSYTH_CACHE_SIZE);
+        }
+
+        cache.Swap(newCache);
+
+        for (unsigned j{ 0 }; j < cache.Size(); ++j)
+        {
+            ForsythVertex& vertex = vertices[cache[j]];
+            vertex.cachePosition_ = j;
+            vertex.score_ = CalculateForsythScore(vertex);
+        }
+
+        // Rescore the triangles of the cached vertices and pick the best one to add next
+        bestTriangle = M_MAX_UNSIGNED;
+        float bestScore = -1.0f;
+        for (unsigned j{ 0 }; j < cache.Size(); ++j)
+        {
+            const ForsythVertex& vertex = vertices[cache[j]];
+            for (unsigned k{ 0 }; k < vertex.numActiveTriangles_; ++k)
+            {
+                const unsigned t = vertexTriangles[vertex.firstTriangle_ + k];
+                const float score = vertices[indices[t * 3]].score_ + vertices[indices[t * 3 + 1]].score_ + vertices[indices[t * 3 + 2]].score_;
+                triangleScores[t] = score;
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestTriangle = t;
+                }
+            }
+        }
+    }
+
+    memcpy(indices, &newIndices[0], numTriangles * 3 * sizeof(unsigned));
+}
+
+void OptimizeOverdraw(unsigned* indices, unsigned indexCount, const void* vertexData, unsigned vertexSize, unsigned vertexCount,
+    float threshold)
+{
+    const unsigned numTriangles = indexCount / 3;
+    if (!indices || !vertexData || numTriangles < 2 || !vertexCount)
+        return;
+
+    for (unsigned i{ 0 }; i < numTriangles * 3; ++i)
+    {
+        if (indices[i] >= vertexCount)
+            return;
+    }
+
+    const auto* data = static_cast<const unsigned char*>(vertexData);
+    const VertexCacheStatistics original = AnalyzeVertexCache(indices, numTriangles * 3, vertexCount);
+
+    // Split the triangles into clusters where the simulated cache restarts: all vertices of a triangle miss
+    PODVector<OverdrawCluster> clusters;
+    PODVector<unsigned> cacheTimes(vertexCount);
+    for (unsigned i{ 0 }; i < vertexCount; ++i)
+        cacheTimes[i] = 0;
+
+    unsigned time = DEFAULT_VERTEX_CACHE_SIZE + 1;
+    for (unsigned i{ 0 }; i < numTriangles; ++i)
+    {
+        unsigned numMisses{ 0 };
+        for (unsigned j{ 0 }; j < 3; ++j)
+        {
+            const unsigned index = indices[i * 3 + j];
+            if (!cacheTimes[index] || time - cacheTimes[index] > DEFAULT_VERTEX_CACHE_SIZE)
+            {
+                cacheTimes[index] = time++;
+                ++numMisses;
+            }
+        }
+
+        if (clusters.IsEmpty() || numMisses == 3)
+        {
+            OverdrawCluster cluster;
+            cluster.start_ = i;
+            cluster.count_ = 0;
+            cluster.sortKey_ = 0.0f;
+            clusters.Push(cluster);
+        }
+
+        ++clusters.Back().count_;
+    }
+
+    if (clusters.Size() < 2)
+        return;
+
+    // Sort the clusters by how much they face away from the mesh center, so that the outer surfaces are drawn first
+    Vector3 meshCenter{ Vector3::ZERO };
+    float meshArea = 0.0f;
+    PODVector<Vector3> clusterCenters(clusters.Size());
+    PODVector<Vector3> clusterNormals(clusters.Size());
+
+    for (unsigned i{ 0 }; i < clusters.Size(); ++i)
+    {
+        Vector3 center{ Vector3::ZERO };
+        Vector3 normal{ Vector3::ZERO };
+        float area = 0.0f;
+
+        for (unsigned j{ clusters[i].start_ }; j < clusters[i].start_ + clusters[i].count_; ++j)
+        {
+            const Vector3& v0 = *reinterpret_cast<const Vector3*>(data + indices[j * 3] * vertexSize);
+            const Vector3& v1 = *reinterpret_cast<const Vector3*>(data + indices[j * 3 + 1] * vertexSize);
+            const Vector3& v2 = *reinterpret_cast<const Vector3*>(data + indices[j * 3 + 2] * vertexSize);
+            const Vector3 triangleNormal = (v1 - v0).CrossProduct(v2 - v0);
+            const float triangleArea = triangleNormal.Length();
+
+            center += (v0 + v1 + v2) * (triangleArea / 3.0f);
+            normal += triangleNormal;
+            area += triangleArea;
+        }
+
+        meshCenter += center;
+        meshArea += area;
+        clusterCenters[i] = area > 0.0f ? center / area : center;
+        clusterNormals[i] = normal.Normalized();
+    }
+
+    if (meshArea > 0.0f)
+        meshCenter /= meshArea;
+
+    for (unsigned i{ 0 }; i < clusters.Size(); ++i)
+        clusters[i].sortKey_ = (clusterCenters[i] - meshCenter).DotProduct(clusterNormals[i]);
+
+    Sort(clusters.Begin(), clusters.End(), CompareOverdrawClusters);
+
+    PODVector<unsigned> newIndices(numTriangles * 3);
+    unsigned writeIndex{ 0 };
+    for (unsigned i{ 0 }; i < clusters.Size(); ++i)
+    {
+        memcpy(&newIndices[writeIndex], &indices[clusters[i].start_ * 3], clusters[i].count_ * 3 * sizeof(unsigned));
+        writeIndex += clusters[i].count_ * 3;
+    }
+
+    const VertexCacheStatistics sorted = AnalyzeVertexCache(&newIndices[0], numTriangles * 3, vertexCount);
+    if (sorted.GetACMR() <= original.GetACMR() * threshold)
+        memcpy(indices, &newIndices[0], numTriangles * 3 * sizeof(unsigned));
+}
+
+unsigned GetVertexFetchRemap(PODVector<unsigned>& remap, const unsigned* indices, unsigned indexCount, unsigned vertexCount)
+{
+    remap.Resize(vertexCount);
+    for (unsigned i{ 0 }; i < vertexCount; ++i)
+        remap[i] = M_MAX_UNSIGNED;
+
+    unsigned numUsed{ 0 };
+    for (unsigned i{ 0 }; i < indexCount; ++i)
+    {
+        const unsigned index = indices[i];
+        if (index < vertexCount && remap[index] == M_MAX_UNSIGNED)
+            remap[index] = numUsed++;
+    }
+
+    unsigned nextUnused = numUsed;
+    for (unsigned i{ 0 }; i < vertexCount; ++i)
+    {
+        if (remap[i] == M_MAX_UNSIGNED)
+            remap[i] = nextUnused++;
+    }
+
+    return numUsed;
+}
+
+void BuildMeshlets(PODVector<Meshlet>& meshlets, unsigned* indices, unsigned indexCount, const void* vertexData,
+    unsigned vertexSize, unsigned vertexCount, unsigned maxTriangles)
+{
+    meshlets.Clear();
+
+    const unsigned numTriangles = indexCount / 3;
+    if (!indices || !vertexData || !numTriangles || !vertexCount)
+        return;
+
+    for (unsigned i{ 0 }; i < numTriangles * 3; ++i)
+    {
+        if (indices[i] >= vertexCount)
+            return;
+    }
+
+    maxTriangles = Max(maxTriangles, 1u);
+    const auto* data = static_cast<const unsigned char*>(vertexData);
+
+    // Build the triangle lists of the vertices and the triangle normals
+    PODVector<unsigned> vertexTriangleStarts(vertexCount + 1);
+    for (unsigned i{ 0 }; i <= vertexCount; ++i)
+        vertexTriangleStarts[i] = 0;
+    for (unsigned i{ 0 }; i < numTriangles * 3; ++i)
+        ++vertexTriangleStarts[indices[i] + 1];
+    for (unsigned i{ 0 }; i < vertexCount; ++i)
+        vertexTriangleStarts[i + 1] += vertexTriangleStarts[i];
+
+    PODVector<unsigned> vertexTriangles(numTriangles * 3);
+    PODVector<unsigned> fill(vertexCount);
+    for (unsigned i{ 0 }; i < vertexCount; ++i)
+        fill[i] = vertexTriangleStarts[i];
+    for (unsigned i{ 0 }; i < numTriangles * 3; ++i)
+        vertexTriangles[fill[indices[i]]++] = i / 3;
+
+    PODVector<Vector3> triangleNormals(numTriangles);
+    for (unsigned i{ 0 }; i < numTriangles; ++i)
+    {
+        const Vector3& v0 = *reinterpret_cast<const Vector3*>(data + indices[i * 3] * vertexSize);
+        const Vector3& v1 = *reinterpret_cast<const Vector3*>(data + indices[i * 3 + 1] * vertexSize);
+        const Vector3& v2 = *reinterpret_cast<const Vector3*>(data + indices[i * 3 + 2] * vertexSize);
+        triangleNormals[i] = (v1 - v0).CrossProduct(v2 - v0).Normalized();
+    }
+
+    PODVector<unsigned> triangleMeshlets(numTriangles);
+    for (unsigned i{ 0 }; i < numTriangles; ++i)
+        triangleMeshlets[i] = M_MAX_UNSIGNED;
+    PODVector<unsigned> vertexMeshlets(vertexCount);
+    for (unsigned i{ 0 }; i < vertexCount; ++i)
+        vertexMeshlets[i] = M_MAX_UNSIGNED;
+
+    PODVector<unsigned> newIndices(numTriangles * 3);
+    PODVector<unsigned> candidates;
+    unsigned numAdded{ 0 };
+    unsigned seed{ 0 };
+
+    while (numAdded < numTriangles)
+    {
+        while (triangleMeshlets[seed] != M_MAX_UNSIGNED)
+            ++seed;
+
+        const unsigned meshletIndex = meshlets.Size();
+        Meshlet meshlet;
+        meshlet.indexStart_ = numAdded * 3;
+        Vector3 normalSum{ Vector3::ZERO };
+        unsigned numMeshletTriangles{ 0 };
+        unsigned triangle = seed;
+        candidates.Clear();
+
+        // Grow the meshlet from the seed by the adjacent triangle sharing the most vertices and facing the most alike
+        while (triangle != M_MAX_UNSIGNED)
+        {
+            triangleMeshlets[triangle] = meshletIndex;
+            normalSum += triangleNormals[triangle];
+            for (unsigned j{ 0 }; j < 3; ++j)
+            {
+                const unsigned vertex = indices[triangle * 3 + j];
+                newIndices[numAdded * 3 + j] = vertex;
+
+                if (vertexMeshlets[vertex] != meshletIndex)
+                {
+                    vertexMeshlets[vertex] = meshletIndex;
+                    for (unsigned k{ vertexTriangleStarts[vertex] }; k < vertexTriangleStarts[vertex + 1]; ++k)
+                    {
+                        if (triangleMeshlets[vertexTriangles[k]] == M_MAX_UNSIGNED)
+                            candidates.Push(vertexTriangles[k]);
+                    }
+                }
+            }
+
+            ++numAdded;
+            if (++numMeshletTriangles >= maxTriangles)
+                break;
+
+            const Vector3 meshletNormal = normalSum.Normalized();
+            float bestScore = -M_INFINITY;
+            unsigned bestCandidate = M_MAX_UNSIGNED;
+            for (unsigned j{ 0 }; j < candidates.Size();)
+            {
+                const unsigned candidate = candidates[j];
+                if (triangleMeshlets[candidate] != M_MAX_UNSIGNED)
+                {
+                    candidates.EraseSwap(j);
+                    continue;
+                }
+
+                unsigned numShared{ 0 };
+                for (unsigned k{ 0 }; k < 3; ++k)
+                {
+                    if (vertexMeshlets[indices[candidate * 3 + k]] == meshletIndex)
+                        ++numShared;
+                }
+
+                const float score = numShared + triangleNormals[candidate].DotProduct(meshletNormal);
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestCandidate = j;
+                }
+                ++j;
+            }
+
+            if (bestCandidate == M_MAX_UNSIGNED)
+                break;
+
+            triangle = candidates[bestCandidate];
+            candidates.EraseSwap(bestCandidate);
+        }
+
+        meshlet.indexCount_ = numAdded * 3 - meshlet.indexStart_;
+
+        // Bounding sphere around the center of the bounding box
+        Vector3 min{ Vector3::ONE * M_INFINITY };
+        Vector3 max{ Vector3::ONE * -M_INFINITY };
+        for (unsigned j{ meshlet.indexStart_ }; j < meshlet.indexStart_ + meshlet.indexCount_; ++j)
+        {
+            const Vector3& position = *reinterpret_cast<const Vector3*>(data + newIndices[j] * vertexSize);
+            min = VectorMin(min, position);
+            max = VectorMax(max, position);
+        }
+
+        meshlet.center_ = (min + max) * 0.5f;
+        for (unsigned j{ meshlet.indexStart_ }; j < meshlet.indexStart_ + meshlet.indexCount_; ++j)
+        {
+            const Vector3& position = *reinterpret_cast<const Vector3*>(data + newIndices[j] * vertexSize);
+            meshlet.radius_ = Max(meshlet.radius_, (position - meshlet.center_).Length());
+        }
+
+        // Normal cone. Meshlets whose triangles face more than sideways apart can not be back face culled as a whole
+        meshlet.coneAxis_ = normalSum.Normalized();
+        float minDot = meshlet.coneAxis_ == Vector3::ZERO ? -1.0f : 1.0f;
+        for (unsigned j{ meshlet.indexStart_ / 3 }; j < (meshlet.indexStart_ + meshlet.indexCount_) / 3 && minDot > 0.0f; ++j)
+        {
+            const Vector3& v0 = *reinterpret_cast<const Vector3*>(data + newIndices[j * 3] * vertexSize);
+            const Vector3& v1 = *reinterpret_cast<const Vector3*>(data + newIndices[j * 3 + 1] * vertexSize);
+            const Vector3& v2 = *reinterpret_cast<const Vector3*>(data + newIndices[j * 3 + 2] * vertexSize);
+            const Vector3 normal = (v1 - v0).CrossProduct(v2 - v0);
+            if (normal != Vector3::ZERO)
+                minDot = Min(minDot, normal.Normalized().DotProduct(meshlet.coneAxis_));
+        }
+
+        meshlet.coneCutoff_ = minDot > 0.0f ? sqrtf(1.0f - minDot * minDot) : 1.0f;
+        meshlets.Push(meshlet);
+    }
+
+    memcpy(indices, &newIndices[0], numTriangles * 3 * sizeof(unsigned));
+}
+
+}
@@ -0,0 +1,98 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+// Copyright (c) 2020-2023 LucKey Productions.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Container/Vector.h"
+#include "../Math/Vector3.h"
+
+namespace Dry
+{
+
+/// Default simulated post-transform vertex cache size for statistics.
+static const unsigned DEFAULT_VERTEX_CACHE_SIZE = 16;
+/// Default ratio by which overdraw optimization may raise the vertex cache miss ratio.
+static const float DEFAULT_OVERDRAW_THRESHOLD = 1.05f;
+/// Default maximum number of triangles in a meshlet.
+static const unsigned DEFAULT_MESHLET_TRIANGLES = 128;
+
+/// Post-transform vertex cache statistics of indexed triangle lists.
+struct DRY_API VertexCacheStatistics
+{
+    /// Return average cache miss ratio: transformed vertices per triangle.
+    float GetACMR() const { return numTriangles_ ? (float)numMisses_ / numTriangles_ : 0.0f; }
+
+    /// Return average transform to vertex ratio: transformed vertices per vertex used.
+    float GetATVR() const { return numVertices_ ? (float)numMisses_ / numVertices_ : 0.0f; }
+
+    /// Add the statistics of another mesh.
+    void Add(const VertexCacheStatistics& rhs)
+    {
+        numMisses_ += rhs.numMisses_;
+        numTriangles_ += rhs.numTriangles_;
+        numVertices_ += rhs.numVertices_;
+    }
+
+    /// Number of vertex cache misses.
+    unsigned numMisses_{};
+    /// Number of triangles.
+    unsigned numTriangles_{};
+    /// Number of distinct vertices used.
+    unsigned numVertices_{};
+};
+
+/// Cluster of adjacent triangles with bounds for culling parts of a geometry.
+struct Meshlet
+{
+    /// First index.
+    unsigned indexStart_{};
+    /// Number of indices.
+    unsigned indexCount_{};
+    /// Bounding sphere center.
+    Vector3 center_;
+    /// Bounding sphere radius.
+    float radius_{};
+    /// Average triangle normal direction.
+    Vector3 coneAxis_;
+    /// Sine of the largest angle between a triangle normal and the cone axis. The meshlet is back facing from a viewpoint when the dot product of the view direction to its center and the cone axis is at least the cutoff times the distance plus the radius. One disables the test.
+    float coneCutoff_{1.0f};
+};
+
+/// Simulate a FIFO post-transform vertex cache over an indexed triangle list.
+DRY_API VertexCacheStatistics AnalyzeVertexCache(const unsigned* indices, unsigned indexCount, unsigned vertexCount,
+    unsigned cacheSize = DEFAULT_VERTEX_CACHE_SIZE);
+/// Reorder the triangles of an indexed triangle list for the post-transform vertex cache, using Tom Forsyth's linear-speed vertex cache optimisation.
+DRY_API void OptimizeVertexCache(unsigned* indices, unsigned indexCount, unsigned vertexCount);
+/// Reorder clusters of a vertex cache optimized triangle list to draw outward facing parts first and reduce overdraw. The vertex data pointer should point to the first position. The new order is only kept if it raises the vertex cache miss ratio by at most the threshold.
+DRY_API void OptimizeOverdraw(unsigned* indices, unsigned indexCount, const void* vertexData, unsigned vertexSize, unsigned vertexCount,
+    float threshold = DEFAULT_OVERDRAW_THRESHOLD);
+/// Calculate a vertex remap that orders the vertices by first use in an indexed triangle list, for vertex fetch locality. Unused vertices are moved to the end. Return the number of vertices used.
+DRY_API unsigned GetVertexFetchRemap(PODVector<unsigned>& remap, const unsigned* indices, unsigned indexCount, unsigned vertexCount);
+/// Split an indexed triangle list into meshlets of adjacent triangles with similar facing, reordering the triangles so that each meshlet is a contiguous index range. The vertex data pointer should point to the first position.
+DRY_API void BuildMeshlets(PODVector<Meshlet>& meshlets, unsigned* indices, unsigned indexCount, const void* vertexData,
+    unsigned vertexSize, unsigned vertexCount, unsigned maxTriangles = DEFAULT_MESHLET_TRIANGLES);
+
+}
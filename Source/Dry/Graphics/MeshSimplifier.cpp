@@ -0,0 +1,353 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+// Copyright (c) 2020-2023 LucKey Productions.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Container/HashMap.h"
+#include "../Container/Sort.h"
+#include "../Graphics/MeshSimplifier.h"
+#include "../Math/Vector3.h"
+
+#include "../DebugNew.h"
+
+namespace Dry
+{
+
+/// Maximum number of collapse passes.
+static const unsigned MAX_SIMPLIFY_PASSES = 64;
+
+/// Symmetric quadric of squared distances to a set of planes.
+struct SimplifyQuadric
+{
+    /// Add the quadric of a plane with a weight.
+    void AddPlane(const Vector3& normal, float d, double weight)
+    {
+        const double x = normal.x_;
+        const double y = normal.y_;
+        const double z = normal.z_;
+
+        a00_ += x * x * weight;
+        a11_ += y * y * weight;
+        a22_ += z * z * weight;
+        a01_ += x * y * weight;
+        a02_ += x * z * weight;
+        a12_ += y * z * weight;
+        b0_ += x * d * weight;
+        b1_ += y * d * weight;
+        b2_ += z * d * weight;
+        c_ += (double)d * d * weight;
+    }
+
+    /// Add another quadric.
+    void Add(const SimplifyQuadric& rhs)
+    {
+        a00_ += rhs.a00_;
+        a11_ += rhs.a11_;
+        a22_ += rhs.a22_;
+        a01_ += rhs.a01_;
+        a02_ += rhs.a02_;
+        a12_ += rhs.a12_;
+        b0_ += rhs.b0_;
+        b1_ += rhs.b1_;
+        b2_ += rhs.b2_;
+        c_ += rhs.c_;
+    }
+
+    /// Return the weighted sum of squared distances of a point to the planes.
+    double Evaluate(const Vector3& point) const
+    {
+        const double x = point.x_;
+        const double y = point.y_;
+        const double z = point.z_;
+
+        return a00_ * x * x + a11_ * y * y + a22_ * z * z + 2.0 * (a01_ * x * y + a02_ * x * z + a12_ * y * z) +
+            2.0 * (b0_ * x + b1_ * y + b2_ * z) + c_;
+    }
+
+    /// Matrix and vector terms.
+    double a00_{}, a11_{}, a22_{}, a01_{}, a02_{}, a12_{}, b0_{}, b1_{}, b2_{}, c_{};
+};
+
+/// Candidate edge collapse.
+struct SimplifyCollapse
+{
+    /// Vertex to remove.
+    unsigned from_;
+    /// Vertex to collapse onto.
+    unsigned to_;
+    /// Quadric error of the collapse.
+    double error_;
+};
+
+/// Compare collapses by error.
+static bool CompareCollapses(const SimplifyCollapse& lhs, const SimplifyCollapse& rhs)
+{
+    return lhs.error_ < rhs.error_;
+}
+
+/// Return the key of an undirected edge between welded vertices.
+static unsigned long long GetEdgeKey(unsigned a, unsigned b)
+{
+    return a < b ? ((unsigned long long)a << 32u) | b : ((unsigned long long)b << 32u) | a;
+}
+
+/// Return the unnormalized normal of a triangle.
+static Vector3 GetTriangleNormal(const Vector3& v0, const Vector3& v1, const Vector3& v2)
+{
+    return (v1 - v0).CrossProduct(v2 - v0);
+}
+
+bool SimplifyMesh(PODVector<unsigned>& dest, const void* vertexData, unsigned vertexSize, unsigned vertexCount,
+    const unsigned* indices, unsigned indexCount, unsigned targetIndexCount)
+{
+    dest.Resize(indexCount);
+    if (indexCount)
+        memcpy(&dest[0], indices, indexCount * sizeof(unsigned));
+
+    if (!vertexData || !vertexCount || !indices || indexCount % 3)
+        return false;
+
+    for (unsigned i{ 0 }; i < indexCount; ++i)
+    {
+        if (indices[i] >= vertexCount)
+            return false;
+    }
+
+    if (targetIndexCount >= indexCount)
+        return true;
+
+    // Weld vertices by position, so that attribute seams do not split the topology
+    const auto* data = static_cast<const unsigned char*>(vertexData);
+    PODVector<Vector3> positions(vertexCount);
+    PODVector<unsigned> welded(vertexCount);
+    PODVector<unsigned> numCopies(vertexCount);
+    HashMap<Vector3, unsigned> weldMap;
+
+    for (unsigned i{ 0 }; i < vertexCount; ++i)
+    {
+        positions[i] = *reinterpret_cast<const Vector3*>(data + i * vertexSize);
+        numCopies[i] = 0;
+
+        HashMap<Vector3, unsigned>::ConstIterator j = weldMap.Find(positions[i]);
+        if (j != weldMap.End())
+            welded[i] = j->second_;
+        else
+            welded[i] = weldMap[positions[i]] = i;
+    }
+
+    for (unsigned i{ 0 }; i < vertexCount; ++i)
+        ++numCopies[welded[i]];
+
+    // Lock seam vertices and the vertices of open borders, and accumulate the plane quadrics of the triangles
+    PODVector<unsigned char> locked(vertexCount);
+    PODVector<SimplifyQuadric> quadrics(vertexCount);
+    HashMap<unsigned long long, unsigned> edgeUses;
+
+    for (unsigned i{ 0 }; i < vertexCount; ++i)
+        locked[i] = numCopies[welded[i]] > 1;
+
+    for (unsigned i{ 0 }; i < indexCount; i += 3)
+    {
+        const unsigned a = welded[indices[i]];
+        const unsigned b = welded[indices[i + 1]];
+        const unsigned c = welded[indices[i + 2]];
+
+        ++edgeUses[GetEdgeKey(a, b)];
+        ++edgeUses[GetEdgeKey(b, c)];
+        ++edgeUses[GetEdgeKey(c, a)];
+
+        const Vector3 normal = GetTriangleNormal(positions[a], positions[b], positions[c]);
+        const float area = normal.Length();
+        if (area < M_EPSILON)
+            continue;
+
+        const Vector3 unitNormal = normal / area;
+        const float d = -unitNormal.DotProduct(positions[a]);
+        quadrics[a].AddPlane(unitNormal, d, area);
+        quadrics[b].AddPlane(unitNormal, d, area);
+        quadrics[c].AddPlane(unitNormal, d, area);
+    }
+
+    for (HashMap<unsigned long long, unsigned>::ConstIterator i = edgeUses.Begin(); i != edgeUses.End(); ++i)
+    {
+        if (i->second_ == 1)
+        {
+            locked[(unsigned)(i->first_ >> 32u)] = 1;
+            locked[(unsigned)(i->first_ & M_MAX_UNSIGNED)] = 1;
+        }
+    }
+
+    unsigned numIndices = indexCount;
+    PODVector<unsigned> triangleOffsets(vertexCount + 1);
+    PODVector<unsigned> vertexTriangles;
+    PODVector<SimplifyCollapse> collapses;
+    PODVector<unsigned> remap(vertexCount);
+    PODVector<unsigned char> touched(vertexCount);
+
+    for (unsigned pass{ 0 }; pass < MAX_SIMPLIFY_PASSES && numIndices > targetIndexCount; ++pass)
+    {
+        // Find the triangles around each welded vertex
+        for (unsigned i{ 0 }; i <= vertexCount; ++i)
+            triangleOffsets[i] = 0;
+        for (unsigned i{ 0 }; i < numIndices; ++i)
+            ++triangleOffsets[welded[dest[i]] + 1];
+        for (unsigned i{ 0 }; i < vertexCount; ++i)
+            triangleOffsets[i + 1] += triangleOffsets[i];
+
+        vertexTriangles.Resize(numIndices);
+        for (unsigned i{ 0 }; i < vertexCount; ++i)
+            remap[i] = triangleOffsets[i];
+        for (unsigned i{ 0 }; i < numIndices; ++i)
+            vertexTriangles[remap[welded[dest[i]]]++] = i / 3;
+
+        // Gather the collapses of unlocked vertices along their edges, cheapest first
+        collapses.Clear();
+        for (unsigned i{ 0 }; i < numIndices; i += 3)
+        {
+            for (unsigned j{ 0 }; j < 3; ++j)
+            {
+                const unsigned from = welded[dest[i + j]];
+                const unsigned to = welded[dest[i + (j + 1) % 3]];
+                if (locked[from] || from == to)
+                    continue;
+
+                SimplifyQuadric quadric = quadrics[from];
+                quadric.Add(quadrics[to]);
+
+                SimplifyCollapse collapse;
+                collapse.from_ = from;
+                collapse.to_ = to;
+                collapse.error_ = quadric.Evaluate(positions[to]);
+                collapses.Push(collapse);
+            }
+        }
+
+        if (collapses.IsEmpty())
+            break;
+
+        Sort(collapses.Begin(), collapses.End(), CompareCollapses);
+
+        for (unsigned i{ 0 }; i < vertexCount; ++i)
+        {
+            remap[i] = i;
+            touched[i] = 0;
+        }
+
+        // Collapse edges whose neighbourhoods do not overlap, until the target is estimated to be reached
+        const unsigned numTriangles = numIndices / 3;
+        const unsigned targetTriangles = targetIndexCount / 3;
+        unsigned removedTriangles{ 0 };
+        unsigned numCollapsed{ 0 };
+
+        for (unsigned i{ 0 }; i < collapses.Size() && numTriangles - removedTriangles > targetTriangles; ++i)
+        {
+            const unsigned from = collapses[i].from_;
+            const unsigned to = collapses[i].to_;
+            if (touched[from] || touched[to])
+                continue;
+
+            // The collapsed vertex takes the attributes of the target vertex in the triangles sharing the edge
+            unsigned target = M_MAX_UNSIGNED;
+            unsigned numShared{ 0 };
+            bool valid = true;
+
+            for (unsigned j{ triangleOffsets[from] }; j < triangleOffsets[from + 1] && valid; ++j)
+            {
+                const unsigned* triangle = &dest[vertexTriangles[j] * 3];
+                for (unsigned k{ 0 }; k < 3; ++k)
+                {
+                    if (welded[triangle[k]] != to)
+                        continue;
+
+                    if (target != M_MAX_UNSIGNED && target != triangle[k])
+                        valid = false;
+                    target = triangle[k];
+                    ++numShared;
+                }
+            }
+
+            if (!valid || target == M_MAX_UNSIGNED)
+                continue;
+
+            // Do not flip the triangles that move with the collapsed vertex
+            for (unsigned j{ triangleOffsets[from] }; j < triangleOffsets[from + 1] && valid; ++j)
+            {
+                const unsigned* triangle = &dest[vertexTriangles[j] * 3];
+                const unsigned a = welded[triangle[0]];
+                const unsigned b = welded[triangle[1]];
+                const unsigned c = welded[triangle[2]];
+                if (a == to || b == to || c == to)
+                    continue;
+
+                const Vector3 before = GetTriangleNormal(positions[a], positions[b], positions[c]);
+                const Vector3 after = GetTriangleNormal(a == from ? positions[to] : positions[a], b == from ? positions[to] : positions[b],
+                    c == from ? positions[to] : positions[c]);
+                if (before.DotProduct(after) <= 0.0f)
+                    valid = false;
+            }
+
+            if (!valid)
+                continue;
+
+            // Unlocked vertices have a single copy, which is the welded vertex itself
+            remap[from] = target;
+            quadrics[to].Add(quadrics[from]);
+
+            for (unsigned j{ triangleOffsets[from] }; j < triangleOffsets[from + 1]; ++j)
+            {
+                const unsigned* triangle = &dest[vertexTriangles[j] * 3];
+                for (unsigned k{ 0 }; k < 3; ++k)
+                    touched[welded[triangle[k]]] = 1;
+            }
+
+            removedTriangles += numShared;
+            ++numCollapsed;
+        }
+
+        if (!numCollapsed)
+            break;
+
+        // Apply the collapses and remove the degenerate triangles
+        unsigned writeIndex{ 0 };
+        for (unsigned i{ 0 }; i < numIndices; i += 3)
+        {
+            const unsigned a = remap[dest[i]];
+            const unsigned b = remap[dest[i + 1]];
+            const unsigned c = remap[dest[i + 2]];
+            if (welded[a] == welded[b] || welded[b] == welded[c] || welded[c] == welded[a])
+                continue;
+
+            dest[writeIndex++] = a;
+            dest[writeIndex++] = b;
+            dest[writeIndex++] = c;
+        }
+
+        numIndices = writeIndex;
+    }
+
+    dest.Resize(numIndices);
+    return true;
+}
+
+}
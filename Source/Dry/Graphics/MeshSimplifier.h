@@ -0,0 +1,38 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+// Copyright (c) 2020-2023 LucKey Productions.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Container/Vector.h"
+
+namespace Dry
+{
+
+/// Simplify an indexed triangle list towards a target index count with quadric error metrics. Edges are collapsed onto existing vertices, so the vertex data stays valid and can be shared with the source. Vertices with the same position are welded for the topology; seams between them and open borders are preserved. The vertex data pointer should point to the first position. Return false on invalid input, in which case the destination receives the source indices.
+DRY_API bool SimplifyMesh(PODVector<unsigned>& dest, const void* vertexData, unsigned vertexSize, unsigned vertexCount,
+    const unsigned* indices, unsigned indexCount, unsigned targetIndexCount);
+
+}
@@ -29,6 +29,8 @@
 #include "../Graphics/IndexBuffer.h"
 #include "../Graphics/Model.h"
 #include "../Graphics/Graphics.h"
+#include "../Graphics/MeshOptimizer.h"
+#include "../Graphics/MeshSimplifier.h"
 #include "../Graphics/VertexBuffer.h"
 #include "../IO/Log.h"
 #include "../IO/File.h"
@@ -41,6 +43,112 @@
 namespace Dry
 {
 
+/// Maximum ratio of vertices covered to vertices morphed for building dense morph deltas.
+static const unsigned MAX_MORPH_DELTA_SPAN_RATIO = 4;
+
+/// Return number of float planes in the dense deltas of a vertex buffer morph.
+static unsigned GetNumMorphDeltaPlanes(const VertexBufferMorph& morph)
+{
+    unsigned numPlanes{ 0 };
+    if (morph.elementMask_ & MASK_POSITION)
+        numPlanes += 3;
+    if (morph.elementMask_ & MASK_NORMAL)
+        numPlanes += 3;
+    if (morph.elementMask_ & MASK_TANGENT)
+        numPlanes += 3;
+    return numPlanes;
+}
+
+/// Return memory use of the dense deltas of a vertex buffer morph.
+static unsigned GetMorphDeltasSize(const VertexBufferMorph& morph)
+{
+    return morph.deltas_ ? GetNumMorphDeltaPlanes(morph) * morph.deltaCount_ * sizeof(float) : 0;
+}
+
+/// Unpack the morphed vertices of a vertex buffer morph into dense delta planes, so that they can be applied with SIMD and split by vertex range.
+static void BuildMorphDeltas(VertexBufferMorph& morph)
+{
+    morph.deltas_.Reset();
+    morph.deltaStart_ = 0;
+    morph.deltaCount_ = 0;
+
+    const unsigned numPlanes = GetNumMorphDeltaPlanes(morph);
+    if (!morph.vertexCount_ || !numPlanes || !morph.morphData_)
+        return;
+
+    const unsigned vertexSize = sizeof(unsigned) + numPlanes * sizeof(float);
+    const unsigned char* data = morph.morphData_.Get();
+
+    unsigned minIndex = M_MAX_UNSIGNED;
+    unsigned maxIndex{ 0 };
+    for (unsigned i{ 0 }; i < morph.vertexCount_; ++i)
+    {
+        const unsigned index = *reinterpret_cast<const unsigned*>(data + i * vertexSize);
+        minIndex = Min(minIndex, index);
+        maxIndex = Max(maxIndex, index);
+    }
+
+    // Morphs scattered over the vertex buffer stay packed
+    const unsigned deltaCount = maxIndex - minIndex + 1;
+    if (deltaCount > morph.vertexCount_ * MAX_MORPH_DELTA_SPAN_RATIO)
+        return;
+
+    SharedArrayPtr<float> deltas(new float[numPlanes * deltaCount]);
+    memset(deltas.Get(), 0, numPlanes * deltaCount * sizeof(float));
+
+    for (unsigned i{ 0 }; i < morph.vertexCount_; ++i)
+    {
+        const unsigned char* vertex = data + i * vertexSize;
+        const unsigned index = *reinterpret_cast<const unsigned*>(vertex) - minIndex;
+        const auto* src = reinterpret_cast<const float*>(vertex + sizeof(unsigned));
+
+        for (unsigned j{ 0 }; j < numPlanes; ++j)
+            deltas[j * deltaCount + index] = src[j];
+    }
+
+    morph.deltaStart_ = minIndex;
+    morph.deltaCount_ = deltaCount;
+    morph.deltas_ = deltas;
+}
+
+/// Read a range of an index buffer's shadow data as 32-bit indices.
+static void ReadIndexRange(PODVector<unsigned>& dest, IndexBuffer* buffer, unsigned start, unsigned count)
+{
+    const unsigned char* data = buffer->GetShadowData() + start * buffer->GetIndexSize();
+    dest.Resize(count);
+
+    for (unsigned i{ 0 }; i < count; ++i)
+    {
+        if (buffer->GetIndexSize() == sizeof(unsigned))
+            dest[i] = reinterpret_cast<const unsigned*>(data)[i];
+        else
+            dest[i] = reinterpret_cast<const unsigned short*>(data)[i];
+    }
+}
+
+/// Write 32-bit indices to a range of an index buffer in its own index size.
+static bool WriteIndexRange(IndexBuffer* buffer, unsigned start, const PODVector<unsigned>& indices)
+{
+    if (indices.IsEmpty())
+        return true;
+
+    if (buffer->GetIndexSize() == sizeof(unsigned))
+        return buffer->SetDataRange(&indices[0], start, indices.Size());
+
+    PODVector<unsigned short> shortIndices(indices.Size());
+    for (unsigned i{ 0 }; i < indices.Size(); ++i)
+        shortIndices[i] = (unsigned short)indices[i];
+
+    return buffer->SetDataRange(&shortIndices[0], start, indices.Size());
+}
+
+/// Return whether a geometry draws the same index range as another.
+static bool IsSameIndexRange(const Geometry* lhs, const Geometry* rhs)
+{
+    return lhs->GetIndexBuffer() == rhs->GetIndexBuffer() && lhs->GetIndexStart() == rhs->GetIndexStart() &&
+        lhs->GetIndexCount() == rhs->GetIndexCount();
+}
+
 unsigned LookupVertexBuffer(VertexBuffer* buffer, const Vector<SharedPtr<VertexBuffer> >& buffers)
 {
     for (unsigned i{ 0 }; i < buffers.Size(); ++i)
@@ -88,6 +196,7 @@ bool Model::BeginLoad(Deserializer& source)
     geometries_.Clear();
     geometryBoneMappings_.Clear();
     geometryCenters_.Clear();
+    geometryMeshlets_.Clear();
     morphs_.Clear();
     vertexBuffers_.Clear();
     indexBuffers_.Clear();
@@ -285,9 +394,10 @@ bool Model::BeginLoad(Deserializer& source)
             newBuffer.morphData_ = new unsigned char[newBuffer.dataSize_];
 
             source.Read(&newBuffer.morphData_[0], newBuffer.vertexCount_ * vertexSize);
+            BuildMorphDeltas(newBuffer);
 
             newMorph.buffers_[bufferIndex] = newBuffer;
-            memoryUse += sizeof(VertexBufferMorph) + newBuffer.vertexCount_ * vertexSize;
+            memoryUse += sizeof(VertexBufferMorph) + newBuffer.vertexCount_ * vertexSize + GetMorphDeltasSize(newBuffer);
         }
 
         morphs_.Push(newMorph);
@@ -308,6 +418,29 @@ bool Model::BeginLoad(Deserializer& source)
         geometryCenters_.Push(Vector3::ZERO);
     memoryUse += sizeof(Vector3) * geometries_.Size();
 
+    // Read meshlets, which older files do not have
+    geometryMeshlets_.Resize(geometries_.Size());
+    if (!source.IsEof() && source.ReadFileID() == "MSHL")
+    {
+        for (unsigned i{ 0 }; i < geometries_.Size(); ++i)
+        {
+            PODVector<Meshlet>& meshlets = geometryMeshlets_[i];
+            meshlets.Resize(source.ReadUInt());
+            for (unsigned j{ 0 }; j < meshlets.Size(); ++j)
+            {
+                Meshlet& meshlet = meshlets[j];
+                meshlet.indexStart_ = source.ReadUInt();
+                meshlet.indexCount_ = source.ReadUInt();
+                meshlet.center_ = source.ReadVector3();
+                meshlet.radius_ = source.ReadFloat();
+                meshlet.coneAxis_ = source.ReadVector3();
+                meshlet.coneCutoff_ = source.ReadFloat();
+            }
+
+            memoryUse += meshlets.Size() * sizeof(Meshlet);
+        }
+    }
+
     // Read metadata
     auto* cache = GetSubsystem<ResourceCache>();
     String xmlName = ReplaceExtension(GetName(), ".xml");
@@ -462,6 +595,34 @@ bool Model::Save(Serializer& dest) const
     for (unsigned i{ 0 }; i < geometryCenters_.Size(); ++i)
         dest.WriteVector3(geometryCenters_[i]);
 
+    // Write meshlets if built
+    bool hasMeshlets = false;
+    for (unsigned i{ 0 }; i < geometryMeshlets_.Size(); ++i)
+    {
+        if (geometryMeshlets_[i].Size())
+            hasMeshlets = true;
+    }
+
+    if (hasMeshlets && geometryMeshlets_.Size() == geometries_.Size())
+    {
+        dest.WriteFileID("MSHL");
+        for (unsigned i{ 0 }; i < geometryMeshlets_.Size(); ++i)
+        {
+            const PODVector<Meshlet>& meshlets = geometryMeshlets_[i];
+            dest.WriteUInt(meshlets.Size());
+            for (unsigned j{ 0 }; j < meshlets.Size(); ++j)
+            {
+                const Meshlet& meshlet = meshlets[j];
+                dest.WriteUInt(meshlet.indexStart_);
+                dest.WriteUInt(meshlet.indexCount_);
+                dest.WriteVector3(meshlet.center_);
+                dest.WriteFloat(meshlet.radius_);
+                dest.WriteVector3(meshlet.coneAxis_);
+                dest.WriteFloat(meshlet.coneCutoff_);
+            }
+        }
+    }
+
     // Write metadata
     if (HasMetadata())
     {
@@ -545,6 +706,7 @@ void Model::SetNumGeometries(unsigned num)
     geometries_.Resize(num);
     geometryBoneMappings_.Resize(num);
     geometryCenters_.Resize(num);
+    geometryMeshlets_.Resize(num);
 
     // For easier creation of from-scratch geometry, ensure that all geometries start with at least 1 LOD level (0 makes no sense)
     for (unsigned i{ 0 }; i < geometries_.Size(); ++i)
@@ -585,6 +747,9 @@ bool Model::SetGeometry(unsigned index, unsigned lodLevel, Geometry* geometry)
     }
 
     geometries_[index][lodLevel] = geometry;
+    // Meshlets refer to the index range of the replaced geometry
+    if (!lodLevel && index < geometryMeshlets_.Size())
+        geometryMeshlets_[index].Clear();
     return true;
 }
 
@@ -613,6 +778,488 @@ void Model::SetGeometryBoneMappings(const Vector<PODVector<unsigned> >& geometry
 void Model::SetMorphs(const Vector<ModelMorph>& morphs)
 {
     morphs_ = morphs;
+
+    for (Vector<ModelMorph>::Iterator i = morphs_.Begin(); i != morphs_.End(); ++i)
+    {
+        for (HashMap<unsigned, VertexBufferMorph>::Iterator j = i->buffers_.Begin(); j != i->buffers_.End(); ++j)
+            BuildMorphDeltas(j->second_);
+    }
+}
+
+bool Model::GenerateLodLevels(unsigned numLevels, float reduction, float distanceStep)
+{
+    reduction = Clamp(reduction, 0.0f, 1.0f);
+    unsigned memoryUse = GetMemoryUse();
+    bool generated = false;
+    // Index buffers of the replaced levels, released afterward unless other geometries still use them
+    Vector<SharedPtr<IndexBuffer> > replacedBuffers;
+
+    for (unsigned i{ 0 }; i < geometries_.Size(); ++i)
+    {
+        Geometry* geometry = geometries_[i].Size() ? geometries_[i][0].Get() : nullptr;
+        if (!geometry || geometry->GetPrimitiveType() != TRIANGLE_LIST || !geometry->GetIndexCount())
+            continue;
+
+        const unsigned char* vertexData;
+        const unsigned char* indexData;
+        unsigned vertexSize;
+        unsigned indexSize;
+        const PODVector<VertexElement>* elements;
+
+        geometry->GetRawData(vertexData, vertexSize, indexData, indexSize, elements);
+        if (!vertexData || !indexData || !elements)
+            continue;
+
+        const unsigned positionOffset = VertexBuffer::GetElementOffset(*elements, TYPE_VECTOR3, SEM_POSITION);
+        if (positionOffset == M_MAX_UNSIGNED)
+            continue;
+
+        const unsigned vertexCount = geometry->GetVertexStart() + geometry->GetVertexCount();
+        PODVector<unsigned> indices(geometry->GetIndexCount());
+        for (unsigned j{ 0 }; j < indices.Size(); ++j)
+        {
+            const unsigned char* index = indexData + (geometry->GetIndexStart() + j) * indexSize;
+            indices[j] = indexSize == sizeof(unsigned) ? *reinterpret_cast<const unsigned*>(index) :
+                *reinterpret_cast<const unsigned short*>(index);
+        }
+
+        // Simplify each level from the previous one, stopping when the simplification no longer makes progress
+        Vector<PODVector<unsigned> > levels;
+        unsigned totalIndices{ 0 };
+        for (unsigned j{ 0 }; j < numLevels; ++j)
+        {
+            const PODVector<unsigned>& source = levels.Size() ? levels.Back() : indices;
+            const unsigned targetIndexCount = (unsigned)(source.Size() / 3 * reduction) * 3;
+
+            PODVector<unsigned> simplified;
+            if (!SimplifyMesh(simplified, vertexData + positionOffset, vertexSize, vertexCount, &source[0], source.Size(),
+                targetIndexCount) || simplified.IsEmpty() || simplified.Size() >= source.Size())
+                break;
+
+            totalIndices += simplified.Size();
+            levels.Push(simplified);
+        }
+
+        if (levels.IsEmpty())
+        {
+            DRY_LOGWARNING("Could not generate LOD levels for geometry " + String(i) + " of model " + GetName());
+            continue;
+        }
+
+        // Store all generated levels of the geometry in one index buffer
+        const bool largeIndices = vertexCount > 65535;
+        SharedPtr<IndexBuffer> indexBuffer(new IndexBuffer(context_));
+        indexBuffer->SetShadowed(true);
+        auto* dest = indexBuffer->SetSize(totalIndices, largeIndices) ? static_cast<unsigned char*>(indexBuffer->Lock(0, totalIndices)) :
+            nullptr;
+        if (!dest)
+            continue;
+
+        for (unsigned j{ 0 }; j < levels.Size(); ++j)
+        {
+            for (unsigned k{ 0 }; k < levels[j].Size(); ++k)
+            {
+                if (largeIndices)
+                    *reinterpret_cast<unsigned*>(dest) = levels[j][k];
+                else
+                    *reinterpret_cast<unsigned short*>(dest) = (unsigned short)levels[j][k];
+
+                dest += indexBuffer->GetIndexSize();
+            }
+        }
+
+        indexBuffer->Unlock();
+        indexBuffers_.Push(indexBuffer);
+        memoryUse += sizeof(IndexBuffer) + totalIndices * indexBuffer->GetIndexSize();
+
+        for (unsigned j{ 1 }; j < geometries_[i].Size(); ++j)
+        {
+            SharedPtr<IndexBuffer> replaced(geometries_[i][j] ? geometries_[i][j]->GetIndexBuffer() : nullptr);
+            if (replaced && !replacedBuffers.Contains(replaced))
+                replacedBuffers.Push(replaced);
+        }
+
+        geometries_[i].Resize(levels.Size() + 1);
+        unsigned indexStart{ 0 };
+        for (unsigned j{ 0 }; j < levels.Size(); ++j)
+        {
+            SharedPtr<Geometry> lodGeometry(new Geometry(context_));
+            lodGeometry->SetNumVertexBuffers(geometry->GetNumVertexBuffers());
+            for (unsigned k{ 0 }; k < geometry->GetNumVertexBuffers(); ++k)
+                lodGeometry->SetVertexBuffer(k, geometry->GetVertexBuffer(k));
+            lodGeometry->SetIndexBuffer(indexBuffer);
+            lodGeometry->SetDrawRange(TRIANGLE_LIST, indexStart, levels[j].Size(), geometry->GetVertexStart(), geometry->GetVertexCount(), false);
+            lodGeometry->SetLodDistance(geometry->GetLodDistance() + distanceStep * (j + 1));
+
+            geometries_[i][j + 1] = lodGeometry;
+            indexStart += levels[j].Size();
+            memoryUse += sizeof(Geometry);
+        }
+
+        generated = true;
+    }
+
+    for (unsigned i{ 0 }; i < replacedBuffers.Size(); ++i)
+    {
+        IndexBuffer* buffer = replacedBuffers[i];
+        if (!indexBuffers_.Contains(replacedBuffers[i]))
+            continue;
+
+        bool used = false;
+        for (unsigned j{ 0 }; j < geometries_.Size() && !used; ++j)
+        {
+            for (unsigned k{ 0 }; k < geometries_[j].Size() && !used; ++k)
+                used = geometries_[j][k] && geometries_[j][k]->GetIndexBuffer() == buffer;
+        }
+
+        if (!used)
+        {
+            memoryUse -= Min(memoryUse, (unsigned)sizeof(IndexBuffer) + buffer->GetIndexCount() * buffer->GetIndexSize());
+            indexBuffers_.Remove(replacedBuffers[i]);
+        }
+    }
+
+    SetMemoryUse(memoryUse);
+    return generated;
+}
+
+bool Model::OptimizeGeometries(VertexCacheStatistics* before, VertexCacheStatistics* after)
+{
+    bool optimized = false;
+    // LOD levels and geometries may draw the same index range, which must be reordered only once
+    PODVector<Geometry*> optimizedRanges;
+
+    for (unsigned i{ 0 }; i < geometries_.Size(); ++i)
+    {
+        for (unsigned j{ 0 }; j < geometries_[i].Size(); ++j)
+        {
+            Geometry* geometry = geometries_[i][j];
+            if (!geometry || geometry->GetPrimitiveType() != TRIANGLE_LIST || geometry->GetIndexCount() < 6 ||
+                !geometry->GetNumVertexBuffers())
+                continue;
+
+            IndexBuffer* indexBuffer = geometry->GetIndexBuffer();
+            VertexBuffer* vertexBuffer = geometry->GetVertexBuffer(0);
+            if (!indexBuffer || !indexBuffer->GetShadowData() || !vertexBuffer || !vertexBuffer->GetShadowData() ||
+                geometry->GetIndexStart() + geometry->GetIndexCount() > indexBuffer->GetIndexCount())
+                continue;
+
+            bool done = false;
+            for (unsigned k{ 0 }; k < optimizedRanges.Size(); ++k)
+            {
+                if (IsSameIndexRange(geometry, optimizedRanges[k]))
+                {
+                    done = true;
+                    break;
+                }
+            }
+            if (done)
+                continue;
+
+            optimizedRanges.Push(geometry);
+
+            PODVector<unsigned> indices;
+            ReadIndexRange(indices, indexBuffer, geometry->GetIndexStart(), geometry->GetIndexCount());
+            const unsigned vertexCount = vertexBuffer->GetVertexCount();
+
+            if (before)
+                before->Add(AnalyzeVertexCache(&indices[0], indices.Size(), vertexCount));
+
+            OptimizeVertexCache(&indices[0], indices.Size(), vertexCount);
+
+            const unsigned positionOffset = vertexBuffer->GetElementOffset(TYPE_VECTOR3, SEM_POSITION);
+            if (positionOffset != M_MAX_UNSIGNED)
+            {
+                OptimizeOverdraw(&indices[0], indices.Size(), vertexBuffer->GetShadowData() + positionOffset,
+                    vertexBuffer->GetVertexSize(), vertexCount);
+            }
+
+            if (after)
+                after->Add(AnalyzeVertexCache(&indices[0], indices.Size(), vertexCount));
+
+            if (WriteIndexRange(indexBuffer, geometry->GetIndexStart(), indices))
+                optimized = true;
+        }
+    }
+
+    // Reorder the vertices by first use in the optimized triangle order. Buffers are skipped when they are morphed or when
+    // the index ranges drawing them are also used with other vertex buffers
+    for (unsigned i{ 0 }; i < vertexBuffers_.Size(); ++i)
+    {
+        VertexBuffer* vertexBuffer = vertexBuffers_[i];
+        if (!vertexBuffer || !vertexBuffer->GetShadowData() || GetMorphRangeCount(i))
+            continue;
+
+        bool eligible = true;
+        for (unsigned j{ 0 }; j < morphs_.Size() && eligible; ++j)
+        {
+            if (morphs_[j].buffers_.Contains(i))
+                eligible = false;
+        }
+
+        PODVector<Geometry*> users;
+        PODVector<Geometry*> ranges;
+        for (unsigned j{ 0 }; j < geometries_.Size() && eligible; ++j)
+        {
+            for (unsigned k{ 0 }; k < geometries_[j].Size(); ++k)
+            {
+                Geometry* geometry = geometries_[j][k];
+                if (!geometry)
+                    continue;
+
+                bool usesBuffer = false;
+                for (unsigned l{ 0 }; l < geometry->GetNumVertexBuffers(); ++l)
+                {
+                    if (geometry->GetVertexBuffer(l) == vertexBuffer)
+                        usesBuffer = true;
+                }
+                if (!usesBuffer)
+                    continue;
+
+                IndexBuffer* indexBuffer = geometry->GetIndexBuffer();
+                if (geometry->GetNumVertexBuffers() != 1 || !indexBuffer || !indexBuffer->GetShadowData() ||
+                    !geometry->GetIndexCount())
+                {
+                    eligible = false;
+                    break;
+                }
+
+                users.Push(geometry);
+
+                bool known = false;
+                for (unsigned l{ 0 }; l < ranges.Size(); ++l)
+                {
+                    if (IsSameIndexRange(geometry, ranges[l]))
+                        known = true;
+                }
+                if (!known)
+                    ranges.Push(geometry);
+            }
+        }
+
+        if (!eligible || users.IsEmpty())
+            continue;
+
+        for (unsigned j{ 0 }; j < geometries_.Size() && eligible; ++j)
+        {
+            for (unsigned k{ 0 }; k < geometries_[j].Size(); ++k)
+            {
+                Geometry* geometry = geometries_[j][k];
+                if (!geometry || users.Contains(geometry))
+                    continue;
+
+                for (unsigned l{ 0 }; l < ranges.Size(); ++l)
+                {
+                    if (geometry->GetIndexBuffer() == ranges[l]->GetIndexBuffer())
+                        eligible = false;
+                }
+            }
+        }
+
+        if (!eligible)
+            continue;
+
+        const unsigned vertexCount = vertexBuffer->GetVertexCount();
+        PODVector<unsigned> allIndices;
+        Vector<PODVector<unsigned> > rangeIndices(ranges.Size());
+        for (unsigned j{ 0 }; j < ranges.Size(); ++j)
+        {
+            ReadIndexRange(rangeIndices[j], ranges[j]->GetIndexBuffer(), ranges[j]->GetIndexStart(), ranges[j]->GetIndexCount());
+            allIndices.Push(rangeIndices[j]);
+        }
+
+        PODVector<unsigned> remap;
+        GetVertexFetchRemap(remap, &allIndices[0], allIndices.Size(), vertexCount);
+
+        bool identity = true;
+        for (unsigned j{ 0 }; j < vertexCount && identity; ++j)
+            identity = remap[j] == j;
+        if (identity)
+            continue;
+
+        const unsigned vertexSize = vertexBuffer->GetVertexSize();
+        const unsigned char* source = vertexBuffer->GetShadowData();
+        SharedArrayPtr<unsigned char> remapped(new unsigned char[vertexCount * vertexSize]);
+        for (unsigned j{ 0 }; j < vertexCount; ++j)
+            memcpy(remapped.Get() + remap[j] * vertexSize, source + j * vertexSize, vertexSize);
+
+        if (!vertexBuffer->SetData(remapped.Get()))
+            continue;
+
+        for (unsigned j{ 0 }; j < ranges.Size(); ++j)
+        {
+            PODVector<unsigned>& indices = rangeIndices[j];
+            for (unsigned k{ 0 }; k < indices.Size(); ++k)
+            {
+                if (indices[k] < vertexCount)
+                    indices[k] = remap[indices[k]];
+            }
+
+            WriteIndexRange(ranges[j]->GetIndexBuffer(), ranges[j]->GetIndexStart(), indices);
+        }
+
+        // The vertex ranges have moved along with the vertices
+        for (unsigned j{ 0 }; j < users.Size(); ++j)
+            users[j]->SetDrawRange(users[j]->GetPrimitiveType(), users[j]->GetIndexStart(), users[j]->GetIndexCount());
+
+        optimized = true;
+    }
+
+    // The meshlets were built on the old triangle order
+    if (optimized)
+    {
+        unsigned memoryUse = GetMemoryUse();
+        for (unsigned i{ 0 }; i < geometryMeshlets_.Size(); ++i)
+        {
+            memoryUse -= geometryMeshlets_[i].Size() * sizeof(Meshlet);
+            geometryMeshlets_[i].Clear();
+        }
+
+        SetMemoryUse(memoryUse);
+    }
+
+    return optimized;
+}
+
+bool Model::BuildMeshlets(unsigned maxTriangles)
+{
+    unsigned memoryUse = GetMemoryUse();
+    bool built = false;
+    geometryMeshlets_.Resize(geometries_.Size());
+
+    for (unsigned i{ 0 }; i < geometries_.Size(); ++i)
+    {
+        PODVector<Meshlet>& meshlets = geometryMeshlets_[i];
+        memoryUse -= meshlets.Size() * sizeof(Meshlet);
+        meshlets.Clear();
+
+        Geometry* geometry = GetGeometry(i, 0);
+        if (!geometry || geometry->GetPrimitiveType() != TRIANGLE_LIST || !geometry->GetIndexCount() ||
+            !geometry->GetNumVertexBuffers())
+            continue;
+
+        IndexBuffer* indexBuffer = geometry->GetIndexBuffer();
+        VertexBuffer* vertexBuffer = geometry->GetVertexBuffer(0);
+        if (!indexBuffer || !indexBuffer->GetShadowData() || !vertexBuffer || !vertexBuffer->GetShadowData() ||
+            geometry->GetIndexStart() + geometry->GetIndexCount() > indexBuffer->GetIndexCount())
+            continue;
+
+        const unsigned positionOffset = vertexBuffer->GetElementOffset(TYPE_VECTOR3, SEM_POSITION);
+        if (positionOffset == M_MAX_UNSIGNED)
+            continue;
+
+        // A geometry drawing the same index range as an earlier one shares its meshlets, as reordering again would break them
+        bool shared = false;
+        for (unsigned j{ 0 }; j < i; ++j)
+        {
+            Geometry* other = GetGeometry(j, 0);
+            if (other && IsSameIndexRange(geometry, other))
+            {
+                meshlets = geometryMeshlets_[j];
+                shared = true;
+                break;
+            }
+        }
+
+        if (!shared)
+        {
+            PODVector<unsigned> indices;
+            ReadIndexRange(indices, indexBuffer, geometry->GetIndexStart(), geometry->GetIndexCount());
+            Dry::BuildMeshlets(meshlets, &indices[0], indices.Size(), vertexBuffer->GetShadowData() + positionOffset,
+                vertexBuffer->GetVertexSize(), vertexBuffer->GetVertexCount(), maxTriangles);
+
+            if (meshlets.IsEmpty() || !WriteIndexRange(indexBuffer, geometry->GetIndexStart(), indices))
+            {
+                meshlets.Clear();
+                continue;
+            }
+
+            for (unsigned j{ 0 }; j < meshlets.Size(); ++j)
+                meshlets[j].indexStart_ += geometry->GetIndexStart();
+        }
+
+        memoryUse += meshlets.Size() * sizeof(Meshlet);
+        built = true;
+    }
+
+    SetMemoryUse(memoryUse);
+    return built;
+}
+
+bool Model::QuantizeTexCoords()
+{
+    unsigned memoryUse = GetMemoryUse();
+    bool quantized = false;
+
+    for (unsigned i{ 0 }; i < vertexBuffers_.Size(); ++i)
+    {
+        VertexBuffer* vertexBuffer = vertexBuffers_[i];
+        if (!vertexBuffer || !vertexBuffer->GetShadowData() || GetMorphRangeCount(i))
+            continue;
+
+        bool morphed = false;
+        for (unsigned j{ 0 }; j < morphs_.Size(); ++j)
+        {
+            if (morphs_[j].buffers_.Contains(i))
+                morphed = true;
+        }
+        if (morphed)
+            continue;
+
+        const PODVector<VertexElement> oldElements = vertexBuffer->GetElements();
+        PODVector<VertexElement> newElements = oldElements;
+        bool hasTexCoords = false;
+        for (unsigned j{ 0 }; j < newElements.Size(); ++j)
+        {
+            if (newElements[j].type_ == TYPE_VECTOR2 && newElements[j].semantic_ == SEM_TEXCOORD)
+            {
+                newElements[j].type_ = TYPE_HALF2;
+                hasTexCoords = true;
+            }
+        }
+        if (!hasTexCoords)
+            continue;
+
+        const unsigned vertexCount = vertexBuffer->GetVertexCount();
+        const unsigned oldVertexSize = vertexBuffer->GetVertexSize();
+        const unsigned oldSize = vertexCount * oldVertexSize;
+        SharedArrayPtr<unsigned char> oldData(new unsigned char[oldSize]);
+        memcpy(oldData.Get(), vertexBuffer->GetShadowData(), oldSize);
+
+        if (!vertexBuffer->SetSize(vertexCount, newElements, vertexBuffer->IsDynamic()))
+            continue;
+
+        const PODVector<VertexElement>& elements = vertexBuffer->GetElements();
+        const unsigned newVertexSize = vertexBuffer->GetVertexSize();
+        SharedArrayPtr<unsigned char> newData(new unsigned char[vertexCount * newVertexSize]);
+
+        for (unsigned j{ 0 }; j < vertexCount; ++j)
+        {
+            const unsigned char* src = oldData.Get() + j * oldVertexSize;
+            unsigned char* dest = newData.Get() + j * newVertexSize;
+
+            for (unsigned k{ 0 }; k < elements.Size(); ++k)
+            {
+                if (elements[k].type_ == TYPE_HALF2 && oldElements[k].type_ == TYPE_VECTOR2)
+                {
+                    const auto* uv = reinterpret_cast<const float*>(src + oldElements[k].offset_);
+                    auto* halfUv = reinterpret_cast<unsigned short*>(dest + elements[k].offset_);
+                    halfUv[0] = FloatToHalf(uv[0]);
+                    halfUv[1] = FloatToHalf(uv[1]);
+                }
+                else
+                    memcpy(dest + elements[k].offset_, src + oldElements[k].offset_, ELEMENT_TYPESIZES[elements[k].type_]);
+            }
+        }
+
+        vertexBuffer->SetData(newData.Get());
+        memoryUse -= oldSize;
+        memoryUse += vertexCount * newVertexSize;
+        quantized = true;
+    }
+
+    SetMemoryUse(memoryUse);
+    return quantized;
 }
 
 SharedPtr<Model> Model::Clone(const String& cloneName) const
@@ -624,6 +1271,7 @@ SharedPtr<Model> Model::Clone(const String& cloneName) const
     ret->skeleton_ = skeleton_;
     ret->geometryBoneMappings_ = geometryBoneMappings_;
     ret->geometryCenters_ = geometryCenters_;
+    ret->geometryMeshlets_ = geometryMeshlets_;
     ret->morphs_ = morphs_;
     ret->morphRangeStarts_ = morphRangeStarts_;
     ret->morphRangeCounts_ = morphRangeCounts_;
@@ -725,6 +1373,7 @@ SharedPtr<Model> Model::Clone(const String& cloneName) const
                 SharedArrayPtr<unsigned char> cloneData(new unsigned char[vbMorph.dataSize_]);
                 memcpy(cloneData.Get(), vbMorph.morphData_.Get(), vbMorph.dataSize_);
                 vbMorph.morphData_ = cloneData;
+                BuildMorphDeltas(vbMorph);
             }
         }
     }
@@ -750,6 +1399,12 @@ Geometry* Model::GetGeometry(unsigned index, unsigned lodLevel) const
     return geometries_[index][lodLevel];
 }
 
+const PODVector<Meshlet>& Model::GetGeometryMeshlets(unsigned index) const
+{
+    static const PODVector<Meshlet> noMeshlets;
+    return index < geometryMeshlets_.Size() ? geometryMeshlets_[index] : noMeshlets;
+}
+
 const ModelMorph* Model::GetMorph(unsigned index) const
 {
     return index < morphs_.Size() ? &morphs_[index] : nullptr;
@@ -26,6 +26,7 @@
 #include "../Container/ArrayPtr.h"
 #include "../Container/Ptr.h"
 #include "../Graphics/GraphicsDefs.h"
+#include "../Graphics/MeshOptimizer.h"
 #include "../Graphics/Skeleton.h"
 #include "../Math/BoundingBox.h"
 #include "../Resource/Resource.h"
@@ -38,6 +39,11 @@ class IndexBuffer;
 class Graphics;
 class VertexBuffer;
 
+/// Default ratio of triangles kept in each generated LOD level.
+static const float DEFAULT_LOD_REDUCTION = 0.5f;
+/// Default LOD distance between generated LOD levels.
+static const float DEFAULT_LOD_DISTANCE_STEP = 10.0f;
+
 /// Vertex buffer morph data.
 struct VertexBufferMorph
 {
@@ -49,6 +55,12 @@ struct VertexBufferMorph
     unsigned dataSize_;
     /// Morphed vertices. Stored packed as <index, data> pairs.
     SharedArrayPtr<unsigned char> morphData_;
+    /// First vertex covered by the dense deltas.
+    unsigned deltaStart_{};
+    /// Number of vertices covered by the dense deltas.
+    unsigned deltaCount_{};
+    /// Dense deltas as planes of x, y and z components of the morphed elements, in position, normal and tangent order. Null when the morph is too sparse for them.
+    SharedArrayPtr<float> deltas_;
 };
 
 /// Definition of a model's vertex morph.
@@ -148,6 +160,14 @@ public:
     void SetMorphs(const Vector<ModelMorph>& morphs);
     /// Clone the model. The geometry data is deep-copied and can be modified in the clone without affecting the original.
     SharedPtr<Model> Clone(const String& cloneName = String::EMPTY) const;
+    /// Generate LOD levels for all geometries by simplifying their first LOD level, replacing the other levels. Each level keeps a ratio of the triangles of the previous one and starts one distance step further. The generated levels share the vertex buffers and get new index buffers. Requires shadowed triangle list geometries. Return true if any levels were generated.
+    bool GenerateLodLevels(unsigned numLevels, float reduction = DEFAULT_LOD_REDUCTION, float distanceStep = DEFAULT_LOD_DISTANCE_STEP);
+    /// Reorder the triangles of all triangle list geometries for the post-transform vertex cache and less overdraw, then reorder the vertices of buffers without morphs by first use. Requires shadowed buffers. Optionally return the vertex cache statistics before and after. Return true if any geometry was optimized.
+    bool OptimizeGeometries(VertexCacheStatistics* before = nullptr, VertexCacheStatistics* after = nullptr);
+    /// Convert 2D float texture coordinates of shadowed vertex buffers without morphs to half floats. Return true if any buffer was converted.
+    bool QuantizeTexCoords();
+    /// Split the first LOD level of all triangle list geometries into meshlets for per-view cluster culling, reordering their triangles so that each meshlet is a contiguous index range. Requires shadowed buffers. Return true if any geometry was split.
+    bool BuildMeshlets(unsigned maxTriangles = DEFAULT_MESHLET_TRIANGLES);
 
     /// Return bounding box.
     const BoundingBox& GetBoundingBox() const { return boundingBox_; }
@@ -182,6 +202,9 @@ public:
         return index < geometryCenters_.Size() ? geometryCenters_[index] : Vector3::ZERO;
     }
 
+    /// Return meshlets of the first LOD level of a geometry. Empty if not built.
+    const PODVector<Meshlet>& GetGeometryMeshlets(unsigned index) const;
+
     /// Return geometery bone mappings.
     const Vector<PODVector<unsigned> >& GetGeometryBoneMappings() const { return geometryBoneMappings_; }
 
@@ -217,6 +240,8 @@ private:
     Vector<PODVector<unsigned> > geometryBoneMappings_;
     /// Geometry centers.
     PODVector<Vector3> geometryCenters_;
+    /// Meshlets of the first LOD level of each geometry.
+    Vector<PODVector<Meshlet> > geometryMeshlets_;
     /// Vertex morphs.
     Vector<ModelMorph> morphs_;
     /// Vertex buffer morph range start.
@@ -71,6 +71,7 @@ bool ConstantBuffer::SetSize(unsigned size)
 
     size_ = size;
     dirty_ = false;
+    ringFrame_ = 0;
     shadowData_ = new unsigned char[size_];
     memset(shadowData_.Get(), 0, size_);
 
@@ -89,14 +90,23 @@ bool ConstantBuffer::SetSize(unsigned size)
 
 void ConstantBuffer::Apply()
 {
-    if (dirty_ && objectName_)
+    // Data that went to the uniform ring buffer is missing from the buffer's own storage
+    if ((dirty_ || ringFrame_) && objectName_)
     {
 #ifndef GL_ES_VERSION_2_0
         graphics_->SetUBO(objectName_);
         glBufferData(GL_UNIFORM_BUFFER, size_, shadowData_.Get(), GL_DYNAMIC_DRAW);
 #endif
         dirty_ = false;
+        ringFrame_ = 0;
     }
 }
 
+void ConstantBuffer::SetRingCopy(unsigned offset, unsigned frame)
+{
+    ringOffset_ = offset;
+    ringFrame_ = frame;
+    dirty_ = false;
+}
+
 }
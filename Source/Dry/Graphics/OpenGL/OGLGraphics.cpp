@@ -41,7 +41,9 @@
 #include "../../Graphics/TextureCube.h"
 #include "../../Graphics/VertexBuffer.h"
 #include "../../IO/File.h"
+#include "../../IO/FileSystem.h"
 #include "../../IO/Log.h"
+#include "../../Resource/DerivedDataCache.h"
 #include "../../Resource/ResourceCache.h"
 
 #include <SDL/SDL.h>
@@ -229,7 +231,12 @@ static const unsigned glElementTypes[] =
     GL_FLOAT,
     GL_FLOAT,
     GL_UNSIGNED_BYTE,
-    GL_UNSIGNED_BYTE
+    GL_UNSIGNED_BYTE,
+#ifndef GL_ES_VERSION_2_0
+    GL_HALF_FLOAT_ARB
+#else
+    GL_HALF_FLOAT_OES
+#endif
 };
 
 static const unsigned glElementComponents[] =
@@ -240,7 +247,8 @@ static const unsigned glElementComponents[] =
     3,
     4,
     4,
-    4
+    4,
+    2
 };
 
 #ifdef GL_ES_VERSION_2_0
@@ -720,6 +728,9 @@ bool Graphics::BeginFrame()
     for (unsigned i{ 0 }; i < MAX_TEXTURE_UNITS; ++i)
         SetTexture(i, nullptr);
 
+    UpdatePendingShaderPrograms();
+    BeginUniformRingFrame();
+
     // Enable color and depth write
     SetColorWrite(true);
     SetDepthWrite(true);
@@ -741,10 +752,18 @@ void Graphics::EndFrame()
 
     SendEvent(E_ENDRENDERING);
 
+#ifndef GL_ES_VERSION_2_0
+    // Mark when the GPU is done with this frame's part of the uniform ring buffer
+    if (impl_->uniformRing_)
+        impl_->uniformRingFences_[impl_->uniformRingSegment_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif
+
     SDL_GL_SwapWindow(window_);
 
     // Clean up too large scratch buffers
     CleanupScratchBuffers();
+    // Clean up pipeline states that are no longer in use
+    CleanupPipelineStates();
 }
 
 void Graphics::Clear(ClearTargetFlags flags, const Color& color, float depth, unsigned stencil)
@@ -881,6 +900,53 @@ bool Graphics::ResolveToTexture(Texture2D* texture)
 #endif
 }
 
+bool Graphics::CopyDepthRect(Texture2D* source, Texture2D* destination, const IntRect& rect)
+{
+#ifndef GL_ES_VERSION_2_0
+    if (!source || !destination || !gl3Support || source->GetFormat() != destination->GetFormat())
+        return false;
+
+    DRY_PROFILE(CopyDepthRect);
+
+    // Use the resolve FBOs to not disturb the currently set rendertarget(s)
+    if (!impl_->resolveSrcFBO_)
+        impl_->resolveSrcFBO_ = CreateFramebuffer();
+    if (!impl_->resolveDestFBO_)
+        impl_->resolveDestFBO_ = CreateFramebuffer();
+
+    // Blits are clipped by the scissor test
+    SetScissorTest(false);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, impl_->resolveSrcFBO_);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, source->GetGPUObjectName(), 0);
+    glReadBuffer(GL_NONE);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, impl_->resolveDestFBO_);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, destination->GetGPUObjectName(), 0);
+    glDrawBuffer(GL_NONE);
+
+    // Rendertarget rows are flipped on OpenGL
+    const int sourceHeight = source->GetHeight();
+    const int destHeight = destination->GetHeight();
+    glBlitFramebuffer(rect.left_, sourceHeight - rect.bottom_, rect.right_, sourceHeight - rect.top_,
+        rect.left_, destHeight - rect.bottom_, rect.right_, destHeight - rect.top_, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+    // Detach the depth textures and restore the color buffers used in resolving
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, 0, 0);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, 0, 0);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+    // Restore previously bound FBO
+    BindFramebuffer(impl_->boundFBO_);
+    return true;
+#else
+    // Not supported on GLES
+    return false;
+#endif
+}
+
 bool Graphics::ResolveToTexture(TextureCube* texture)
 {
 #ifndef GL_ES_VERSION_2_0
@@ -1068,6 +1134,37 @@ void Graphics::DrawInstanced(PrimitiveType type, unsigned indexStart, unsigned i
 #endif
 }
 
+void Graphics::MultiDrawIndirect(PrimitiveType type, const IndirectDrawCommand* commands, unsigned count)
+{
+#ifndef GL_ES_VERSION_2_0
+    if (!count || !indexBuffer_ || !indexBuffer_->GetGPUObjectName() || !multiDrawIndirectSupport_)
+        return;
+
+    PrepareDraw();
+
+    unsigned indexSize = indexBuffer_->GetIndexSize();
+    unsigned primitiveCount{ 0 };
+    GLenum glPrimitiveType{ GL_TRIANGLES };
+
+    for (unsigned i{ 0 }; i < count; ++i)
+    {
+        GetGLPrimitiveType(commands[i].indexCount_, type, primitiveCount, glPrimitiveType);
+        numPrimitives_ += commands[i].instanceCount_ * primitiveCount;
+    }
+    GLenum indexType = indexSize == sizeof(unsigned short) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+    if (!impl_->indirectBuffer_)
+        glGenBuffers(1, &impl_->indirectBuffer_);
+
+    // Respecify the storage each call, so that the driver does not wait for earlier draws reading the commands
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, impl_->indirectBuffer_);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, count * sizeof(IndirectDrawCommand), commands, GL_STREAM_DRAW);
+    glMultiDrawElementsIndirect(glPrimitiveType, indexType, nullptr, count, 0);
+
+    ++numBatches_;
+#endif
+}
+
 void Graphics::SetVertexBuffer(VertexBuffer* buffer)
 {
     // Note: this is not multi-instance safe
@@ -1124,6 +1221,8 @@ void Graphics::SetShaders(ShaderVariation* vs, ShaderVariation* ps)
     if (vs == vertexShader_ && ps == pixelShader_)
         return;
 
+    pipelineState_ = nullptr;
+
     // Compile the shaders now if not yet compiled. If already attempted, do not retry
     if (vs && !vs->GetGPUObjectName())
     {
@@ -1180,6 +1279,10 @@ void Graphics::SetShaders(ShaderVariation* vs, ShaderVariation* ps)
 
         if (i != impl_->shaderPrograms_.End())
         {
+            // A program still compiling in the background is needed now, so wait for it
+            if (i->second_->IsLinkPending())
+                FinishShaderProgram(i->second_);
+
             // Use the existing linked program
             if (i->second_->GetGPUObjectName())
             {
@@ -1227,10 +1330,14 @@ void Graphics::SetShaders(ShaderVariation* vs, ShaderVariation* ps)
             ConstantBuffer* buffer = constantBuffers[i].Get();
             if (buffer != impl_->constantBuffers_[i])
             {
-                unsigned object = buffer ? buffer->GetGPUObjectName() : 0;
-                glBindBufferBase(GL_UNIFORM_BUFFER, i, object);
-                // Calling glBindBufferBase also affects the generic buffer binding point
-                impl_->boundUBO_ = object;
+                // With the uniform ring buffer, ranges are bound when drawing
+                if (!impl_->uniformRing_)
+                {
+                    unsigned object = buffer ? buffer->GetGPUObjectName() : 0;
+                    glBindBufferBase(GL_UNIFORM_BUFFER, i, object);
+                    // Calling glBindBufferBase also affects the generic buffer binding point
+                    impl_->boundUBO_ = object;
+                }
                 impl_->constantBuffers_[i] = buffer;
                 ShaderProgram::ClearGlobalParameterSource((ShaderParameterGroup)(i % MAX_SHADER_PARAMETER_GROUPS));
             }
@@ -1258,6 +1365,163 @@ void Graphics::SetShaders(ShaderVariation* vs, ShaderVariation* ps)
     impl_->vertexBuffersDirty_ = true;
 }
 
+bool Graphics::IsShaderProgramReady(ShaderVariation* vs, ShaderVariation* ps)
+{
+    if (!asyncShaders_ || !vs || !ps)
+        return true;
+
+    Pair<ShaderVariation*, ShaderVariation*> combination(vs, ps);
+    ShaderProgramMap::Iterator i = impl_->shaderPrograms_.Find(combination);
+    if (i != impl_->shaderPrograms_.End())
+    {
+        ShaderProgram* program = i->second_;
+        if (!program->IsLinkPending())
+            return true;
+        if (!program->IsLinkComplete())
+            return false;
+
+        FinishShaderProgram(program);
+        return true;
+    }
+
+    // Shaders that failed before are not retried, SetShaders() skips them
+    if ((!vs->GetGPUObjectName() && !vs->GetCompilerOutput().IsEmpty()) ||
+        (!ps->GetGPUObjectName() && !ps->GetCompilerOutput().IsEmpty()))
+        return true;
+
+    if (parallelShaderCompileSupport_)
+    {
+        DRY_PROFILE(BeginCompileShaders);
+
+        // Submit the compiles and the link, and check the results once the driver reports the program complete
+        if ((!vs->GetGPUObjectName() && !vs->BeginCreate()) || (!ps->GetGPUObjectName() && !ps->BeginCreate()))
+            return true;
+
+        SharedPtr<ShaderProgram> newProgram(new ShaderProgram(this, vs, ps));
+        impl_->shaderPrograms_[combination] = newProgram;
+        if (!newProgram->BeginLink())
+            return true;
+
+        // A program loaded from the binary cache is complete already
+        if (newProgram->IsLinkComplete())
+        {
+            FinishShaderProgram(newProgram);
+            return true;
+        }
+
+        impl_->pendingShaderPrograms_.Push(newProgram);
+        return false;
+    }
+
+    // Otherwise link on the shared context of the program binary thread. SetShaders() loads the binary once written
+    HashMap<Pair<ShaderVariation*, ShaderVariation*>, String>::Iterator j = impl_->pendingProgramBinaries_.Find(combination);
+    if (j != impl_->pendingProgramBinaries_.End())
+    {
+        if (impl_->programBinaryThread_ && impl_->programBinaryThread_->IsPending(j->second_))
+            return false;
+
+        const String fileName = j->second_;
+        impl_->pendingProgramBinaries_.Erase(j);
+        FinishProgramBinary(vs, ps, fileName);
+        return true;
+    }
+
+    if (!impl_->programBinarySupport_)
+        return true;
+
+    const String vsCode = vs->GetShaderCode();
+    const String psCode = ps->GetShaderCode();
+    const String fileName = ShaderProgram::GetBinaryFileName(this, vsCode, psCode);
+    if (fileName.IsEmpty() || GetSubsystem<FileSystem>()->FileExists(fileName))
+        return true;
+
+    if (!impl_->programBinaryThread_)
+        impl_->programBinaryThread_ = new ProgramBinaryThread(this);
+
+    impl_->programBinaryThread_->AddProgram(vsCode, psCode, fileName);
+    if (!impl_->programBinaryThread_->Start())
+    {
+        // No shared context, compile synchronously from now on
+        impl_->programBinaryThread_.Reset();
+        impl_->programBinarySupport_ = false;
+        return true;
+    }
+
+    impl_->pendingProgramBinaries_[combination] = fileName;
+    return false;
+}
+
+unsigned Graphics::GetNumPendingShaderPrograms() const
+{
+    return impl_->pendingShaderPrograms_.Size() + impl_->pendingProgramBinaries_.Size();
+}
+
+void Graphics::FinishShaderProgram(ShaderProgram* program)
+{
+    SharedPtr<ShaderProgram> programPtr(program);
+    impl_->pendingShaderPrograms_.Remove(programPtr);
+
+    ShaderVariation* vs = program->GetVertexShader();
+    ShaderVariation* ps = program->GetPixelShader();
+    if (!vs || !ps)
+    {
+        program->Release();
+        return;
+    }
+
+    if (!vs->CheckCompileStatus())
+        DRY_LOGERROR("Failed to compile vertex shader " + vs->GetFullName() + ":\n" + vs->GetCompilerOutput());
+    else if (!ps->CheckCompileStatus())
+        DRY_LOGERROR("Failed to compile pixel shader " + ps->GetFullName() + ":\n" + ps->GetCompilerOutput());
+    else if (program->EndLink())
+        DRY_LOGDEBUG("Linked vertex shader " + vs->GetFullName() + " and pixel shader " + ps->GetFullName());
+    else
+        DRY_LOGERROR("Failed to link vertex shader " + vs->GetFullName() + " and pixel shader " + ps->GetFullName() + ":\n" +
+                     program->GetLinkerOutput());
+
+    if (program->IsLinkPending())
+        program->Release();
+
+    // Linking binds the program to set the texture sampler uniforms, so restore the program in use
+    glUseProgram(impl_->shaderProgram_ ? impl_->shaderProgram_->GetGPUObjectName() : 0);
+}
+
+void Graphics::UpdatePendingShaderPrograms()
+{
+    for (unsigned i = impl_->pendingShaderPrograms_.Size() - 1; i < impl_->pendingShaderPrograms_.Size(); --i)
+    {
+        ShaderProgram* program = impl_->pendingShaderPrograms_[i];
+        if (program->IsLinkComplete())
+            FinishShaderProgram(program);
+    }
+
+    for (HashMap<Pair<ShaderVariation*, ShaderVariation*>, String>::Iterator i = impl_->pendingProgramBinaries_.Begin();
+         i != impl_->pendingProgramBinaries_.End();)
+    {
+        if (!impl_->programBinaryThread_ || !impl_->programBinaryThread_->IsPending(i->second_))
+        {
+            const Pair<ShaderVariation*, ShaderVariation*> combination = i->first_;
+            const String fileName = i->second_;
+            i = impl_->pendingProgramBinaries_.Erase(i);
+            FinishProgramBinary(combination.first_, combination.second_, fileName);
+        }
+        else
+            ++i;
+    }
+}
+
+void Graphics::FinishProgramBinary(ShaderVariation* vs, ShaderVariation* ps, const String& fileName)
+{
+    String output;
+    if (!impl_->programBinaryThread_ || !impl_->programBinaryThread_->TakeFailure(fileName, output))
+        return;
+
+    DRY_LOGERROR("Failed to link vertex shader " + vs->GetFullName() + " and pixel shader " + ps->GetFullName() + ":\n" + output);
+
+    // Store the combination without a program object, so that it is neither queued again nor linked on the main thread
+    impl_->shaderPrograms_[MakePair(vs, ps)] = new ShaderProgram(this, vs, ps);
+}
+
 void Graphics::SetShaderParameter(StringHash param, const float* data, unsigned count)
 {
     if (impl_->shaderProgram_)
@@ -1867,6 +2131,7 @@ void Graphics::SetBlendMode(BlendMode mode, bool alphaToCoverage)
         }
 
         blendMode_ = mode;
+        pipelineState_ = nullptr;
     }
 
     if (alphaToCoverage != alphaToCoverage_)
@@ -1877,6 +2142,7 @@ void Graphics::SetBlendMode(BlendMode mode, bool alphaToCoverage)
             glDisable(GL_SAMPLE_ALPHA_TO_COVERAGE);
 
         alphaToCoverage_ = alphaToCoverage;
+        pipelineState_ = nullptr;
     }
 }
 
@@ -1907,6 +2173,7 @@ void Graphics::SetCullMode(CullMode mode)
         }
 
         cullMode_ = mode;
+        pipelineState_ = nullptr;
     }
 }
 
@@ -1927,6 +2194,8 @@ void Graphics::SetDepthBias(float constantBias, float slopeScaledBias)
 
         constantDepthBias_ = constantBias;
         slopeScaledDepthBias_ = slopeScaledBias;
+        if (pipelineState_ && pipelineState_->GetDesc().hasDepthBias_)
+            pipelineState_ = nullptr;
         // Force update of the projection matrix shader parameter
         ClearParameterSource(SP_CAMERA);
     }
@@ -1938,6 +2207,7 @@ void Graphics::SetDepthTest(CompareMode mode)
     {
         glDepthFunc(glCmpFunc[mode]);
         depthTestMode_ = mode;
+        pipelineState_ = nullptr;
     }
 }
 
@@ -1947,6 +2217,7 @@ void Graphics::SetDepthWrite(bool enable)
     {
         glDepthMask(enable ? GL_TRUE : GL_FALSE);
         depthWrite_ = enable;
+        pipelineState_ = nullptr;
     }
 }
 
@@ -1957,6 +2228,7 @@ void Graphics::SetFillMode(FillMode mode)
     {
         glPolygonMode(GL_FRONT_AND_BACK, glFillMode[mode]);
         fillMode_ = mode;
+        pipelineState_ = nullptr;
     }
 #endif
 }
@@ -1971,6 +2243,7 @@ void Graphics::SetLineAntiAlias(bool enable)
         else
             glDisable(GL_LINE_SMOOTH);
         lineAntiAlias_ = enable;
+        pipelineState_ = nullptr;
     }
 #endif
 }
@@ -2100,6 +2373,10 @@ void Graphics::SetStencilTest(bool enable, CompareMode mode, StencilOp pass, Ste
     unsigned compareMask, unsigned writeMask)
 {
 #ifndef GL_ES_VERSION_2_0
+    // Pipeline states normally leave the stencil test to the caller
+    if (pipelineState_ && pipelineState_->GetDesc().hasStencil_)
+        pipelineState_ = nullptr;
+
     if (enable != stencilTest_)
     {
         if (enable)
@@ -2433,8 +2710,19 @@ void Graphics::CleanupShaderPrograms(ShaderVariation* variation)
             ++i;
     }
 
+    for (HashMap<Pair<ShaderVariation*, ShaderVariation*>, String>::Iterator i = impl_->pendingProgramBinaries_.Begin();
+         i != impl_->pendingProgramBinaries_.End();)
+    {
+        if (i->first_.first_ == variation || i->first_.second_ == variation)
+            i = impl_->pendingProgramBinaries_.Erase(i);
+        else
+            ++i;
+    }
+
     if (vertexShader_ == variation || pixelShader_ == variation)
         impl_->shaderProgram_ = nullptr;
+
+    CleanupPipelineStates(variation);
 }
 
 ConstantBuffer* Graphics::GetOrCreateConstantBuffer(ShaderType /*type*/,  unsigned index, unsigned size)
@@ -2465,6 +2753,7 @@ void Graphics::Release(bool clearGPUObjects, bool closeWindow)
             // Shutting down: release all GPU objects that still exist
             // Shader programs are also GPU objects; clear them first to avoid list modification during iteration
             impl_->shaderPrograms_.Clear();
+            impl_->pendingShaderPrograms_.Clear();
 
             for (PODVector<GPUObject*>::Iterator i = gpuObjects_.Begin(); i != gpuObjects_.End(); ++i)
                 (*i)->Release();
@@ -2479,13 +2768,23 @@ void Graphics::Release(bool clearGPUObjects, bool closeWindow)
             // In this case clear shader programs last so that they do not attempt to delete their OpenGL program
             // from a context that may no longer exist
             impl_->shaderPrograms_.Clear();
+            impl_->pendingShaderPrograms_.Clear();
 
             SendEvent(E_DEVICELOST);
         }
     }
 
     CleanupFramebuffers();
+    ReleaseUniformRing();
+#ifndef GL_ES_VERSION_2_0
+    if (impl_->indirectBuffer_ && !IsDeviceLost())
+        glDeleteBuffers(1, &impl_->indirectBuffer_);
+    impl_->indirectBuffer_ = 0;
+#endif
     impl_->depthTextures_.Clear();
+    // Stop linking on the shared context before the main context goes away
+    impl_->programBinaryThread_.Reset();
+    impl_->pendingProgramBinaries_.Clear();
 
     // End fullscreen mode first to counteract transition and getting stuck problems on OS X
 #if defined(__APPLE__) && !defined(IOS) && !defined(TVOS)
@@ -2650,6 +2949,182 @@ void Graphics::SetUBO(unsigned object)
 #endif
 }
 
+void Graphics::SetUniformRingSize(unsigned size)
+{
+    if (size == uniformRingSize_)
+        return;
+
+    uniformRingSize_ = size;
+    // Recreated with the new size on the next frame
+    ReleaseUniformRing();
+}
+
+void Graphics::CreateUniformRing()
+{
+#ifndef GL_ES_VERSION_2_0
+    int alignment{ 0 };
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    impl_->uniformRingAlignment_ = (unsigned)Max(alignment, 16);
+
+    // Each frame gets an equal, aligned part
+    const unsigned segmentSize = uniformRingSize_ / NUM_UNIFORM_RING_SEGMENTS / impl_->uniformRingAlignment_ * impl_->uniformRingAlignment_;
+    if (!segmentSize)
+        return;
+
+    impl_->uniformRingSize_ = segmentSize * NUM_UNIFORM_RING_SEGMENTS;
+    glGenBuffers(1, &impl_->uniformRing_);
+    SetUBO(impl_->uniformRing_);
+
+    // Write through a persistent mapping where supported, otherwise with buffer sub-updates
+    if (glBufferStorage)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_UNIFORM_BUFFER, impl_->uniformRingSize_, nullptr, flags);
+        impl_->uniformRingData_ = static_cast<unsigned char*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, impl_->uniformRingSize_, flags));
+    }
+    if (!impl_->uniformRingData_)
+        glBufferData(GL_UNIFORM_BUFFER, impl_->uniformRingSize_, nullptr, GL_STREAM_DRAW);
+
+    impl_->uniformRingSegment_ = NUM_UNIFORM_RING_SEGMENTS - 1;
+    impl_->uniformRingOffset_ = impl_->uniformRingEnd_ = 0;
+
+    // Constant buffers are bound again as ranges of the ring
+    for (auto& object : impl_->uniformBindingObjects_)
+        object = 0;
+
+    DRY_LOGDEBUGF("Created uniform ring buffer of %u bytes, %s", impl_->uniformRingSize_,
+                  impl_->uniformRingData_ ? "persistently mapped" : "not mapped");
+#endif
+}
+
+void Graphics::ReleaseUniformRing()
+{
+#ifndef GL_ES_VERSION_2_0
+    if (!impl_->uniformRing_)
+        return;
+
+    if (!IsDeviceLost())
+    {
+        SetUBO(impl_->uniformRing_);
+        if (impl_->uniformRingData_)
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+        SetUBO(0);
+        glDeleteBuffers(1, &impl_->uniformRing_);
+
+        for (auto& fence : impl_->uniformRingFences_)
+        {
+            if (fence)
+                glDeleteSync(static_cast<GLsync>(fence));
+        }
+
+        // Bind the constant buffers' own storage on the next shader change
+        SetShaders(nullptr, nullptr);
+    }
+
+    impl_->uniformRing_ = 0;
+    impl_->uniformRingData_ = nullptr;
+    for (auto& fence : impl_->uniformRingFences_)
+        fence = nullptr;
+    for (auto& constantBuffer : impl_->constantBuffers_)
+        constantBuffer = nullptr;
+    for (auto& object : impl_->uniformBindingObjects_)
+        object = 0;
+#endif
+}
+
+void Graphics::BeginUniformRingFrame()
+{
+#ifndef GL_ES_VERSION_2_0
+    if (!gl3Support || !uniformRingSize_)
+        return;
+
+    if (!impl_->uniformRing_)
+    {
+        CreateUniformRing();
+        if (!impl_->uniformRing_)
+            return;
+    }
+
+    impl_->uniformRingSegment_ = (impl_->uniformRingSegment_ + 1) % NUM_UNIFORM_RING_SEGMENTS;
+
+    void*& fence = impl_->uniformRingFences_[impl_->uniformRingSegment_];
+    if (fence)
+    {
+        DRY_PROFILE(WaitUniformRing);
+        glClientWaitSync(static_cast<GLsync>(fence), GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ULL);
+        glDeleteSync(static_cast<GLsync>(fence));
+        fence = nullptr;
+    }
+
+    const unsigned segmentSize = impl_->uniformRingSize_ / NUM_UNIFORM_RING_SEGMENTS;
+    impl_->uniformRingOffset_ = impl_->uniformRingSegment_ * segmentSize;
+    impl_->uniformRingEnd_ = impl_->uniformRingOffset_ + segmentSize;
+
+    // Copies from earlier frames may be overwritten from now on. 0 means the buffer's own storage
+    if (!++impl_->uniformRingFrame_)
+        ++impl_->uniformRingFrame_;
+#endif
+}
+
+void Graphics::ApplyUniformRing()
+{
+#ifndef GL_ES_VERSION_2_0
+    // Buffers are checked through their bindings instead
+    impl_->dirtyConstantBuffers_.Clear();
+
+    for (unsigned i{ 0 }; i < MAX_SHADER_PARAMETER_GROUPS * 2; ++i)
+    {
+        ConstantBuffer* buffer = impl_->constantBuffers_[i];
+        if (!buffer)
+            continue;
+
+        unsigned object = impl_->uniformRing_;
+        unsigned offset = buffer->GetRingOffset();
+
+        // Copy changed data, or data copied during an earlier frame, to the ring
+        if (buffer->IsDirty() || buffer->GetRingFrame() != impl_->uniformRingFrame_)
+        {
+            const unsigned size = buffer->GetSize();
+            const unsigned alignment = impl_->uniformRingAlignment_;
+            offset = (impl_->uniformRingOffset_ + alignment - 1) / alignment * alignment;
+
+            if (offset + size <= impl_->uniformRingEnd_)
+            {
+                if (impl_->uniformRingData_)
+                    memcpy(impl_->uniformRingData_ + offset, buffer->GetShadowData(), size);
+                else
+                {
+                    SetUBO(impl_->uniformRing_);
+                    glBufferSubData(GL_UNIFORM_BUFFER, offset, size, buffer->GetShadowData());
+                }
+
+                impl_->uniformRingOffset_ = offset + size;
+                buffer->SetRingCopy(offset, impl_->uniformRingFrame_);
+            }
+            else
+            {
+                // This frame's part of the ring is full: use the buffer's own storage until the next frame
+                buffer->Apply();
+                object = buffer->GetGPUObjectName();
+                offset = 0;
+            }
+        }
+
+        if (object != impl_->uniformBindingObjects_[i] || offset != impl_->uniformBindingOffsets_[i])
+        {
+            if (object == impl_->uniformRing_)
+                glBindBufferRange(GL_UNIFORM_BUFFER, i, object, offset, buffer->GetSize());
+            else
+                glBindBufferBase(GL_UNIFORM_BUFFER, i, object);
+            // Binding also affects the generic buffer binding point
+            impl_->boundUBO_ = object;
+            impl_->uniformBindingObjects_[i] = object;
+            impl_->uniformBindingOffsets_[i] = offset;
+        }
+    }
+#endif
+}
+
 unsigned Graphics::GetAlphaFormat()
 {
 #ifndef GL_ES_VERSION_2_0
@@ -2844,6 +3319,10 @@ void Graphics::CheckFeatureSupport()
     {
         // Work around GLEW failure to check extensions properly from a GL3 context
         instancingSupport_ = glDrawElementsInstanced != nullptr && glVertexAttribDivisor != nullptr;
+        // Multi-draw indirect commands carry a base instance, which needs GL 4.2 or ARB_base_instance besides GL 4.3 or
+        // ARB_multi_draw_indirect
+        multiDrawIndirectSupport_ = instancingSupport_ && glMultiDrawElementsIndirect != nullptr &&
+            glDrawElementsInstancedBaseInstance != nullptr;
         dxtTextureSupport_ = true;
         anisotropySupport_ = true;
         sRGBSupport_ = true;
@@ -2868,6 +3347,25 @@ void Graphics::CheckFeatureSupport()
     if (numSupportedRTs >= 4)
         deferredSupport_ = true;
 
+    // Program binaries need GL 4.1 or ARB_get_program_binary, and a driver that reports at least one binary format.
+    // Check the function pointers as GLEW may not detect the extension from a GL3 context
+    int numBinaryFormats = 0;
+    if (glGetProgramBinary != nullptr && glProgramBinary != nullptr && glProgramParameteri != nullptr)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numBinaryFormats);
+    impl_->programBinarySupport_ = numBinaryFormats > 0;
+
+    // Let the driver use as many compiler threads as it likes for parallel shader compilation
+    parallelShaderCompileSupport_ = glMaxShaderCompilerThreadsARB != nullptr;
+    if (parallelShaderCompileSupport_)
+        glMaxShaderCompilerThreadsARB(0xffffffff);
+
+    // Binaries are only valid for the driver that produced them
+    DerivedDataHash driverHash;
+    driverHash.Add(String((const char*)glGetString(GL_VENDOR)));
+    driverHash.Add(String((const char*)glGetString(GL_RENDERER)));
+    driverHash.Add(String((const char*)glGetString(GL_VERSION)));
+    impl_->driverHash_ = driverHash.GetValue();
+
 #if defined(__APPLE__) && !defined(IOS) && !defined(TVOS)
     // On macOS check for an Intel driver and use shadow map RGBA dummy color textures, because mixing
     // depth-only FBO rendering and backbuffer rendering will bug, resulting in a black screen in full
@@ -2932,9 +3430,14 @@ void Graphics::PrepareDraw()
 #ifndef GL_ES_VERSION_2_0
     if (gl3Support)
     {
-        for (PODVector<ConstantBuffer*>::Iterator i = impl_->dirtyConstantBuffers_.Begin(); i != impl_->dirtyConstantBuffers_.End(); ++i)
-            (*i)->Apply();
-        impl_->dirtyConstantBuffers_.Clear();
+        if (impl_->uniformRing_)
+            ApplyUniformRing();
+        else
+        {
+            for (PODVector<ConstantBuffer*>::Iterator i = impl_->dirtyConstantBuffers_.Begin(); i != impl_->dirtyConstantBuffers_.End(); ++i)
+                (*i)->Apply();
+            impl_->dirtyConstantBuffers_.Clear();
+        }
     }
 #endif
 
@@ -3284,6 +3787,7 @@ void Graphics::ResetCachedState()
     indexBuffer_ = nullptr;
     vertexShader_ = nullptr;
     pixelShader_ = nullptr;
+    pipelineState_ = nullptr;
     blendMode_ = BLEND_REPLACE;
     alphaToCoverage_ = false;
     colorWrite_ = true;
@@ -3327,6 +3831,8 @@ void Graphics::ResetCachedState()
 
     for (auto& constantBuffer : impl_->constantBuffers_)
         constantBuffer = nullptr;
+    for (auto& object : impl_->uniformBindingObjects_)
+        object = 0;
     impl_->dirtyConstantBuffers_.Clear();
 }
 
@@ -3353,6 +3859,11 @@ void Graphics::SetTextureUnitMappings()
     textureUnits_["LightBuffer"] = TU_LIGHTBUFFER;
     textureUnits_["ZoneCubeMap"] = TU_ZONE;
     textureUnits_["ZoneVolumeMap"] = TU_ZONE;
+    // Clustered lighting shares the units of the per-pixel light textures, which it does not use
+    textureUnits_["ClusterLightMap"] = TU_LIGHTRAMP;
+    textureUnits_["ClusterGridMap"] = TU_LIGHTSHAPE;
+    textureUnits_["ClusterIndexMap"] = TU_SHADOWMAP;
+    textureUnits_["SkinMap"] = TU_SKINMAP;
 #endif
 }
 
@@ -81,6 +81,9 @@ class Context;
 using ConstantBufferMap = HashMap<unsigned, SharedPtr<ConstantBuffer> >;
 using ShaderProgramMap = HashMap<Pair<ShaderVariation*, ShaderVariation*>, SharedPtr<ShaderProgram> >;
 
+/// Number of frames the uniform ring buffer is split between.
+static const unsigned NUM_UNIFORM_RING_SEGMENTS = 3;
+
 /// Cached state of a frame buffer object
 struct FrameBufferObject
 {
@@ -108,6 +111,18 @@ public:
     /// Return the GL Context.
     const SDL_GLContext& GetGLContext() { return context_; }
 
+    /// Return whether linked programs can be retrieved and reloaded as binaries.
+    bool GetProgramBinarySupport() const { return programBinarySupport_; }
+
+    /// Return hash of the driver vendor, renderer and version strings.
+    unsigned long long GetDriverHash() const { return driverHash_; }
+
+    /// Set the background thread filling the program binary cache. Stops the previous thread.
+    void SetProgramBinaryThread(ProgramBinaryThread* thread) { programBinaryThread_ = thread; }
+
+    /// Return the background thread filling the program binary cache.
+    ProgramBinaryThread* GetProgramBinaryThread() const { return programBinaryThread_; }
+
 private:
     /// SDL OpenGL context.
     SDL_GLContext context_{};
@@ -145,6 +160,30 @@ private:
     ConstantBuffer* constantBuffers_[MAX_SHADER_PARAMETER_GROUPS * 2]{};
     /// Dirty constant buffers.
     PODVector<ConstantBuffer*> dirtyConstantBuffers_;
+    /// Uniform ring buffer object that constant buffer data is streamed through.
+    unsigned uniformRing_{};
+    /// Persistently mapped uniform ring buffer data, if buffer storage is supported.
+    unsigned char* uniformRingData_{};
+    /// Uniform ring buffer size.
+    unsigned uniformRingSize_{};
+    /// Uniform ring buffer offset alignment.
+    unsigned uniformRingAlignment_{};
+    /// Next free offset in the uniform ring buffer.
+    unsigned uniformRingOffset_{};
+    /// End of the current frame's part of the uniform ring buffer.
+    unsigned uniformRingEnd_{};
+    /// Current part of the uniform ring buffer.
+    unsigned uniformRingSegment_{};
+    /// Uniform ring buffer frame number. Never 0.
+    unsigned uniformRingFrame_{};
+    /// Fences for when the GPU is done with each part of the uniform ring buffer.
+    void* uniformRingFences_[NUM_UNIFORM_RING_SEGMENTS]{};
+    /// Buffer objects bound to the uniform buffer binding points.
+    unsigned uniformBindingObjects_[MAX_SHADER_PARAMETER_GROUPS * 2]{};
+    /// Buffer offsets bound to the uniform buffer binding points.
+    unsigned uniformBindingOffsets_[MAX_SHADER_PARAMETER_GROUPS * 2]{};
+    /// Buffer object for multi-draw indirect commands.
+    unsigned indirectBuffer_{};
     /// Last used instance data offset.
     unsigned lastInstanceOffset_{};
     /// Map for additional depth textures, to emulate Direct3D9 ability to mix render texture and backbuffer rendering.
@@ -153,6 +192,16 @@ private:
     ShaderProgram* shaderProgram_{};
     /// Linked shader programs.
     ShaderProgramMap shaderPrograms_;
+    /// Shader programs being compiled and linked in parallel by the driver.
+    Vector<SharedPtr<ShaderProgram> > pendingShaderPrograms_;
+    /// Shader programs being linked by the background thread, with their program binary cache files.
+    HashMap<Pair<ShaderVariation*, ShaderVariation*>, String> pendingProgramBinaries_;
+    /// Background thread filling the program binary cache.
+    SharedPtr<ProgramBinaryThread> programBinaryThread_;
+    /// Hash of the driver vendor, renderer and version strings.
+    unsigned long long driverHash_{};
+    /// Program binary support flag.
+    bool programBinarySupport_{};
     /// Need FBO commit flag.
     bool fboDirty_{};
     /// Need vertex attribute pointer update flag.
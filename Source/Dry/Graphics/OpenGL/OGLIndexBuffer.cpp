@@ -90,6 +90,8 @@ bool IndexBuffer::SetData(const void* data)
         return false;
     }
 
+    ++dataVersion_;
+
     if (shadowData_ && data != shadowData_.Get())
         memcpy(shadowData_.Get(), data, indexCount_ * (size_t)indexSize_);
 
@@ -137,6 +139,8 @@ bool IndexBuffer::SetDataRange(const void* data, unsigned start, unsigned count,
     if (!count)
         return true;
 
+    ++dataVersion_;
+
     if (shadowData_ && shadowData_.Get() + start * indexSize_ != data)
         memcpy(shadowData_.Get() + start * indexSize_, data, count * (size_t)indexSize_);
 
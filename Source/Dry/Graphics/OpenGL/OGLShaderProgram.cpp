@@ -23,12 +23,20 @@
 
 #include "../../Precompiled.h"
 
+#include "../../Core/Context.h"
 #include "../../Graphics/ConstantBuffer.h"
 #include "../../Graphics/Graphics.h"
 #include "../../Graphics/GraphicsImpl.h"
 #include "../../Graphics/ShaderProgram.h"
 #include "../../Graphics/ShaderVariation.h"
+#include "../../IO/File.h"
+#include "../../IO/FileSystem.h"
 #include "../../IO/Log.h"
+#include "../../Resource/DerivedDataCache.h"
+
+#include <SDL/SDL.h>
+
+#include <cstdio>
 
 #include "../../DebugNew.h"
 
@@ -45,6 +53,9 @@ static const char* shaderParameterGroups[] = {
     "custom"
 };
 
+static const char* PROGRAM_BINARY_ID = "GLPB";
+static const char* PROGRAM_BINARY_EXTENSION = ".glb";
+
 static unsigned NumberPostfix(const String& str)
 {
     for (unsigned i{ 0 }; i < str.Length(); ++i)
@@ -83,6 +94,7 @@ void ShaderProgram::OnDeviceLost()
     if (graphics_ && graphics_->GetShaderProgram() == this)
         graphics_->SetShaders(nullptr, nullptr);
 
+    linkPending_ = false;
     linkerOutput_.Clear();
 }
 
@@ -102,6 +114,7 @@ void ShaderProgram::Release()
         }
 
         objectName_ = 0;
+        linkPending_ = false;
         linkerOutput_.Clear();
         shaderParameters_.Clear();
         vertexAttributes_.Clear();
@@ -115,6 +128,11 @@ void ShaderProgram::Release()
 }
 
 bool ShaderProgram::Link()
+{
+    return BeginLink() && EndLink();
+}
+
+bool ShaderProgram::BeginLink()
 {
     Release();
 
@@ -128,9 +146,54 @@ bool ShaderProgram::Link()
         return false;
     }
 
-    glAttachShader(objectName_, vertexShader_->GetGPUObjectName());
-    glAttachShader(objectName_, pixelShader_->GetGPUObjectName());
-    glLinkProgram(objectName_);
+    // A cached binary skips the link step entirely. If the driver rejects it, link from the compiled shaders instead
+    binaryFileName_ = GetBinaryFileName(graphics_, vertexShader_->GetSourceHash(), pixelShader_->GetSourceHash());
+    loadedBinary_ = LoadBinary(binaryFileName_);
+    if (!loadedBinary_)
+    {
+#ifndef GL_ES_VERSION_2_0
+        if (!binaryFileName_.IsEmpty())
+            glProgramParameteri(objectName_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
+        glAttachShader(objectName_, vertexShader_->GetGPUObjectName());
+        glAttachShader(objectName_, pixelShader_->GetGPUObjectName());
+        glLinkProgram(objectName_);
+    }
+
+    linkPending_ = true;
+    return true;
+}
+
+bool ShaderProgram::IsLinkComplete() const
+{
+    if (!linkPending_ || loadedBinary_)
+        return true;
+
+#ifndef GL_ES_VERSION_2_0
+    // Querying the completion status does not block, unlike the link status
+    if (graphics_->GetParallelShaderCompileSupport())
+    {
+        int complete = 0;
+        glGetProgramiv(objectName_, GL_COMPLETION_STATUS_ARB, &complete);
+        return complete != 0;
+    }
+#endif
+
+    return true;
+}
+
+bool ShaderProgram::EndLink()
+{
+    if (!linkPending_)
+        return objectName_ != 0;
+
+    linkPending_ = false;
+
+    if (!vertexShader_ || !pixelShader_)
+    {
+        Release();
+        return false;
+    }
 
     int linked, length;
     glGetProgramiv(objectName_, GL_LINK_STATUS, &linked);
@@ -144,7 +207,11 @@ bool ShaderProgram::Link()
         objectName_ = 0;
     }
     else
+    {
         linkerOutput_.Clear();
+        if (!loadedBinary_ && !binaryFileName_.IsEmpty())
+            SaveBinary(graphics_->GetContext(), objectName_, binaryFileName_);
+    }
 
     if (!objectName_)
         return false;
@@ -418,4 +485,320 @@ void ShaderProgram::ClearGlobalParameterSource(ShaderParameterGroup group)
     globalParameterSources[group] = (const void*)M_MAX_UNSIGNED;
 }
 
+String ShaderProgram::GetBinaryFileName(Graphics* graphics, const String& vsCode, const String& psCode)
+{
+    DerivedDataHash vsHash;
+    vsHash.Add(vsCode);
+    DerivedDataHash psHash;
+    psHash.Add(psCode);
+    return GetBinaryFileName(graphics, vsHash.GetValue(), psHash.GetValue());
+}
+
+String ShaderProgram::GetBinaryFileName(Graphics* graphics, unsigned long long vsHash, unsigned long long psHash)
+{
+    if (!graphics || !graphics->GetImpl()->GetProgramBinarySupport() || graphics->GetShaderCacheDir().IsEmpty())
+        return String::EMPTY;
+
+    DerivedDataHash hash;
+    hash.AddValue(vsHash);
+    hash.AddValue(psHash);
+    hash.AddValue(graphics->GetImpl()->GetDriverHash());
+
+    char hashString[17];
+    sprintf(hashString, "%016llx", hash.GetValue());
+    return graphics->GetShaderCacheDir() + hashString + PROGRAM_BINARY_EXTENSION;
+}
+
+bool ShaderProgram::SaveBinary(Context* context, unsigned program, const String& fileName)
+{
+#ifndef GL_ES_VERSION_2_0
+    int length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return false;
+
+    PODVector<unsigned char> binary((unsigned)length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, &binary[0]);
+    if (length <= 0)
+        return false;
+
+    // Write to a temporary file first so that a program being linked elsewhere never sees a truncated binary.
+    // The main thread and the background thread may write the same program, so give each its own
+    const String tempName = fileName + (Thread::IsMainThread() ? ".tmp" : ".bgtmp");
+    {
+        File file(context, tempName, FILE_WRITE);
+        if (!file.IsOpen())
+        {
+            DRY_LOGWARNING("Could not write program binary " + fileName);
+            return false;
+        }
+
+        file.WriteFileID(PROGRAM_BINARY_ID);
+        file.WriteUInt(format);
+        file.WriteUInt((unsigned)length);
+        file.Write(&binary[0], (unsigned)length);
+    }
+
+    auto* fileSystem = context->GetSubsystem<FileSystem>();
+    if (fileSystem->FileExists(fileName))
+        fileSystem->Delete(fileName);
+    if (!fileSystem->Rename(tempName, fileName))
+    {
+        fileSystem->Delete(tempName);
+        return false;
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool ShaderProgram::LoadBinary(const String& fileName)
+{
+#ifndef GL_ES_VERSION_2_0
+    if (fileName.IsEmpty())
+        return false;
+
+    Context* context = graphics_->GetContext();
+    auto* fileSystem = context->GetSubsystem<FileSystem>();
+    if (!fileSystem->FileExists(fileName))
+        return false;
+
+    PODVector<unsigned char> binary;
+    GLenum format = 0;
+    {
+        File file(context, fileName);
+        if (!file.IsOpen() || file.ReadFileID() != PROGRAM_BINARY_ID)
+            return false;
+
+        format = file.ReadUInt();
+        const unsigned length = file.ReadUInt();
+        if (!length || length != file.GetSize() - file.GetPosition())
+            return false;
+
+        binary.Resize(length);
+        if (file.Read(&binary[0], length) != length)
+            return false;
+    }
+
+    glProgramBinary(objectName_, format, &binary[0], (GLsizei)binary.Size());
+
+    int linked = 0;
+    glGetProgramiv(objectName_, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        // A driver update invalidates binaries it produced earlier. Drop the file so that it is written again
+        DRY_LOGDEBUG("Discarding stale program binary for " + vertexShader_->GetFullName() + " " + pixelShader_->GetFullName());
+        fileSystem->Delete(fileName);
+        return false;
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+/// Compile one shader on the current context. Return the shader object, or zero and the compiler output on failure.
+static unsigned CompileShader(GLenum type, const String& code, String& output)
+{
+    unsigned shader = glCreateShader(type);
+    if (!shader)
+        return 0;
+
+    const char* codeCStr = code.CString();
+    glShaderSource(shader, 1, &codeCStr, nullptr);
+    glCompileShader(shader);
+
+    int compiled = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (!compiled)
+    {
+        int length = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        output.Resize((unsigned)length);
+        int outLength;
+        if (length)
+            glGetShaderInfoLog(shader, length, &outLength, &output[0]);
+        glDeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+ProgramBinaryThread::ProgramBinaryThread(Graphics* graphics) :
+    graphics_(graphics),
+    context_(nullptr),
+    finished_(false)
+{
+}
+
+ProgramBinaryThread::~ProgramBinaryThread()
+{
+    Stop();
+
+    if (context_)
+        SDL_GL_DeleteContext(context_);
+}
+
+void ProgramBinaryThread::AddProgram(const String& vsCode, const String& psCode, const String& fileName)
+{
+    MutexLock lock(queueMutex_);
+
+    if (pending_.Contains(fileName))
+        return;
+
+    failed_.Erase(fileName);
+
+    ProgramBinarySource source;
+    source.vsCode_ = vsCode;
+    source.psCode_ = psCode;
+    source.fileName_ = fileName;
+    queue_.Push(source);
+    pending_.Insert(fileName);
+}
+
+bool ProgramBinaryThread::Start()
+{
+    SDL_Window* window = graphics_->GetWindow();
+    if (!window)
+        return false;
+
+    if (!context_)
+    {
+        // Creating a context also makes it current, so restore the main context afterward
+        SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+        context_ = SDL_GL_CreateContext(window);
+        SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 0);
+        SDL_GL_MakeCurrent(window, graphics_->GetImpl()->GetGLContext());
+
+        if (!context_)
+        {
+            DRY_LOGWARNINGF("Could not create shared OpenGL context for linking shaders, root cause '%s'", SDL_GetError());
+            return false;
+        }
+    }
+
+    {
+        MutexLock lock(queueMutex_);
+
+        if (!IsStarted() || !finished_)
+            return IsStarted() || Run();
+
+        // The thread ran out of work and is exiting. It checks the queue under the mutex, so nothing queued since is lost
+        finished_ = false;
+    }
+
+    Stop();
+    return Run();
+}
+
+bool ProgramBinaryThread::IsPending(const String& fileName) const
+{
+    MutexLock lock(queueMutex_);
+    return pending_.Contains(fileName);
+}
+
+bool ProgramBinaryThread::TakeFailure(const String& fileName, String& output)
+{
+    MutexLock lock(queueMutex_);
+
+    HashMap<String, String>::Iterator i = failed_.Find(fileName);
+    if (i == failed_.End())
+        return false;
+
+    output = i->second_;
+    failed_.Erase(i);
+    return true;
+}
+
+unsigned ProgramBinaryThread::GetNumPending() const
+{
+    MutexLock lock(queueMutex_);
+    return pending_.Size();
+}
+
+void ProgramBinaryThread::ThreadFunction()
+{
+    SDL_Window* window = graphics_->GetWindow();
+    if (SDL_GL_MakeCurrent(window, context_))
+    {
+        DRY_LOGWARNINGF("Could not use shared OpenGL context for linking shaders, root cause '%s'", SDL_GetError());
+
+        MutexLock lock(queueMutex_);
+        queue_.Clear();
+        pending_.Clear();
+        finished_ = true;
+        return;
+    }
+
+    Context* context = graphics_->GetContext();
+
+    while (shouldRun_)
+    {
+        ProgramBinarySource source;
+        {
+            MutexLock lock(queueMutex_);
+            if (queue_.IsEmpty())
+            {
+                finished_ = true;
+                break;
+            }
+
+            source = queue_.Front();
+            queue_.PopFront();
+        }
+
+        String output;
+        unsigned vs = CompileShader(GL_VERTEX_SHADER, source.vsCode_, output);
+        unsigned ps = vs ? CompileShader(GL_FRAGMENT_SHADER, source.psCode_, output) : 0;
+        unsigned program = (vs && ps) ? glCreateProgram() : 0;
+        bool linked = false;
+
+        if (program)
+        {
+#ifndef GL_ES_VERSION_2_0
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
+            glAttachShader(program, vs);
+            glAttachShader(program, ps);
+            glLinkProgram(program);
+
+            int linkStatus = 0;
+            glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+            linked = linkStatus != 0;
+            if (linked)
+                ShaderProgram::SaveBinary(context, program, source.fileName_);
+            else
+            {
+                int length = 0;
+                glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+                output.Resize((unsigned)length);
+                int outLength;
+                if (length)
+                    glGetProgramInfoLog(program, length, &outLength, &output[0]);
+            }
+
+            glDeleteProgram(program);
+        }
+
+        if (vs)
+            glDeleteShader(vs);
+        if (ps)
+            glDeleteShader(ps);
+
+        MutexLock lock(queueMutex_);
+        pending_.Erase(source.fileName_);
+        if (!linked)
+            failed_[source.fileName_] = output;
+    }
+
+    // Make sure the deletions reach the driver before the context is released
+    glFinish();
+    SDL_GL_MakeCurrent(window, nullptr);
+}
+
 }
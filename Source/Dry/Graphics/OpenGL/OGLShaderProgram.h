@@ -24,7 +24,11 @@
 #pragma once
 
 #include "../../Container/HashMap.h"
+#include "../../Container/HashSet.h"
+#include "../../Container/List.h"
 #include "../../Container/RefCounted.h"
+#include "../../Core/Mutex.h"
+#include "../../Core/Thread.h"
 #include "../../Graphics/GPUObject.h"
 #include "../../Graphics/GraphicsDefs.h"
 #include "../../Graphics/ShaderVariation.h"
@@ -33,6 +37,7 @@ namespace Dry
 {
 
 class ConstantBuffer;
+class Context;
 class Graphics;
 
 /// Linked shader program on the GPU.
@@ -51,6 +56,15 @@ public:
 
     /// Link the shaders and examine the uniforms and samplers used. Return true if successful.
     bool Link();
+    /// Begin linking without waiting for the result, so that the driver may link in parallel. Return true if the link could be started.
+    bool BeginLink();
+    /// Return whether the link started with BeginLink() has finished. Does not block.
+    bool IsLinkComplete() const;
+    /// Finish the link started with BeginLink() and examine the uniforms and samplers used. Blocks until the link has finished. Return true if successful.
+    bool EndLink();
+
+    /// Return whether a link started with BeginLink() awaits EndLink().
+    bool IsLinkPending() const { return linkPending_; }
 
     /// Return the vertex shader.
     ShaderVariation* GetVertexShader() const;
@@ -86,8 +100,17 @@ public:
     static void ClearParameterSources();
     /// Clear a global parameter source when constant buffers change.
     static void ClearGlobalParameterSource(ShaderParameterGroup group);
+    /// Return the program binary cache file for a vertex and pixel shader source hash, or empty if the cache is not available.
+    static String GetBinaryFileName(Graphics* graphics, unsigned long long vsHash, unsigned long long psHash);
+    /// Return the program binary cache file for complete vertex and pixel shader source code, or empty if the cache is not available.
+    static String GetBinaryFileName(Graphics* graphics, const String& vsCode, const String& psCode);
+    /// Write the binary of a linked program object to the program binary cache. Return true if successful.
+    static bool SaveBinary(Context* context, unsigned program, const String& fileName);
 
 private:
+    /// Load the program from the program binary cache. Return true if successful.
+    bool LoadBinary(const String& fileName);
+
     /// Vertex shader.
     WeakPtr<ShaderVariation> vertexShader_;
     /// Pixel shader.
@@ -108,6 +131,12 @@ private:
     String linkerOutput_;
     /// Shader parameter source framenumber.
     unsigned frameNumber_{};
+    /// Program binary cache file.
+    String binaryFileName_;
+    /// Loaded from the program binary cache flag.
+    bool loadedBinary_{};
+    /// Link started but not finished flag.
+    bool linkPending_{};
 
     /// Global shader parameter source framenumber.
     static unsigned globalFrameNumber;
@@ -115,4 +144,55 @@ private:
     static const void* globalParameterSources[MAX_SHADER_PARAMETER_GROUPS];
 };
 
+/// Shader program source code queued for the program binary cache.
+struct ProgramBinarySource
+{
+    /// Complete vertex shader source code.
+    String vsCode_;
+    /// Complete pixel shader source code.
+    String psCode_;
+    /// Program binary cache file to write.
+    String fileName_;
+};
+
+/// Background thread that links shader programs on a shared OpenGL context to fill the program binary cache.
+class DRY_API ProgramBinaryThread : public RefCounted, public Thread
+{
+public:
+    /// Construct.
+    explicit ProgramBinaryThread(Graphics* graphics);
+    /// Destruct. Stop linking and delete the shared context.
+    ~ProgramBinaryThread() override;
+
+    /// Queue a program to link. Call Start() afterward.
+    void AddProgram(const String& vsCode, const String& psCode, const String& fileName);
+    /// Create the shared context if necessary and start linking the queued programs. Restarts the thread if it ran out of work. Return true if successful.
+    bool Start();
+    /// Link the queued programs until none are left.
+    void ThreadFunction() override;
+
+    /// Return whether a program binary cache file is queued or being linked.
+    bool IsPending(const String& fileName) const;
+    /// Return and forget the compiler or linker output of a program that failed to compile or link. Return false if it did not fail.
+    bool TakeFailure(const String& fileName, String& output);
+    /// Return number of programs queued or being linked.
+    unsigned GetNumPending() const;
+
+private:
+    /// Graphics subsystem.
+    Graphics* graphics_;
+    /// Shared OpenGL context used by the thread.
+    void* context_;
+    /// Mutex for the queue.
+    mutable Mutex queueMutex_;
+    /// Queued programs.
+    List<ProgramBinarySource> queue_;
+    /// Files of the programs queued or being linked.
+    HashSet<String> pending_;
+    /// Compiler or linker output of the programs that failed, by file.
+    HashMap<String, String> failed_;
+    /// Ran out of work flag.
+    bool finished_;
+};
+
 }
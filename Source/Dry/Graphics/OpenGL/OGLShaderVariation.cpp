@@ -29,6 +29,7 @@
 #include "../../Graphics/ShaderProgram.h"
 #include "../../Graphics/ShaderVariation.h"
 #include "../../IO/Log.h"
+#include "../../Resource/DerivedDataCache.h"
 
 #include "../../DebugNew.h"
 
@@ -89,6 +90,11 @@ void ShaderVariation::Release()
 }
 
 bool ShaderVariation::Create()
+{
+    return BeginCreate() && CheckCompileStatus();
+}
+
+bool ShaderVariation::BeginCreate()
 {
     Release();
 
@@ -105,6 +111,58 @@ bool ShaderVariation::Create()
         return false;
     }
 
+    const String shaderCode = GetShaderCode();
+
+    // In debug mode, check that all defines are referenced by the shader code
+#ifdef _DEBUG
+    const String& originalShaderCode = owner_->GetSourceCode(type_);
+    Vector<String> defineVec = defines_.Split(' ');
+    for (unsigned i{ 0 }; i < defineVec.Size(); ++i)
+    {
+        String defineCheck = defineVec[i].Substring(0, defineVec[i].Find('='));
+        if (originalShaderCode.Find(defineCheck) == String::NPOS)
+            DRY_LOGWARNING("Shader " + GetFullName() + " does not use the define " + defineCheck);
+    }
+#endif
+
+    DerivedDataHash hash;
+    hash.Add(shaderCode);
+    sourceHash_ = hash.GetValue();
+
+    const char* shaderCStr = shaderCode.CString();
+    glShaderSource(objectName_, 1, &shaderCStr, nullptr);
+    glCompileShader(objectName_);
+
+    return true;
+}
+
+bool ShaderVariation::CheckCompileStatus()
+{
+    if (!objectName_)
+        return false;
+
+    int compiled, length;
+    glGetShaderiv(objectName_, GL_COMPILE_STATUS, &compiled);
+    if (!compiled)
+    {
+        glGetShaderiv(objectName_, GL_INFO_LOG_LENGTH, &length);
+        compilerOutput_.Resize((unsigned)length);
+        int outLength;
+        glGetShaderInfoLog(objectName_, length, &outLength, &compilerOutput_[0]);
+        glDeleteShader(objectName_);
+        objectName_ = 0;
+    }
+    else
+        compilerOutput_.Clear();
+
+    return objectName_ != 0;
+}
+
+String ShaderVariation::GetShaderCode() const
+{
+    if (!owner_)
+        return String::EMPTY;
+
     const String& originalShaderCode = owner_->GetSourceCode(type_);
     String shaderCode;
 
@@ -141,18 +199,7 @@ bool ShaderVariation::Create()
     // Prepend the defines to the shader code
     Vector<String> defineVec = defines_.Split(' ');
     for (unsigned i{ 0 }; i < defineVec.Size(); ++i)
-    {
-        // Add extra space for the checking code below
-        String defineString = "#define " + defineVec[i].Replaced('=', ' ') + " \n";
-        shaderCode += defineString;
-
-        // In debug mode, check that all defines are referenced by the shader code
-#ifdef _DEBUG
-        String defineCheck = defineString.Substring(8, defineString.Find(' ', 8) - 8);
-        if (originalShaderCode.Find(defineCheck) == String::NPOS)
-            DRY_LOGWARNING("Shader " + GetFullName() + " does not use the define " + defineCheck);
-#endif
-    }
+        shaderCode += "#define " + defineVec[i].Replaced('=', ' ') + " \n";
 
 #ifdef RPI
     if (type_ == VS)
@@ -170,25 +217,7 @@ bool ShaderVariation::Create()
     else
         shaderCode += originalShaderCode;
 
-    const char* shaderCStr = shaderCode.CString();
-    glShaderSource(objectName_, 1, &shaderCStr, nullptr);
-    glCompileShader(objectName_);
-
-    int compiled, length;
-    glGetShaderiv(objectName_, GL_COMPILE_STATUS, &compiled);
-    if (!compiled)
-    {
-        glGetShaderiv(objectName_, GL_INFO_LOG_LENGTH, &length);
-        compilerOutput_.Resize((unsigned)length);
-        int outLength;
-        glGetShaderInfoLog(objectName_, length, &outLength, &compilerOutput_[0]);
-        glDeleteShader(objectName_);
-        objectName_ = 0;
-    }
-    else
-        compilerOutput_.Clear();
-
-    return objectName_ != 0;
+    return shaderCode;
 }
 
 void ShaderVariation::SetDefines(const String& defines)
@@ -196,7 +225,7 @@ void ShaderVariation::SetDefines(const String& defines)
     defines_ = defines;
 }
 
-// These methods are no-ops for OpenGL
+// These methods are no-ops for OpenGL. Compiled code is cached per linked program instead, see ShaderProgram::Link()
 bool ShaderVariation::LoadByteCode(const String& binaryShaderName) { return false; }
 bool ShaderVariation::Compile() { return false; }
 void ShaderVariation::ParseParameters(unsigned char* bufData, unsigned bufSize) {}
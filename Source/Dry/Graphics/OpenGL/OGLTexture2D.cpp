@@ -30,6 +30,7 @@
 #include "../../Graphics/GraphicsImpl.h"
 #include "../../Graphics/Renderer.h"
 #include "../../Graphics/Texture2D.h"
+#include "../../IO/AsyncFileReader.h"
 #include "../../IO/FileSystem.h"
 #include "../../IO/Log.h"
 #include "../../Resource/ResourceCache.h"
@@ -40,6 +41,9 @@
 namespace Dry
 {
 
+/// Largest mip size uploaded at load time when streaming mip levels.
+static const int STREAMING_MIN_MIP_SIZE = 64;
+
 void Texture2D::OnDeviceLost()
 {
     if (objectName_ && !graphics_->IsDeviceLost())
@@ -170,7 +174,7 @@ bool Texture2D::SetData(unsigned level, int x, int y, int width, int height, con
     return true;
 }
 
-bool Texture2D::SetData(Image* image, bool useAlpha)
+bool Texture2D::SetImageData(Image* image, bool useAlpha, bool streamLevels)
 {
     if (!image)
     {
@@ -178,6 +182,12 @@ bool Texture2D::SetData(Image* image, bool useAlpha)
         return false;
     }
 
+    // Streaming in progress is superseded by the new data
+    numResidencyLevels_ = 1;
+    residencyLevel_ = targetResidencyLevel_ = 0;
+    streamRequest_.Reset();
+    streamImage_.Reset();
+
     // Use a shared ptr for managing the temporary mip images created during this function
     SharedPtr<Image> mipImage;
     unsigned memoryUse = sizeof(Texture2D);
@@ -281,7 +291,23 @@ bool Texture2D::SetData(Image* image, bool useAlpha)
         SetNumLevels(Max((levels - mipsToSkip), 1U));
         SetSize(width, height, format);
 
-        for (unsigned i{ 0 }; i < levels_ && i < levels - mipsToSkip; ++i)
+        unsigned baseLevel{ 0 };
+#ifndef GL_ES_VERSION_2_0
+        // When streaming, upload only the coarse levels now. The finer ones are read back from the file on demand
+        if (streamLevels && !needDecompress && objectName_)
+        {
+            while (baseLevel + 1 < levels_ && baseLevel + 1 < levels - mipsToSkip &&
+                   Max(GetLevelWidth(baseLevel), GetLevelHeight(baseLevel)) > STREAMING_MIN_MIP_SIZE)
+                ++baseLevel;
+        }
+#endif
+        numResidencyLevels_ = baseLevel + 1;
+        residencyLevel_ = targetResidencyLevel_ = baseLevel;
+        streamMipsSkipped_ = mipsToSkip;
+        if (baseLevel)
+            SetBaseLevel(baseLevel);
+
+        for (unsigned i{ baseLevel }; i < levels_ && i < levels - mipsToSkip; ++i)
         {
             CompressedLevel level = image->GetCompressedLevel(i + mipsToSkip);
             if (!needDecompress)
@@ -365,6 +391,23 @@ bool Texture2D::GetData(unsigned level, void* dest) const
 #endif
 }
 
+void Texture2D::SetBaseLevel(unsigned level)
+{
+#ifndef GL_ES_VERSION_2_0
+    if (!objectName_ || !graphics_ || graphics_->IsDeviceLost())
+        return;
+
+    graphics_->SetTextureForUpdate(this);
+    glTexParameteri(target_, GL_TEXTURE_BASE_LEVEL, level);
+
+    // Levels below the base do not take part in sampling; respecify them empty to release their memory
+    for (unsigned i{ 0 }; i < level; ++i)
+        glTexImage2D(target_, i, GL_RGBA, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    graphics_->SetTexture(0, nullptr);
+#endif
+}
+
 bool Texture2D::Create()
 {
     Release();
@@ -93,6 +93,8 @@ bool VertexBuffer::SetData(const void* data)
         return false;
     }
 
+    ++dataVersion_;
+
     if (shadowData_ && data != shadowData_.Get())
         memcpy(shadowData_.Get(), data, vertexCount_ * (size_t)vertexSize_);
 
@@ -140,6 +142,8 @@ bool VertexBuffer::SetDataRange(const void* data, unsigned start, unsigned count
     if (!count)
         return true;
 
+    ++dataVersion_;
+
     if (shadowData_ && shadowData_.Get() + start * vertexSize_ != data)
         memcpy(shadowData_.Get() + start * vertexSize_, data, count * (size_t)vertexSize_);
 
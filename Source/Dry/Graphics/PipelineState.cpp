@@ -0,0 +1,91 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+// Copyright (c) 2020-2023 LucKey Productions.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Graphics/PipelineState.h"
+#include "../Graphics/ShaderVariation.h"
+
+#include "../DebugNew.h"
+
+namespace Dry
+{
+
+bool PipelineStateDesc::operator ==(const PipelineStateDesc& rhs) const
+{
+    if (vertexShader_ != rhs.vertexShader_ || pixelShader_ != rhs.pixelShader_ || vertexLayoutHash_ != rhs.vertexLayoutHash_ ||
+        blendMode_ != rhs.blendMode_ || alphaToCoverage_ != rhs.alphaToCoverage_ || depthTestMode_ != rhs.depthTestMode_ ||
+        depthWrite_ != rhs.depthWrite_ || cullMode_ != rhs.cullMode_ || fillMode_ != rhs.fillMode_ ||
+        lineAntiAlias_ != rhs.lineAntiAlias_ || hasDepthBias_ != rhs.hasDepthBias_ || hasStencil_ != rhs.hasStencil_)
+        return false;
+
+    if (hasDepthBias_ && (constantDepthBias_ != rhs.constantDepthBias_ || slopeScaledDepthBias_ != rhs.slopeScaledDepthBias_))
+        return false;
+
+    if (hasStencil_ && (stencilTest_ != rhs.stencilTest_ || stencilTestMode_ != rhs.stencilTestMode_ ||
+        stencilPass_ != rhs.stencilPass_ || stencilFail_ != rhs.stencilFail_ || stencilZFail_ != rhs.stencilZFail_ ||
+        stencilRef_ != rhs.stencilRef_ || stencilCompareMask_ != rhs.stencilCompareMask_ || stencilWriteMask_ != rhs.stencilWriteMask_))
+        return false;
+
+    return true;
+}
+
+unsigned PipelineStateDesc::ToHash() const
+{
+    unsigned hash = MakeHash(vertexShader_);
+    CombineHash(hash, MakeHash(pixelShader_));
+    CombineHash(hash, vertexLayoutHash_);
+
+    // Pack the small enums and flags into one word
+    unsigned states = (unsigned)blendMode_ | (unsigned)depthTestMode_ << 4u | (unsigned)cullMode_ << 8u | (unsigned)fillMode_ << 10u;
+    if (alphaToCoverage_)
+        states |= 1u << 12u;
+    if (depthWrite_)
+        states |= 1u << 13u;
+    if (lineAntiAlias_)
+        states |= 1u << 14u;
+    CombineHash(hash, states);
+
+    if (hasDepthBias_)
+    {
+        unsigned bits;
+        memcpy(&bits, &constantDepthBias_, sizeof bits);
+        CombineHash(hash, bits);
+        memcpy(&bits, &slopeScaledDepthBias_, sizeof bits);
+        CombineHash(hash, bits);
+    }
+
+    if (hasStencil_)
+    {
+        CombineHash(hash, (unsigned)stencilTestMode_ | (unsigned)stencilPass_ << 4u | (unsigned)stencilFail_ << 8u |
+            (unsigned)stencilZFail_ << 12u | (stencilTest_ ? 1u << 16u : 0u));
+        CombineHash(hash, stencilRef_);
+        CombineHash(hash, stencilCompareMask_);
+        CombineHash(hash, stencilWriteMask_);
+    }
+
+    return hash;
+}
+
+}
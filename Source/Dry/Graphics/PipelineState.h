@@ -0,0 +1,127 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+// Copyright (c) 2020-2023 LucKey Productions.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Container/Hash.h"
+#include "../Container/RefCounted.h"
+#include "../Graphics/GraphicsDefs.h"
+#include "../Math/MathDefs.h"
+
+namespace Dry
+{
+
+class ShaderVariation;
+
+/// Description of a pipeline state: shaders, vertex layout, blend, depth and raster state, and optionally depth bias and stencil. States that are left out are not touched when the pipeline state is set.
+struct DRY_API PipelineStateDesc
+{
+    /// Test for equality with another description.
+    bool operator ==(const PipelineStateDesc& rhs) const;
+    /// Test for inequality with another description.
+    bool operator !=(const PipelineStateDesc& rhs) const { return !(*this == rhs); }
+
+    /// Return hash value.
+    unsigned ToHash() const;
+
+    /// Vertex shader.
+    ShaderVariation* vertexShader_{};
+    /// Pixel shader.
+    ShaderVariation* pixelShader_{};
+    /// Hash of the vertex buffer layout.
+    unsigned vertexLayoutHash_{};
+    /// Blending mode.
+    BlendMode blendMode_{ BLEND_REPLACE };
+    /// Alpha-to-coverage enable.
+    bool alphaToCoverage_{};
+    /// Depth compare mode.
+    CompareMode depthTestMode_{ CMP_LESSEQUAL };
+    /// Depth write enable.
+    bool depthWrite_{ true };
+    /// Hardware culling mode.
+    CullMode cullMode_{ CULL_CCW };
+    /// Polygon fill mode.
+    FillMode fillMode_{ FILL_SOLID };
+    /// Line antialiasing enable.
+    bool lineAntiAlias_{};
+    /// Whether the depth bias is part of the state.
+    bool hasDepthBias_{};
+    /// Depth constant bias.
+    float constantDepthBias_{};
+    /// Depth slope scaled bias.
+    float slopeScaledDepthBias_{};
+    /// Whether the stencil test is part of the state.
+    bool hasStencil_{};
+    /// Stencil test enable.
+    bool stencilTest_{};
+    /// Stencil test compare mode.
+    CompareMode stencilTestMode_{ CMP_ALWAYS };
+    /// Stencil operation on pass.
+    StencilOp stencilPass_{ OP_KEEP };
+    /// Stencil operation on fail.
+    StencilOp stencilFail_{ OP_KEEP };
+    /// Stencil operation on depth fail.
+    StencilOp stencilZFail_{ OP_KEEP };
+    /// Stencil test reference value.
+    unsigned stencilRef_{};
+    /// Stencil compare bitmask.
+    unsigned stencilCompareMask_{ M_MAX_UNSIGNED };
+    /// Stencil write bitmask.
+    unsigned stencilWriteMask_{ M_MAX_UNSIGNED };
+};
+
+/// Immutable pipeline state object. Created and cached by Graphics::GetPipelineState(), which gives equal descriptions the same object. States that go unused for a while are released.
+class DRY_API PipelineState : public RefCounted
+{
+public:
+    /// Construct from a description and a unique ID.
+    PipelineState(const PipelineStateDesc& desc, unsigned id) :
+        desc_(desc),
+        id_(id)
+    {
+    }
+
+    /// Return description.
+    const PipelineStateDesc& GetDesc() const { return desc_; }
+
+    /// Return unique ID, for use in sort keys.
+    unsigned GetID() const { return id_; }
+
+    /// Set the frame number of the last use.
+    void SetLastUseFrame(unsigned frame) { lastUseFrame_ = frame; }
+    /// Return the frame number of the last use.
+    unsigned GetLastUseFrame() const { return lastUseFrame_; }
+
+private:
+    /// Description.
+    const PipelineStateDesc desc_;
+    /// Unique ID.
+    const unsigned id_;
+    /// Frame number of the last use.
+    unsigned lastUseFrame_{};
+};
+
+}
@@ -183,6 +183,8 @@ struct DRY_API RenderPathCommand
     bool useLitBase_{true};
     /// Vertex lights flag.
     bool vertexLights_{};
+    /// Clustered lights flag. Unshadowed point and spot lights are then applied in this pass instead of the forward light passes.
+    bool clusteredLights_{};
     /// Event name.
     String eventName_;
 };
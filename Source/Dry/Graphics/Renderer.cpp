@@ -28,6 +28,7 @@
 #include "../Graphics/Camera.h"
 #include "../Graphics/DebugRenderer.h"
 #include "../Graphics/Geometry.h"
+#include "../Graphics/GeometryPool.h"
 #include "../Graphics/Graphics.h"
 #include "../Graphics/GraphicsEvents.h"
 #include "../Graphics/GraphicsImpl.h"
@@ -37,6 +38,7 @@
 #include "../Graphics/Octree.h"
 #include "../Graphics/Renderer.h"
 #include "../Graphics/RenderPath.h"
+#include "../Graphics/ShadowAtlas.h"
 #include "../Graphics/ShaderVariation.h"
 #include "../Graphics/Technique.h"
 #include "../Graphics/Texture2D.h"
@@ -184,7 +186,8 @@ static const char* geometryVSVariations[] =
     "BILLBOARD ",
     "DIRBILLBOARD ",
     "TRAILFACECAM ",
-    "TRAILBONE "
+    "TRAILBONE ",
+    "SKINNED INSTANCED "
 };
 
 static const char* lightVSVariations[] =
@@ -253,8 +256,6 @@ static const char* heightFogVariations[] =
 
 static const unsigned MAX_BUFFER_AGE = 1000;
 
-static const int MAX_EXTRA_INSTANCING_BUFFER_ELEMENTS = 4;
-
 inline PODVector<VertexElement> CreateInstancingBufferElements(unsigned numExtraElements)
 {
     static const unsigned NUM_INSTANCEMATRIX_ELEMENTS = 3;
@@ -457,6 +458,16 @@ void Renderer::SetMaxShadowMaps(int shadowMaps)
     }
 }
 
+void Renderer::SetShadowAtlasSize(int size)
+{
+    size = size > 0 ? (int)NextPowerOfTwo((unsigned)Max(size, SHADOW_MIN_PIXELS)) : 0;
+    if (size != shadowAtlasSize_)
+    {
+        shadowAtlasSize_ = size;
+        shadowAtlas_.Reset();
+    }
+}
+
 void Renderer::SetDynamicInstancing(bool enable)
 {
     if (!instancingBuffer_)
@@ -465,6 +476,84 @@ void Renderer::SetDynamicInstancing(bool enable)
     dynamicInstancing_ = enable;
 }
 
+void Renderer::SetMultiDrawIndirect(bool enable)
+{
+    multiDrawIndirect_ = enable;
+
+    if (enable && !geometryPool_)
+        geometryPool_ = new GeometryPool(context_);
+    else if (!enable)
+        geometryPool_.Reset();
+}
+
+void Renderer::SetClusterCulling(bool enable)
+{
+    clusterCulling_ = enable;
+}
+
+bool Renderer::UseMultiDrawIndirect() const
+{
+    return multiDrawIndirect_ && geometryPool_ && GetInstancingBuffer() && graphics_ && graphics_->GetMultiDrawIndirectSupport();
+}
+
+void Renderer::SetSkinInstancing(bool enable)
+{
+    skinInstancing_ = enable;
+
+    if (!enable)
+        skinTexture_.Reset();
+}
+
+void Renderer::SetAnimationLodLevels(const PODVector<AnimationLodLevel>& levels)
+{
+    animationLodLevels_ = levels;
+}
+
+void Renderer::SetAnimationBoneBudget(unsigned bones)
+{
+    animationBoneBudget_ = bones;
+}
+
+const AnimationLodLevel* Renderer::GetAnimationLodLevel(float screenSize) const
+{
+    const AnimationLodLevel* level = nullptr;
+    for (unsigned i{ 0 }; i < animationLodLevels_.Size(); ++i)
+    {
+        if (screenSize < animationLodLevels_[i].screenSize_)
+            level = &animationLodLevels_[i];
+    }
+
+    return level;
+}
+
+bool Renderer::ReserveAnimatedBones(unsigned num, bool force)
+{
+    if (!animationBoneBudget_ || force)
+    {
+        numAnimatedBones_ += num;
+        return true;
+    }
+
+    unsigned animated = numAnimatedBones_.load();
+    do
+    {
+        if (animated + num > animationBoneBudget_)
+            return false;
+    }
+    while (!numAnimatedBones_.compare_exchange_weak(animated, animated + num));
+
+    return true;
+}
+
+bool Renderer::UseSkinInstancing() const
+{
+#ifndef GL_ES_VERSION_2_0
+    return skinInstancing_ && GetInstancingBuffer() && Graphics::GetGL3Support();
+#else
+    return false;
+#endif
+}
+
 void Renderer::SetNumExtraInstancingBufferElements(int elements)
 {
     if (numExtraInstancingBufferElements_ != elements)
@@ -588,6 +677,11 @@ Technique* Renderer::GetDefaultTechnique() const
     return defaultTechnique_;
 }
 
+unsigned Renderer::GetNumPendingShaderPrograms() const
+{
+    return graphics_ ? graphics_->GetNumPendingShaderPrograms() : 0;
+}
+
 unsigned Renderer::GetNumGeometries(bool allViews) const
 {
     unsigned numGeometries = 0;
@@ -680,12 +774,20 @@ void Renderer::Update(float timeStep)
     frame_.camera_ = nullptr;
     numShadowCameras_ = 0;
     numOcclusionBuffers_ = 0;
+    numAnimatedBones_ = 0;
     updatedOctrees_.Clear();
 
     // Reload shaders now if needed
     if (shadersDirty_)
         LoadShaders();
 
+    // Release pooled copies of destroyed geometries
+    if (geometryPool_)
+        geometryPool_->Cleanup();
+
+    if (shadowAtlas_)
+        shadowAtlas_->BeginFrame(frame_.frameNumber_);
+
     // Queue update of the main viewports. Use reverse order, as rendering order is also reverse
     // to render auxiliary views before dependent main views
     for (unsigned i = viewports_.Size() - 1; i < viewports_.Size(); --i)
@@ -851,7 +953,7 @@ Geometry* Renderer::GetQuadGeometry()
     return dirLightGeometry_;
 }
 
-Texture2D* Renderer::GetShadowMap(Light* light, Camera* camera, unsigned viewWidth, unsigned viewHeight)
+IntVector2 Renderer::CalculateShadowMapSize(Light* light, Camera* camera, unsigned viewWidth, unsigned viewHeight) const
 {
     LightType type = light->GetLightType();
     const FocusParameters& parameters = light->GetShadowFocus();
@@ -907,6 +1009,33 @@ Texture2D* Renderer::GetShadowMap(Light* light, Camera* camera, unsigned viewWid
         height *= 3;
     }
 
+    return {width, height};
+}
+
+ShadowAtlasTile* Renderer::GetShadowAtlasTile(Light* light, Camera* camera, unsigned viewWidth, unsigned viewHeight)
+{
+    // The atlas holds depth shadow maps only
+    if (!shadowAtlasSize_ || shadowQuality_ == SHADOWQUALITY_VSM || shadowQuality_ == SHADOWQUALITY_BLUR_VSM)
+        return nullptr;
+
+    if (!shadowAtlas_)
+    {
+        shadowAtlas_ = new ShadowAtlas(context_);
+        const bool hires = shadowQuality_ == SHADOWQUALITY_SIMPLE_24BIT || shadowQuality_ == SHADOWQUALITY_PCF_24BIT;
+        shadowAtlas_->SetSize(shadowAtlasSize_, hires ? graphics_->GetHiresShadowMapFormat() : graphics_->GetShadowMapFormat());
+        shadowAtlas_->BeginFrame(frame_.frameNumber_);
+    }
+
+    const IntVector2 size = CalculateShadowMapSize(light, camera, viewWidth, viewHeight);
+    return shadowAtlas_->GetTile(light, camera, size.x_, size.y_);
+}
+
+Texture2D* Renderer::GetShadowMap(Light* light, Camera* camera, unsigned viewWidth, unsigned viewHeight)
+{
+    const IntVector2 size = CalculateShadowMapSize(light, camera, viewWidth, viewHeight);
+    int width = size.x_;
+    int height = size.y_;
+
     int searchKey = width << 16u | height;
     if (shadowMaps_.Contains(searchKey))
     {
@@ -1281,6 +1410,25 @@ void Renderer::SetBatchShaders(Batch& batch, Technique* tech, bool allowShadows,
         }
     }
 
+    // While the shader program compiles in the background, draw with the default technique instead, or skip the batch
+    // if that is not ready either
+    if (batch.vertexShader_ && batch.pixelShader_ && !graphics_->IsShaderProgramReady(batch.vertexShader_, batch.pixelShader_))
+    {
+        Technique* fallbackTech = GetDefaultTechnique();
+        Pass* fallbackPass = (fallbackTech && fallbackTech != tech) ? fallbackTech->GetPass(pass->GetIndex()) : nullptr;
+
+        batch.vertexShader_ = nullptr;
+        batch.pixelShader_ = nullptr;
+
+        if (fallbackPass)
+        {
+            batch.pass_ = fallbackPass;
+            SetBatchShaders(batch, fallbackTech, allowShadows, queue);
+        }
+
+        return;
+    }
+
     // Log error if shaders could not be assigned, but only once per technique
     if (!batch.vertexShader_ || !batch.pixelShader_)
     {
@@ -1387,6 +1535,49 @@ bool Renderer::ResizeInstancingBuffer(unsigned numInstances)
     return true;
 }
 
+bool Renderer::SetSkinMatrices(const Matrix3x4* matrices, unsigned count)
+{
+    if (!count)
+        return true;
+
+    // Each matrix is stored as three RGBA texels, the same layout as the skinning matrix shader uniforms
+    const int width = SKIN_TEXTURE_MATRICES_PER_ROW * 3;
+    const int fullRows = count / SKIN_TEXTURE_MATRICES_PER_ROW;
+    const int lastRowMatrices = count % SKIN_TEXTURE_MATRICES_PER_ROW;
+    const int rows = fullRows + (lastRowMatrices ? 1 : 0);
+
+    if (!skinTexture_ || skinTexture_->GetHeight() < rows)
+    {
+        const int height = (int)NextPowerOfTwo((unsigned)rows);
+
+        skinTexture_ = new Texture2D(context_);
+        skinTexture_->SetName("SkinTexture");
+        skinTexture_->SetNumLevels(1);
+        skinTexture_->SetFilterMode(FILTER_NEAREST);
+        skinTexture_->SetAddressMode(COORD_U, ADDRESS_CLAMP);
+        skinTexture_->SetAddressMode(COORD_V, ADDRESS_CLAMP);
+        if (!skinTexture_->SetSize(width, height, Graphics::GetRGBAFloat32Format(), TEXTURE_DYNAMIC))
+        {
+            DRY_LOGERROR("Failed to create bone texture for " + String(count) + " skinning matrices");
+            skinTexture_.Reset();
+            return false;
+        }
+
+        DRY_LOGDEBUG("Resized bone texture to " + String(height) + " rows");
+    }
+
+    bool success = true;
+    if (fullRows)
+        success &= skinTexture_->SetData(0, 0, 0, width, fullRows, matrices);
+    if (lastRowMatrices)
+    {
+        success &= skinTexture_->SetData(0, 0, fullRows, lastRowMatrices * 3, 1,
+            matrices + fullRows * SKIN_TEXTURE_MATRICES_PER_ROW);
+    }
+
+    return success;
+}
+
 void Renderer::OptimizeLightByScissor(Light* light, Camera* camera)
 {
     if (light && light->GetLightType() != LIGHT_DIRECTIONAL)
@@ -1918,6 +2109,7 @@ void Renderer::ResetShadowMaps()
     shadowMaps_.Clear();
     shadowMapAllocations_.Clear();
     colorShadowMaps_.Clear();
+    shadowAtlas_.Reset();
 }
 
 void Renderer::ResetBuffers()
@@ -32,10 +32,15 @@
 #include "../Graphics/Viewport.h"
 #include "../Math/Color.h"
 
+#include <atomic>
+
 namespace Dry
 {
 
 class Geometry;
+class GeometryPool;
+class ShadowAtlas;
+struct ShadowAtlasTile;
 class Drawable;
 class Light;
 class Material;
@@ -59,6 +64,8 @@ struct BatchQueue;
 
 static const int SHADOW_MIN_PIXELS = 64;
 static const int INSTANCING_BUFFER_DEFAULT_SIZE = 1024;
+/// Number of skinning matrices in one row of the bone texture. Each matrix takes three texels.
+static const int SKIN_TEXTURE_MATRICES_PER_ROW = 256;
 
 /// Light vertex shader variations.
 enum LightVSVariation
@@ -172,6 +179,22 @@ enum DeferredLightPSVariation
     MAX_DEFERRED_LIGHT_PS_VARIATIONS
 };
 
+/// Maximum number of extra instancing buffer elements.
+static const int MAX_EXTRA_INSTANCING_BUFFER_ELEMENTS = 4;
+
+/// %Animation LOD level. Used by the animated models whose projected height is below the level's screen size.
+struct AnimationLodLevel
+{
+    /// Projected height as a fraction of the view height, below which the level is used.
+    float screenSize_{};
+    /// Interval between animation updates in seconds. The pose is interpolated in between, so it trails the animation by one interval. Zero updates every frame.
+    float updateInterval_{};
+    /// Maximum number of bones to animate, nearest to the skeleton root first. The rest stay in their initial pose.
+    unsigned maxBones_{M_MAX_UNSIGNED};
+    /// Minimum weight of an animation state to be applied. Should stay below the weight of the base animations.
+    float minWeight_{};
+};
+
 /// High-level rendering subsystem. Manages drawing of 3D views.
 class DRY_API Renderer : public Object
 {
@@ -225,8 +248,20 @@ public:
     void SetReuseShadowMaps(bool enable);
     /// Set maximum number of shadow maps created for one resolution. Only has effect if reuse of shadow maps is disabled.
     void SetMaxShadowMaps(int shadowMaps);
+    /// Set shadow atlas width and height. When nonzero, depth shadow maps are allocated as tiles of one atlas texture that persist across frames, so that static shadow casters are only redrawn when they or the light change. Lights that do not fit fall back to separate shadow maps. Not used with VSM shadows. Default 0 (disabled.)
+    void SetShadowAtlasSize(int size);
     /// Set dynamic instancing on/off. When on (default), drawables using the same static-type geometry and material will be automatically combined to an instanced draw call.
     void SetDynamicInstancing(bool enable);
+    /// Set multi-draw indirect rendering of static geometry on/off. When on and supported, instanced static geometries are copied into the shared buffers of the geometry pool, and batch groups that differ only by geometry are drawn with one multi-draw indirect call. Requires dynamic instancing. Default is false.
+    void SetMultiDrawIndirect(bool enable);
+    /// Set cluster culling of static models on/off. When on (default), static models whose geometries have meshlets submit only the meshlets inside the view frustum, not back facing and not occluded, as compacted index ranges per view.
+    void SetClusterCulling(bool enable);
+    /// Set instancing of skinned geometry on/off. When on and supported, the skinning matrices of the visible skinned drawables are packed into one bone texture each frame, so that drawables using the same skinned geometry and material are combined to an instanced draw call regardless of their poses. Requires dynamic instancing and OpenGL 3. Default is false.
+    void SetSkinInstancing(bool enable);
+    /// Set animation LOD levels in order of decreasing screen size. Animated models use the last level whose screen size is larger than their projected height, instead of the distance based animation LOD. Default none.
+    void SetAnimationLodLevels(const PODVector<AnimationLodLevel>& levels);
+    /// Set maximum number of bones animated per frame by all animated models together. Models over the budget update on the next frame instead. Zero is unlimited (default.)
+    void SetAnimationBoneBudget(unsigned bones);
     /// Set number of extra instancing buffer elements. Default is 0. Extra 4-vectors are available through TEXCOORD7 and further.
     void SetNumExtraInstancingBufferElements(int elements);
     /// Set minimum number of instances required in a batch group to render as instanced.
@@ -309,9 +344,51 @@ public:
     /// Return maximum number of shadow maps per resolution.
     int GetMaxShadowMaps() const { return maxShadowMaps_; }
 
+    /// Return shadow atlas width and height, or zero if disabled.
+    int GetShadowAtlasSize() const { return shadowAtlasSize_; }
+
+    /// Return the shadow atlas, or null if not in use.
+    ShadowAtlas* GetShadowAtlas() const { return shadowAtlas_; }
+
     /// Return whether dynamic instancing is in use.
     bool GetDynamicInstancing() const { return dynamicInstancing_; }
 
+    /// Return whether multi-draw indirect rendering of static geometry is enabled.
+    bool GetMultiDrawIndirect() const { return multiDrawIndirect_; }
+
+    /// Return whether multi-draw indirect rendering of static geometry is enabled and can be used.
+    bool UseMultiDrawIndirect() const;
+
+    /// Return whether cluster culling of static models is enabled.
+    bool GetClusterCulling() const { return clusterCulling_; }
+
+    /// Return whether instancing of skinned geometry is enabled.
+    bool GetSkinInstancing() const { return skinInstancing_; }
+
+    /// Return whether instancing of skinned geometry is enabled and can be used.
+    bool UseSkinInstancing() const;
+
+    /// Return the bone texture holding the skinning matrices of skinned instances.
+    Texture2D* GetSkinTexture() const { return skinTexture_; }
+
+    /// Return animation LOD levels.
+    const PODVector<AnimationLodLevel>& GetAnimationLodLevels() const { return animationLodLevels_; }
+
+    /// Return animation LOD level for a projected height, or null for full detail.
+    const AnimationLodLevel* GetAnimationLodLevel(float screenSize) const;
+
+    /// Return maximum number of bones animated per frame.
+    unsigned GetAnimationBoneBudget() const { return animationBoneBudget_; }
+
+    /// Return number of bones animated this frame.
+    unsigned GetNumAnimatedBones() const { return numAnimatedBones_; }
+
+    /// Reserve bones from the per-frame animation budget. Return false if the budget would be exceeded, unless forced. Can be called from worker threads.
+    bool ReserveAnimatedBones(unsigned num, bool force);
+
+    /// Return the geometry pool for multi-draw indirect rendering, or null if not enabled.
+    GeometryPool* GetGeometryPool() const { return geometryPool_; }
+
     /// Return number of extra instancing buffer elements.
     int GetNumExtraInstancingBufferElements() const { return numExtraInstancingBufferElements_; };
 
@@ -351,6 +428,8 @@ public:
     /// Return number of batches rendered.
     unsigned GetNumBatches() const { return numBatches_; }
 
+    /// Return number of shader programs still compiling in the background.
+    unsigned GetNumPendingShaderPrograms() const;
     /// Return number of geometries rendered.
     unsigned GetNumGeometries(bool allViews = false) const;
     /// Return number of lights rendered.
@@ -401,6 +480,8 @@ public:
     Geometry* GetQuadGeometry();
     /// Allocate a shadow map. If shadow map reuse is disabled, a different map is returned each time.
     Texture2D* GetShadowMap(Light* light, Camera* camera, unsigned viewWidth, unsigned viewHeight);
+    /// Allocate a shadow atlas tile for a light seen from a camera. Return null if the shadow atlas is not in use or is full.
+    ShadowAtlasTile* GetShadowAtlasTile(Light* light, Camera* camera, unsigned viewWidth, unsigned viewHeight);
     /// Allocate a rendertarget or depth-stencil texture for deferred rendering or postprocessing. Should only be called during actual rendering, not before.
     Texture* GetScreenBuffer
         (int width, int height, unsigned format, int multiSample, bool autoResolve, bool cubemap, bool filtered, bool srgb, unsigned persistentKey = 0);
@@ -423,6 +504,8 @@ public:
     void SetCullMode(CullMode mode, Camera* camera);
     /// Ensure sufficient size of the instancing vertex buffer. Return true if successful.
     bool ResizeInstancingBuffer(unsigned numInstances);
+    /// Upload skinning matrices to the bone texture, enlarging it as necessary. Return true if successful.
+    bool SetSkinMatrices(const Matrix3x4* matrices, unsigned count);
     /// Optimize a light by scissor rectangle.
     void OptimizeLightByScissor(Light* light, Camera* camera);
     /// Optimize a light by marking it to the stencil buffer and setting a stencil test.
@@ -464,6 +547,8 @@ private:
     void ResetShadowMaps();
     /// Remove all occlusion and screen buffers.
     void ResetBuffers();
+    /// Return shadow map width and height for a light, including room for all its splits.
+    IntVector2 CalculateShadowMapSize(Light* light, Camera* camera, unsigned viewWidth, unsigned viewHeight) const;
     /// Find variations for shadow shaders
     String GetShadowVariations() const;
     /// Handle screen mode event.
@@ -489,6 +574,12 @@ private:
     SharedPtr<Geometry> pointLightGeometry_;
     /// Instance stream vertex buffer.
     SharedPtr<VertexBuffer> instancingBuffer_;
+    /// Shared buffers for multi-draw indirect rendering of static geometry.
+    SharedPtr<GeometryPool> geometryPool_;
+    /// Bone texture for skinned instances.
+    SharedPtr<Texture2D> skinTexture_;
+    /// Shadow atlas.
+    SharedPtr<ShadowAtlas> shadowAtlas_;
     /// Default material.
     SharedPtr<Material> defaultMaterial_;
     /// Default range attenuation texture.
@@ -557,6 +648,8 @@ private:
     int vsmMultiSample_{1};
     /// Maximum number of shadow maps per resolution.
     int maxShadowMaps_{1};
+    /// Shadow atlas width and height.
+    int shadowAtlasSize_{};
     /// Minimum number of instances required in a batch group to render as instanced.
     int minInstances_{2};
     /// Maximum sorted instances per batch group.
@@ -581,6 +674,12 @@ private:
     unsigned numPrimitives_{};
     /// Number of batches (3D geometry only.)
     unsigned numBatches_{};
+    /// Animation LOD levels.
+    PODVector<AnimationLodLevel> animationLodLevels_;
+    /// Maximum number of bones animated per frame.
+    unsigned animationBoneBudget_{};
+    /// Number of bones animated this frame.
+    std::atomic<unsigned> numAnimatedBones_{};
     /// Frame number on which shaders last changed.
     unsigned shadersChangedFrameNumber_{M_MAX_UNSIGNED};
     /// Current stencil value for light optimization.
@@ -595,6 +694,12 @@ private:
     bool reuseShadowMaps_{true};
     /// Dynamic instancing flag.
     bool dynamicInstancing_{true};
+    /// Multi-draw indirect flag.
+    bool multiDrawIndirect_{};
+    /// Cluster culling flag.
+    bool clusterCulling_{true};
+    /// Skinned geometry instancing flag.
+    bool skinInstancing_{};
     /// Number of extra instancing data elements.
     int numExtraInstancingBufferElements_{};
     /// Threaded occlusion rendering flag.
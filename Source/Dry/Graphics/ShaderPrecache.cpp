@@ -26,6 +26,7 @@
 #include "../Graphics/Graphics.h"
 #include "../Graphics/GraphicsImpl.h"
 #include "../Graphics/ShaderPrecache.h"
+#include "../Graphics/ShaderProgram.h"
 #include "../Graphics/ShaderVariation.h"
 #include "../IO/File.h"
 #include "../IO/FileSystem.h"
@@ -105,13 +106,23 @@ void ShaderPrecache::StoreShaders(ShaderVariation* vs, ShaderVariation* ps)
     shaderElem.SetAttribute("psdefines", psDefines);
 }
 
-void ShaderPrecache::LoadShaders(Graphics* graphics, Deserializer& source)
+void ShaderPrecache::LoadShaders(Graphics* graphics, Deserializer& source, bool async)
 {
     DRY_LOGDEBUG("Begin precaching shaders");
 
     XMLFile xmlFile(graphics->GetContext());
     xmlFile.Load(source);
 
+    auto* fileSystem = graphics->GetSubsystem<FileSystem>();
+    SharedPtr<ProgramBinaryThread> binaryThread;
+    if (async)
+    {
+        binaryThread = graphics->GetImpl()->GetProgramBinaryThread();
+        if (!binaryThread)
+            binaryThread = new ProgramBinaryThread(graphics);
+    }
+    PODVector<Pair<ShaderVariation*, ShaderVariation*> > deferred;
+
     XMLElement shader = xmlFile.GetRoot().GetChild("shader");
     while (shader)
     {
@@ -133,12 +144,43 @@ void ShaderPrecache::LoadShaders(Graphics* graphics, Deserializer& source)
 
         ShaderVariation* vs = graphics->GetShader(VS, shader.GetAttribute("vs"), vsDefines);
         ShaderVariation* ps = graphics->GetShader(PS, shader.GetAttribute("ps"), psDefines);
+
+        // Leave programs without a cached binary to the background thread. Those with one link quickly from it
+        if (binaryThread && vs && ps)
+        {
+            const String vsCode = vs->GetShaderCode();
+            const String psCode = ps->GetShaderCode();
+            const String fileName = ShaderProgram::GetBinaryFileName(graphics, vsCode, psCode);
+            if (!fileName.IsEmpty() && !fileSystem->FileExists(fileName))
+            {
+                binaryThread->AddProgram(vsCode, psCode, fileName);
+                deferred.Push(MakePair(vs, ps));
+                shader = shader.GetNext("shader");
+                continue;
+            }
+        }
+
         // Set the shaders active to actually compile them
         graphics->SetShaders(vs, ps);
 
         shader = shader.GetNext("shader");
     }
 
+    if (!deferred.IsEmpty())
+    {
+        if (binaryThread->Start())
+        {
+            DRY_LOGINFOF("Linking %u shader programs in the background", deferred.Size());
+            graphics->GetImpl()->SetProgramBinaryThread(binaryThread);
+        }
+        else
+        {
+            // No shared context, link them here after all
+            for (unsigned i{ 0 }; i < deferred.Size(); ++i)
+                graphics->SetShaders(deferred[i].first_, deferred[i].second_);
+        }
+    }
+
     DRY_LOGDEBUG("End precaching shaders");
 }
 
@@ -47,8 +47,8 @@ public:
     /// Collect a shader combination. Called by Graphics when shaders have been set.
     void StoreShaders(ShaderVariation* vs, ShaderVariation* ps);
 
-    /// Load shaders from an XML file.
-    static void LoadShaders(Graphics* graphics, Deserializer& source);
+    /// Load shaders from an XML file. With async, programs missing from the program binary cache are linked in a background thread to fill it.
+    static void LoadShaders(Graphics* graphics, Deserializer& source, bool async = false);
 
 private:
     /// XML file name.
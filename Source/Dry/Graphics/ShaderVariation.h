@@ -94,6 +94,10 @@ public:
 
     /// Compile the shader. Return true if successful.
     bool Create();
+    /// Begin compiling the shader without waiting for the result, so that the driver may compile in parallel. Call CheckCompileStatus() before relying on the result. Used only on OpenGL.
+    bool BeginCreate();
+    /// Wait for the compile result if still pending. Release the shader object on failure. Return true if successful. Used only on OpenGL.
+    bool CheckCompileStatus();
     /// Set name.
     void SetName(const String& name);
     /// Set defines.
@@ -138,6 +142,12 @@ public:
     /// Return defines with the CLIPPLANE define appended. Used internally on Direct3D11 only, will be empty on other APIs.
     const String& GetDefinesClipPlane() { return definesClipPlane_; }
 
+    /// Return the complete source code passed to the compiler, including the generated defines. Used only on OpenGL.
+    String GetShaderCode() const;
+
+    /// Return hash of the compiled source code. Used only on OpenGL to key the program binary cache.
+    unsigned long long GetSourceHash() const { return sourceHash_; }
+
     /// D3D11 vertex semantic names. Used internally.
     static const char* elementSemanticNames[];
 
@@ -175,6 +185,8 @@ private:
     String definesClipPlane_;
     /// Shader compile error string.
     String compilerOutput_;
+    /// Hash of the compiled source code. Used only on OpenGL.
+    unsigned long long sourceHash_{};
 };
 
 }
@@ -0,0 +1,240 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+// Copyright (c) 2020-2023 LucKey Productions.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Container/Sort.h"
+#include "../Core/Profiler.h"
+#include "../Graphics/Camera.h"
+#include "../Graphics/Graphics.h"
+#include "../Graphics/ShadowAtlas.h"
+#include "../Graphics/Texture2D.h"
+#include "../IO/Log.h"
+
+#include "../DebugNew.h"
+
+namespace Dry
+{
+
+/// Tile to repack, with the size it had.
+struct ShadowAtlasRepack
+{
+    /// Tile.
+    ShadowAtlasTile* tile_;
+    /// Width.
+    int width_;
+    /// Height.
+    int height_;
+};
+
+static bool CompareRepackTiles(const ShadowAtlasRepack& lhs, const ShadowAtlasRepack& rhs)
+{
+    return lhs.width_ * lhs.height_ > rhs.width_ * rhs.height_;
+}
+
+ShadowAtlas::ShadowAtlas(Context* context) :
+    Object(context),
+    size_(0),
+    frameNumber_(0),
+    repackPending_(false)
+{
+}
+
+ShadowAtlas::~ShadowAtlas() = default;
+
+bool ShadowAtlas::SetSize(int size, unsigned format)
+{
+    auto* graphics = GetSubsystem<Graphics>();
+    if (!graphics || !format || size <= 0)
+        return false;
+
+    tiles_.Clear();
+    staticTexture_.Reset();
+    repackPending_ = false;
+
+    texture_ = new Texture2D(context_);
+    texture_->SetNumLevels(1);
+    if (!texture_->SetSize(size, size, format, TEXTURE_DEPTHSTENCIL))
+    {
+        DRY_LOGERROR("Failed to create shadow atlas of size " + String(size));
+        texture_.Reset();
+        size_ = 0;
+        return false;
+    }
+
+#ifndef GL_ES_VERSION_2_0
+    texture_->SetFilterMode(FILTER_BILINEAR);
+    texture_->SetShadowCompare(true);
+#endif
+
+    // Create dummy color texture if necessary, as for the separate shadow maps
+    const unsigned dummyColorFormat = graphics->GetDummyColorFormat();
+    if (dummyColorFormat)
+    {
+        dummyColorTexture_ = new Texture2D(context_);
+        dummyColorTexture_->SetNumLevels(1);
+        dummyColorTexture_->SetSize(size, size, dummyColorFormat, TEXTURE_RENDERTARGET);
+        texture_->GetRenderSurface()->SetLinkedRenderTarget(dummyColorTexture_->GetRenderSurface());
+    }
+    else
+        dummyColorTexture_.Reset();
+
+    size_ = size;
+    allocator_.Reset(size_, size_, 0, 0, false);
+    return true;
+}
+
+void ShadowAtlas::BeginFrame(unsigned frameNumber)
+{
+    frameNumber_ = frameNumber;
+    if (!texture_)
+        return;
+
+    // Contents of the render targets are gone after a device loss
+    if (texture_->IsDataLost())
+    {
+        InvalidateTiles();
+        texture_->ClearDataLost();
+    }
+
+    // Forget tiles of destroyed lights and cameras
+    for (HashMap<Pair<Light*, Camera*>, ShadowAtlasTile>::Iterator i = tiles_.Begin(); i != tiles_.End();)
+    {
+        if (i->second_.light_.Expired() || i->second_.camera_.Expired())
+            i = tiles_.Erase(i);
+        else
+            ++i;
+    }
+
+    if (!repackPending_)
+        return;
+
+    DRY_PROFILE(RepackShadowAtlas);
+
+    // Keep the tiles used on the previous frame, largest first. The others are released
+    PODVector<ShadowAtlasRepack> repack;
+    for (HashMap<Pair<Light*, Camera*>, ShadowAtlasTile>::Iterator i = tiles_.Begin(); i != tiles_.End();)
+    {
+        if (i->second_.lastFrame_ + 1 >= frameNumber_)
+        {
+            ShadowAtlasRepack entry{ &i->second_, i->second_.rect_.Width(), i->second_.rect_.Height() };
+            repack.Push(entry);
+            ++i;
+        }
+        else
+            i = tiles_.Erase(i);
+    }
+
+    Sort(repack.Begin(), repack.End(), CompareRepackTiles);
+    allocator_.Reset(size_, size_, 0, 0, false);
+    repackPending_ = false;
+
+    for (unsigned i{ 0 }; i < repack.Size(); ++i)
+    {
+        ShadowAtlasTile* tile = repack[i].tile_;
+        const IntRect oldRect = tile->rect_;
+        if (!AllocateTile(*tile, repack[i].width_, repack[i].height_))
+        {
+            // Leave it to be allocated again when next requested
+            tile->rect_ = IntRect::ZERO;
+            repackPending_ = true;
+        }
+        else if (tile->rect_ != oldRect)
+        {
+            for (unsigned j{ 0 }; j < MAX_LIGHT_SPLITS; ++j)
+                tile->splits_[j] = ShadowAtlasSplit();
+        }
+    }
+}
+
+ShadowAtlasTile* ShadowAtlas::GetTile(Light* light, Camera* camera, int width, int height)
+{
+    if (!texture_ || !light || !camera || width > size_ || height > size_)
+        return nullptr;
+
+    ShadowAtlasTile& tile = tiles_[MakePair(light, camera)];
+    tile.lastFrame_ = frameNumber_;
+
+    if (tile.rect_.Width() == width && tile.rect_.Height() == height)
+        return &tile;
+
+    // The previous area, if any, stays unused until the next repack
+    tile.light_ = light;
+    tile.camera_ = camera;
+    if (!AllocateTile(tile, width, height))
+    {
+        tile.rect_ = IntRect::ZERO;
+        repackPending_ = true;
+        return nullptr;
+    }
+
+    for (unsigned i{ 0 }; i < MAX_LIGHT_SPLITS; ++i)
+        tile.splits_[i] = ShadowAtlasSplit();
+
+    return &tile;
+}
+
+bool ShadowAtlas::CopyStatic(const IntRect& rect, bool restore)
+{
+    auto* graphics = GetSubsystem<Graphics>();
+    if (!texture_ || !graphics)
+        return false;
+
+    if (!staticTexture_)
+    {
+        staticTexture_ = new Texture2D(context_);
+        staticTexture_->SetNumLevels(1);
+        if (!staticTexture_->SetSize(size_, size_, texture_->GetFormat(), TEXTURE_DEPTHSTENCIL))
+        {
+            staticTexture_.Reset();
+            return false;
+        }
+    }
+
+    if (restore)
+        return graphics->CopyDepthRect(staticTexture_, texture_, rect);
+    else
+        return graphics->CopyDepthRect(texture_, staticTexture_, rect);
+}
+
+void ShadowAtlas::InvalidateTiles()
+{
+    for (HashMap<Pair<Light*, Camera*>, ShadowAtlasTile>::Iterator i = tiles_.Begin(); i != tiles_.End(); ++i)
+    {
+        for (unsigned j{ 0 }; j < MAX_LIGHT_SPLITS; ++j)
+            i->second_.splits_[j] = ShadowAtlasSplit();
+    }
+}
+
+bool ShadowAtlas::AllocateTile(ShadowAtlasTile& tile, int width, int height)
+{
+    int x, y;
+    if (!allocator_.Allocate(width, height, x, y))
+        return false;
+
+    tile.rect_ = IntRect(x, y, x + width, y + height);
+    return true;
+}
+
+}
@@ -0,0 +1,126 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+// Copyright (c) 2020-2023 LucKey Productions.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Container/HashMap.h"
+#include "../Container/Ptr.h"
+#include "../Core/Object.h"
+#include "../Graphics/Light.h"
+#include "../Math/AreaAllocator.h"
+
+namespace Dry
+{
+
+class Camera;
+class Texture2D;
+
+/// Default shadow atlas width and height.
+static const int DEFAULT_SHADOW_ATLAS_SIZE = 4096;
+
+/// Cache state of one shadow split in a shadow atlas tile.
+struct ShadowAtlasSplit
+{
+    /// Hash of the static shadow casters and shadow camera the split was last rendered with. Zero if not rendered.
+    unsigned staticHash_{};
+    /// Whether the static copy holds the split's static shadow casters.
+    bool hasStaticCopy_{};
+    /// Whether the atlas holds only the split's static shadow casters, so that it can be used as is.
+    bool staticOnly_{};
+};
+
+/// Shadow atlas tile of one light seen from one camera. Kept across frames so that the static shadow casters need not be redrawn.
+struct ShadowAtlasTile
+{
+    /// Light.
+    WeakPtr<Light> light_;
+    /// Camera the tile is used with.
+    WeakPtr<Camera> camera_;
+    /// Area of the atlas.
+    IntRect rect_;
+    /// Frame number the tile was last used on.
+    unsigned lastFrame_{};
+    /// Cache state of the shadow splits.
+    ShadowAtlasSplit splits_[MAX_LIGHT_SPLITS];
+};
+
+/// %Shadow map atlas. Holds the depth shadow maps of all lights in one texture, with tiles allocated by an area allocator. Tiles persist across frames, and a static copy of the atlas keeps the static shadow casters of each tile so that only dynamic casters are redrawn every frame.
+class DRY_API ShadowAtlas : public Object
+{
+    DRY_OBJECT(ShadowAtlas, Object);
+
+public:
+    /// Construct.
+    explicit ShadowAtlas(Context* context);
+    /// Destruct.
+    ~ShadowAtlas() override;
+
+    /// Set size and depth format. Removes all tiles. Return true on success.
+    bool SetSize(int size, unsigned format);
+    /// Prepare for a new frame. Repacks the tiles still in use if an allocation failed on the previous frame.
+    void BeginFrame(unsigned frameNumber);
+    /// Return the tile for a light seen from a camera, allocating it if necessary. Return null if the atlas is full.
+    ShadowAtlasTile* GetTile(Light* light, Camera* camera, int width, int height);
+    /// Copy a tile area from the atlas to the static copy, or back when restoring. Return true on success.
+    bool CopyStatic(const IntRect& rect, bool restore);
+    /// Forget the cached contents of all tiles.
+    void InvalidateTiles();
+
+    /// Return width and height.
+    int GetSize() const { return size_; }
+
+    /// Return the atlas texture.
+    Texture2D* GetTexture() const { return texture_; }
+
+    /// Return the static copy texture, or null if not needed yet.
+    Texture2D* GetStaticTexture() const { return staticTexture_; }
+
+    /// Return number of tiles.
+    unsigned GetNumTiles() const { return tiles_.Size(); }
+
+private:
+    /// Allocate an area for a tile. Return true on success.
+    bool AllocateTile(ShadowAtlasTile& tile, int width, int height);
+
+    /// Area allocator.
+    AreaAllocator allocator_;
+    /// Tiles by light and camera.
+    HashMap<Pair<Light*, Camera*>, ShadowAtlasTile> tiles_;
+    /// Atlas texture.
+    SharedPtr<Texture2D> texture_;
+    /// Static copy texture.
+    SharedPtr<Texture2D> staticTexture_;
+    /// Dummy color texture for drivers that need a color attachment.
+    SharedPtr<Texture2D> dummyColorTexture_;
+    /// Width and height.
+    int size_;
+    /// Current frame number.
+    unsigned frameNumber_;
+    /// Repack flag. Set when an allocation fails.
+    bool repackPending_;
+};
+
+}
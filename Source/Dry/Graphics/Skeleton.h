@@ -83,6 +83,17 @@ struct Bone
     WeakPtr<Node> node_;
 };
 
+/// Local transform of a bone in an evaluated animation pose.
+struct BonePose
+{
+    /// Position.
+    Vector3 position_;
+    /// Rotation.
+    Quaternion rotation_;
+    /// Scale.
+    Vector3 scale_;
+};
+
 /// Hierarchical collection of bones.
 class DRY_API Skeleton
 {
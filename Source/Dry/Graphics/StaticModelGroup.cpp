@@ -27,7 +27,9 @@
 #include "../Graphics/Batch.h"
 #include "../Graphics/Camera.h"
 #include "../Graphics/Geometry.h"
+#include "../Graphics/IndexBuffer.h"
 #include "../Graphics/Material.h"
+#include "../Graphics/MeshSimplifier.h"
 #include "../Graphics/OcclusionBuffer.h"
 #include "../Graphics/OctreeQuery.h"
 #include "../Graphics/StaticModelGroup.h"
@@ -61,6 +63,8 @@ void StaticModelGroup::RegisterObject(Context* context)
     context->RegisterFactory<StaticModelGroup>(DRY_GEOMETRY_CATEGORY);
 
     DRY_COPY_BASE_ATTRIBUTES(StaticModel);
+    DRY_ACCESSOR_ATTRIBUTE("HLOD Distance", GetHlodDistance, SetHlodDistance, float, 0.0f, AM_DEFAULT);
+    DRY_ACCESSOR_ATTRIBUTE("HLOD Reduction", GetHlodReduction, SetHlodReduction, float, DEFAULT_HLOD_REDUCTION, AM_DEFAULT);
     DRY_ACCESSOR_ATTRIBUTE("Instance Nodes", GetNodeIDsAttr, SetNodeIDsAttr,
         VariantVector, Variant::emptyVariantVector, AM_DEFAULT | AM_NODEIDVECTOR)
         .SetMetadata(AttributeMetadata::P_VECTOR_STRUCT_ELEMENTS, instanceNodesStructureElementNames);
@@ -198,6 +202,51 @@ void StaticModelGroup::UpdateBatches(const FrameInfo& frame)
         lodDistance_ = newLodDistance;
         CalculateLodLevels();
     }
+
+    // Draw the merged proxies when far enough. Until they have been created, the instances are drawn as usual
+    const bool useProxy = hlodDistance_ > 0.0f && distance_ >= hlodDistance_ && !proxyDirty_ &&
+        proxyGeometries_.Size() == batches_.Size();
+    if (useProxy)
+    {
+        for (unsigned i{ 0 }; i < batches_.Size(); ++i)
+        {
+            if (proxyGeometries_[i])
+            {
+                batches_[i].geometry_ = proxyGeometries_[i];
+                batches_[i].worldTransform_ = &Matrix3x4::IDENTITY;
+                batches_[i].numWorldTransforms_ = 1;
+            }
+        }
+    }
+    else if (proxyActive_)
+        CalculateLodLevels();
+
+    proxyActive_ = useProxy;
+
+    // Recreate the proxies once the group is far enough to use them and the instances have settled, instead of every frame
+    // while they move
+    if (proxyChanged_)
+    {
+        proxyChanged_ = false;
+        proxyChangeFrame_ = frame.frameNumber_;
+    }
+    proxyRebuild_ = hlodDistance_ > 0.0f && proxyDirty_ && distance_ >= hlodDistance_ &&
+        frame.frameNumber_ - proxyChangeFrame_ >= HLOD_REBUILD_DELAY;
+}
+
+void StaticModelGroup::UpdateGeometry(const FrameInfo& frame)
+{
+    if (proxyRebuild_)
+        CreateProxyGeometries();
+}
+
+UpdateGeometryType StaticModelGroup::GetUpdateGeometryType()
+{
+    // Proxies are created on the main thread
+    if (proxyRebuild_)
+        return UPDATE_MAIN_THREAD;
+    else
+        return StaticModel::GetUpdateGeometryType();
 }
 
 unsigned StaticModelGroup::GetNumOccluderTriangles()
@@ -314,6 +363,23 @@ void StaticModelGroup::RemoveAllInstanceNodes()
     UpdateNumTransforms();
 }
 
+void StaticModelGroup::SetHlodDistance(float distance)
+{
+    hlodDistance_ = Max(distance, 0.0f);
+    if (hlodDistance_ == 0.0f)
+        proxyGeometries_.Clear();
+
+    proxyDirty_ = true;
+    MarkNetworkUpdate();
+}
+
+void StaticModelGroup::SetHlodReduction(float reduction)
+{
+    hlodReduction_ = Clamp(reduction, 0.0f, 1.0f);
+    proxyDirty_ = true;
+    MarkNetworkUpdate();
+}
+
 Node* StaticModelGroup::GetInstanceNode(unsigned index) const
 {
     return index < instanceNodes_.Size() ? instanceNodes_[index] : nullptr;
@@ -385,6 +451,8 @@ void StaticModelGroup::OnWorldBoundingBoxUpdate()
     }
 
     worldBoundingBox_ = worldBox;
+    proxyDirty_ = true;
+    proxyChanged_ = true;
 
     // Store the amount of valid instances we found instead of resizing worldTransforms_. This is because this function may be
     // called from multiple worker threads simultaneously
@@ -417,4 +485,128 @@ void StaticModelGroup::UpdateNodeIDs() const
     nodeIDsDirty_ = false;
 }
 
+void StaticModelGroup::CreateProxyGeometries()
+{
+    // Make sure instance transforms are up-to-date
+    GetWorldBoundingBox();
+
+    proxyGeometries_.Resize(batches_.Size());
+    for (unsigned i{ 0 }; i < batches_.Size(); ++i)
+        proxyGeometries_[i] = i < geometries_.Size() && geometries_[i].Size() ? CreateProxyGeometry(geometries_[i].Back()) : nullptr;
+
+    proxyDirty_ = false;
+    proxyRebuild_ = false;
+}
+
+SharedPtr<Geometry> StaticModelGroup::CreateProxyGeometry(Geometry* geometry)
+{
+    if (!geometry || !numWorldTransforms_ || geometry->GetNumVertexBuffers() != 1 || geometry->GetPrimitiveType() != TRIANGLE_LIST ||
+        !geometry->GetIndexCount())
+        return SharedPtr<Geometry>();
+
+    VertexBuffer* sourceVertices = geometry->GetVertexBuffer(0);
+    IndexBuffer* sourceIndices = geometry->GetIndexBuffer();
+    if (!sourceVertices || !sourceIndices || !sourceVertices->GetShadowData() || !sourceIndices->GetShadowData())
+        return SharedPtr<Geometry>();
+
+    const unsigned positionOffset = sourceVertices->GetElementOffset(TYPE_VECTOR3, SEM_POSITION);
+    const unsigned normalOffset = sourceVertices->GetElementOffset(TYPE_VECTOR3, SEM_NORMAL);
+    const unsigned tangentOffset = sourceVertices->GetElementOffset(TYPE_VECTOR4, SEM_TANGENT);
+    if (positionOffset == M_MAX_UNSIGNED)
+        return SharedPtr<Geometry>();
+
+    // Read the indices and find the vertex range they use
+    const unsigned indexCount = geometry->GetIndexCount();
+    const unsigned char* indexData = sourceIndices->GetShadowData() + geometry->GetIndexStart() * sourceIndices->GetIndexSize();
+    PODVector<unsigned> sourceIndexData(indexCount);
+    unsigned minVertex = M_MAX_UNSIGNED;
+    unsigned maxVertex = 0;
+
+    for (unsigned i{ 0 }; i < indexCount; ++i)
+    {
+        if (sourceIndices->GetIndexSize() == sizeof(unsigned))
+            sourceIndexData[i] = reinterpret_cast<const unsigned*>(indexData)[i];
+        else
+            sourceIndexData[i] = reinterpret_cast<const unsigned short*>(indexData)[i];
+
+        minVertex = Min(minVertex, sourceIndexData[i]);
+        maxVertex = Max(maxVertex, sourceIndexData[i]);
+    }
+
+    if (maxVertex >= sourceVertices->GetVertexCount())
+        return SharedPtr<Geometry>();
+
+    // Transform a copy of the vertices of each instance to world space
+    const unsigned vertexCount = maxVertex - minVertex + 1;
+    const unsigned vertexSize = sourceVertices->GetVertexSize();
+    const unsigned totalVertices = vertexCount * numWorldTransforms_;
+    PODVector<unsigned char> vertexData(totalVertices * vertexSize);
+    PODVector<unsigned> indices(indexCount * numWorldTransforms_);
+
+    for (unsigned i{ 0 }; i < numWorldTransforms_; ++i)
+    {
+        const Matrix3x4& transform = worldTransforms_[i];
+        unsigned char* dest = &vertexData[i * vertexCount * vertexSize];
+        memcpy(dest, sourceVertices->GetShadowData() + minVertex * vertexSize, vertexCount * vertexSize);
+
+        for (unsigned j{ 0 }; j < vertexCount; ++j)
+        {
+            unsigned char* vertex = dest + j * vertexSize;
+            auto& position = *reinterpret_cast<Vector3*>(vertex + positionOffset);
+            position = transform * position;
+
+            if (normalOffset != M_MAX_UNSIGNED)
+            {
+                auto& normal = *reinterpret_cast<Vector3*>(vertex + normalOffset);
+                normal = (transform * Vector4(normal, 0.0f)).Normalized();
+            }
+            if (tangentOffset != M_MAX_UNSIGNED)
+            {
+                auto& tangent = *reinterpret_cast<Vector4*>(vertex + tangentOffset);
+                tangent = Vector4((transform * Vector4(Vector3(tangent), 0.0f)).Normalized(), tangent.w_);
+            }
+        }
+
+        for (unsigned j{ 0 }; j < indexCount; ++j)
+            indices[i * indexCount + j] = sourceIndexData[j] - minVertex + i * vertexCount;
+    }
+
+    PODVector<unsigned> simplified;
+    const auto targetIndexCount = (unsigned)(indices.Size() / 3 * hlodReduction_) * 3;
+    SimplifyMesh(simplified, &vertexData[positionOffset], vertexSize, totalVertices, &indices[0], indices.Size(), targetIndexCount);
+    if (simplified.IsEmpty())
+        return SharedPtr<Geometry>();
+
+    // Keep only the vertices the simplified mesh still uses, in the order of first use
+    PODVector<unsigned> remap(totalVertices);
+    for (unsigned i{ 0 }; i < totalVertices; ++i)
+        remap[i] = M_MAX_UNSIGNED;
+
+    PODVector<unsigned char> usedVertexData;
+    unsigned usedVertices{ 0 };
+    for (unsigned i{ 0 }; i < simplified.Size(); ++i)
+    {
+        unsigned& index = simplified[i];
+        if (remap[index] == M_MAX_UNSIGNED)
+        {
+            remap[index] = usedVertices++;
+            const unsigned char* vertex = vertexData.Buffer() + index * vertexSize;
+            usedVertexData.Insert(usedVertexData.End(), vertex, vertex + vertexSize);
+        }
+        index = remap[index];
+    }
+
+    SharedPtr<VertexBuffer> vertexBuffer(new VertexBuffer(context_));
+    SharedPtr<IndexBuffer> indexBuffer(new IndexBuffer(context_));
+    if (!vertexBuffer->SetSize(usedVertices, sourceVertices->GetElements()) || !vertexBuffer->SetData(&usedVertexData[0]) ||
+        !indexBuffer->SetSize(simplified.Size(), true) || !indexBuffer->SetData(&simplified[0]))
+        return SharedPtr<Geometry>();
+
+    SharedPtr<Geometry> proxy(new Geometry(context_));
+    proxy->SetVertexBuffer(0, vertexBuffer);
+    proxy->SetIndexBuffer(indexBuffer);
+    proxy->SetDrawRange(TRIANGLE_LIST, 0, simplified.Size(), 0, usedVertices, false);
+    return proxy;
+}
+
 }
@@ -28,6 +28,11 @@
 namespace Dry
 {
 
+/// Default ratio of triangles kept in a hierarchical LOD proxy.
+static const float DEFAULT_HLOD_REDUCTION = 0.25f;
+/// Number of frames the instances must stay unchanged before the hierarchical LOD proxies are recreated.
+static const unsigned HLOD_REBUILD_DELAY = 30;
+
 /// Renders several object instances while culling and receiving light as one unit. Can be used as a CPU-side optimization, but note that also regular StaticModels will use instanced rendering if possible.
 class DRY_API StaticModelGroup : public StaticModel
 {
@@ -51,6 +56,10 @@ public:
     unsigned GetNumOccluderTriangles() override;
     /// Draw to occlusion buffer. Return true if did not run out of triangles.
     bool DrawOcclusion(OcclusionBuffer* buffer) override;
+    /// Prepare geometry for rendering. Called from a worker thread if possible (no GPU update.)
+    void UpdateGeometry(const FrameInfo& frame) override;
+    /// Return whether a geometry update is necessary, and if it can happen in a worker thread.
+    UpdateGeometryType GetUpdateGeometryType() override;
 
     /// Add an instance scene node. It does not need any drawable components of its own.
     void AddInstanceNode(Node* node);
@@ -58,6 +67,10 @@ public:
     void RemoveInstanceNode(Node* node);
     /// Remove all instance scene nodes.
     void RemoveAllInstanceNodes();
+    /// Set distance beyond which the instances are drawn as one merged and simplified proxy mesh per batch. Zero disables.
+    void SetHlodDistance(float distance);
+    /// Set ratio of the merged triangles kept in the proxy meshes.
+    void SetHlodReduction(float reduction);
 
     /// Return number of instance nodes.
     unsigned GetNumInstanceNodes() const { return instanceNodes_.Size(); }
@@ -65,6 +78,12 @@ public:
     /// Return instance node by index.
     Node* GetInstanceNode(unsigned index) const;
 
+    /// Return distance beyond which the proxy meshes are drawn.
+    float GetHlodDistance() const { return hlodDistance_; }
+
+    /// Return ratio of the merged triangles kept in the proxy meshes.
+    float GetHlodReduction() const { return hlodReduction_; }
+
     /// Set node IDs attribute.
     void SetNodeIDsAttr(const VariantVector& value);
 
@@ -82,6 +101,10 @@ private:
     void UpdateNumTransforms();
     /// Update node IDs attribute from the actual nodes.
     void UpdateNodeIDs() const;
+    /// Merge the lowest LOD level of the instances into a simplified proxy geometry per batch.
+    void CreateProxyGeometries();
+    /// Create the proxy geometry of a batch. Return null if the geometry can not be merged.
+    SharedPtr<Geometry> CreateProxyGeometry(Geometry* geometry);
 
     /// Instance nodes.
     Vector<WeakPtr<Node> > instanceNodes_;
@@ -89,8 +112,24 @@ private:
     PODVector<Matrix3x4> worldTransforms_;
     /// IDs of instance nodes for serialization.
     mutable VariantVector nodeIDsAttr_;
+    /// Merged and simplified proxy geometries per batch.
+    Vector<SharedPtr<Geometry> > proxyGeometries_;
     /// Number of valid instance node transforms.
     unsigned numWorldTransforms_{};
+    /// Distance beyond which the proxy geometries are drawn.
+    float hlodDistance_{};
+    /// Ratio of the merged triangles kept in the proxy geometries.
+    float hlodReduction_{ DEFAULT_HLOD_REDUCTION };
+    /// Proxy geometries need to be recreated flag.
+    bool proxyDirty_{ true };
+    /// Instances changed since the last batch update flag.
+    bool proxyChanged_{ true };
+    /// Proxy geometries are due to be recreated in the next geometry update flag.
+    bool proxyRebuild_{};
+    /// Frame number of the last instance change.
+    unsigned proxyChangeFrame_{};
+    /// Batches use the proxy geometries flag.
+    bool proxyActive_{};
     /// Whether node IDs have been set and nodes should be searched for during ApplyAttributes.
     mutable bool nodesDirty_{};
     /// Whether nodes have been manipulated by the API and node ID attribute should be refreshed.
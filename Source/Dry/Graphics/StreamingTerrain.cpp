@@ -0,0 +1,1156 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+// Copyright (c) 2020-2023 LucKey Productions.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Container/Sort.h"
+#include "../Core/Context.h"
+#include "../Core/Profiler.h"
+#include "../Core/Timer.h"
+#include "../Graphics/Camera.h"
+#include "../Graphics/Drawable.h"
+#include "../Graphics/Geometry.h"
+#include "../Graphics/GraphicsEvents.h"
+#include "../Graphics/IndexBuffer.h"
+#include "../Graphics/Material.h"
+#include "../Graphics/StreamingTerrain.h"
+#include "../Graphics/StreamingTerrainBlock.h"
+#include "../Graphics/Technique.h"
+#include "../Graphics/Texture.h"
+#include "../Graphics/VertexBuffer.h"
+#include "../IO/AsyncFileReader.h"
+#include "../IO/File.h"
+#include "../IO/Log.h"
+#include "../Resource/ResourceCache.h"
+#include "../Resource/ResourceEvents.h"
+#include "../Scene/Node.h"
+#include "../Scene/Scene.h"
+
+#include "../DebugNew.h"
+
+namespace Dry
+{
+
+extern const char* DRY_GEOMETRY_CATEGORY;
+
+static const Vector3 DEFAULT_SPACING(1.0f, 0.25f, 1.0f);
+static const int MIN_PATCH_SIZE = 4;
+static const int MAX_PATCH_SIZE = 128;
+static const float DEFAULT_LOD_DISTANCE = 100.0f;
+/// Minimum finest LOD range relative to the finest node size. Keeps nodes next to each other within one level.
+static const float MIN_LOD_RANGE_SCALE = 2.0f * M_SQRT2;
+/// Maximum number of blocks per side when building a tile file.
+static const int MAX_BLOCKS_PER_SIDE = 8;
+/// Maximum number of tile reads in flight.
+static const unsigned MAX_LOADING_TILES = 64;
+/// Floats per vertex: position, normal, texture coordinate, tangent and morph offset.
+static const unsigned VERTEX_FLOATS = 16;
+static const char* TILE_FILE_ID = "DHTS";
+static const unsigned TILE_FILE_HEADER_SIZE = 20;
+
+static unsigned long long GetTileKey(unsigned level, int x, int z)
+{
+    return ((unsigned long long)level << 48u) | ((unsigned long long)(unsigned)x << 24u) | (unsigned long long)(unsigned)z;
+}
+
+static float GetTileHeight(const StreamingTerrainTile* tile, int patchSize, int x, int z)
+{
+    return tile->heights_[(z + 1) * (patchSize + 3) + x + 1];
+}
+
+/// Return a signature of the material state the morph materials copy: techniques, textures, parameters and render state.
+static unsigned GetMaterialSignature(const Material* material)
+{
+    unsigned signature{ material->GetShaderParameterHash() };
+
+    const Vector<TechniqueEntry>& techniques = material->GetTechniques();
+    for (unsigned i{ 0 }; i < techniques.Size(); ++i)
+    {
+        CombineHash(signature, MakeHash(techniques[i].original_.Get()));
+        CombineHash(signature, (unsigned)techniques[i].qualityLevel_);
+        CombineHash(signature, FloatToRawIntBits(techniques[i].lodDistance_));
+    }
+
+    const HashMap<TextureUnit, SharedPtr<Texture> >& textures = material->GetTextures();
+    for (HashMap<TextureUnit, SharedPtr<Texture> >::ConstIterator i = textures.Begin(); i != textures.End(); ++i)
+    {
+        CombineHash(signature, (unsigned)i->first_);
+        CombineHash(signature, MakeHash(i->second_.Get()));
+    }
+
+    const BiasParameters& depthBias = material->GetDepthBias();
+    CombineHash(signature, material->GetVertexShaderDefines().ToHash());
+    CombineHash(signature, material->GetPixelShaderDefines().ToHash());
+    CombineHash(signature, (unsigned)material->GetCullMode());
+    CombineHash(signature, (unsigned)material->GetShadowCullMode());
+    CombineHash(signature, (unsigned)material->GetFillMode());
+    CombineHash(signature, FloatToRawIntBits(depthBias.constantBias_));
+    CombineHash(signature, FloatToRawIntBits(depthBias.slopeScaledBias_));
+    CombineHash(signature, material->GetRenderOrder());
+    CombineHash(signature, material->GetOcclusion() ? 1u : 0u);
+    CombineHash(signature, material->GetAlphaToCoverage() ? 1u : 0u);
+    CombineHash(signature, material->GetLineAntiAlias() ? 1u : 0u);
+
+    return signature;
+}
+
+static bool CompareTileUsage(const StreamingTerrainTile* lhs, const StreamingTerrainTile* rhs)
+{
+    return lhs->lastUsed_ < rhs->lastUsed_;
+}
+
+StreamingTerrain::StreamingTerrain(Context* context) :
+    Component(context),
+    indexBuffer_(new IndexBuffer(context)),
+    spacing_(DEFAULT_SPACING),
+    origin_(Vector2::ZERO),
+    numVertices_(IntVector2::ZERO),
+    numBlocks_(IntVector2::ZERO),
+    patchSize_(0),
+    numLevels_(0),
+    lodDistance_(DEFAULT_LOD_DISTANCE),
+    maxTiles_(DEFAULT_STREAMING_TERRAIN_TILES),
+    lastUpdateFrame_(0),
+    materialSignature_(0),
+    materialCheckFrame_(0),
+    readsQueued_(false),
+    castShadows_(false),
+    viewMask_(DEFAULT_VIEWMASK),
+    lightMask_(DEFAULT_LIGHTMASK),
+    shadowMask_(DEFAULT_SHADOWMASK),
+    zoneMask_(DEFAULT_ZONEMASK),
+    drawDistance_(0.0f),
+    shadowDistance_(0.0f),
+    maxLights_(0),
+    recreateTerrain_(false)
+{
+    reader_ = GetSubsystem<AsyncFileReader>();
+
+    SubscribeToEvent(E_BEGINVIEWUPDATE, DRY_HANDLER(StreamingTerrain, HandleBeginViewUpdate));
+}
+
+StreamingTerrain::~StreamingTerrain()
+{
+    // The blocks' batches refer to the tile geometries
+    for (unsigned i{ 0 }; i < blocks_.Size(); ++i)
+    {
+        if (blocks_[i])
+            blocks_[i]->SetOwner(nullptr);
+    }
+
+    ClearTiles();
+}
+
+void StreamingTerrain::RegisterObject(Context* context)
+{
+    context->RegisterFactory<StreamingTerrain>(DRY_GEOMETRY_CATEGORY);
+
+    DRY_ACCESSOR_ATTRIBUTE("Is Enabled", IsEnabled, SetEnabled, bool, true, AM_DEFAULT);
+    DRY_ACCESSOR_ATTRIBUTE("Tile File", GetTileFile, SetTileFileAttr, String, String::EMPTY, AM_DEFAULT);
+    DRY_MIXED_ACCESSOR_ATTRIBUTE("Material", GetMaterialAttr, SetMaterialAttr, ResourceRef, ResourceRef(Material::GetTypeStatic()),
+        AM_DEFAULT);
+    DRY_ATTRIBUTE_EX("Vertex Spacing", Vector3, spacing_, MarkTerrainDirty, DEFAULT_SPACING, AM_DEFAULT);
+    DRY_ACCESSOR_ATTRIBUTE("LOD Distance", GetLodDistance, SetLodDistance, float, DEFAULT_LOD_DISTANCE, AM_DEFAULT);
+    DRY_ACCESSOR_ATTRIBUTE("Max Tiles", GetMaxTiles, SetMaxTiles, unsigned, DEFAULT_STREAMING_TERRAIN_TILES, AM_DEFAULT);
+    DRY_ACCESSOR_ATTRIBUTE("Cast Shadows", GetCastShadows, SetCastShadows, bool, false, AM_DEFAULT);
+    DRY_ACCESSOR_ATTRIBUTE("Draw Distance", GetDrawDistance, SetDrawDistance, float, 0.0f, AM_DEFAULT);
+    DRY_ACCESSOR_ATTRIBUTE("Shadow Distance", GetShadowDistance, SetShadowDistance, float, 0.0f, AM_DEFAULT);
+    DRY_ACCESSOR_ATTRIBUTE("Max Lights", GetMaxLights, SetMaxLights, unsigned, 0, AM_DEFAULT);
+    DRY_ACCESSOR_ATTRIBUTE("View Mask", GetViewMask, SetViewMask, unsigned, DEFAULT_VIEWMASK, AM_DEFAULT);
+    DRY_ACCESSOR_ATTRIBUTE("Light Mask", GetLightMask, SetLightMask, unsigned, DEFAULT_LIGHTMASK, AM_DEFAULT);
+    DRY_ACCESSOR_ATTRIBUTE("Shadow Mask", GetShadowMask, SetShadowMask, unsigned, DEFAULT_SHADOWMASK, AM_DEFAULT);
+    DRY_ACCESSOR_ATTRIBUTE("Zone Mask", GetZoneMask, SetZoneMask, unsigned, DEFAULT_ZONEMASK, AM_DEFAULT);
+}
+
+void StreamingTerrain::ApplyAttributes()
+{
+    if (recreateTerrain_)
+        CreateGeometry();
+}
+
+void StreamingTerrain::OnSetEnabled()
+{
+    bool enabled = IsEnabledEffective();
+
+    for (unsigned i{ 0 }; i < blocks_.Size(); ++i)
+    {
+        if (blocks_[i])
+            blocks_[i]->SetEnabled(enabled);
+    }
+}
+
+bool StreamingTerrain::BuildTileFile(Context* context, const String& rawFileName, const IntVector2& size, const String& tileFileName,
+    int patchSize)
+{
+    if (patchSize < MIN_PATCH_SIZE || patchSize > MAX_PATCH_SIZE || !IsPowerOfTwo((unsigned)patchSize))
+    {
+        DRY_LOGERROR("Terrain tile patch size must be a power of two between " + String(MIN_PATCH_SIZE) + " and " +
+            String(MAX_PATCH_SIZE));
+        return false;
+    }
+
+    File source(context, rawFileName);
+    if (size.x_ < 2 || size.y_ < 2 || !source.IsOpen() || source.GetSize() < (unsigned)(size.x_ * size.y_) * sizeof(unsigned short))
+    {
+        DRY_LOGERROR("Could not read " + String(size.x_) + "x" + String(size.y_) + " heightmap from " + rawFileName);
+        return false;
+    }
+
+    // Use enough levels for the coarsest tiles to cover the heightmap with a handful of blocks
+    const int maxQuads = Max(size.x_, size.y_) - 1;
+    unsigned numLevels = 1;
+    while (numLevels < MAX_STREAMING_TERRAIN_LEVELS && (patchSize << (numLevels - 1)) * MAX_BLOCKS_PER_SIDE < maxQuads)
+        ++numLevels;
+
+    const unsigned topLevel = numLevels - 1;
+    const int blockQuads = patchSize << topLevel;
+    const IntVector2 numBlocks((size.x_ - 1 + blockQuads - 1) / blockQuads, (size.y_ - 1 + blockQuads - 1) / blockQuads);
+    const int row = patchSize + 3;
+
+    unsigned long long numTiles = 0;
+    for (unsigned i{ 0 }; i < numLevels; ++i)
+        numTiles += (unsigned long long)(numBlocks.x_ << (topLevel - i)) * (unsigned long long)(numBlocks.y_ << (topLevel - i));
+
+    if (TILE_FILE_HEADER_SIZE + numTiles * (row * row + 2) * sizeof(unsigned short) > M_MAX_UNSIGNED)
+    {
+        DRY_LOGERROR("Terrain tile file for " + rawFileName + " would exceed 4 GB");
+        return false;
+    }
+
+    File dest(context, tileFileName, FILE_WRITE);
+    if (!dest.IsOpen())
+    {
+        DRY_LOGERROR("Could not open terrain tile file " + tileFileName + " for writing");
+        return false;
+    }
+
+    dest.WriteFileID(TILE_FILE_ID);
+    dest.WriteUInt((unsigned)size.x_);
+    dest.WriteUInt((unsigned)size.y_);
+    dest.WriteUInt((unsigned)patchSize);
+    dest.WriteUInt(numLevels);
+
+    // Process one row of tiles at a time, so that only the source rows it samples need to be in memory. Tiles sample every
+    // 2^level'th vertex, so that the vertices of a coarser tile coincide with every other vertex of the finer ones. Each tile
+    // ends with the height range of its full resolution footprint, which the coarser samples may miss. A footprint is the
+    // union of its children's, so only the finest level takes the range from the heights
+    PODVector<unsigned short> rows((unsigned)(row * size.x_));
+    PODVector<unsigned short> tileData((unsigned)(row * row + 2));
+    PODVector<unsigned short> heightRanges;
+    PODVector<unsigned short> childHeightRanges;
+
+    for (unsigned level{ 0 }; level < numLevels; ++level)
+    {
+        const int step = 1 << level;
+        const int numTilesX = numBlocks.x_ << (topLevel - level);
+        const int numTilesZ = numBlocks.y_ << (topLevel - level);
+        heightRanges.Resize((unsigned)(numTilesX * numTilesZ * 2));
+
+        for (int tileZ{ 0 }; tileZ < numTilesZ; ++tileZ)
+        {
+            for (int j{ 0 }; j < row; ++j)
+            {
+                // The first row of the source is north, while tile rows go from south to north
+                const int z = Clamp((tileZ * patchSize + j - 1) * step, 0, size.y_ - 1);
+                source.Seek((unsigned)((size.y_ - 1 - z) * size.x_) * sizeof(unsigned short));
+                source.Read(&rows[(unsigned)(j * size.x_)], (unsigned)size.x_ * sizeof(unsigned short));
+            }
+
+            for (int tileX{ 0 }; tileX < numTilesX; ++tileX)
+            {
+                for (int j{ 0 }; j < row; ++j)
+                {
+                    for (int i{ 0 }; i < row; ++i)
+                    {
+                        const int x = Clamp((tileX * patchSize + i - 1) * step, 0, size.x_ - 1);
+                        tileData[(unsigned)(j * row + i)] = rows[(unsigned)(j * size.x_ + x)];
+                    }
+                }
+
+                unsigned short minHeight = 0xffff;
+                unsigned short maxHeight = 0;
+                if (!level)
+                {
+                    for (int j{ 1 }; j <= patchSize + 1; ++j)
+                    {
+                        for (int i{ 1 }; i <= patchSize + 1; ++i)
+                        {
+                            minHeight = Min(minHeight, tileData[(unsigned)(j * row + i)]);
+                            maxHeight = Max(maxHeight, tileData[(unsigned)(j * row + i)]);
+                        }
+                    }
+                }
+                else
+                {
+                    for (unsigned c{ 0 }; c < 4; ++c)
+                    {
+                        const unsigned child = (unsigned)(((tileZ * 2 + (int)(c >> 1u)) * numTilesX * 2 + tileX * 2 + (int)(c & 1u)) * 2);
+                        minHeight = Min(minHeight, childHeightRanges[child]);
+                        maxHeight = Max(maxHeight, childHeightRanges[child + 1]);
+                    }
+                }
+
+                const unsigned tileIndex = (unsigned)(tileZ * numTilesX + tileX);
+                heightRanges[tileIndex * 2] = minHeight;
+                heightRanges[tileIndex * 2 + 1] = maxHeight;
+                tileData[(unsigned)(row * row)] = minHeight;
+                tileData[(unsigned)(row * row + 1)] = maxHeight;
+
+                dest.Write(&tileData[0], tileData.Size() * sizeof(unsigned short));
+            }
+        }
+
+        childHeightRanges.Swap(heightRanges);
+    }
+
+    DRY_LOGINFOF("Built terrain tile file %s with %u levels and %dx%d blocks", tileFileName.CString(), numLevels, numBlocks.x_,
+        numBlocks.y_);
+    return true;
+}
+
+bool StreamingTerrain::SetTileFile(const String& name)
+{
+    const bool success = OpenTileFile(name);
+    CreateGeometry();
+    MarkNetworkUpdate();
+    return success;
+}
+
+void StreamingTerrain::SetMaterial(Material* material)
+{
+    if (material != material_)
+    {
+        if (material_)
+            UnsubscribeFromEvent(material_, E_RELOADFINISHED);
+        if (material)
+            SubscribeToEvent(material, E_RELOADFINISHED, DRY_HANDLER(StreamingTerrain, HandleMaterialReloadFinished));
+    }
+
+    material_ = material;
+
+    CreateMorphMaterial();
+    MarkNetworkUpdate();
+}
+
+void StreamingTerrain::SetSpacing(const Vector3& spacing)
+{
+    if (spacing != spacing_)
+    {
+        spacing_ = spacing;
+
+        CreateGeometry();
+        MarkNetworkUpdate();
+    }
+}
+
+void StreamingTerrain::SetLodDistance(float distance)
+{
+    lodDistance_ = Max(distance, 0.0f);
+    UpdateBlocks();
+    MarkNetworkUpdate();
+}
+
+void StreamingTerrain::SetMaxTiles(unsigned num)
+{
+    maxTiles_ = Max(num, 1u);
+    MarkNetworkUpdate();
+}
+
+void StreamingTerrain::SetDrawDistance(float distance)
+{
+    drawDistance_ = distance;
+    UpdateBlocks();
+    MarkNetworkUpdate();
+}
+
+void StreamingTerrain::SetShadowDistance(float distance)
+{
+    shadowDistance_ = distance;
+    UpdateBlocks();
+    MarkNetworkUpdate();
+}
+
+void StreamingTerrain::SetViewMask(unsigned mask)
+{
+    viewMask_ = mask;
+    UpdateBlocks();
+    MarkNetworkUpdate();
+}
+
+void StreamingTerrain::SetLightMask(unsigned mask)
+{
+    lightMask_ = mask;
+    UpdateBlocks();
+    MarkNetworkUpdate();
+}
+
+void StreamingTerrain::SetShadowMask(unsigned mask)
+{
+    shadowMask_ = mask;
+    UpdateBlocks();
+    MarkNetworkUpdate();
+}
+
+void StreamingTerrain::SetZoneMask(unsigned mask)
+{
+    zoneMask_ = mask;
+    UpdateBlocks();
+    MarkNetworkUpdate();
+}
+
+void StreamingTerrain::SetMaxLights(unsigned num)
+{
+    maxLights_ = num;
+    UpdateBlocks();
+    MarkNetworkUpdate();
+}
+
+void StreamingTerrain::SetCastShadows(bool enable)
+{
+    castShadows_ = enable;
+    UpdateBlocks();
+    MarkNetworkUpdate();
+}
+
+Material* StreamingTerrain::GetMaterial() const
+{
+    return material_;
+}
+
+Material* StreamingTerrain::GetMorphMaterial() const
+{
+    return morphMaterial_;
+}
+
+Material* StreamingTerrain::GetViewMaterial(Camera* camera) const
+{
+    MutexLock lock(tileMutex_);
+
+    HashMap<Camera*, StreamingTerrainViewMaterial>::ConstIterator i = viewMaterials_.Find(camera);
+    return i != viewMaterials_.End() ? i->second_.material_.Get() : nullptr;
+}
+
+unsigned StreamingTerrain::GetNumTiles() const
+{
+    MutexLock lock(tileMutex_);
+    return tiles_.Size();
+}
+
+unsigned StreamingTerrain::GetNumLoadingTiles() const
+{
+    MutexLock lock(tileMutex_);
+    return loadingTiles_.Size();
+}
+
+StreamingTerrainBlock* StreamingTerrain::GetBlock(int x, int z) const
+{
+    if (x < 0 || x >= numBlocks_.x_ || z < 0 || z >= numBlocks_.y_)
+        return nullptr;
+
+    const unsigned index = (unsigned)(z * numBlocks_.x_ + x);
+    return index < blocks_.Size() ? blocks_[index].Get() : nullptr;
+}
+
+float StreamingTerrain::GetHeight(const Vector3& worldPosition) const
+{
+    if (node_)
+    {
+        Vector3 position = node_->GetWorldTransform().Inverse() * worldPosition;
+        float h = GetLocalHeight(position.x_, position.z_);
+        /// \todo This assumes that the terrain scene node is upright
+        return node_->GetWorldScale().y_ * h + node_->GetWorldPosition().y_;
+    }
+    else
+        return 0.0f;
+}
+
+float StreamingTerrain::GetLocalHeight(float x, float z) const
+{
+    if (!numLevels_)
+        return 0.0f;
+
+    const float gridX = (x - origin_.x_) / spacing_.x_;
+    const float gridZ = (z - origin_.y_) / spacing_.z_;
+
+    MutexLock lock(tileMutex_);
+
+    // Descend from the coarsest level as long as the tiles are resident
+    const StreamingTerrainTile* tile = nullptr;
+    for (int level{ (int)numLevels_ - 1 }; level >= 0; --level)
+    {
+        const int shift = (int)numLevels_ - 1 - level;
+        const float nodeQuads = (float)(patchSize_ << level);
+        const int tileX = Clamp(FloorToInt(gridX / nodeQuads), 0, (numBlocks_.x_ << shift) - 1);
+        const int tileZ = Clamp(FloorToInt(gridZ / nodeQuads), 0, (numBlocks_.y_ << shift) - 1);
+
+        HashMap<unsigned long long, SharedPtr<StreamingTerrainTile> >::ConstIterator i = tiles_.Find(GetTileKey((unsigned)level, tileX, tileZ));
+        if (i == tiles_.End())
+            break;
+
+        const unsigned state = i->second_->state_;
+        if (state != TILE_DECODED && state != TILE_READY)
+            break;
+
+        tile = i->second_;
+    }
+
+    if (!tile)
+        return 0.0f;
+
+    const float step = (float)(1u << tile->level_);
+    const float xPos = Clamp((gridX - (float)(tile->x_ * patchSize_) * step) / step, 0.0f, (float)patchSize_);
+    const float zPos = Clamp((gridZ - (float)(tile->z_ * patchSize_) * step) / step, 0.0f, (float)patchSize_);
+    const int xInt = Min((int)xPos, patchSize_ - 1);
+    const int zInt = Min((int)zPos, patchSize_ - 1);
+    float xFrac = xPos - (float)xInt;
+    float zFrac = zPos - (float)zInt;
+    float h1, h2, h3;
+
+    if (xFrac + zFrac >= 1.0f)
+    {
+        h1 = GetTileHeight(tile, patchSize_, xInt + 1, zInt + 1);
+        h2 = GetTileHeight(tile, patchSize_, xInt, zInt + 1);
+        h3 = GetTileHeight(tile, patchSize_, xInt + 1, zInt);
+        xFrac = 1.0f - xFrac;
+        zFrac = 1.0f - zFrac;
+    }
+    else
+    {
+        h1 = GetTileHeight(tile, patchSize_, xInt, zInt);
+        h2 = GetTileHeight(tile, patchSize_, xInt + 1, zInt);
+        h3 = GetTileHeight(tile, patchSize_, xInt, zInt + 1);
+    }
+
+    return (h1 * (1.0f - xFrac - zFrac) + h2 * xFrac + h3 * zFrac) * spacing_.y_;
+}
+
+StreamingTerrainTile* StreamingTerrain::GetTile(unsigned level, int x, int z, unsigned frameNumber)
+{
+    if (level >= numLevels_)
+        return nullptr;
+
+    const int shift = (int)numLevels_ - 1 - (int)level;
+    if (x < 0 || z < 0 || x >= (numBlocks_.x_ << shift) || z >= (numBlocks_.y_ << shift))
+        return nullptr;
+
+    const unsigned long long key = GetTileKey(level, x, z);
+
+    MutexLock lock(tileMutex_);
+
+    HashMap<unsigned long long, SharedPtr<StreamingTerrainTile> >::Iterator i = tiles_.Find(key);
+    if (i != tiles_.End())
+    {
+        StreamingTerrainTile* tile = i->second_;
+        tile->lastUsed_ = frameNumber;
+        return tile->state_ == TILE_READY ? tile : nullptr;
+    }
+
+    // Throttle the reads so that a fast moving camera does not queue tiles it has already left behind
+    if (loadingTiles_.Size() >= MAX_LOADING_TILES)
+        return nullptr;
+
+    SharedPtr<StreamingTerrainTile> tile(new StreamingTerrainTile());
+    tile->owner_ = this;
+    tile->level_ = level;
+    tile->x_ = x;
+    tile->z_ = z;
+    tile->lastUsed_ = frameNumber;
+    tiles_[key] = tile;
+    loadingTiles_.Push(tile);
+
+    if (reader_)
+    {
+        SharedPtr<AsyncReadRequest> request(new AsyncReadRequest());
+        request->fileName_ = tileFileName_;
+        request->offset_ = GetTileOffset(level, x, z);
+        request->size_ = GetTileDataSize();
+        request->callback_ = HandleTileRead;
+        request->aux_ = tile.Get();
+        tile->request_ = request;
+
+        reader_->Read(request);
+        readsQueued_ = true;
+    }
+    else if (!LoadTile(tile))
+        tile->state_ = TILE_FAILED;
+
+    return nullptr;
+}
+
+float StreamingTerrain::GetLodRange(unsigned level) const
+{
+    const float minRange = MIN_LOD_RANGE_SCALE * (float)patchSize_ * Max(spacing_.x_, spacing_.z_);
+    return Max(lodDistance_, minRange) * (float)(1u << level);
+}
+
+void StreamingTerrain::UpdateTiles(const FrameInfo& frame)
+{
+    if (frame.frameNumber_ == lastUpdateFrame_)
+        return;
+
+    lastUpdateFrame_ = frame.frameNumber_;
+
+    DRY_PROFILE(UpdateTerrainTiles);
+
+    MutexLock lock(tileMutex_);
+
+    if (readsQueued_ && reader_)
+    {
+        reader_->Submit();
+        readsQueued_ = false;
+    }
+
+    // GPU objects can only be created on the main thread
+    for (Vector<SharedPtr<StreamingTerrainTile> >::Iterator i = loadingTiles_.Begin(); i != loadingTiles_.End();)
+    {
+        StreamingTerrainTile* tile = *i;
+        const unsigned state = tile->state_;
+        if (state == TILE_LOADING)
+        {
+            ++i;
+            continue;
+        }
+
+        if (state == TILE_DECODED)
+            UploadTile(tile);
+        else
+            DRY_LOGERRORF("Failed to read level %u terrain tile %d,%d from %s", tile->level_, tile->x_, tile->z_, tileFile_.CString());
+
+        tile->request_.Reset();
+        i = loadingTiles_.Erase(i);
+    }
+
+    RestoreTiles();
+
+    // Release the least recently used tiles above the limit. Tiles used on this or the previous frame may still be referenced by
+    // the blocks' batches, and the coarsest level always stays resident
+    if (tiles_.Size() > maxTiles_)
+    {
+        PODVector<StreamingTerrainTile*> unusedTiles;
+        for (HashMap<unsigned long long, SharedPtr<StreamingTerrainTile> >::ConstIterator i = tiles_.Begin(); i != tiles_.End(); ++i)
+        {
+            StreamingTerrainTile* tile = i->second_;
+            const unsigned state = tile->state_;
+            if (tile->level_ + 1 < numLevels_ && (state == TILE_READY || state == TILE_FAILED) && tile->lastUsed_ + 1 < frame.frameNumber_)
+                unusedTiles.Push(tile);
+        }
+
+        Sort(unusedTiles.Begin(), unusedTiles.End(), CompareTileUsage);
+
+        for (unsigned i{ 0 }; i < unusedTiles.Size() && tiles_.Size() > maxTiles_; ++i)
+        {
+            StreamingTerrainTile* tile = unusedTiles[i];
+            tiles_.Erase(GetTileKey(tile->level_, tile->x_, tile->z_));
+        }
+    }
+
+    // Release the materials of views that were not updated on this or the previous frame. Views later in this frame were
+    // updated on the previous one
+    for (HashMap<Camera*, StreamingTerrainViewMaterial>::Iterator i = viewMaterials_.Begin(); i != viewMaterials_.End();)
+    {
+        if (i->second_.lastUsed_ + 1 < frame.frameNumber_)
+            i = viewMaterials_.Erase(i);
+        else
+            ++i;
+    }
+}
+
+void StreamingTerrain::SetTileFileAttr(const String& value)
+{
+    OpenTileFile(value);
+    recreateTerrain_ = true;
+}
+
+void StreamingTerrain::SetMaterialAttr(const ResourceRef& value)
+{
+    auto* cache = GetSubsystem<ResourceCache>();
+    SetMaterial(cache->GetResource<Material>(value.name_));
+}
+
+ResourceRef StreamingTerrain::GetMaterialAttr() const
+{
+    return GetResourceRef(material_, Material::GetTypeStatic());
+}
+
+void StreamingTerrain::OnNodeSet(Node* node)
+{
+    if (node && numLevels_)
+        CreateGeometry();
+}
+
+bool StreamingTerrain::OpenTileFile(const String& name)
+{
+    ClearTiles();
+
+    tileFile_ = name.Trimmed();
+    tileFileName_.Clear();
+    levelOffsets_.Clear();
+    numVertices_ = IntVector2::ZERO;
+    numBlocks_ = IntVector2::ZERO;
+    patchSize_ = 0;
+    numLevels_ = 0;
+
+    if (tileFile_.IsEmpty())
+        return true;
+
+    auto* cache = GetSubsystem<ResourceCache>();
+    const String fileName = cache ? cache->GetResourceFileName(tileFile_) : tileFile_;
+    if (fileName.IsEmpty())
+    {
+        DRY_LOGERROR("Could not find terrain tile file " + tileFile_);
+        return false;
+    }
+
+    File file(context_, fileName);
+    if (!file.IsOpen() || file.ReadFileID() != TILE_FILE_ID)
+    {
+        DRY_LOGERROR(tileFile_ + " is not a valid terrain tile file");
+        return false;
+    }
+
+    const IntVector2 numVertices((int)file.ReadUInt(), (int)file.ReadUInt());
+    const int patchSize = (int)file.ReadUInt();
+    const unsigned numLevels = file.ReadUInt();
+    if (numVertices.x_ < 2 || numVertices.y_ < 2 || patchSize < MIN_PATCH_SIZE || patchSize > MAX_PATCH_SIZE ||
+        !IsPowerOfTwo((unsigned)patchSize) || !numLevels || numLevels > MAX_STREAMING_TERRAIN_LEVELS)
+    {
+        DRY_LOGERROR("Terrain tile file " + tileFile_ + " has an invalid header");
+        return false;
+    }
+
+    const int blockQuads = patchSize << (numLevels - 1);
+    numVertices_ = numVertices;
+    numBlocks_ = IntVector2((numVertices.x_ - 1 + blockQuads - 1) / blockQuads, (numVertices.y_ - 1 + blockQuads - 1) / blockQuads);
+    patchSize_ = patchSize;
+    numLevels_ = numLevels;
+    tileFileName_ = fileName;
+
+    unsigned numTiles = 0;
+    for (unsigned i{ 0 }; i < numLevels_; ++i)
+    {
+        levelOffsets_.Push(numTiles);
+        numTiles += (unsigned)((numBlocks_.x_ << (numLevels_ - 1 - i)) * (numBlocks_.y_ << (numLevels_ - 1 - i)));
+    }
+
+    if (file.GetSize() < TILE_FILE_HEADER_SIZE + numTiles * GetTileDataSize())
+    {
+        DRY_LOGERROR("Terrain tile file " + tileFile_ + " is truncated");
+        numLevels_ = 0;
+        return false;
+    }
+
+    return true;
+}
+
+void StreamingTerrain::CreateGeometry()
+{
+    recreateTerrain_ = false;
+
+    if (!node_)
+        return;
+
+    DRY_PROFILE(CreateStreamingTerrainGeometry);
+
+    ClearTiles();
+
+    // Remove the old block nodes
+    PODVector<Node*> oldBlockNodes;
+    node_->GetChildrenWithComponent<StreamingTerrainBlock>(oldBlockNodes);
+    for (PODVector<Node*>::Iterator i = oldBlockNodes.Begin(); i != oldBlockNodes.End(); ++i)
+        node_->RemoveChild(*i);
+
+    blocks_.Clear();
+
+    if (!numLevels_)
+        return;
+
+    const float blockQuads = (float)(patchSize_ << (numLevels_ - 1));
+    origin_ = Vector2(-0.5f * (float)numBlocks_.x_ * blockQuads * spacing_.x_, -0.5f * (float)numBlocks_.y_ * blockQuads * spacing_.z_);
+
+    CreateIndexData();
+
+    const unsigned topLevel = numLevels_ - 1;
+    const bool enabled = IsEnabledEffective();
+    blocks_.Reserve((unsigned)(numBlocks_.x_ * numBlocks_.y_));
+
+    // The coarsest level is loaded immediately and stays resident, so that there is always something to draw
+    for (int z{ 0 }; z < numBlocks_.y_; ++z)
+    {
+        for (int x{ 0 }; x < numBlocks_.x_; ++x)
+        {
+            SharedPtr<StreamingTerrainTile> tile(new StreamingTerrainTile());
+            tile->owner_ = this;
+            tile->level_ = topLevel;
+            tile->x_ = x;
+            tile->z_ = z;
+
+            if (!LoadTile(tile))
+            {
+                DRY_LOGERROR("Failed to read terrain tile file " + tileFile_);
+                ClearTiles();
+                blocks_.Clear();
+                return;
+            }
+
+            UploadTile(tile);
+
+            {
+                MutexLock lock(tileMutex_);
+                tiles_[GetTileKey(topLevel, x, z)] = tile;
+            }
+
+            // Create the block scene node as local and temporary so that it is not unnecessarily serialized to either file or
+            // replicated over the network
+            Node* blockNode = node_->CreateTemporaryChild("Block_" + String(x) + "_" + String(z), LOCAL);
+            auto* block = blockNode->CreateComponent<StreamingTerrainBlock>();
+            block->SetOwner(this);
+            block->SetCoordinates(IntVector2(x, z));
+            block->SetBoundingBox(tile->boundingBox_);
+            block->SetEnabled(enabled);
+
+            blocks_.Push(WeakPtr<StreamingTerrainBlock>(block));
+        }
+    }
+
+    UpdateBlocks();
+}
+
+void StreamingTerrain::CreateIndexData()
+{
+    DRY_PROFILE(CreateIndexData);
+
+    PODVector<unsigned short> indices;
+    const int row = patchSize_ + 1;
+    const int half = patchSize_ / 2;
+
+    // Order the triangles by quadrant, so that a node can draw either all of them or only the quadrants not covered by its
+    // children. The diagonals all run the same way, so that morphing the odd vertices onto their even neighbors leaves only
+    // the coarser level's triangles
+    for (int q{ 0 }; q < 4; ++q)
+    {
+        const int xStart = (q & 1) * half;
+        const int zStart = (q >> 1) * half;
+
+        for (int z{ zStart }; z < zStart + half; ++z)
+        {
+            for (int x{ xStart }; x < xStart + half; ++x)
+            {
+                indices.Push((unsigned short)((z + 1) * row + x));
+                indices.Push((unsigned short)(z * row + x + 1));
+                indices.Push((unsigned short)(z * row + x));
+                indices.Push((unsigned short)((z + 1) * row + x));
+                indices.Push((unsigned short)((z + 1) * row + x + 1));
+                indices.Push((unsigned short)(z * row + x + 1));
+            }
+        }
+    }
+
+    indexBuffer_->SetShadowed(true);
+    indexBuffer_->SetSize(indices.Size(), false);
+    indexBuffer_->SetData(&indices[0]);
+}
+
+void StreamingTerrain::ClearTiles()
+{
+    MutexLock lock(tileMutex_);
+
+    // The read callbacks write into the tiles, so wait for them before letting go
+    if (reader_ && !loadingTiles_.IsEmpty())
+    {
+        reader_->Submit();
+        for (unsigned i{ 0 }; i < loadingTiles_.Size(); ++i)
+        {
+            if (loadingTiles_[i]->request_)
+                reader_->Wait(loadingTiles_[i]->request_);
+        }
+    }
+
+    loadingTiles_.Clear();
+    tiles_.Clear();
+    readsQueued_ = false;
+}
+
+bool StreamingTerrain::LoadTile(StreamingTerrainTile* tile)
+{
+    const unsigned offset = GetTileOffset(tile->level_, tile->x_, tile->z_);
+    const unsigned size = GetTileDataSize();
+    PODVector<unsigned char> data(size);
+
+    File file(context_, tileFileName_);
+    if (!file.IsOpen() || file.Seek(offset) != offset || file.Read(&data[0], size) != size)
+        return false;
+
+    DecodeTile(tile, &data[0]);
+    tile->state_ = TILE_DECODED;
+    return true;
+}
+
+void StreamingTerrain::UploadTile(StreamingTerrainTile* tile)
+{
+    PODVector<VertexElement> elements;
+    elements.Push(VertexElement(TYPE_VECTOR3, SEM_POSITION));
+    elements.Push(VertexElement(TYPE_VECTOR3, SEM_NORMAL));
+    elements.Push(VertexElement(TYPE_VECTOR2, SEM_TEXCOORD));
+    elements.Push(VertexElement(TYPE_VECTOR4, SEM_TANGENT));
+    elements.Push(VertexElement(TYPE_VECTOR4, SEM_TEXCOORD, 3));
+
+    const unsigned numVertices = (unsigned)((patchSize_ + 1) * (patchSize_ + 1));
+    const unsigned quadrantIndices = (unsigned)(patchSize_ * patchSize_ / 4 * 6);
+
+    tile->vertexBuffer_ = new VertexBuffer(context_);
+    tile->vertexBuffer_->SetSize(numVertices, elements);
+    tile->vertexBuffer_->SetData(&tile->vertexData_[0]);
+
+    for (unsigned i{ 0 }; i < 5; ++i)
+    {
+        SharedPtr<Geometry> geometry(new Geometry(context_));
+        geometry->SetVertexBuffer(0, tile->vertexBuffer_);
+        geometry->SetIndexBuffer(indexBuffer_);
+        if (i == 0)
+            geometry->SetDrawRange(TRIANGLE_LIST, 0, quadrantIndices * 4, false);
+        else
+            geometry->SetDrawRange(TRIANGLE_LIST, (i - 1) * quadrantIndices, quadrantIndices, false);
+
+        tile->geometries_[i] = geometry;
+    }
+
+    tile->vertexData_.Clear();
+    tile->vertexData_.Compact();
+    tile->state_ = TILE_READY;
+}
+
+void StreamingTerrain::RestoreTiles()
+{
+    // The vertex buffers are not shadowed, as the tiles keep their heights to rebuild the vertices from
+    for (HashMap<unsigned long long, SharedPtr<StreamingTerrainTile> >::ConstIterator i = tiles_.Begin(); i != tiles_.End(); ++i)
+    {
+        StreamingTerrainTile* tile = i->second_;
+        if (tile->state_ != TILE_READY || !tile->vertexBuffer_ || !tile->vertexBuffer_->IsDataLost())
+            continue;
+
+        CreateVertexData(tile);
+        tile->vertexBuffer_->SetData(&tile->vertexData_[0]);
+        tile->vertexBuffer_->ClearDataLost();
+        tile->vertexData_.Clear();
+        tile->vertexData_.Compact();
+    }
+}
+
+void StreamingTerrain::CreateMorphMaterial()
+{
+    morphMaterial_.Reset();
+
+    {
+        MutexLock lock(tileMutex_);
+        viewMaterials_.Clear();
+    }
+
+    if (material_)
+    {
+        morphMaterial_ = material_->Clone();
+        materialSignature_ = GetMaterialSignature(material_);
+
+        const String& defines = morphMaterial_->GetVertexShaderDefines();
+        if (!defines.Split(' ').Contains("CDLOD"))
+            morphMaterial_->SetVertexShaderDefines(defines.IsEmpty() ? String("CDLOD") : defines + " CDLOD");
+    }
+
+    UpdateBlocks();
+}
+
+void StreamingTerrain::UpdateBlocks()
+{
+    // Blocks fall back to the shared morph material in views that have no material of their own yet, so give it a valid
+    // morph range
+    if (morphMaterial_)
+        morphMaterial_->SetShaderParameter("TerrainMorph", Vector4(Vector3::ZERO, GetLodRange(0)));
+
+    for (unsigned i{ 0 }; i < blocks_.Size(); ++i)
+    {
+        StreamingTerrainBlock* block = blocks_[i];
+        if (!block)
+            continue;
+
+        block->SetMaterial(morphMaterial_);
+        block->SetDrawDistance(drawDistance_);
+        block->SetShadowDistance(shadowDistance_);
+        block->SetViewMask(viewMask_);
+        block->SetLightMask(lightMask_);
+        block->SetShadowMask(shadowMask_);
+        block->SetZoneMask(zoneMask_);
+        block->SetMaxLights(maxLights_);
+        block->SetCastShadows(castShadows_);
+    }
+}
+
+unsigned StreamingTerrain::GetTileOffset(unsigned level, int x, int z) const
+{
+    const int numTilesX = numBlocks_.x_ << (numLevels_ - 1 - level);
+    return TILE_FILE_HEADER_SIZE + (levelOffsets_[level] + (unsigned)(z * numTilesX + x)) * GetTileDataSize();
+}
+
+unsigned StreamingTerrain::GetTileDataSize() const
+{
+    // The samples are followed by the tile's full resolution height range
+    return (unsigned)((patchSize_ + 3) * (patchSize_ + 3) + 2) * sizeof(unsigned short);
+}
+
+void StreamingTerrain::DecodeTile(StreamingTerrainTile* tile, const unsigned char* data) const
+{
+    const int row = patchSize_ + 3;
+    const auto* source = reinterpret_cast<const unsigned short*>(data);
+
+    tile->heights_.Resize((unsigned)(row * row));
+    for (unsigned i{ 0 }; i < tile->heights_.Size(); ++i)
+        tile->heights_[i] = (float)source[i] / 256.0f;
+
+    // Bound the full resolution heights of the footprint, so that the box also contains the finer levels below the tile
+    const int step = 1 << tile->level_;
+    const int startX = tile->x_ * patchSize_ * step;
+    const int startZ = tile->z_ * patchSize_ * step;
+    const float minHeight = (float)source[row * row] / 256.0f * spacing_.y_;
+    const float maxHeight = (float)source[row * row + 1] / 256.0f * spacing_.y_;
+    BoundingBox box;
+    box.Merge(Vector3(origin_.x_ + (float)startX * spacing_.x_, minHeight, origin_.y_ + (float)startZ * spacing_.z_));
+    box.Merge(Vector3(origin_.x_ + (float)(startX + patchSize_ * step) * spacing_.x_, maxHeight,
+        origin_.y_ + (float)(startZ + patchSize_ * step) * spacing_.z_));
+    tile->boundingBox_ = box;
+
+    CreateVertexData(tile);
+}
+
+void StreamingTerrain::CreateVertexData(StreamingTerrainTile* tile) const
+{
+    const int step = 1 << tile->level_;
+    const int startX = tile->x_ * patchSize_ * step;
+    const int startZ = tile->z_ * patchSize_ * step;
+    const float stepX = (float)step * spacing_.x_;
+    const float stepZ = (float)step * spacing_.z_;
+    // The coarsest level has nothing to morph towards
+    const bool morph = tile->level_ + 1 < numLevels_;
+
+    tile->vertexData_.Resize((unsigned)((patchSize_ + 1) * (patchSize_ + 1)) * VERTEX_FLOATS);
+    float* vertexData = &tile->vertexData_[0];
+
+    for (int z{ 0 }; z <= patchSize_; ++z)
+    {
+        for (int x{ 0 }; x <= patchSize_; ++x)
+        {
+            const float height = GetTileHeight(tile, patchSize_, x, z);
+
+            // Position
+            Vector3 position(origin_.x_ + (float)(startX + x * step) * spacing_.x_, height * spacing_.y_,
+                origin_.y_ + (float)(startZ + z * step) * spacing_.z_);
+            *vertexData++ = position.x_;
+            *vertexData++ = position.y_;
+            *vertexData++ = position.z_;
+
+            // Normal from the neighbors, which the apron provides also at the tile edges
+            const float dX = (GetTileHeight(tile, patchSize_, x + 1, z) - GetTileHeight(tile, patchSize_, x - 1, z)) * spacing_.y_ /
+                (2.0f * stepX);
+            const float dZ = (GetTileHeight(tile, patchSize_, x, z + 1) - GetTileHeight(tile, patchSize_, x, z - 1)) * spacing_.y_ /
+                (2.0f * stepZ);
+            Vector3 normal = Vector3(-dX, 1.0f, -dZ).Normalized();
+            *vertexData++ = normal.x_;
+            *vertexData++ = normal.y_;
+            *vertexData++ = normal.z_;
+
+            // Texture coordinate
+            *vertexData++ = (float)(startX + x * step) / (float)(numVertices_.x_ - 1);
+            *vertexData++ = 1.0f - (float)(startZ + z * step) / (float)(numVertices_.y_ - 1);
+
+            // Tangent
+            Vector3 xyz = (Vector3::RIGHT - normal * normal.DotProduct(Vector3::RIGHT)).Normalized();
+            *vertexData++ = xyz.x_;
+            *vertexData++ = xyz.y_;
+            *vertexData++ = xyz.z_;
+            *vertexData++ = 1.0f;
+
+            // Morph offset onto the even vertex that remains in the parent, and the level's range scale
+            const int morphX = morph ? (x & ~1) : x;
+            const int morphZ = morph && (z & 1) ? z + 1 : z;
+            *vertexData++ = (float)(morphX - x) * stepX;
+            *vertexData++ = (GetTileHeight(tile, patchSize_, morphX, morphZ) - height) * spacing_.y_;
+            *vertexData++ = (float)(morphZ - z) * stepZ;
+            *vertexData++ = (float)step;
+        }
+    }
+}
+
+void StreamingTerrain::HandleBeginViewUpdate(StringHash eventType, VariantMap& eventData)
+{
+    using namespace BeginViewUpdate;
+
+    // Each view morphs against its own camera, also in its shadow passes, so that the vertices match the view's selection
+    auto* scene = static_cast<Scene*>(eventData[P_SCENE].GetPtr());
+    auto* camera = static_cast<Camera*>(eventData[P_CAMERA].GetPtr());
+    if (!morphMaterial_ || !blocks_.Size() || !node_ || scene != GetScene() || !camera || !camera->GetNode())
+        return;
+
+    // The morph materials are clones, so pick up runtime changes of the source material. Only on the first view of the
+    // frame, before any view has queued batches with the current clones
+    const unsigned frameNumber = GetSubsystem<Time>()->GetFrameNumber();
+    if (frameNumber != materialCheckFrame_)
+    {
+        materialCheckFrame_ = frameNumber;
+
+        if (GetMaterialSignature(material_) != materialSignature_)
+        {
+            CreateMorphMaterial();
+            if (!morphMaterial_)
+                return;
+        }
+    }
+
+    const Vector3 viewPosition = node_->GetWorldTransform().Inverse() * camera->GetNode()->GetWorldPosition();
+
+    MutexLock lock(tileMutex_);
+
+    StreamingTerrainViewMaterial& view = viewMaterials_[camera];
+    if (!view.material_)
+        view.material_ = morphMaterial_->Clone();
+
+    view.material_->SetShaderParameter("TerrainMorph", Vector4(viewPosition, GetLodRange(0)));
+    view.lastUsed_ = frameNumber;
+}
+
+void StreamingTerrain::HandleMaterialReloadFinished(StringHash /*eventType*/, VariantMap& /*eventData*/)
+{
+    CreateMorphMaterial();
+}
+
+void StreamingTerrain::HandleTileRead(AsyncReadRequest* request)
+{
+    auto* tile = static_cast<StreamingTerrainTile*>(request->aux_);
+
+    if (request->success_ && request->data_.Size() == tile->owner_->GetTileDataSize())
+    {
+        tile->owner_->DecodeTile(tile, &request->data_[0]);
+        tile->state_ = TILE_DECODED;
+    }
+    else
+        tile->state_ = TILE_FAILED;
+}
+
+}
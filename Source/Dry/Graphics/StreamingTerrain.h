@@ -0,0 +1,337 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+// Copyright (c) 2020-2023 LucKey Productions.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Container/HashMap.h"
+#include "../Core/Mutex.h"
+#include "../Math/BoundingBox.h"
+#include "../Scene/Component.h"
+
+#include <atomic>
+
+namespace Dry
+{
+
+class AsyncFileReader;
+class Camera;
+class Geometry;
+class IndexBuffer;
+class Material;
+class StreamingTerrain;
+class StreamingTerrainBlock;
+class VertexBuffer;
+struct AsyncReadRequest;
+struct FrameInfo;
+
+/// Maximum number of levels in a streamed terrain tile file.
+static const unsigned MAX_STREAMING_TERRAIN_LEVELS = 16;
+/// Default number of resident streamed terrain tiles.
+static const unsigned DEFAULT_STREAMING_TERRAIN_TILES = 512;
+
+/// Streamed terrain tile state.
+enum StreamingTerrainTileState
+{
+    TILE_LOADING = 0,
+    TILE_DECODED,
+    TILE_READY,
+    TILE_FAILED
+};
+
+/// Resident tile of a streamed terrain. Covers one quadtree node: a patch of quads sampled at the node's level.
+struct StreamingTerrainTile : public RefCounted
+{
+    /// Owner terrain.
+    StreamingTerrain* owner_{};
+    /// Quadtree level. 0 is the finest.
+    unsigned level_{};
+    /// Tile X coordinate within the level.
+    int x_{};
+    /// Tile Z coordinate within the level.
+    int z_{};
+    /// Heights in heightmap units, including a one sample apron on each side.
+    PODVector<float> heights_;
+    /// Vertex data waiting for upload.
+    PODVector<float> vertexData_;
+    /// Local-space bounding box of the tile's footprint, including the full resolution heights that the finer levels show.
+    BoundingBox boundingBox_;
+    /// Vertex buffer.
+    SharedPtr<VertexBuffer> vertexBuffer_;
+    /// Geometries for the whole tile and its four quadrants.
+    SharedPtr<Geometry> geometries_[5];
+    /// Read request in flight.
+    SharedPtr<AsyncReadRequest> request_;
+    /// Load state.
+    std::atomic<unsigned> state_{ TILE_LOADING };
+    /// Frame number the tile was last selected or requested on.
+    std::atomic<unsigned> lastUsed_{};
+};
+
+/// Morph material of one view of a streamed terrain.
+struct StreamingTerrainViewMaterial
+{
+    /// Material with the view's morph center.
+    SharedPtr<Material> material_;
+    /// Frame number the view was last updated on.
+    unsigned lastUsed_{};
+};
+
+/// %Terrain component that streams its heightmap from a tile file on demand and renders it as a continuous distance-dependent LOD quadtree. Each node morphs smoothly towards its parent in the vertex shader, so materials need techniques whose vertex shaders use GetWorldPos(); the CDLOD define is added automatically.
+class DRY_API StreamingTerrain : public Component
+{
+    DRY_OBJECT(StreamingTerrain, Component);
+
+public:
+    /// Construct.
+    explicit StreamingTerrain(Context* context);
+    /// Destruct.
+    ~StreamingTerrain() override;
+    /// Register object factory.
+    static void RegisterObject(Context* context);
+
+    /// Apply attribute changes that can not be applied immediately. Called after scene load or a network update.
+    void ApplyAttributes() override;
+    /// Handle enabled/disabled state change.
+    void OnSetEnabled() override;
+
+    /// Convert a raw little-endian 16-bit heightmap into a tile file. Heights are the raw value / 256, the same scale as a 16-bit Terrain heightmap. The first row is north, like in a heightmap image. Return true if successful.
+    static bool BuildTileFile(Context* context, const String& rawFileName, const IntVector2& size, const String& tileFileName, int patchSize = 32);
+
+    /// Set tile file by resource name. The file is read directly from a resource directory, package files are not supported. Return true if successful.
+    bool SetTileFile(const String& name);
+    /// Set material.
+    void SetMaterial(Material* material);
+    /// Set vertex (XZ) and height (Y) spacing.
+    void SetSpacing(const Vector3& spacing);
+    /// Set range of the finest LOD level. Each coarser level doubles it. Clamped so that finer nodes are always surrounded by at most one level coarser ones.
+    void SetLodDistance(float distance);
+    /// Set maximum number of resident tiles. Least recently used tiles above the limit are released.
+    void SetMaxTiles(unsigned num);
+    /// Set draw distance for blocks.
+    void SetDrawDistance(float distance);
+    /// Set shadow draw distance for blocks.
+    void SetShadowDistance(float distance);
+    /// Set view mask for blocks. Is and'ed with camera's view mask to see if the object should be rendered.
+    void SetViewMask(unsigned mask);
+    /// Set light mask for blocks. Is and'ed with light's and zone's light mask to see if the object should be lit.
+    void SetLightMask(unsigned mask);
+    /// Set shadow mask for blocks. Is and'ed with light's light mask and zone's shadow mask to see if the object should be rendered to a shadow map.
+    void SetShadowMask(unsigned mask);
+    /// Set zone mask for blocks. Is and'ed with zone's zone mask to see if the object should belong to the zone.
+    void SetZoneMask(unsigned mask);
+    /// Set maximum number of per-pixel lights for blocks. Default 0 is unlimited.
+    void SetMaxLights(unsigned num);
+    /// Set shadowcaster flag for blocks. Shadowcasting blocks also select nodes outside the view frustum.
+    void SetCastShadows(bool enable);
+
+    /// Return tile file resource name.
+    const String& GetTileFile() const { return tileFile_; }
+    /// Return material.
+    Material* GetMaterial() const;
+    /// Return material with the morphing define, which the per-view morph materials are cloned from.
+    Material* GetMorphMaterial() const;
+    /// Return the morph material of a view's camera, whose morph center is the camera position, or null if the view has not been updated. Can be called from worker threads.
+    Material* GetViewMaterial(Camera* camera) const;
+
+    /// Return vertex and height spacing.
+    const Vector3& GetSpacing() const { return spacing_; }
+
+    /// Return range of the finest LOD level.
+    float GetLodDistance() const { return lodDistance_; }
+
+    /// Return maximum number of resident tiles.
+    unsigned GetMaxTiles() const { return maxTiles_; }
+
+    /// Return tile quads per side.
+    int GetPatchSize() const { return patchSize_; }
+
+    /// Return number of quadtree levels.
+    unsigned GetNumLevels() const { return numLevels_; }
+
+    /// Return source heightmap size in vertices.
+    const IntVector2& GetNumVertices() const { return numVertices_; }
+
+    /// Return terrain size in blocks, one per coarsest level tile.
+    const IntVector2& GetNumBlocks() const { return numBlocks_; }
+
+    /// Return number of resident tiles.
+    unsigned GetNumTiles() const;
+    /// Return number of tiles being loaded.
+    unsigned GetNumLoadingTiles() const;
+    /// Return block by block coordinates.
+    StreamingTerrainBlock* GetBlock(int x, int z) const;
+    /// Return height at world coordinates, using the finest resident tile.
+    float GetHeight(const Vector3& worldPosition) const;
+    /// Return height in local space, using the finest resident tile.
+    float GetLocalHeight(float x, float z) const;
+
+    /// Return draw distance.
+    float GetDrawDistance() const { return drawDistance_; }
+
+    /// Return shadow draw distance.
+    float GetShadowDistance() const { return shadowDistance_; }
+
+    /// Return view mask.
+    unsigned GetViewMask() const { return viewMask_; }
+
+    /// Return light mask.
+    unsigned GetLightMask() const { return lightMask_; }
+
+    /// Return shadow mask.
+    unsigned GetShadowMask() const { return shadowMask_; }
+
+    /// Return zone mask.
+    unsigned GetZoneMask() const { return zoneMask_; }
+
+    /// Return maximum number of per-pixel lights.
+    unsigned GetMaxLights() const { return maxLights_; }
+
+    /// Return shadowcaster flag.
+    bool GetCastShadows() const { return castShadows_; }
+
+    /// Return a tile if it is ready for rendering, and queue its load if not resident. Marks the tile used on the frame. Can be called from worker threads.
+    StreamingTerrainTile* GetTile(unsigned level, int x, int z, unsigned frameNumber);
+    /// Return the range within which a level's nodes are subdivided into the next finer level.
+    float GetLodRange(unsigned level) const;
+    /// Submit queued tile reads, upload loaded tiles, restore lost vertex data and release unused tiles above the limit. Called once per frame from the blocks on the main thread.
+    void UpdateTiles(const FrameInfo& frame);
+
+    /// Set tile file attribute.
+    void SetTileFileAttr(const String& value);
+    /// Set material attribute.
+    void SetMaterialAttr(const ResourceRef& value);
+    /// Return material attribute.
+    ResourceRef GetMaterialAttr() const;
+
+protected:
+    /// Handle node being assigned.
+    void OnNodeSet(Node* node) override;
+
+private:
+    /// Read the tile file header. Return true if successful.
+    bool OpenTileFile(const String& name);
+    /// Create the blocks and load the coarsest level.
+    void CreateGeometry();
+    /// Create index data shared by all tiles.
+    void CreateIndexData();
+    /// Release all tiles, waiting for the reads in flight.
+    void ClearTiles();
+    /// Read a tile synchronously. Return true if successful.
+    bool LoadTile(StreamingTerrainTile* tile);
+    /// Create the vertex buffer and geometries of a decoded tile.
+    void UploadTile(StreamingTerrainTile* tile);
+    /// Recreate vertex data of resident tiles whose vertex buffers lost their data.
+    void RestoreTiles();
+    /// Copy the drawable parameters to the blocks.
+    void UpdateBlocks();
+    /// Return byte offset of a tile in the tile file.
+    unsigned GetTileOffset(unsigned level, int x, int z) const;
+    /// Return size of a tile in the tile file.
+    unsigned GetTileDataSize() const;
+    /// Decode tile data read from the file into heights and vertices.
+    void DecodeTile(StreamingTerrainTile* tile, const unsigned char* data) const;
+    /// Create the vertex data of a tile from its heights.
+    void CreateVertexData(StreamingTerrainTile* tile) const;
+    /// Recreate the material with the morphing define from the source material and drop the per-view clones.
+    void CreateMorphMaterial();
+    /// Handle a view update starting. Sets the morph center of the view's material and picks up changes of the source material.
+    void HandleBeginViewUpdate(StringHash eventType, VariantMap& eventData);
+    /// Handle the source material being reloaded.
+    void HandleMaterialReloadFinished(StringHash eventType, VariantMap& eventData);
+    /// Handle an asynchronous tile read completing. Called from an I/O thread.
+    static void HandleTileRead(AsyncReadRequest* request);
+    /// Mark terrain dirty.
+    void MarkTerrainDirty() { recreateTerrain_ = true; }
+
+    /// Shared index buffer.
+    SharedPtr<IndexBuffer> indexBuffer_;
+    /// Material.
+    SharedPtr<Material> material_;
+    /// Material with the morphing define.
+    SharedPtr<Material> morphMaterial_;
+    /// Morph materials by view camera.
+    HashMap<Camera*, StreamingTerrainViewMaterial> viewMaterials_;
+    /// Blocks.
+    Vector<WeakPtr<StreamingTerrainBlock> > blocks_;
+    /// Resident tiles by level and coordinates.
+    HashMap<unsigned long long, SharedPtr<StreamingTerrainTile> > tiles_;
+    /// Tiles being loaded.
+    Vector<SharedPtr<StreamingTerrainTile> > loadingTiles_;
+    /// Mutex for the tiles.
+    mutable Mutex tileMutex_;
+    /// Asynchronous file reader. Tiles are read synchronously when it does not exist.
+    WeakPtr<AsyncFileReader> reader_;
+    /// Tile file resource name.
+    String tileFile_;
+    /// Tile file filesystem path.
+    String tileFileName_;
+    /// Index of the first tile of each level in the tile file.
+    PODVector<unsigned> levelOffsets_;
+    /// Vertex and height spacing.
+    Vector3 spacing_;
+    /// Origin of the blocks on the XZ-plane.
+    Vector2 origin_;
+    /// Source heightmap size in vertices.
+    IntVector2 numVertices_;
+    /// Terrain size in blocks.
+    IntVector2 numBlocks_;
+    /// Tile quads per side.
+    int patchSize_;
+    /// Number of quadtree levels.
+    unsigned numLevels_;
+    /// Range of the finest LOD level.
+    float lodDistance_;
+    /// Maximum number of resident tiles.
+    unsigned maxTiles_;
+    /// Frame number of the last tile update.
+    unsigned lastUpdateFrame_;
+    /// Signature of the source material state the morph material was cloned from.
+    unsigned materialSignature_;
+    /// Frame number the source material was last compared against the signature.
+    unsigned materialCheckFrame_;
+    /// Tile reads queued since the last submit flag.
+    bool readsQueued_;
+    /// Shadowcaster flag.
+    bool castShadows_;
+    /// View mask.
+    unsigned viewMask_;
+    /// Light mask.
+    unsigned lightMask_;
+    /// Shadow mask.
+    unsigned shadowMask_;
+    /// Zone mask.
+    unsigned zoneMask_;
+    /// Draw distance.
+    float drawDistance_;
+    /// Shadow distance.
+    float shadowDistance_;
+    /// Maximum lights.
+    unsigned maxLights_;
+    /// Terrain needs regeneration flag.
+    bool recreateTerrain_;
+};
+
+}
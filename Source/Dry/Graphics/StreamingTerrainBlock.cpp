@@ -0,0 +1,299 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+// Copyright (c) 2020-2023 LucKey Productions.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Core/Context.h"
+#include "../Graphics/Camera.h"
+#include "../Graphics/DebugRenderer.h"
+#include "../Graphics/Material.h"
+#include "../Graphics/OctreeQuery.h"
+#include "../Graphics/StreamingTerrain.h"
+#include "../Graphics/StreamingTerrainBlock.h"
+#include "../IO/Log.h"
+#include "../Math/Sphere.h"
+#include "../Scene/Node.h"
+
+#include "../DebugNew.h"
+
+namespace Dry
+{
+
+/// Number of bisection steps to refine a heightfield ray hit.
+static const unsigned RAY_REFINE_STEPS = 8;
+
+StreamingTerrainBlock::StreamingTerrainBlock(Context* context) :
+    Drawable(context, DRAWABLE_GEOMETRY),
+    coordinates_(IntVector2::ZERO)
+{
+}
+
+StreamingTerrainBlock::~StreamingTerrainBlock() = default;
+
+void StreamingTerrainBlock::RegisterObject(Context* context)
+{
+    context->RegisterFactory<StreamingTerrainBlock>();
+}
+
+void StreamingTerrainBlock::ProcessRayQuery(const RayOctreeQuery& query, PODVector<RayQueryResult>& results)
+{
+    RayQueryLevel level = query.level_;
+
+    switch (level)
+    {
+    case RAY_AABB:
+        Drawable::ProcessRayQuery(query, results);
+        break;
+
+    case RAY_OBB:
+    case RAY_TRIANGLE:
+        {
+            Matrix3x4 inverse(node_->GetWorldTransform().Inverse());
+            Ray localRay = query.ray_.Transformed(inverse);
+            float distance = localRay.HitDistance(boundingBox_);
+            Vector3 normal = -query.ray_.direction_;
+
+            StreamingTerrain* owner = owner_;
+            if (level == RAY_TRIANGLE && distance < query.maxDistance_ && owner)
+            {
+                // March through the heightfield of the finest resident tiles at the vertex spacing, then refine the crossing
+                const Vector3& spacing = owner->GetSpacing();
+                const float step = Min(spacing.x_, spacing.z_);
+                float hitDistance = M_INFINITY;
+                float prevDistance = distance;
+                Vector3 point = localRay.origin_ + distance * localRay.direction_;
+
+                if (point.y_ < owner->GetLocalHeight(point.x_, point.z_))
+                    hitDistance = distance;
+                else
+                {
+                    for (float t{ distance + step }; t < query.maxDistance_; t += step)
+                    {
+                        point = localRay.origin_ + t * localRay.direction_;
+                        if (boundingBox_.IsInside(point) == OUTSIDE)
+                            break;
+
+                        if (point.y_ < owner->GetLocalHeight(point.x_, point.z_))
+                        {
+                            float above = prevDistance;
+                            float below = t;
+                            for (unsigned i{ 0 }; i < RAY_REFINE_STEPS; ++i)
+                            {
+                                const float mid = 0.5f * (above + below);
+                                const Vector3 midPoint = localRay.origin_ + mid * localRay.direction_;
+                                if (midPoint.y_ < owner->GetLocalHeight(midPoint.x_, midPoint.z_))
+                                    below = mid;
+                                else
+                                    above = mid;
+                            }
+
+                            hitDistance = below;
+                            break;
+                        }
+
+                        prevDistance = t;
+                    }
+                }
+
+                distance = hitDistance;
+                if (distance < query.maxDistance_)
+                {
+                    const Vector3 hit = localRay.origin_ + distance * localRay.direction_;
+                    const Vector3 localNormal = Vector3(
+                        owner->GetLocalHeight(hit.x_ - spacing.x_, hit.z_) - owner->GetLocalHeight(hit.x_ + spacing.x_, hit.z_),
+                        2.0f * spacing.x_ * spacing.z_ / Max(spacing.x_, spacing.z_),
+                        owner->GetLocalHeight(hit.x_, hit.z_ - spacing.z_) - owner->GetLocalHeight(hit.x_, hit.z_ + spacing.z_));
+                    normal = (node_->GetWorldTransform() * Vector4(localNormal.Normalized(), 0.0f)).Normalized();
+                }
+            }
+
+            if (distance < query.maxDistance_)
+            {
+                RayQueryResult result;
+                result.position_ = query.ray_.origin_ + distance * query.ray_.direction_;
+                result.normal_ = normal;
+                result.distance_ = distance;
+                result.drawable_ = this;
+                result.node_ = node_;
+                result.subObject_ = M_MAX_UNSIGNED;
+                results.Push(result);
+            }
+        }
+        break;
+
+    case RAY_TRIANGLE_UV:
+        DRY_LOGWARNING("RAY_TRIANGLE_UV query level is not supported for StreamingTerrainBlock component");
+        break;
+    }
+}
+
+void StreamingTerrainBlock::UpdateBatches(const FrameInfo& frame)
+{
+    MutexLock lock(selectionMutex_);
+
+    batches_.Clear();
+    selectedBoxes_.Clear();
+    distance_ = frame.camera_->GetDistance(GetWorldBoundingBox().Center());
+
+    StreamingTerrain* owner = owner_;
+    if (!owner || !owner->GetNumLevels())
+        return;
+
+    StreamingTerrainTile* root = owner->GetTile(owner->GetNumLevels() - 1, coordinates_.x_, coordinates_.y_, frame.frameNumber_);
+    if (!root)
+        return;
+
+    // Select in local space, the same space the vertex shader morphs in. The view's material holds the same morph center
+    const Vector3 viewPosition = node_->GetWorldTransform().Inverse() * frame.camera_->GetNode()->GetWorldPosition();
+    Material* material = owner->GetViewMaterial(frame.camera_);
+    if (!material)
+        material = material_;
+
+    // Nodes outside the view may still cast shadows into it
+    SelectNode(root, frame, viewPosition, material, !castShadows_);
+}
+
+void StreamingTerrainBlock::UpdateGeometry(const FrameInfo& frame)
+{
+    StreamingTerrain* owner = owner_;
+    if (owner)
+        owner->UpdateTiles(frame);
+}
+
+UpdateGeometryType StreamingTerrainBlock::GetUpdateGeometryType()
+{
+    // The owner submits the tile reads and uploads the loaded tiles once per frame
+    return owner_ ? UPDATE_MAIN_THREAD : UPDATE_NONE;
+}
+
+void StreamingTerrainBlock::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
+{
+    if (!debug || !IsEnabledEffective())
+        return;
+
+    MutexLock lock(selectionMutex_);
+
+    for (unsigned i{ 0 }; i < selectedBoxes_.Size(); ++i)
+        debug->AddBoundingBox(selectedBoxes_[i], node_->GetWorldTransform(), Color::GREEN, depthTest);
+}
+
+void StreamingTerrainBlock::SetOwner(StreamingTerrain* terrain)
+{
+    owner_ = terrain;
+
+    if (!owner_)
+    {
+        MutexLock lock(selectionMutex_);
+
+        batches_.Clear();
+        selectedBoxes_.Clear();
+    }
+}
+
+void StreamingTerrainBlock::SetMaterial(Material* material)
+{
+    material_ = material;
+}
+
+void StreamingTerrainBlock::SetBoundingBox(const BoundingBox& box)
+{
+    boundingBox_ = box;
+    OnMarkedDirty(node_);
+}
+
+void StreamingTerrainBlock::SetCoordinates(const IntVector2& coordinates)
+{
+    coordinates_ = coordinates;
+}
+
+StreamingTerrain* StreamingTerrainBlock::GetOwner() const
+{
+    return owner_;
+}
+
+void StreamingTerrainBlock::OnWorldBoundingBoxUpdate()
+{
+    worldBoundingBox_ = boundingBox_.Transformed(node_->GetWorldTransform());
+}
+
+void StreamingTerrainBlock::SelectNode(StreamingTerrainTile* tile, const FrameInfo& frame, const Vector3& viewPosition,
+    Material* material, bool cull)
+{
+    if (cull && frame.camera_->GetFrustum().IsInsideFast(tile->boundingBox_.Transformed(node_->GetWorldTransform())) == OUTSIDE)
+        return;
+
+    StreamingTerrain* owner = owner_;
+
+    // Subdivide when the node reaches into the range of the next finer level and its children are resident. Children out of
+    // that range are drawn as the matching quadrant of this node instead
+    if (tile->level_ > 0)
+    {
+        const Sphere range(viewPosition, owner->GetLodRange(tile->level_ - 1));
+        if (range.IsInside(tile->boundingBox_) != OUTSIDE)
+        {
+            StreamingTerrainTile* children[4];
+            bool childrenReady = true;
+
+            for (unsigned i{ 0 }; i < 4; ++i)
+            {
+                children[i] = owner->GetTile(tile->level_ - 1, tile->x_ * 2 + (int)(i & 1u), tile->z_ * 2 + (int)(i >> 1u),
+                    frame.frameNumber_);
+                if (!children[i])
+                    childrenReady = false;
+            }
+
+            if (childrenReady)
+            {
+                for (unsigned i{ 0 }; i < 4; ++i)
+                {
+                    if (range.IsInside(children[i]->boundingBox_) != OUTSIDE)
+                        SelectNode(children[i], frame, viewPosition, material, cull);
+                    else
+                        AddNodeBatch(tile, i, frame, material);
+                }
+
+                return;
+            }
+        }
+    }
+
+    AddNodeBatch(tile, M_MAX_UNSIGNED, frame, material);
+}
+
+void StreamingTerrainBlock::AddNodeBatch(StreamingTerrainTile* tile, unsigned quadrant, const FrameInfo& frame, Material* material)
+{
+    const Matrix3x4& worldTransform = node_->GetWorldTransform();
+
+    SourceBatch batch;
+    batch.distance_ = frame.camera_->GetDistance(worldTransform * tile->boundingBox_.Center());
+    batch.geometry_ = tile->geometries_[quadrant == M_MAX_UNSIGNED ? 0 : quadrant + 1];
+    batch.geometryType_ = GEOM_STATIC_NOINSTANCING;
+    batch.material_ = material;
+    batch.worldTransform_ = &worldTransform;
+    batches_.Push(batch);
+
+    selectedBoxes_.Push(tile->boundingBox_);
+}
+
+}
@@ -0,0 +1,102 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+// Copyright (c) 2020-2023 LucKey Productions.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Core/Mutex.h"
+#include "../Graphics/Drawable.h"
+
+namespace Dry
+{
+
+class StreamingTerrain;
+struct StreamingTerrainTile;
+
+/// Individually rendered part of a streamed terrain, covering one tile of the coarsest level. Selects the quadtree nodes to draw each frame.
+class DRY_API StreamingTerrainBlock : public Drawable
+{
+    DRY_OBJECT(StreamingTerrainBlock, Drawable);
+
+public:
+    /// Construct.
+    explicit StreamingTerrainBlock(Context* context);
+    /// Destruct.
+    ~StreamingTerrainBlock() override;
+    /// Register object factory.
+    static void RegisterObject(Context* context);
+
+    /// Process octree raycast. May be called from a worker thread.
+    void ProcessRayQuery(const RayOctreeQuery& query, PODVector<RayQueryResult>& results) override;
+    /// Calculate distance and prepare batches for rendering. May be called from worker thread(s), possibly re-entrantly.
+    void UpdateBatches(const FrameInfo& frame) override;
+    /// Prepare geometry for rendering.
+    void UpdateGeometry(const FrameInfo& frame) override;
+    /// Return whether a geometry update is necessary, and if it can happen in a worker thread.
+    UpdateGeometryType GetUpdateGeometryType() override;
+    /// Visualize the component as debug geometry.
+    void DrawDebugGeometry(DebugRenderer* debug, bool depthTest) override;
+
+    /// Set owner terrain.
+    void SetOwner(StreamingTerrain* terrain);
+    /// Set material.
+    void SetMaterial(Material* material);
+    /// Set local-space bounding box.
+    void SetBoundingBox(const BoundingBox& box);
+    /// Set block coordinates.
+    void SetCoordinates(const IntVector2& coordinates);
+
+    /// Return owner terrain.
+    StreamingTerrain* GetOwner() const;
+
+    /// Return block coordinates.
+    const IntVector2& GetCoordinates() const { return coordinates_; }
+
+    /// Return number of nodes selected on the last update.
+    unsigned GetNumSelectedNodes() const { return selectedBoxes_.Size(); }
+
+protected:
+    /// Recalculate the world-space bounding box.
+    void OnWorldBoundingBoxUpdate() override;
+
+private:
+    /// Select a node or its children for drawing.
+    void SelectNode(StreamingTerrainTile* tile, const FrameInfo& frame, const Vector3& viewPosition, Material* material, bool cull);
+    /// Add a batch for a whole node (quadrant M_MAX_UNSIGNED) or one of its quadrants.
+    void AddNodeBatch(StreamingTerrainTile* tile, unsigned quadrant, const FrameInfo& frame, Material* material);
+
+    /// Parent terrain.
+    WeakPtr<StreamingTerrain> owner_;
+    /// Material, used for views that have no morph material of their own.
+    SharedPtr<Material> material_;
+    /// Local-space bounding boxes of the selected nodes.
+    Vector<BoundingBox> selectedBoxes_;
+    /// Mutex for the selection.
+    Mutex selectionMutex_;
+    /// Block coordinates in the terrain.
+    IntVector2 coordinates_;
+};
+
+}
@@ -82,6 +82,7 @@ Pass::Pass(const String& name) :
     shadersLoadedFrameNumber_(0),
     alphaToCoverage_(false),
     depthWrite_(true),
+    clusteredLights_(false),
     isDesktop_(false)
 {
     name_ = name.ToLower();
@@ -127,6 +128,11 @@ void Pass::SetAlphaToCoverage(bool enable)
     alphaToCoverage_ = enable;
 }
 
+void Pass::SetClusteredLights(bool enable)
+{
+    clusteredLights_ = enable;
+}
+
 
 void Pass::SetIsDesktop(bool enable)
 {
@@ -275,6 +281,7 @@ bool Technique::BeginLoad(Deserializer& source)
     String globalPS = rootElem.GetAttribute("ps");
     String globalVSDefines = rootElem.GetAttribute("vsdefines");
     String globalPSDefines = rootElem.GetAttribute("psdefines");
+    bool globalClustered = rootElem.GetBool("clustered");
     // End with space so that the pass-specific defines can be appended
     if (!globalVSDefines.IsEmpty())
         globalVSDefines += ' ';
@@ -349,6 +356,12 @@ bool Technique::BeginLoad(Deserializer& source)
 
             if (passElem.HasAttribute("alphatocoverage"))
                 newPass->SetAlphaToCoverage(passElem.GetBool("alphatocoverage"));
+
+            // Clustered lights support follows the technique-level pixel shader unless the pass overrides it
+            if (passElem.HasAttribute("clustered"))
+                newPass->SetClusteredLights(passElem.GetBool("clustered"));
+            else
+                newPass->SetClusteredLights(globalClustered && !passElem.HasAttribute("ps"));
         }
         else
             DRY_LOGERROR("Missing pass name");
@@ -395,6 +408,7 @@ SharedPtr<Technique> Technique::Clone(const String& cloneName) const
         newPass->SetLightingMode(srcPass->GetLightingMode());
         newPass->SetDepthWrite(srcPass->GetDepthWrite());
         newPass->SetAlphaToCoverage(srcPass->GetAlphaToCoverage());
+        newPass->SetClusteredLights(srcPass->GetClusteredLights());
         newPass->SetIsDesktop(srcPass->IsDesktop());
         newPass->SetVertexShader(srcPass->GetVertexShader());
         newPass->SetPixelShader(srcPass->GetPixelShader());
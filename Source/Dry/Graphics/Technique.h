@@ -62,6 +62,8 @@ public:
     void SetDepthWrite(bool enable);
     /// Set alpha-to-coverage on/off.
     void SetAlphaToCoverage(bool enable);
+    /// Set whether the pass shaders add the clustered lights when compiled with the CLUSTERED define. Other passes receive those lights as forward lights.
+    void SetClusteredLights(bool enable);
     /// Set whether requires desktop level hardware.
     void SetIsDesktop(bool enable);
     /// Set vertex shader name.
@@ -100,6 +102,9 @@ public:
     bool GetDepthWrite() const { return depthWrite_; }
     /// Return alpha-to-coverage mode.
     bool GetAlphaToCoverage() const { return alphaToCoverage_; }
+
+    /// Return whether the pass shaders add the clustered lights.
+    bool GetClusteredLights() const { return clusteredLights_; }
     /// Return whether requires desktop level hardware.
     bool IsDesktop() const { return isDesktop_; }
     /// Return vertex shader name.
@@ -145,6 +150,8 @@ private:
     bool depthWrite_;
     /// Alpha-to-coverage mode.
     bool alphaToCoverage_;
+    /// Clustered lights support flag.
+    bool clusteredLights_;
     /// Require desktop level hardware flag.
     bool isDesktop_;
     /// Vertex shader name.
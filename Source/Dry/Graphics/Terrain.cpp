@@ -25,6 +25,8 @@
 
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
+#include "../Core/Thread.h"
+#include "../Core/WorkQueue.h"
 #include "../Graphics/DrawableEvents.h"
 #include "../Graphics/Geometry.h"
 #include "../Graphics/IndexBuffer.h"
@@ -40,6 +42,10 @@
 #include "../Scene/Node.h"
 #include "../Scene/Scene.h"
 
+#ifdef DRY_SSE
+#include <xmmintrin.h>
+#endif
+
 #include "../DebugNew.h"
 
 namespace Dry
@@ -57,6 +63,7 @@ static const unsigned STITCH_NORTH = 1;
 static const unsigned STITCH_SOUTH = 2;
 static const unsigned STITCH_WEST = 4;
 static const unsigned STITCH_EAST = 8;
+static const unsigned PATCH_VERTEX_FLOATS = 12;
 
 inline void GrowUpdateRegion(IntRect& updateRegion, int x, int y)
 {
@@ -78,6 +85,103 @@ inline void GrowUpdateRegion(IntRect& updateRegion, int x, int y)
     }
 }
 
+inline float GetClampedHeight(const float* heightData, const IntVector2& numVertices, int x, int z)
+{
+    x = Clamp(x, 0, numVertices.x_ - 1);
+    z = Clamp(z, 0, numVertices.y_ - 1);
+    return heightData[z * numVertices.x_ + x];
+}
+
+static Vector3 CalculateNormal(const float* heightData, const IntVector2& numVertices, float up, int x, int z)
+{
+    float baseHeight = GetClampedHeight(heightData, numVertices, x, z);
+    float nSlope = GetClampedHeight(heightData, numVertices, x, z - 1) - baseHeight;
+    float neSlope = GetClampedHeight(heightData, numVertices, x + 1, z - 1) - baseHeight;
+    float eSlope = GetClampedHeight(heightData, numVertices, x + 1, z) - baseHeight;
+    float seSlope = GetClampedHeight(heightData, numVertices, x + 1, z + 1) - baseHeight;
+    float sSlope = GetClampedHeight(heightData, numVertices, x, z + 1) - baseHeight;
+    float swSlope = GetClampedHeight(heightData, numVertices, x - 1, z + 1) - baseHeight;
+    float wSlope = GetClampedHeight(heightData, numVertices, x - 1, z) - baseHeight;
+    float nwSlope = GetClampedHeight(heightData, numVertices, x - 1, z - 1) - baseHeight;
+
+    return (Vector3(0.0f, up, nSlope) +
+            Vector3(-neSlope, up, neSlope) +
+            Vector3(-eSlope, up, 0.0f) +
+            Vector3(-seSlope, up, -seSlope) +
+            Vector3(0.0f, up, -sSlope) +
+            Vector3(swSlope, up, -swSlope) +
+            Vector3(wSlope, up, 0.0f) +
+            Vector3(nwSlope, up, nwSlope)).Normalized();
+}
+
+static void CalculateNormalRow(const float* heightData, const IntVector2& numVertices, float up, int startX, int z, int count, Vector3* dest)
+{
+    int i{ 0 };
+
+#ifdef DRY_SSE
+    // Vertices away from the edges need no clamping and are done four at a time
+    if (up > 0.0f && z > 0 && z < numVertices.y_ - 1)
+    {
+        const float* north = heightData + (z - 1) * numVertices.x_;
+        const float* center = heightData + z * numVertices.x_;
+        const float* south = heightData + (z + 1) * numVertices.x_;
+        const __m128 upSum = _mm_set1_ps(8.0f * up);
+        const __m128 one = _mm_set1_ps(1.0f);
+        float normalX[4];
+        float normalY[4];
+        float normalZ[4];
+
+        for (; i < count && startX + i < 1; ++i)
+            dest[i] = CalculateNormal(heightData, numVertices, up, startX + i, z);
+
+        for (; i + 4 <= count && startX + i + 4 < numVertices.x_; i += 4)
+        {
+            const int x{ startX + i };
+            const __m128 base = _mm_loadu_ps(center + x);
+            const __m128 n = _mm_sub_ps(_mm_loadu_ps(north + x), base);
+            const __m128 ne = _mm_sub_ps(_mm_loadu_ps(north + x + 1), base);
+            const __m128 e = _mm_sub_ps(_mm_loadu_ps(center + x + 1), base);
+            const __m128 se = _mm_sub_ps(_mm_loadu_ps(south + x + 1), base);
+            const __m128 s = _mm_sub_ps(_mm_loadu_ps(south + x), base);
+            const __m128 sw = _mm_sub_ps(_mm_loadu_ps(south + x - 1), base);
+            const __m128 w = _mm_sub_ps(_mm_loadu_ps(center + x - 1), base);
+            const __m128 nw = _mm_sub_ps(_mm_loadu_ps(north + x - 1), base);
+
+            const __m128 nx = _mm_sub_ps(_mm_add_ps(_mm_add_ps(sw, w), nw), _mm_add_ps(_mm_add_ps(ne, e), se));
+            const __m128 nz = _mm_sub_ps(_mm_add_ps(_mm_add_ps(n, ne), nw), _mm_add_ps(_mm_add_ps(se, s), sw));
+            const __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(upSum, upSum)), _mm_mul_ps(nz, nz));
+            const __m128 invLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSquared));
+
+            _mm_storeu_ps(normalX, _mm_mul_ps(nx, invLength));
+            _mm_storeu_ps(normalY, _mm_mul_ps(upSum, invLength));
+            _mm_storeu_ps(normalZ, _mm_mul_ps(nz, invLength));
+
+            for (unsigned j{ 0 }; j < 4; ++j)
+                dest[i + j] = Vector3(normalX[j], normalY[j], normalZ[j]);
+        }
+    }
+#endif
+
+    for (; i < count; ++i)
+        dest[i] = CalculateNormal(heightData, numVertices, up, startX + i, z);
+}
+
+static void SmoothHeightDataWork(const WorkItem* item, unsigned /*threadIndex*/)
+{
+    auto* terrain = reinterpret_cast<Terrain*>(item->aux_);
+    terrain->SmoothHeightData(*reinterpret_cast<IntRect*>(item->start_));
+}
+
+static void GeneratePatchGeometryWork(const WorkItem* item, unsigned /*threadIndex*/)
+{
+    auto* terrain = reinterpret_cast<Terrain*>(item->aux_);
+    auto* start = reinterpret_cast<TerrainPatchUpdate*>(item->start_);
+    auto* end = reinterpret_cast<TerrainPatchUpdate*>(item->end_);
+
+    while (start != end)
+        terrain->GeneratePatchGeometry(*start++);
+}
+
 Terrain::Terrain(Context* context) :
     Component(context),
     indexBuffer_(new IndexBuffer(context)),
@@ -516,6 +620,19 @@ void Terrain::ApplyHeightMap()
         CreateGeometry();
 }
 
+void Terrain::ApplyHeightMap(const IntRect& region)
+{
+    if (!heightMap_)
+        return;
+
+    const IntRect clipped(Max(region.left_, 0), Max(region.top_, 0),
+        Min(region.right_, heightMap_->GetWidth()), Min(region.bottom_, heightMap_->GetHeight()));
+    if (clipped.right_ <= clipped.left_ || clipped.bottom_ <= clipped.top_)
+        return;
+
+    CreateGeometry(clipped);
+}
+
 Image* Terrain::GetHeightMap() const
 {
     return heightMap_;
@@ -653,112 +770,113 @@ void Terrain::CreatePatchGeometry(TerrainPatch* patch)
 {
     DRY_PROFILE(CreatePatchGeometry);
 
-    auto row = (unsigned)(patchSize_ + 1);
-    VertexBuffer* vertexBuffer = patch->GetVertexBuffer();
-    Geometry* geometry = patch->GetGeometry();
-    Geometry* maxLodGeometry = patch->GetMaxLodGeometry();
-    Geometry* occlusionGeometry = patch->GetOcclusionGeometry();
-
-    if (vertexBuffer->GetVertexCount() != row * row)
-        vertexBuffer->SetSize(row * row, MASK_POSITION | MASK_NORMAL | MASK_TEXCOORD1 | MASK_TANGENT);
-
-    SharedArrayPtr<unsigned char> cpuVertexData(new unsigned char[row * row * sizeof(Vector3)]);
-    SharedArrayPtr<unsigned char> occlusionCpuVertexData(new unsigned char[row * row * sizeof(Vector3)]);
+    TerrainPatchUpdate update;
+    InitPatchUpdate(update, patch, 0, patchSize_);
+    GeneratePatchGeometry(update);
+    UploadPatchGeometry(update);
+}
 
-    auto* vertexData = (float*)vertexBuffer->Lock(0, vertexBuffer->GetVertexCount());
-    auto* positionData = (float*)cpuVertexData.Get();
-    auto* occlusionData = (float*)occlusionCpuVertexData.Get();
-    BoundingBox box;
+void Terrain::GeneratePatchGeometry(TerrainPatchUpdate& update)
+{
+    const int row{ patchSize_ + 1 };
+    const IntVector2& coords = update.patch_->GetCoordinates();
+    const float up = 0.5f * (spacing_.x_ + spacing_.z_);
 
     unsigned occlusionLevel = occlusionLodLevel_;
     if (occlusionLevel > numLodLevels_ - 1)
         occlusionLevel = numLodLevels_ - 1;
 
-    if (vertexData)
+    unsigned lodExpand = (1u << (occlusionLevel)) - 1;
+    int halfLodExpand = (1 << (occlusionLevel)) / 2;
+
+    update.vertexData_.Resize((unsigned)((update.endRow_ - update.startRow_ + 1) * row) * PATCH_VERTEX_FLOATS);
+    PODVector<Vector3> normals((unsigned)row);
+
+    float* vertexData = &update.vertexData_[0];
+    auto* positionData = (float*)update.positionData_.Get() + update.startRow_ * row * 3;
+    auto* occlusionData = (float*)update.occlusionData_.Get() + update.startRow_ * row * 3;
+
+    for (int z{ update.startRow_ }; z <= update.endRow_; ++z)
     {
-        const IntVector2& coords = patch->GetCoordinates();
-        unsigned lodExpand = (1u << (occlusionLevel)) - 1;
-        unsigned halfLodExpand = (1u << (occlusionLevel)) / 2;
+        int zPos = coords.y_ * patchSize_ + z;
+        CalculateNormalRow(heightData_.Get(), numVertices_, up, coords.x_ * patchSize_, zPos, row, &normals[0]);
 
-        for (unsigned z{ 0 }; z <= patchSize_; ++z)
+        for (int x{ 0 }; x < row; ++x)
         {
-            for (unsigned x{ 0 }; x <= patchSize_; ++x)
+            int xPos = coords.x_ * patchSize_ + x;
+
+            // Position
+            Vector3 position((float)x * spacing_.x_, GetRawHeight(xPos, zPos), (float)z * spacing_.z_);
+            *vertexData++ = position.x_;
+            *vertexData++ = position.y_;
+            *vertexData++ = position.z_;
+            *positionData++ = position.x_;
+            *positionData++ = position.y_;
+            *positionData++ = position.z_;
+
+            // For vertices that are part of the occlusion LOD, calculate the minimum height in the neighborhood
+            // to prevent false positive occlusion due to inaccuracy between occlusion LOD & visible LOD
+            float minHeight = position.y_;
+            if (halfLodExpand > 0 && (x & lodExpand) == 0 && (z & lodExpand) == 0)
             {
-                int xPos = coords.x_ * patchSize_ + x;
-                int zPos = coords.y_ * patchSize_ + z;
-
-                // Position
-                Vector3 position((float)x * spacing_.x_, GetRawHeight(xPos, zPos), (float)z * spacing_.z_);
-                *vertexData++ = position.x_;
-                *vertexData++ = position.y_;
-                *vertexData++ = position.z_;
-                *positionData++ = position.x_;
-                *positionData++ = position.y_;
-                *positionData++ = position.z_;
-
-                box.Merge(position);
-
-                // For vertices that are part of the occlusion LOD, calculate the minimum height in the neighborhood
-                // to prevent false positive occlusion due to inaccuracy between occlusion LOD & visible LOD
-                float minHeight = position.y_;
-                if (halfLodExpand > 0 && (x & lodExpand) == 0 && (z & lodExpand) == 0)
+                int minX = Max(xPos - halfLodExpand, 0);
+                int maxX = Min(xPos + halfLodExpand, numVertices_.x_ - 1);
+                int minZ = Max(zPos - halfLodExpand, 0);
+                int maxZ = Min(zPos + halfLodExpand, numVertices_.y_ - 1);
+                for (int nZ{ minZ }; nZ <= maxZ; ++nZ)
                 {
-                    int minX = Max(xPos - halfLodExpand, 0);
-                    int maxX = Min(xPos + halfLodExpand, numVertices_.x_ - 1);
-                    int minZ = Max(zPos - halfLodExpand, 0);
-                    int maxZ = Min(zPos + halfLodExpand, numVertices_.y_ - 1);
-                    for (int nZ{ minZ }; nZ <= maxZ; ++nZ)
-                    {
-                        for (int nX{ minX }; nX <= maxX; ++nX)
-                            minHeight = Min(minHeight, GetRawHeight(nX, nZ));
-                    }
+                    for (int nX{ minX }; nX <= maxX; ++nX)
+                        minHeight = Min(minHeight, GetRawHeight(nX, nZ));
                 }
-                *occlusionData++ = position.x_;
-                *occlusionData++ = minHeight;
-                *occlusionData++ = position.z_;
-
-                // Normal
-                Vector3 normal = GetRawNormal(xPos, zPos);
-                *vertexData++ = normal.x_;
-                *vertexData++ = normal.y_;
-                *vertexData++ = normal.z_;
-
-                // Texture coordinate
-                Vector2 texCoord((float)xPos / (float)(numVertices_.x_ - 1), 1.0f - (float)zPos / (float)(numVertices_.y_ - 1));
-                *vertexData++ = texCoord.x_;
-                *vertexData++ = texCoord.y_;
-
-                // Tangent
-                Vector3 xyz = (Vector3::RIGHT - normal * normal.DotProduct(Vector3::RIGHT)).Normalized();
-                *vertexData++ = xyz.x_;
-                *vertexData++ = xyz.y_;
-                *vertexData++ = xyz.z_;
-                *vertexData++ = 1.0f;
             }
+            *occlusionData++ = position.x_;
+            *occlusionData++ = minHeight;
+            *occlusionData++ = position.z_;
+
+            // Normal
+            const Vector3& normal = normals[x];
+            *vertexData++ = normal.x_;
+            *vertexData++ = normal.y_;
+            *vertexData++ = normal.z_;
+
+            // Texture coordinate
+            Vector2 texCoord((float)xPos / (float)(numVertices_.x_ - 1), 1.0f - (float)zPos / (float)(numVertices_.y_ - 1));
+            *vertexData++ = texCoord.x_;
+            *vertexData++ = texCoord.y_;
+
+            // Tangent
+            Vector3 xyz = (Vector3::RIGHT - normal * normal.DotProduct(Vector3::RIGHT)).Normalized();
+            *vertexData++ = xyz.x_;
+            *vertexData++ = xyz.y_;
+            *vertexData++ = xyz.z_;
+            *vertexData++ = 1.0f;
         }
-
-        vertexBuffer->Unlock();
-        vertexBuffer->ClearDataLost();
     }
 
-    patch->SetBoundingBox(box);
+    // The bounding box also covers the rows that were kept
+    const auto* positions = reinterpret_cast<const Vector3*>(update.positionData_.Get());
+    update.box_.Clear();
+    for (int i{ 0 }; i < row * row; ++i)
+        update.box_.Merge(positions[i]);
 
-    if (drawRanges_.Size())
+    CalculateLodErrors(update.patch_);
+}
+
+void Terrain::SmoothHeightData(const IntRect& region)
+{
+    for (int z{ region.top_ }; z < region.bottom_; ++z)
     {
-        unsigned occlusionDrawRange = occlusionLevel << 4u;
+        for (int x{ region.left_ }; x < region.right_; ++x)
+        {
+            float smoothedHeight = (
+                GetSourceHeight(x - 1, z - 1) + GetSourceHeight(x, z - 1) * 2.0f + GetSourceHeight(x + 1, z - 1) +
+                GetSourceHeight(x - 1, z) * 2.0f + GetSourceHeight(x, z) * 4.0f + GetSourceHeight(x + 1, z) * 2.0f +
+                GetSourceHeight(x - 1, z + 1) + GetSourceHeight(x, z + 1) * 2.0f + GetSourceHeight(x + 1, z + 1)
+            ) / 16.0f;
 
-        geometry->SetIndexBuffer(indexBuffer_);
-        geometry->SetDrawRange(TRIANGLE_LIST, drawRanges_[0].first_, drawRanges_[0].second_, false);
-        geometry->SetRawVertexData(cpuVertexData, MASK_POSITION);
-        maxLodGeometry->SetIndexBuffer(indexBuffer_);
-        maxLodGeometry->SetDrawRange(TRIANGLE_LIST, drawRanges_[0].first_, drawRanges_[0].second_, false);
-        maxLodGeometry->SetRawVertexData(cpuVertexData, MASK_POSITION);
-        occlusionGeometry->SetIndexBuffer(indexBuffer_);
-        occlusionGeometry->SetDrawRange(TRIANGLE_LIST, drawRanges_[occlusionDrawRange].first_, drawRanges_[occlusionDrawRange].second_, false);
-        occlusionGeometry->SetRawVertexData(occlusionCpuVertexData, MASK_POSITION);
+            heightData_[z * numVertices_.x_ + x] = smoothedHeight;
+        }
     }
-
-    patch->ResetLod();
 }
 
 void Terrain::UpdatePatchLod(TerrainPatch* patch)
@@ -846,7 +964,7 @@ ResourceRef Terrain::GetHeightMapAttr() const
     return GetResourceRef(heightMap_, Image::GetTypeStatic());
 }
 
-void Terrain::CreateGeometry()
+void Terrain::CreateGeometry(const IntRect& heightMapRegion)
 {
     recreateTerrain_ = false;
 
@@ -941,18 +1059,28 @@ void Terrain::CreateGeometry()
     {
         // Copy heightmap data
         const unsigned char* src = heightMap_->GetData();
-        float* dest = smoothing_ ? sourceHeightData_ : heightData_;
+        float* destData = smoothing_ ? sourceHeightData_ : heightData_;
         unsigned imgComps = heightMap_->GetComponents();
         unsigned imgRow = heightMap_->GetWidth() * imgComps;
         IntRect updateRegion(-1, -1, -1, -1);
 
+        // When a heightmap rectangle was applied, compare only it. Heightmap rows run opposite to vertex rows
+        IntRect copyRegion(0, 0, numVertices_.x_, numVertices_.y_);
+        if (!updateAll && heightMapRegion != IntRect::ZERO)
+        {
+            copyRegion = IntRect(Max(heightMapRegion.left_, 0), Max(numVertices_.y_ - heightMapRegion.bottom_, 0),
+                Min(heightMapRegion.right_, numVertices_.x_), Min(numVertices_.y_ - heightMapRegion.top_, numVertices_.y_));
+        }
+
         if (imgComps == 1)
         {
             DRY_PROFILE(CopyHeightData);
 
-            for (int z{ 0 }; z < numVertices_.y_; ++z)
+            for (int z{ copyRegion.top_ }; z < copyRegion.bottom_; ++z)
             {
-                for (int x{ 0 }; x < numVertices_.x_; ++x)
+                float* dest = destData + z * numVertices_.x_ + copyRegion.left_;
+
+                for (int x{ copyRegion.left_ }; x < copyRegion.right_; ++x)
                 {
                     float newHeight = (float)src[imgRow * (numVertices_.y_ - 1 - z) + x] * spacing_.y_;
 
@@ -976,9 +1104,11 @@ void Terrain::CreateGeometry()
             DRY_PROFILE(CopyHeightData);
 
             // If more than 1 component, use the green channel for more accuracy
-            for (int z{ 0 }; z < numVertices_.y_; ++z)
+            for (int z{ copyRegion.top_ }; z < copyRegion.bottom_; ++z)
             {
-                for (int x{ 0 }; x < numVertices_.x_; ++x)
+                float* dest = destData + z * numVertices_.x_ + copyRegion.left_;
+
+                for (int x{ copyRegion.left_ }; x < copyRegion.right_; ++x)
                 {
                     float newHeight = ((float)src[imgRow * (numVertices_.y_ - 1 - z) + imgComps * x] +
                                        (float)src[imgRow * (numVertices_.y_ - 1 - z) + imgComps * x + 1] / 256.0f) * spacing_.y_;
@@ -1000,9 +1130,11 @@ void Terrain::CreateGeometry()
         }
 
         // If updating a region of the heightmap, check which patches change
-        if (!updateAll)
+        const bool heightChanged = updateRegion.left_ >= 0;
+        if (!updateAll && heightChanged)
         {
-            int lodExpand = 1u << (numLodLevels_ - 1);
+            // Smoothing spreads the changes one vertex further
+            int lodExpand = (1 << (numLodLevels_ - 1)) + (smoothing_ ? 1 : 0);
             // Expand the right & bottom 1 pixel more, as patches share vertices at the edge
             updateRegion.left_ -= lodExpand;
             updateRegion.right_ += lodExpand + 1;
@@ -1080,48 +1212,41 @@ void Terrain::CreateGeometry()
         // Create vertex data for patches. First update smoothing to ensure normals are calculated correctly across patch borders
         if (smoothing_)
         {
-            DRY_PROFILE(UpdateSmoothing);
-
-            for (unsigned i{ 0 }; i < patches_.Size(); ++i)
+            if (updateAll)
+                UpdateSmoothing(IntRect(0, 0, numVertices_.x_, numVertices_.y_));
+            else if (heightChanged)
             {
-                if (dirtyPatches[i])
-                {
-                    TerrainPatch* patch = patches_[i];
-                    const IntVector2& coords = patch->GetCoordinates();
-                    int startX = coords.x_ * patchSize_;
-                    int endX = startX + patchSize_;
-                    int startZ = coords.y_ * patchSize_;
-                    int endZ = startZ + patchSize_;
-
-                    for (int z{ startZ }; z <= endZ; ++z)
-                    {
-                        for (int x{ startX }; x <= endX; ++x)
-                        {
-                            float smoothedHeight = (
-                                GetSourceHeight(x - 1, z - 1) + GetSourceHeight(x, z - 1) * 2.0f + GetSourceHeight(x + 1, z - 1) +
-                                GetSourceHeight(x - 1, z) * 2.0f + GetSourceHeight(x, z) * 4.0f + GetSourceHeight(x + 1, z) * 2.0f +
-                                GetSourceHeight(x - 1, z + 1) + GetSourceHeight(x, z + 1) * 2.0f + GetSourceHeight(x + 1, z + 1)
-                            ) / 16.0f;
-
-                            heightData_[z * numVertices_.x_ + x] = smoothedHeight;
-                        }
-                    }
-                }
+                UpdateSmoothing(IntRect(Max(updateRegion.left_, 0), Max(updateRegion.top_, 0),
+                    Min(updateRegion.right_ + 1, numVertices_.x_), Min(updateRegion.bottom_ + 1, numVertices_.y_)));
             }
         }
 
+        Vector<TerrainPatchUpdate> updates;
         for (unsigned i{ 0 }; i < patches_.Size(); ++i)
         {
+            if (!dirtyPatches[i])
+                continue;
+
             TerrainPatch* patch = patches_[i];
+            int startRow{ 0 };
+            int endRow{ patchSize_ };
 
-            if (dirtyPatches[i])
+            // Regenerate only the vertex rows the changes reach
+            if (!updateAll)
             {
-                CreatePatchGeometry(patch);
-                CalculateLodErrors(patch);
+                const int zStart{ patch->GetCoordinates().y_ * patchSize_ };
+                startRow = Max(updateRegion.top_ - zStart, 0);
+                endRow = Min(updateRegion.bottom_ - zStart, patchSize_);
             }
 
-            SetPatchNeighbors(patch);
+            updates.Resize(updates.Size() + 1);
+            InitPatchUpdate(updates.Back(), patch, startRow, endRow);
         }
+
+        UpdatePatchGeometries(updates);
+
+        for (unsigned i{ 0 }; i < patches_.Size(); ++i)
+            SetPatchNeighbors(patches_[i]);
     }
 
     // Send event only if new geometry was generated, or the old was cleared
@@ -1295,6 +1420,157 @@ void Terrain::CreateIndexData()
     indexBuffer_->SetData(&indices[0]);
 }
 
+void Terrain::UpdateSmoothing(const IntRect& region)
+{
+    DRY_PROFILE(UpdateSmoothing);
+
+    auto* queue = GetSubsystem<WorkQueue>();
+    const unsigned numThreads = queue && Thread::IsMainThread() ? queue->GetNumThreads() + 1 : 1;
+    const int numRows{ region.bottom_ - region.top_ };
+
+    if (numThreads < 2 || numRows < 2 * (int)numThreads)
+    {
+        SmoothHeightData(region);
+        return;
+    }
+
+    // Smooth in bands of rows, as each vertex reads only the source data
+    PODVector<IntRect> bands(numThreads);
+    for (unsigned i{ 0 }; i < numThreads; ++i)
+    {
+        bands[i] = IntRect(region.left_, region.top_ + numRows * (int)i / (int)numThreads,
+            region.right_, region.top_ + numRows * (int)(i + 1) / (int)numThreads);
+
+        SharedPtr<WorkItem> item = queue->GetFreeItem();
+        item->priority_ = M_MAX_UNSIGNED;
+        item->workFunction_ = SmoothHeightDataWork;
+        item->aux_ = this;
+        item->start_ = &bands[i];
+        item->end_ = &bands[i] + 1;
+        queue->AddWorkItem(item);
+    }
+
+    queue->Complete(M_MAX_UNSIGNED);
+}
+
+void Terrain::InitPatchUpdate(TerrainPatchUpdate& update, TerrainPatch* patch, int startRow, int endRow) const
+{
+    const auto row = (unsigned)(patchSize_ + 1);
+    const unsigned dataSize = row * row * sizeof(Vector3);
+
+    update.patch_ = patch;
+    update.startRow_ = 0;
+    update.endRow_ = patchSize_;
+    update.positionData_ = new unsigned char[dataSize];
+    update.occlusionData_ = new unsigned char[dataSize];
+
+    if (startRow == 0 && endRow == patchSize_)
+        return;
+
+    // Keep the previous data of the other rows if it is intact
+    const unsigned char* positionData;
+    const unsigned char* occlusionData;
+    const unsigned char* indexData;
+    unsigned positionSize;
+    unsigned occlusionSize;
+    unsigned indexSize;
+    const PODVector<VertexElement>* elements;
+    patch->GetGeometry()->GetRawData(positionData, positionSize, indexData, indexSize, elements);
+    patch->GetOcclusionGeometry()->GetRawData(occlusionData, occlusionSize, indexData, indexSize, elements);
+
+    VertexBuffer* vertexBuffer = patch->GetVertexBuffer();
+    if (vertexBuffer->GetVertexCount() != row * row || vertexBuffer->IsDataLost() || !positionData ||
+        positionSize != sizeof(Vector3) || !occlusionData || occlusionSize != sizeof(Vector3))
+        return;
+
+    memcpy(update.positionData_.Get(), positionData, dataSize);
+    memcpy(update.occlusionData_.Get(), occlusionData, dataSize);
+    update.startRow_ = startRow;
+    update.endRow_ = endRow;
+}
+
+void Terrain::UpdatePatchGeometries(Vector<TerrainPatchUpdate>& updates)
+{
+    if (updates.IsEmpty())
+        return;
+
+    DRY_PROFILE(UpdatePatchGeometries);
+
+    auto* queue = GetSubsystem<WorkQueue>();
+    const unsigned numThreads = queue && Thread::IsMainThread() ? queue->GetNumThreads() + 1 : 1;
+
+    if (numThreads > 1 && updates.Size() > 1)
+    {
+        // Split into a few work items per thread, as patches of a partial update differ in cost
+        const unsigned numItems = Min(updates.Size(), numThreads * 4);
+        unsigned start{ 0 };
+
+        for (unsigned i{ 0 }; i < numItems; ++i)
+        {
+            const unsigned end = (i + 1) * updates.Size() / numItems;
+
+            SharedPtr<WorkItem> item = queue->GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = GeneratePatchGeometryWork;
+            item->aux_ = this;
+            item->start_ = &updates[start];
+            item->end_ = &updates[start] + (end - start);
+            queue->AddWorkItem(item);
+
+            start = end;
+        }
+
+        queue->Complete(M_MAX_UNSIGNED);
+    }
+    else
+    {
+        for (unsigned i{ 0 }; i < updates.Size(); ++i)
+            GeneratePatchGeometry(updates[i]);
+    }
+
+    for (unsigned i{ 0 }; i < updates.Size(); ++i)
+        UploadPatchGeometry(updates[i]);
+}
+
+void Terrain::UploadPatchGeometry(const TerrainPatchUpdate& update)
+{
+    TerrainPatch* patch = update.patch_;
+    const auto row = (unsigned)(patchSize_ + 1);
+    VertexBuffer* vertexBuffer = patch->GetVertexBuffer();
+    Geometry* geometry = patch->GetGeometry();
+    Geometry* maxLodGeometry = patch->GetMaxLodGeometry();
+    Geometry* occlusionGeometry = patch->GetOcclusionGeometry();
+
+    if (vertexBuffer->GetVertexCount() != row * row)
+        vertexBuffer->SetSize(row * row, MASK_POSITION | MASK_NORMAL | MASK_TEXCOORD1 | MASK_TANGENT);
+
+    if (vertexBuffer->SetDataRange(&update.vertexData_[0], (unsigned)update.startRow_ * row,
+        (unsigned)(update.endRow_ - update.startRow_ + 1) * row))
+        vertexBuffer->ClearDataLost();
+
+    patch->SetBoundingBox(update.box_);
+
+    if (drawRanges_.Size())
+    {
+        unsigned occlusionLevel = occlusionLodLevel_;
+        if (occlusionLevel > numLodLevels_ - 1)
+            occlusionLevel = numLodLevels_ - 1;
+        unsigned occlusionDrawRange = occlusionLevel << 4u;
+
+        geometry->SetIndexBuffer(indexBuffer_);
+        geometry->SetDrawRange(TRIANGLE_LIST, drawRanges_[0].first_, drawRanges_[0].second_, false);
+        geometry->SetRawVertexData(update.positionData_, MASK_POSITION);
+        maxLodGeometry->SetIndexBuffer(indexBuffer_);
+        maxLodGeometry->SetDrawRange(TRIANGLE_LIST, drawRanges_[0].first_, drawRanges_[0].second_, false);
+        maxLodGeometry->SetRawVertexData(update.positionData_, MASK_POSITION);
+        occlusionGeometry->SetIndexBuffer(indexBuffer_);
+        occlusionGeometry->SetDrawRange(TRIANGLE_LIST, drawRanges_[occlusionDrawRange].first_, drawRanges_[occlusionDrawRange].second_, false);
+        occlusionGeometry->SetRawVertexData(update.occlusionData_, MASK_POSITION);
+    }
+
+    patch->ResetLod();
+}
+
 float Terrain::GetRawHeight(int x, int z) const
 {
     if (!heightData_)
@@ -1342,25 +1618,10 @@ float Terrain::GetLodHeight(int x, int z, unsigned lodLevel) const
 
 Vector3 Terrain::GetRawNormal(int x, int z) const
 {
-    float baseHeight = GetRawHeight(x, z);
-    float nSlope = GetRawHeight(x, z - 1) - baseHeight;
-    float neSlope = GetRawHeight(x + 1, z - 1) - baseHeight;
-    float eSlope = GetRawHeight(x + 1, z) - baseHeight;
-    float seSlope = GetRawHeight(x + 1, z + 1) - baseHeight;
-    float sSlope = GetRawHeight(x, z + 1) - baseHeight;
-    float swSlope = GetRawHeight(x - 1, z + 1) - baseHeight;
-    float wSlope = GetRawHeight(x - 1, z) - baseHeight;
-    float nwSlope = GetRawHeight(x - 1, z - 1) - baseHeight;
-    float up = 0.5f * (spacing_.x_ + spacing_.z_);
+    if (!heightData_)
+        return Vector3::UP;
 
-    return (Vector3(0.0f, up, nSlope) +
-            Vector3(-neSlope, up, neSlope) +
-            Vector3(-eSlope, up, 0.0f) +
-            Vector3(-seSlope, up, -seSlope) +
-            Vector3(0.0f, up, -sSlope) +
-            Vector3(swSlope, up, -swSlope) +
-            Vector3(wSlope, up, 0.0f) +
-            Vector3(nwSlope, up, nwSlope)).Normalized();
+    return CalculateNormal(heightData_.Get(), numVertices_, 0.5f * (spacing_.x_ + spacing_.z_), x, z);
 }
 
 void Terrain::CalculateLodErrors(TerrainPatch* patch)
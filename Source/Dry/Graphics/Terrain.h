@@ -24,6 +24,7 @@
 #pragma once
 
 #include "../Container/ArrayPtr.h"
+#include "../Math/BoundingBox.h"
 #include "../Scene/Component.h"
 
 namespace Dry
@@ -35,6 +36,25 @@ class Material;
 class Node;
 class TerrainPatch;
 
+/// Vertex rows of a terrain patch to regenerate, and the data generated for them.
+struct TerrainPatchUpdate
+{
+    /// Patch to update.
+    TerrainPatch* patch_{};
+    /// First vertex row to regenerate.
+    int startRow_{};
+    /// Last vertex row to regenerate.
+    int endRow_{};
+    /// Generated vertex buffer data of the rows.
+    PODVector<float> vertexData_;
+    /// CPU-side positions of the whole patch.
+    SharedArrayPtr<unsigned char> positionData_;
+    /// CPU-side occlusion positions of the whole patch.
+    SharedArrayPtr<unsigned char> occlusionData_;
+    /// Bounding box of the whole patch.
+    BoundingBox box_;
+};
+
 /// Heightmap terrain component.
 class DRY_API Terrain : public Component
 {
@@ -101,6 +121,8 @@ public:
     void SetOccludee(bool enable);
     /// Apply changes from the heightmap image.
     void ApplyHeightMap();
+    /// Apply changes from a rectangle of the heightmap image, in pixels. Only the patch vertex rows the changes reach are regenerated.
+    void ApplyHeightMap(const IntRect& region);
 
     /// Return patch quads per side.
     int GetPatchSize() const { return patchSize_; }
@@ -195,6 +217,10 @@ public:
 
     /// Regenerate patch geometry.
     void CreatePatchGeometry(TerrainPatch* patch);
+    /// Generate the vertex data, bounding box and LOD errors of a patch update. Called from worker threads during the geometry update.
+    void GeneratePatchGeometry(TerrainPatchUpdate& update);
+    /// Smooth a rectangle of the height data from the source height data. Called from worker threads during the geometry update.
+    void SmoothHeightData(const IntRect& region);
     /// Update patch based on LOD and neighbor LOD.
     void UpdatePatchLod(TerrainPatch* patch);
     /// Set heightmap attribute.
@@ -213,10 +239,18 @@ public:
     ResourceRef GetMaterialAttr() const;
 
 private:
-    /// Regenerate terrain geometry.
-    void CreateGeometry();
+    /// Regenerate terrain geometry. When a heightmap rectangle is given, only it is compared for changes.
+    void CreateGeometry(const IntRect& heightMapRegion = IntRect::ZERO);
     /// Create index data shared by all patches.
     void CreateIndexData();
+    /// Smooth a rectangle of the height data, in parallel if possible. Returns once all of it is smoothed.
+    void UpdateSmoothing(const IntRect& region);
+    /// Set up the update of a range of patch vertex rows. The whole patch is regenerated if its previous data can not be kept.
+    void InitPatchUpdate(TerrainPatchUpdate& update, TerrainPatch* patch, int startRow, int endRow) const;
+    /// Generate patch updates in parallel if possible, wait for them and upload them in the same call.
+    void UpdatePatchGeometries(Vector<TerrainPatchUpdate>& updates);
+    /// Upload a generated patch update to the patch's vertex buffer and geometries.
+    void UploadPatchGeometry(const TerrainPatchUpdate& update);
     /// Return an uninterpolated terrain height value, clamping to edges.
     float GetRawHeight(int x, int z) const;
     /// Return a source terrain height value, clamping to edges. The source data is used for smoothing.
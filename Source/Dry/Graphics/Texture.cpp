@@ -127,6 +127,28 @@ int Texture::GetMipsToSkip(MaterialQuality quality) const
     return (quality >= QUALITY_LOW && quality < MAX_TEXTURE_QUALITY_LEVELS) ? mipsToSkip_[quality] : 0;
 }
 
+void Texture::ApplyStreamingDistance()
+{
+    Resource::ApplyStreamingDistance();
+
+    streamingScreenSize_ = requestedScreenSize_;
+    requestedScreenSize_ = 0.f;
+}
+
+unsigned Texture::GetStreamingDetailLevel() const
+{
+    // Each level down halves the size, so stop at the first level no larger than the screen size
+    unsigned level{ 0 };
+    int size = Max(width_, height_);
+    while (level + 1 < levels_ && (size >> 1) >= streamingScreenSize_)
+    {
+        size >>= 1;
+        ++level;
+    }
+
+    return level;
+}
+
 int Texture::GetLevelWidth(unsigned level) const
 {
     if (level > levels_)
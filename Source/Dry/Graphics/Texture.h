@@ -69,6 +69,15 @@ public:
     void SetBackupTexture(Texture* texture);
     /// Set mip levels to skip on a quality setting when loading. Ensures higher quality levels do not skip more.
     void SetMipsToSkip(MaterialQuality quality, int toSkip);
+    /// Report the screen size in pixels the texture is drawn at this frame. The largest size of the frame limits the detail that is streamed in. Call only from the main thread.
+    void UpdateStreamingScreenSize(float size)
+    {
+        if (size > requestedScreenSize_)
+            requestedScreenSize_ = size;
+    }
+
+    /// Begin a new streaming frame: latch the view distance and screen size reported during the previous one. Called by ResourceCache.
+    void ApplyStreamingDistance() override;
 
     /// Return API-specific texture format.
     unsigned GetFormat() const { return format_; }
@@ -123,6 +132,12 @@ public:
 
     /// Return mip levels to skip on a quality setting when loading.
     int GetMipsToSkip(MaterialQuality quality) const;
+    /// Return the finest mip level needed for the screen size reported during the previous frame.
+    unsigned GetStreamingDetailLevel() const;
+
+    /// Return the largest screen size in pixels reported during the previous frame.
+    float GetStreamingScreenSize() const { return streamingScreenSize_; }
+
     /// Return mip level width, or 0 if level does not exist.
     int GetLevelWidth(unsigned level) const;
     /// Return mip level width, or 0 if level does not exist.
@@ -246,6 +261,10 @@ protected:
     bool levelsDirty_{};
     /// Backup texture.
     SharedPtr<Texture> backupTexture_;
+    /// Largest screen size reported during the current frame.
+    float requestedScreenSize_{};
+    /// Largest screen size reported during the previous frame.
+    float streamingScreenSize_{};
 };
 
 }
@@ -24,14 +24,18 @@
 #include "../Precompiled.h"
 
 #include "../Core/Context.h"
+#include "../Core/CoreEvents.h"
 #include "../Core/Profiler.h"
 #include "../Graphics/Graphics.h"
 #include "../Graphics/GraphicsEvents.h"
 #include "../Graphics/GraphicsImpl.h"
 #include "../Graphics/Renderer.h"
 #include "../Graphics/Texture2D.h"
+#include "../IO/AsyncFileReader.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
+#include "../IO/MemoryBuffer.h"
+#include "../Resource/Image.h"
 #include "../Resource/ResourceCache.h"
 #include "../Resource/XMLFile.h"
 
@@ -40,6 +44,9 @@
 namespace Dry
 {
 
+/// Time in milliseconds to keep the streaming source image after its last use.
+static const unsigned STREAM_IMAGE_KEEP_MS = 2000;
+
 Texture2D::Texture2D(Context* context) :
     Texture(context)
 {
@@ -102,7 +109,7 @@ bool Texture2D::EndLoad()
     CheckTextureBudget(GetTypeStatic());
 
     SetParameters(loadParameters_);
-    bool success = SetData(loadImage_);
+    bool success = SetImageData(loadImage_, false, GetSubsystem<ResourceCache>()->IsStreamingEnabled() && !GetName().IsEmpty());
 
     loadImage_.Reset();
     loadParameters_.Reset();
@@ -161,6 +168,107 @@ bool Texture2D::SetSize(int width, int height, unsigned format, TextureUsage usa
     return Create();
 }
 
+bool Texture2D::SetData(Image* image, bool useAlpha)
+{
+    return SetImageData(image, useAlpha, false);
+}
+
+bool Texture2D::SetResidencyLevel(unsigned level)
+{
+    if (numResidencyLevels_ <= 1 || !objectName_)
+        return false;
+
+    level = Min(level, numResidencyLevels_ - 1);
+    if (level == residencyLevel_)
+        return false;
+
+    if (level > residencyLevel_)
+    {
+        // Drop the finest levels; also cancel a pending upgrade
+        streamRequest_.Reset();
+        SetBaseLevel(level);
+        residencyLevel_ = targetResidencyLevel_ = level;
+        SetMemoryUse(GetResidencyMemoryUse(level));
+        return true;
+    }
+
+    // Do not stream in more detail than the screen size needs
+    level = Max(level, GetStreamingDetailLevel());
+    if (level >= residencyLevel_)
+        return false;
+
+    targetResidencyLevel_ = level;
+    if (streamImage_)
+        return UploadStreamedLevels();
+    if (streamRequest_)
+        return false;
+
+    // Read the image file back in the background
+    auto* cache = GetSubsystem<ResourceCache>();
+    Vector<SharedPtr<AsyncReadRequest> > requests;
+    cache->ReadFilesAsync(Vector<String>(1, GetName()), requests);
+    if (requests[0])
+    {
+        streamRequest_ = requests[0];
+        SubscribeToEvent(E_BEGINFRAME, DRY_HANDLER(Texture2D, HandleStreamingUpdate));
+        return true;
+    }
+
+    // Not directly readable, for example in a compressed package; load synchronously instead
+    SharedPtr<File> file = cache->GetFile(GetName(), false);
+    if (!file)
+        return false;
+
+    streamImage_ = new Image(context_);
+    if (!streamImage_->Load(*file) || !UploadStreamedLevels())
+    {
+        streamImage_.Reset();
+        return false;
+    }
+
+    SubscribeToEvent(E_BEGINFRAME, DRY_HANDLER(Texture2D, HandleStreamingUpdate));
+    return true;
+}
+
+unsigned Texture2D::GetResidencyMemoryUse(unsigned level) const
+{
+    unsigned memoryUse = sizeof(Texture2D);
+    for (unsigned i{ level }; i < levels_; ++i)
+        memoryUse += GetDataSize(GetLevelWidth(i), GetLevelHeight(i));
+
+    return memoryUse;
+}
+
+bool Texture2D::UploadStreamedLevels()
+{
+    const unsigned numLevels = streamImage_->GetNumCompressedLevels();
+    if (!streamImage_->IsCompressed() || numLevels < streamMipsSkipped_ + residencyLevel_ ||
+        graphics_->GetFormat(streamImage_->GetCompressedFormat()) != format_)
+    {
+        DRY_LOGWARNING("Image " + GetName() + " changed on disk, can not stream in its mip levels");
+        streamImage_.Reset();
+        numResidencyLevels_ = residencyLevel_ + 1;
+        return false;
+    }
+
+    for (unsigned i{ targetResidencyLevel_ }; i < residencyLevel_; ++i)
+    {
+        CompressedLevel level = streamImage_->GetCompressedLevel(i + streamMipsSkipped_);
+        if (level.width_ != GetLevelWidth(i) || level.height_ != GetLevelHeight(i) ||
+            !SetData(i, 0, 0, level.width_, level.height_, level.data_))
+        {
+            streamImage_.Reset();
+            return false;
+        }
+    }
+
+    SetBaseLevel(targetResidencyLevel_);
+    residencyLevel_ = targetResidencyLevel_;
+    SetMemoryUse(GetResidencyMemoryUse(residencyLevel_));
+    streamImageTimer_.Reset();
+    return true;
+}
+
 bool Texture2D::GetImage(Image& image) const
 {
     if (format_ != Graphics::GetRGBAFormat() && format_ != Graphics::GetRGBFormat())
@@ -182,6 +290,34 @@ SharedPtr<Image> Texture2D::GetImage() const
     return rawImage;
 }
 
+void Texture2D::HandleStreamingUpdate(StringHash eventType, VariantMap& eventData)
+{
+    if (streamRequest_ && streamRequest_->completed_)
+    {
+        SharedPtr<AsyncReadRequest> request = streamRequest_;
+        streamRequest_.Reset();
+
+        if (request->success_)
+        {
+            MemoryBuffer buffer(request->data_);
+            buffer.SetName(GetName());
+            streamImage_ = new Image(context_);
+            if (!streamImage_->Load(buffer))
+                streamImage_.Reset();
+        }
+
+        if (streamImage_ && targetResidencyLevel_ < residencyLevel_)
+            UploadStreamedLevels();
+    }
+
+    // Release the source image when fully resident or no longer being used
+    if (streamImage_ && (!residencyLevel_ || streamImageTimer_.GetMSec(false) > STREAM_IMAGE_KEEP_MS))
+        streamImage_.Reset();
+
+    if (!streamRequest_ && !streamImage_)
+        UnsubscribeFromEvent(E_BEGINFRAME);
+}
+
 void Texture2D::HandleRenderSurfaceUpdate(StringHash eventType, VariantMap& eventData)
 {
     if (renderSurface_ && (renderSurface_->GetUpdateMode() == SURFACE_UPDATEALWAYS || renderSurface_->IsUpdateQueued()))
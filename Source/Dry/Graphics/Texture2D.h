@@ -24,12 +24,14 @@
 #pragma once
 
 #include "../Container/Ptr.h"
+#include "../Core/Timer.h"
 #include "../Graphics/RenderSurface.h"
 #include "../Graphics/Texture.h"
 
 namespace Dry
 {
 
+struct AsyncReadRequest;
 class Image;
 class XMLFile;
 
@@ -56,6 +58,8 @@ public:
     void OnDeviceReset() override;
     /// Release the texture.
     void Release() override;
+    /// Set residency level for streaming, which is the finest resident mip level. Finer levels are read back from the image file in the background. Return true if changed or a read was started.
+    bool SetResidencyLevel(unsigned level) override;
 
     /// Set size, format, usage and multisampling parameters for rendertargets. Zero size will follow application window size. Return true if successful.
     /** Autoresolve true means the multisampled texture will be automatically resolved to 1-sample after being rendered to and before being sampled as a texture.
@@ -77,13 +81,30 @@ public:
     /// Return render surface.
     RenderSurface* GetRenderSurface() const { return renderSurface_; }
 
+    /// Return number of residency levels. More than one if the mip levels are streamed.
+    unsigned GetNumResidencyLevels() const override { return numResidencyLevels_; }
+
+    /// Return current residency level, which is the finest resident mip level.
+    unsigned GetResidencyLevel() const override { return residencyLevel_; }
+
+    /// Return estimated memory use in bytes at a residency level.
+    unsigned GetResidencyMemoryUse(unsigned level) const override;
+
 protected:
     /// Create the GPU texture.
     bool Create() override;
 
 private:
+    /// Set data from an image, optionally uploading only the coarsest mip levels for streaming in the rest later.
+    bool SetImageData(Image* image, bool useAlpha, bool streamLevels);
+    /// Upload the mip levels down to the target residency level from the streaming source image.
+    bool UploadStreamedLevels();
+    /// Set the finest mip level used for sampling and release the data of finer levels.
+    void SetBaseLevel(unsigned level);
     /// Handle render surface update event.
     void HandleRenderSurfaceUpdate(StringHash eventType, VariantMap& eventData);
+    /// Handle begin frame event while mip levels are being streamed in.
+    void HandleStreamingUpdate(StringHash eventType, VariantMap& eventData);
 
     /// Render surface.
     SharedPtr<RenderSurface> renderSurface_;
@@ -91,6 +112,20 @@ private:
     SharedPtr<Image> loadImage_;
     /// Parameter file acquired during BeginLoad.
     SharedPtr<XMLFile> loadParameters_;
+    /// Pending read of the image file for streaming in mip levels.
+    SharedPtr<AsyncReadRequest> streamRequest_;
+    /// Image the streamed mip levels are uploaded from. Kept for a while after the read to serve further upgrades.
+    SharedPtr<Image> streamImage_;
+    /// Time since the streaming source image was last used.
+    Timer streamImageTimer_;
+    /// Number of residency levels.
+    unsigned numResidencyLevels_{1};
+    /// Finest resident mip level.
+    unsigned residencyLevel_{};
+    /// Finest mip level requested to become resident.
+    unsigned targetResidencyLevel_{};
+    /// Mip levels of the image file skipped by the texture quality setting.
+    unsigned streamMipsSkipped_{};
 };
 
 }
@@ -79,6 +79,7 @@ bool VertexBuffer::SetSize(unsigned vertexCount, const PODVector<VertexElement>&
     vertexCount_ = vertexCount;
     elements_ = elements;
     dynamic_ = dynamic;
+    ++dataVersion_;
 
     UpdateOffsets();
 
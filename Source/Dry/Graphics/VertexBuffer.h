@@ -109,6 +109,9 @@ public:
     /// Return shared array pointer to the CPU memory shadow data.
     SharedArrayPtr<unsigned char> GetShadowDataShared() const { return shadowData_; }
 
+    /// Return data version, which changes whenever the data or size is set.
+    unsigned GetDataVersion() const { return dataVersion_; }
+
     /// Return buffer hash for building vertex declarations. Used internally.
     unsigned long long GetBufferHash(unsigned streamIndex) { return elementHash_ << (streamIndex * 16); }
 
@@ -157,6 +160,8 @@ private:
     unsigned long long elementHash_{};
     /// Vertex element legacy bitmask.
     VertexMaskFlags elementMask_{};
+    /// Data version.
+    unsigned dataVersion_{};
     /// Buffer locking state.
     LockState lockState_{LOCK_NONE};
     /// Lock start vertex.
@@ -28,16 +28,21 @@
 #include "../Graphics/Camera.h"
 #include "../Graphics/DebugRenderer.h"
 #include "../Graphics/Geometry.h"
+#include "../Graphics/GeometryPool.h"
 #include "../Graphics/Graphics.h"
 #include "../Graphics/GraphicsEvents.h"
 #include "../Graphics/GraphicsImpl.h"
+#include "../Graphics/IndexBuffer.h"
 #include "../Graphics/Material.h"
+#include "../Graphics/Model.h"
 #include "../Graphics/OcclusionBuffer.h"
 #include "../Graphics/Octree.h"
 #include "../Graphics/Renderer.h"
 #include "../Graphics/RenderPath.h"
 #include "../Graphics/ShaderVariation.h"
+#include "../Graphics/ShadowAtlas.h"
 #include "../Graphics/Skybox.h"
+#include "../Graphics/StaticModel.h"
 #include "../Graphics/Technique.h"
 #include "../Graphics/Texture2D.h"
 #include "../Graphics/Texture2DArray.h"
@@ -51,6 +56,10 @@
 #include "../Scene/Scene.h"
 #include "../UI/UI.h"
 
+#ifdef DRY_SSE
+#include <xmmintrin.h>
+#endif
+
 #include "../DebugNew.h"
 
 namespace Dry
@@ -235,6 +244,14 @@ void ProcessLightWork(const WorkItem* item, unsigned threadIndex)
     view->ProcessLight(*query, threadIndex);
 }
 
+void ProcessShadowCastersWork(const WorkItem* item, unsigned threadIndex)
+{
+    auto* view = reinterpret_cast<View*>(item->aux_);
+    auto* range = reinterpret_cast<ShadowCasterRange*>(item->start_);
+
+    view->ProcessShadowCasters(*range);
+}
+
 void UpdateDrawableGeometriesWork(const WorkItem* item, unsigned threadIndex)
 {
     const FrameInfo& frame = *(reinterpret_cast<FrameInfo*>(item->aux_));
@@ -275,7 +292,139 @@ void SortShadowQueueWork(const WorkItem* item, unsigned threadIndex)
 {
     auto* start = reinterpret_cast<LightBatchQueue*>(item->start_);
     for (unsigned i{ 0 }; i < start->shadowSplits_.Size(); ++i)
+    {
         start->shadowSplits_[i].shadowBatches_.SortFrontToBack();
+        start->shadowSplits_[i].dynamicShadowBatches_.SortFrontToBack();
+    }
+}
+
+/// Number of shadow caster candidates checked by one work item.
+static const unsigned SHADOW_CASTERS_PER_WORK_ITEM = 256;
+
+/// Shadow caster candidate visibility states within a split.
+static const unsigned char SHADOW_CASTER_HIDDEN = 0;
+static const unsigned char SHADOW_CASTER_TEST = 1;
+static const unsigned char SHADOW_CASTER_VISIBLE = 2;
+
+/// Extrude a shadow caster's light view space bounding box in the direction its shadow is cast.
+static void ExtrudeShadowCasterBox(BoundingBox& lightViewBox, Camera* shadowCamera, float frustumFarZ)
+{
+    if (shadowCamera->IsOrthographic())
+    {
+        // Extrude the light space bounding box up to the far edge of the frustum's light space bounding box
+        lightViewBox.max_.z_ = Max(lightViewBox.max_.z_, frustumFarZ);
+    }
+    else
+    {
+        // For perspective lights, extrusion direction depends on the position of the shadow caster
+        Vector3 center = lightViewBox.Center();
+        Ray extrusionRay(center, center);
+
+        float extrusionDistance = shadowCamera->GetFarClip();
+        float originalDistance = Clamp(center.Length(), M_EPSILON, extrusionDistance);
+
+        // Because of the perspective, the bounding box must also grow when it is extruded to the distance
+        float sizeFactor = extrusionDistance / originalDistance;
+
+        // Calculate the endpoint box and merge it to the original. Because it's axis-aligned, it will be larger
+        // than necessary, so the test will be conservative
+        Vector3 newCenter = extrusionDistance * extrusionRay.direction_;
+        Vector3 newHalfSize = lightViewBox.Size() * sizeFactor * 0.5f;
+        BoundingBox extrudedBox(newCenter - newHalfSize, newCenter + newHalfSize);
+        lightViewBox.Merge(extrudedBox);
+    }
+}
+
+/// Test bounding boxes stored as separate min and max coordinate arrays against a frustum, four at a time. Hide the ones
+/// marked for testing that are outside. The stride must be a multiple of four.
+static void TestShadowCasterBoxes(const Frustum& frustum, const float* boxes, unsigned stride, unsigned char* states)
+{
+    const float* minX = boxes;
+    const float* minY = boxes + stride;
+    const float* minZ = boxes + stride * 2;
+    const float* maxX = boxes + stride * 3;
+    const float* maxY = boxes + stride * 4;
+    const float* maxZ = boxes + stride * 5;
+
+#ifdef DRY_SSE
+    const __m128 half = _mm_set1_ps(0.5f);
+
+    for (unsigned i{ 0 }; i < stride; i += 4)
+    {
+        const __m128 boxMinX = _mm_loadu_ps(minX + i);
+        const __m128 boxMinY = _mm_loadu_ps(minY + i);
+        const __m128 boxMinZ = _mm_loadu_ps(minZ + i);
+        const __m128 boxMaxX = _mm_loadu_ps(maxX + i);
+        const __m128 boxMaxY = _mm_loadu_ps(maxY + i);
+        const __m128 boxMaxZ = _mm_loadu_ps(maxZ + i);
+        const __m128 centerX = _mm_mul_ps(_mm_add_ps(boxMinX, boxMaxX), half);
+        const __m128 centerY = _mm_mul_ps(_mm_add_ps(boxMinY, boxMaxY), half);
+        const __m128 centerZ = _mm_mul_ps(_mm_add_ps(boxMinZ, boxMaxZ), half);
+        const __m128 edgeX = _mm_sub_ps(centerX, boxMinX);
+        const __m128 edgeY = _mm_sub_ps(centerY, boxMinY);
+        const __m128 edgeZ = _mm_sub_ps(centerZ, boxMinZ);
+        __m128 outside = _mm_setzero_ps();
+
+        for (const auto& plane : frustum.planes_)
+        {
+            const __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.normal_.x_), centerX),
+                _mm_mul_ps(_mm_set1_ps(plane.normal_.y_), centerY)), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.normal_.z_),
+                centerZ), _mm_set1_ps(plane.d_)));
+            const __m128 absDist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.absNormal_.x_), edgeX),
+                _mm_mul_ps(_mm_set1_ps(plane.absNormal_.y_), edgeY)), _mm_mul_ps(_mm_set1_ps(plane.absNormal_.z_), edgeZ));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(dist, absDist), _mm_setzero_ps()));
+        }
+
+        int mask = _mm_movemask_ps(outside);
+        for (unsigned j{ i }; mask; ++j, mask >>= 1)
+        {
+            if ((mask & 1) && states[j] == SHADOW_CASTER_TEST)
+                states[j] = SHADOW_CASTER_HIDDEN;
+        }
+    }
+#else
+    for (unsigned i{ 0 }; i < stride; ++i)
+    {
+        if (states[i] != SHADOW_CASTER_TEST)
+            continue;
+
+        BoundingBox box(Vector3(minX[i], minY[i], minZ[i]), Vector3(maxX[i], maxY[i], maxZ[i]));
+        if (frustum.IsInsideFast(box) == OUTSIDE)
+            states[i] = SHADOW_CASTER_HIDDEN;
+    }
+#endif
+}
+
+/// Combine floating point values into a hash.
+static void CombineFloatHash(unsigned& hash, const float* data, unsigned count)
+{
+    for (unsigned i{ 0 }; i < count; ++i)
+    {
+        unsigned bits;
+        memcpy(&bits, &data[i], sizeof bits);
+        CombineHash(hash, bits);
+    }
+}
+
+/// Parameters for recording batch queues in worker threads.
+struct RecordBatchQueueParams
+{
+    /// Locked instancing buffer data, or null if not instancing.
+    void* instancingData_;
+    /// Instancing buffer vertex size.
+    unsigned instancingStride_;
+    /// Whether to combine batch groups into multi-draw indirect calls.
+    bool combineGroups_;
+};
+
+void RecordBatchQueueWork(const WorkItem* item, unsigned threadIndex)
+{
+    const RecordBatchQueueParams& params = *(reinterpret_cast<RecordBatchQueueParams*>(item->aux_));
+    auto* queue = reinterpret_cast<BatchQueue*>(item->start_);
+
+    if (params.instancingData_)
+        queue->FillInstancingData(params.instancingData_, params.instancingStride_);
+    queue->Record(params.combineGroups_);
 }
 
 StringHash ParseTextureTypeXml(ResourceCache* cache, const String& filename);
@@ -343,6 +492,8 @@ bool View::Define(RenderSurface* renderTarget, Viewport* viewport)
             deferred_ = sourceView_->deferred_;
             deferredAmbient_ = sourceView_->deferredAmbient_;
             useLitBase_ = sourceView_->useLitBase_;
+            clusteredLighting_ = sourceView_->clusteredLighting_;
+            lightClusters_ = sourceView_->lightClusters_;
             hasScenePasses_ = sourceView_->hasScenePasses_;
             noStencil_ = sourceView_->noStencil_;
             lightVolumeCommand_ = sourceView_->lightVolumeCommand_;
@@ -368,6 +519,7 @@ bool View::Define(RenderSurface* renderTarget, Viewport* viewport)
     deferred_ = false;
     deferredAmbient_ = false;
     useLitBase_ = false;
+    clusteredLighting_ = false;
     hasScenePasses_ = false;
     noStencil_ = false;
     lightVolumeCommand_ = nullptr;
@@ -414,6 +566,10 @@ bool View::Define(RenderSurface* renderTarget, Viewport* viewport)
             info.allowInstancing_ = command.sortMode_ != SORT_BACKTOFRONT;
             info.markToStencil_ = !noStencil_ && command.markToStencil_;
             info.vertexLights_ = command.vertexLights_;
+            // Clustered lighting reads the light data with integer texture fetches
+            info.clusteredLights_ = command.clusteredLights_ && Graphics::GetGL3Support();
+            if (info.clusteredLights_)
+                clusteredLighting_ = true;
 
             // Check scenepass metadata for defining custom passes which interact with lighting
             if (!command.metadata_.IsEmpty())
@@ -436,7 +592,7 @@ bool View::Define(RenderSurface* renderTarget, Viewport* viewport)
             if (j == batchQueues_.End())
                 j = batchQueues_.Insert(Pair<unsigned, BatchQueue>(info.passIndex_, BatchQueue()));
             info.batchQueue_ = &j->second_;
-            SetQueueShaderDefines(*info.batchQueue_, command);
+            SetQueueShaderDefines(*info.batchQueue_, command, info.clusteredLights_);
 
             scenePasses_.Push(info);
         }
@@ -493,9 +649,20 @@ bool View::Define(RenderSurface* renderTarget, Viewport* viewport)
         }
     }
 
+    if (clusteredLighting_)
+    {
+        // The lit base pass would miss the clustered lights, which are added in the ambient pass
+        useLitBase_ = false;
+        if (!lightClusters_)
+            lightClusters_ = new LightClusters(context_);
+    }
+
     drawShadows_ = renderer_->GetDrawShadows();
     materialQuality_ = renderer_->GetMaterialQuality();
     maxOccluderTriangles_ = renderer_->GetMaxOccluderTriangles();
+    multiDrawIndirect_ = renderer_->UseMultiDrawIndirect();
+    skinInstancing_ = renderer_->UseSkinInstancing();
+    clusterCulling_ = renderer_->GetClusterCulling();
     minInstances_ = renderer_->GetMinInstances();
 
     // Set possible quality overrides from the camera
@@ -580,8 +747,7 @@ void View::Render()
     // Forget parameter sources from the previous view
     graphics_->ClearParameterSources();
 
-    if (renderer_->GetDynamicInstancing() && graphics_->GetInstancingSupport())
-        PrepareInstancingBuffer();
+    RecordBatchQueues();
 
     // It is possible, though not recommended, that the same camera is used for multiple main views. Set automatic aspect ratio
     // to ensure correct projection will be used
@@ -748,6 +914,9 @@ void View::SetCameraShaderParameters(Camera* camera)
 
     graphics_->SetShaderParameter(VSP_VIEWPROJ, projection * camera->GetView());
 
+    if (clusteredLighting_)
+        graphics_->SetShaderParameter(PSP_CLUSTERPARAMS, lightClusters_->GetClusterParams());
+
     // If in a scene pass and the command defines shader parameters, set them now
     if (passCommand_)
         SetCommandShaderParameters(*passCommand_);
@@ -964,10 +1133,24 @@ void View::GetBatches()
 
     nonThreadedGeometries_.Clear();
     threadedGeometries_.Clear();
+    clusterGeometries_.Clear();
+    clusterIndices_.Clear();
+    numClusterGeometries_ = 0;
 
     ProcessLights();
+    if (clusteredLighting_)
+    {
+        // Assign the lights to the clusters as seen by the camera that renders, with the projection flipped like it will
+        // be when rendering to a texture on OpenGL, so that the clusters match the shaders' screen positions
+        bool flipVertical = false;
+#ifdef DRY_OPENGL
+        flipVertical = renderTarget_ != nullptr;
+#endif
+        lightClusters_->Update(camera_, clusteredLights_, flipVertical);
+    }
     GetLightBatches();
     GetBaseBatches();
+    UpdateClusterIndexBuffer();
 }
 
 void View::ProcessLights()
@@ -976,7 +1159,16 @@ void View::ProcessLights()
     DRY_PROFILE(ProcessLights);
 
     auto* queue = GetSubsystem<WorkQueue>();
+
+    // Lights applied through the clusters still get lit geometry queries, for the drawables whose passes can not add them
+    clusteredLights_.Clear();
     lightQueryResults_.Resize(lights_.Size());
+    for (unsigned i{ 0 }; i < lights_.Size(); ++i)
+    {
+        lightQueryResults_[i].light_ = lights_[i];
+        if (clusteredLighting_ && IsClusteredLight(lights_[i]))
+            clusteredLights_.Push(lights_[i]);
+    }
 
     for (unsigned i{ 0 }; i < lightQueryResults_.Size(); ++i)
     {
@@ -986,7 +1178,6 @@ void View::ProcessLights()
         item->aux_ = this;
 
         LightQueryResult& query = lightQueryResults_[i];
-        query.light_ = lights_[i];
 
         item->start_ = &query;
         queue->AddWorkItem(item);
@@ -994,6 +1185,75 @@ void View::ProcessLights()
 
     // Ensure all lights have been processed before proceeding
     queue->Complete(M_MAX_UNSIGNED);
+
+    // Check the shadow caster candidates of each shadowed light against all its splits at once, in ranges
+    unsigned numRanges = 0;
+    for (unsigned i{ 0 }; i < lightQueryResults_.Size(); ++i)
+    {
+        const LightQueryResult& query = lightQueryResults_[i];
+        if (query.numSplits_)
+            numRanges += (query.shadowCasterCandidates_.Size() + SHADOW_CASTERS_PER_WORK_ITEM - 1) / SHADOW_CASTERS_PER_WORK_ITEM;
+    }
+
+    if (shadowCasterRanges_.Size() < numRanges)
+        shadowCasterRanges_.Resize(numRanges);
+
+    for (unsigned i{ 0 }, j{ 0 }; i < lightQueryResults_.Size(); ++i)
+    {
+        LightQueryResult& query = lightQueryResults_[i];
+        if (!query.numSplits_)
+            continue;
+
+        for (unsigned start{ 0 }; start < query.shadowCasterCandidates_.Size(); start += SHADOW_CASTERS_PER_WORK_ITEM)
+        {
+            ShadowCasterRange& range = shadowCasterRanges_[j++];
+            range.query_ = &query;
+            range.start_ = start;
+            range.end_ = Min(start + SHADOW_CASTERS_PER_WORK_ITEM, query.shadowCasterCandidates_.Size());
+
+            SharedPtr<WorkItem> item = queue->GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = ProcessShadowCastersWork;
+            item->aux_ = this;
+            item->start_ = &range;
+            queue->AddWorkItem(item);
+        }
+    }
+
+    queue->Complete(M_MAX_UNSIGNED);
+
+    // Gather the shadow casters of each light in split order. The ranges are in the same order as the lights
+    for (unsigned i{ 0 }, j{ 0 }; i < lightQueryResults_.Size(); ++i)
+    {
+        LightQueryResult& query = lightQueryResults_[i];
+        if (!query.numSplits_)
+            continue;
+
+        const unsigned firstRange = j;
+        while (j < numRanges && shadowCasterRanges_[j].query_ == &query)
+            ++j;
+
+        query.shadowCasters_.Clear();
+        for (unsigned split{ 0 }; split < query.numSplits_; ++split)
+        {
+            query.shadowCasterBegin_[split] = query.shadowCasters_.Size();
+            query.shadowCasterBox_[split].Clear();
+
+            for (unsigned k{ firstRange }; k < j; ++k)
+            {
+                const ShadowCasterRange& range = shadowCasterRanges_[k];
+                query.shadowCasters_.Push(range.casters_[split]);
+                query.shadowCasterBox_[split].Merge(range.casterBox_[split]);
+            }
+
+            query.shadowCasterEnd_[split] = query.shadowCasters_.Size();
+        }
+
+        // If no shadow casters, the light can be rendered unshadowed. At this point we have not allocated a shadow map yet,
+        // so the only cost has been the shadow camera setup & queries
+        if (query.shadowCasters_.IsEmpty())
+            query.numSplits_ = 0;
+    }
 }
 
 void View::GetLightBatches()
@@ -1004,6 +1264,25 @@ void View::GetLightBatches()
     {
         DRY_PROFILE(GetLightBatches);
 
+        // Clustered lights need forward light batches only for the drawables that can not add them in the scene passes
+        if (!clusteredLights_.IsEmpty())
+        {
+            for (Vector<LightQueryResult>::Iterator i = lightQueryResults_.Begin(); i != lightQueryResults_.End(); ++i)
+            {
+                if (!IsClusteredLight(i->light_))
+                    continue;
+
+                PODVector<Drawable*>& litGeometries = i->litGeometries_;
+                for (unsigned j{ 0 }; j < litGeometries.Size();)
+                {
+                    if (NeedsClusteredForwardLights(litGeometries[j]))
+                        ++j;
+                    else
+                        litGeometries.EraseSwap(j);
+                }
+            }
+        }
+
         // Preallocate light queues: per-pixel lights which have lit geometries
         unsigned numLightQueues = 0;
         unsigned usedLightQueues = 0;
@@ -1038,6 +1317,7 @@ void View::GetLightBatches()
                 lightQueue.light_ = light;
                 lightQueue.negative_ = light->IsNegative();
                 lightQueue.shadowMap_ = nullptr;
+                lightQueue.shadowTile_ = nullptr;
                 lightQueue.litBaseBatches_.Clear(maxSortedInstances);
                 lightQueue.litBatches_.Clear(maxSortedInstances);
                 if (forwardLightsCommand_)
@@ -1052,10 +1332,15 @@ void View::GetLightBatches()
                 }
                 lightQueue.volumeBatches_.Clear();
 
-                // Allocate shadow map now
+                // Allocate shadow map now, preferring a tile of the shadow atlas
                 if (shadowSplits > 0)
                 {
-                    lightQueue.shadowMap_ = renderer_->GetShadowMap(light, cullCamera_, (unsigned)viewSize_.x_, (unsigned)viewSize_.y_);
+                    lightQueue.shadowTile_ = renderer_->GetShadowAtlasTile(light, cullCamera_, (unsigned)viewSize_.x_,
+                        (unsigned)viewSize_.y_);
+                    if (lightQueue.shadowTile_)
+                        lightQueue.shadowMap_ = renderer_->GetShadowAtlas()->GetTexture();
+                    else
+                        lightQueue.shadowMap_ = renderer_->GetShadowMap(light, cullCamera_, (unsigned)viewSize_.x_, (unsigned)viewSize_.y_);
                     // If did not manage to get a shadow map, convert the light to unshadowed
                     if (!lightQueue.shadowMap_)
                         shadowSplits = 0;
@@ -1071,11 +1356,26 @@ void View::GetLightBatches()
                     shadowQueue.nearSplit_ = query.shadowNearSplits_[j];
                     shadowQueue.farSplit_ = query.shadowFarSplits_[j];
                     shadowQueue.shadowBatches_.Clear(maxSortedInstances);
+                    shadowQueue.dynamicShadowBatches_.Clear(maxSortedInstances);
 
                     // Setup the shadow split viewport and finalize shadow camera parameters
-                    shadowQueue.shadowViewport_ = GetShadowMapViewport(light, j, lightQueue.shadowMap_);
+                    const IntRect shadowArea = lightQueue.shadowTile_ ? lightQueue.shadowTile_->rect_ :
+                        IntRect(0, 0, lightQueue.shadowMap_->GetWidth(), lightQueue.shadowMap_->GetHeight());
+                    shadowQueue.shadowViewport_ = GetShadowMapViewport(light, j, shadowArea);
                     FinalizeShadowCamera(shadowCamera, light, shadowQueue.shadowViewport_, query.shadowCasterBox_[j]);
 
+                    // In a shadow atlas tile the static shadow casters are kept across frames. Hash them along with the
+                    // shadow camera to know when they need to be redrawn
+                    unsigned staticHash = 0;
+                    if (lightQueue.shadowTile_)
+                    {
+                        const BiasParameters& bias = light->GetShadowBias();
+                        CombineFloatHash(staticHash, shadowCamera->GetView().Data(), 12);
+                        CombineFloatHash(staticHash, shadowCamera->GetProjection().Data(), 16);
+                        CombineFloatHash(staticHash, &bias.constantBias_, 1);
+                        CombineFloatHash(staticHash, &bias.slopeScaledBias_, 1);
+                    }
+
                     // Loop through shadow casters
                     for (PODVector<Drawable*>::ConstIterator k = query.shadowCasters_.Begin() + query.shadowCasterBegin_[j];
                          k < query.shadowCasters_.Begin() + query.shadowCasterEnd_[j]; ++k)
@@ -1093,6 +1393,10 @@ void View::GetLightBatches()
                         }
 
                         const Vector<SourceBatch>& batches = drawable->GetBatches();
+                        // Drawables that do not update their geometry count as static casters
+                        const bool isStatic = drawable->GetUpdateGeometryType() == UPDATE_NONE;
+                        BatchQueue& casterQueue = !lightQueue.shadowTile_ || isStatic ? shadowQueue.shadowBatches_ :
+                            shadowQueue.dynamicShadowBatches_;
 
                         for (unsigned l{ 0 }; l < batches.Size(); ++l)
                         {
@@ -1107,13 +1411,37 @@ void View::GetLightBatches()
                             if (!pass)
                                 continue;
 
+                            if (lightQueue.shadowTile_ && isStatic)
+                            {
+                                // Hash the geometry data versions so that rewritten geometry invalidates the cache, and all
+                                // transforms so that moved, added or removed instances do
+                                Geometry* geometry = srcBatch.geometry_;
+                                CombineHash(staticHash, MakeHash(geometry));
+                                for (unsigned m{ 0 }; m < geometry->GetNumVertexBuffers(); ++m)
+                                {
+                                    VertexBuffer* buffer = geometry->GetVertexBuffer(m);
+                                    CombineHash(staticHash, buffer ? buffer->GetDataVersion() : 0u);
+                                }
+                                IndexBuffer* indexBuffer = geometry->GetIndexBuffer();
+                                CombineHash(staticHash, indexBuffer ? indexBuffer->GetDataVersion() : 0u);
+                                CombineHash(staticHash, geometry->GetIndexStart());
+                                CombineHash(staticHash, geometry->GetIndexCount());
+                                CombineHash(staticHash, MakeHash(srcBatch.material_.Get()));
+                                CombineHash(staticHash, srcBatch.numWorldTransforms_);
+                                for (unsigned m{ 0 }; m < srcBatch.numWorldTransforms_; ++m)
+                                    CombineFloatHash(staticHash, srcBatch.worldTransform_[m].Data(), 12);
+                            }
+
                             Batch destBatch(srcBatch);
                             destBatch.pass_ = pass;
                             destBatch.zone_ = nullptr;
 
-                            AddBatchToQueue(shadowQueue.shadowBatches_, destBatch, tech);
+                            AddBatchToQueue(casterQueue, destBatch, tech, true, true, shadowCamera);
                         }
                     }
+
+                    // Zero is reserved for a split that has not been drawn
+                    shadowQueue.staticHash_ = Max(staticHash, 1u);
                 }
 
                 // Process lit geometries
@@ -1189,6 +1517,8 @@ void View::GetBaseBatches()
 {
     DRY_PROFILE(GetBaseBatches);
 
+    const bool streaming = GetSubsystem<ResourceCache>()->IsStreamingEnabled();
+
     for (PODVector<Drawable*>::ConstIterator i = geometries_.Begin(); i != geometries_.End(); ++i)
     {
         Drawable* drawable = *i;
@@ -1201,6 +1531,15 @@ void View::GetBaseBatches()
         const Vector<SourceBatch>& batches = drawable->GetBatches();
         bool vertexLightsProcessed = false;
 
+        // Estimate the drawable's size on screen in pixels to limit the texture detail streamed in for it
+        float screenSize = 0.f;
+        if (streaming)
+        {
+            const float viewExtent = 2.f * cullCamera_->GetHalfViewSize() *
+                (cullCamera_->IsOrthographic() ? 1.f : Max(drawable->GetDistance(), M_EPSILON));
+            screenSize = drawable->GetWorldBoundingBox().Size().Length() / viewExtent * viewSize_.y_;
+        }
+
         for (unsigned j{ 0 }; j < batches.Size(); ++j)
         {
             const SourceBatch& srcBatch = batches[j];
@@ -1214,6 +1553,14 @@ void View::GetBaseBatches()
             if (!srcBatch.geometry_ || !srcBatch.numWorldTransforms_ || !tech)
                 continue;
 
+            Geometry* geometry = GetClusterCulledGeometry(drawable, j, srcBatch);
+            if (!geometry)
+                continue;
+
+            // Feed the view distance and screen size to resource streaming
+            if (streaming && srcBatch.material_)
+                srcBatch.material_->UpdateTextureStreaming(srcBatch.distance_, screenSize);
+
             // Check each of the scene passes
             for (unsigned k{ 0 }; k < scenePasses_.Size(); ++k)
             {
@@ -1227,6 +1574,7 @@ void View::GetBaseBatches()
                     continue;
 
                 Batch destBatch(srcBatch);
+                destBatch.geometry_ = geometry;
                 destBatch.pass_ = pass;
                 destBatch.zone_ = GetZone(drawable);
                 destBatch.isBase_ = true;
@@ -1254,6 +1602,7 @@ void View::GetBaseBatches()
                             i = vertexLightQueues_.Insert(MakePair(hash, LightBatchQueue()));
                             i->second_.light_ = nullptr;
                             i->second_.shadowMap_ = nullptr;
+                            i->second_.shadowTile_ = nullptr;
                             i->second_.vertexLights_ = drawableVertexLights;
                         }
 
@@ -1273,6 +1622,117 @@ void View::GetBaseBatches()
     }
 }
 
+Geometry* View::GetClusterCulledGeometry(Drawable* drawable, unsigned batchIndex, const SourceBatch& batch)
+{
+    if (!clusterCulling_ || batch.geometryType_ != GEOM_STATIC || batch.numWorldTransforms_ != 1 || !batch.worldTransform_ ||
+        !drawable->IsInstanceOf<StaticModel>())
+        return batch.geometry_;
+
+    Model* model = static_cast<StaticModel*>(drawable)->GetModel();
+    if (!model || model->GetGeometry(batchIndex, 0) != batch.geometry_)
+        return batch.geometry_;
+
+    const PODVector<Meshlet>& meshlets = model->GetGeometryMeshlets(batchIndex);
+    IndexBuffer* indexBuffer = batch.geometry_->GetIndexBuffer();
+    if (meshlets.Size() < 2 || !indexBuffer || !indexBuffer->GetShadowData())
+        return batch.geometry_;
+
+    // Lit batches of the same drawable reuse the result of its first batch this frame
+    const Pair<Drawable*, unsigned> key(drawable, batchIndex);
+    HashMap<Pair<Drawable*, unsigned>, Geometry*>::ConstIterator i = clusterGeometries_.Find(key);
+    if (i != clusterGeometries_.End())
+        return i->second_;
+
+    const Matrix3x4& transform = *batch.worldTransform_;
+    const Matrix3 rotationScale = transform.ToMatrix3();
+    const Vector3 scale = transform.Scale();
+    const float maxScale = Max(Max(scale.x_, scale.y_), scale.z_);
+    const Frustum& frustum = cullCamera_->GetFrustum();
+    const Vector3 cameraPosition = cullCamera_->GetNode()->GetWorldPosition();
+
+    // Normal cones only hold for back face culled materials under uniform scale seen through a perspective camera
+    const bool coneCulling = batch.material_ && batch.material_->GetCullMode() == CULL_CCW && !cullCamera_->GetReverseCulling() &&
+        !cullCamera_->IsOrthographic() && Equals(scale.x_, scale.y_) && Equals(scale.y_, scale.z_);
+
+    const unsigned indexSize = indexBuffer->GetIndexSize();
+    const unsigned char* indexData = indexBuffer->GetShadowData();
+    const unsigned start = clusterIndices_.Size();
+    unsigned numVisible{ 0 };
+
+    for (unsigned j{ 0 }; j < meshlets.Size(); ++j)
+    {
+        const Meshlet& meshlet = meshlets[j];
+        if (meshlet.indexStart_ + meshlet.indexCount_ > indexBuffer->GetIndexCount())
+            return batch.geometry_;
+
+        const Sphere sphere(transform * meshlet.center_, meshlet.radius_ * maxScale);
+        if (frustum.IsInsideFast(sphere) == OUTSIDE)
+            continue;
+
+        if (coneCulling)
+        {
+            const Vector3 axis = (rotationScale * meshlet.coneAxis_).Normalized();
+            const Vector3 toCenter = sphere.center_ - cameraPosition;
+            if (toCenter.DotProduct(axis) >= meshlet.coneCutoff_ * toCenter.Length() + sphere.radius_)
+                continue;
+        }
+
+        if (occlusionBuffer_ && !occlusionBuffer_->IsVisible(BoundingBox(sphere)))
+            continue;
+
+        const unsigned char* source = indexData + meshlet.indexStart_ * indexSize;
+        for (unsigned k{ 0 }; k < meshlet.indexCount_; ++k)
+        {
+            if (indexSize == sizeof(unsigned))
+                clusterIndices_.Push(reinterpret_cast<const unsigned*>(source)[k]);
+            else
+                clusterIndices_.Push(reinterpret_cast<const unsigned short*>(source)[k]);
+        }
+
+        ++numVisible;
+    }
+
+    Geometry* geometry = nullptr;
+    if (numVisible == meshlets.Size())
+    {
+        clusterIndices_.Resize(start);
+        geometry = batch.geometry_;
+    }
+    else if (numVisible)
+    {
+        if (numClusterGeometries_ >= clusterGeometryPool_.Size())
+            clusterGeometryPool_.Push(SharedPtr<Geometry>(new Geometry(context_)));
+
+        if (!clusterIndexBuffer_)
+            clusterIndexBuffer_ = new IndexBuffer(context_);
+
+        Geometry* source = batch.geometry_;
+        geometry = clusterGeometryPool_[numClusterGeometries_++];
+        geometry->SetNumVertexBuffers(source->GetNumVertexBuffers());
+        for (unsigned j{ 0 }; j < source->GetNumVertexBuffers(); ++j)
+            geometry->SetVertexBuffer(j, source->GetVertexBuffer(j));
+        geometry->SetIndexBuffer(clusterIndexBuffer_);
+        geometry->SetDrawRange(TRIANGLE_LIST, start, clusterIndices_.Size() - start, source->GetVertexStart(),
+            source->GetVertexCount(), false);
+        geometry->SetLodDistance(source->GetLodDistance());
+    }
+
+    clusterGeometries_[key] = geometry;
+    return geometry;
+}
+
+void View::UpdateClusterIndexBuffer()
+{
+    if (clusterIndices_.IsEmpty() || !clusterIndexBuffer_)
+        return;
+
+    if (clusterIndexBuffer_->GetIndexCount() < clusterIndices_.Size() &&
+        !clusterIndexBuffer_->SetSize(NextPowerOfTwo(clusterIndices_.Size()), true, true))
+        return;
+
+    clusterIndexBuffer_->SetDataRange(&clusterIndices_[0], 0, clusterIndices_.Size(), true);
+}
+
 void View::UpdateGeometries()
 {
     // Update geometries in the source view if necessary (prepare order may differ from render order)
@@ -1381,6 +1841,7 @@ void View::GetLitBatches(Drawable* drawable, LightBatchQueue& lightQueue, BatchQ
     bool allowLitBase =
         useLitBase_ && !lightQueue.negative_ && light == drawable->GetFirstLight() && drawable->GetVertexLights().IsEmpty() &&
         !zone->GetAmbientGradient();
+    const bool clustered = clusteredLighting_ && IsClusteredLight(light);
 
     for (unsigned i{ 0 }; i < batches.Size(); ++i)
     {
@@ -1394,7 +1855,16 @@ void View::GetLitBatches(Drawable* drawable, LightBatchQueue& lightQueue, BatchQ
         if (gBufferPassIndex_ != M_MAX_UNSIGNED && tech->HasPass(gBufferPassIndex_))
             continue;
 
+        // Nor for clustered lights the scene pass already adds
+        if (clustered && HasClusteredPass(tech))
+            continue;
+
+        Geometry* geometry = GetClusterCulledGeometry(drawable, i, srcBatch);
+        if (!geometry)
+            continue;
+
         Batch destBatch(srcBatch);
+        destBatch.geometry_ = geometry;
         bool isLitAlpha = false;
 
         // Check for lit base pass. Because it uses the replace blend mode, it must be ensured to be the first light
@@ -1447,14 +1917,14 @@ void View::ExecuteRenderPathCommands()
 {
     View* actualView = sourceView_ ? sourceView_ : this;
 
-    // If not reusing shadowmaps, render all of them first
-    if (!renderer_->GetReuseShadowMaps() && renderer_->GetDrawShadows() && !actualView->lightQueues_.IsEmpty())
+    // If not reusing shadowmaps, render all of them first. Shadow atlas tiles are never reused
+    if (renderer_->GetDrawShadows() && !actualView->lightQueues_.IsEmpty())
     {
         DRY_PROFILE(RenderShadowMaps);
 
         for (Vector<LightBatchQueue>::Iterator i = actualView->lightQueues_.Begin(); i != actualView->lightQueues_.End(); ++i)
         {
-            if (NeedRenderShadowMap(*i))
+            if ((!renderer_->GetReuseShadowMaps() || i->shadowTile_) && NeedRenderShadowMap(*i))
                 RenderShadowMap(*i);
         }
     }
@@ -1620,7 +2090,7 @@ void View::ExecuteRenderPathCommands()
                     for (Vector<LightBatchQueue>::Iterator i = actualView->lightQueues_.Begin(); i != actualView->lightQueues_.End(); ++i)
                     {
                         // If reusing shadowmaps, render each of them before the lit batches
-                        if (renderer_->GetReuseShadowMaps() && NeedRenderShadowMap(*i))
+                        if (renderer_->GetReuseShadowMaps() && !i->shadowTile_ && NeedRenderShadowMap(*i))
                         {
                             RenderShadowMap(*i);
                             SetRenderTargets(command);
@@ -1666,7 +2136,7 @@ void View::ExecuteRenderPathCommands()
                     for (Vector<LightBatchQueue>::Iterator i = actualView->lightQueues_.Begin(); i != actualView->lightQueues_.End(); ++i)
                     {
                         // If reusing shadowmaps, render each of them before the lit batches
-                        if (renderer_->GetReuseShadowMaps() && NeedRenderShadowMap(*i))
+                        if (renderer_->GetReuseShadowMaps() && !i->shadowTile_ && NeedRenderShadowMap(*i))
                         {
                             RenderShadowMap(*i);
                             SetRenderTargets(command);
@@ -2337,86 +2807,106 @@ void View::ProcessLight(LightQueryResult& query, unsigned threadIndex)
     // Determine number of shadow cameras and setup their initial positions
     SetupShadowCameras(query);
 
-    // Process each split for shadow casters
+    // Prepare the splits for the shadow caster checks, which happen once all lights have been processed. Transform the
+    // scene frustum into each shadow camera's view space. For point & spot lights, we can use the whole scene frustum. For
+    // directional lights, use the intersection of the scene frustum and the split frustum, so that shadow casters do not
+    // get rendered into unnecessary splits
     query.shadowCasters_.Clear();
+    query.shadowCasterCandidates_.Clear();
+    BoundingBox candidateBox;
+    bool hasActiveSplits = false;
+
     for (unsigned i{ 0 }; i < query.numSplits_; ++i)
     {
         Camera* shadowCamera = query.shadowCameras_[i];
         const Frustum& shadowCameraFrustum = shadowCamera->GetFrustum();
-        query.shadowCasterBegin_[i] = query.shadowCasterEnd_[i] = query.shadowCasters_.Size();
+        query.shadowCasterBegin_[i] = query.shadowCasterEnd_[i] = 0;
+        query.shadowCasterBox_[i].Clear();
+        query.shadowSplitActive_[i] = false;
 
         // For point light check that the face is visible: if not, can skip the split
         if (type == LIGHT_POINT && frustum.IsInsideFast(BoundingBox(shadowCameraFrustum)) == OUTSIDE)
             continue;
 
         // For directional light check that the split is inside the visible scene: if not, can skip the split
+        if (type == LIGHT_DIRECTIONAL && (minZ_ > query.shadowFarSplits_[i] || maxZ_ < query.shadowNearSplits_[i]))
+            continue;
+
+        const Matrix3x4& lightView = shadowCamera->GetView();
+        Frustum& lightViewFrustum = query.shadowCasterFrustums_[i];
+        if (type != LIGHT_DIRECTIONAL)
+            lightViewFrustum = cullCamera_->GetSplitFrustum(minZ_, maxZ_).Transformed(lightView);
+        else
+            lightViewFrustum = cullCamera_->GetSplitFrustum(Max(minZ_, query.shadowNearSplits_[i]),
+                Min(maxZ_, query.shadowFarSplits_[i])).Transformed(lightView);
+
+        // Check for degenerate split frustum: in that case there is no need to get shadow casters
+        if (lightViewFrustum.vertices_[0] == lightViewFrustum.vertices_[4])
+            continue;
+
+        query.shadowCasterFrustumFarZ_[i] = BoundingBox(lightViewFrustum).max_.z_;
+        // The camera computes its projection on demand, which is not safe from the shadow caster work items
+        query.shadowCameraProjections_[i] = shadowCamera->GetProjection();
+        query.shadowSplitActive_[i] = true;
+        hasActiveSplits = true;
+
+        // The cascades of a directional light overlap: gather their candidates with one query, in the first split's view
+        // space
         if (type == LIGHT_DIRECTIONAL)
         {
-            if (minZ_ > query.shadowFarSplits_[i])
-                continue;
-            if (maxZ_ < query.shadowNearSplits_[i])
-                continue;
-
-            // Reuse lit geometry query for all except directional lights
-            ShadowCasterOctreeQuery query(tempDrawables, shadowCameraFrustum, DRAWABLE_GEOMETRY, cullCamera_->GetViewMask());
-            octree_->GetDrawables(query);
+            const Matrix3x4& firstLightView = query.shadowCameras_[0]->GetView();
+            for (const Vector3& vertex : shadowCameraFrustum.vertices_)
+                candidateBox.Merge(firstLightView * vertex);
         }
-
-        // Check which shadow casters actually contribute to the shadowing
-        ProcessShadowCasters(query, tempDrawables, i);
     }
 
-    // If no shadow casters, the light can be rendered unshadowed. At this point we have not allocated a shadow map yet, so the
-    // only cost has been the shadow camera setup & queries
-    if (query.shadowCasters_.IsEmpty())
+    if (!hasActiveSplits)
+    {
         query.numSplits_ = 0;
+        return;
+    }
+
+    if (type == LIGHT_DIRECTIONAL)
+    {
+        Frustum candidateFrustum;
+        candidateFrustum.Define(candidateBox, query.shadowCameras_[0]->GetView().Inverse());
+        ShadowCasterOctreeQuery octreeQuery(query.shadowCasterCandidates_, candidateFrustum, DRAWABLE_GEOMETRY,
+            cullCamera_->GetViewMask());
+        octree_->GetDrawables(octreeQuery);
+    }
+    else
+    {
+        // Reuse the lit geometry query for point and spot lights. It may include non-shadowcasters
+        for (unsigned i{ 0 }; i < tempDrawables.Size(); ++i)
+        {
+            if (tempDrawables[i]->GetCastShadows())
+                query.shadowCasterCandidates_.Push(tempDrawables[i]);
+        }
+    }
 }
 
-void View::ProcessShadowCasters(LightQueryResult& query, const PODVector<Drawable*>& drawables, unsigned splitIndex)
+void View::ProcessShadowCasters(ShadowCasterRange& range)
 {
+    const LightQueryResult& query = *range.query_;
     Light* light = query.light_;
     unsigned lightMask = light->GetLightMask();
-
-    Camera* shadowCamera = query.shadowCameras_[splitIndex];
-    const Frustum& shadowCameraFrustum = shadowCamera->GetFrustum();
-    const Matrix3x4& lightView = shadowCamera->GetView();
-    const Matrix4& lightProj = shadowCamera->GetProjection();
     LightType type = light->GetLightType();
+    bool focused = type == LIGHT_SPOT && light->GetShadowFocus().focus_;
 
-    query.shadowCasterBox_[splitIndex].Clear();
-
-    // Transform scene frustum into shadow camera's view space for shadow caster visibility check. For point & spot lights,
-    // we can use the whole scene frustum. For directional lights, use the intersection of the scene frustum and the split
-    // frustum, so that shadow casters do not get rendered into unnecessary splits
-    Frustum lightViewFrustum;
-    if (type != LIGHT_DIRECTIONAL)
-        lightViewFrustum = cullCamera_->GetSplitFrustum(minZ_, maxZ_).Transformed(lightView);
-    else
-        lightViewFrustum = cullCamera_->GetSplitFrustum(Max(minZ_, query.shadowNearSplits_[splitIndex]),
-            Min(maxZ_, query.shadowFarSplits_[splitIndex])).Transformed(lightView);
-
-    BoundingBox lightViewFrustumBox(lightViewFrustum);
-
-    // Check for degenerate split frustum: in that case there is no need to get shadow casters
-    if (lightViewFrustum.vertices_[0] == lightViewFrustum.vertices_[4])
-        return;
-
-    BoundingBox lightViewBox;
-    BoundingBox lightProjBox;
+    for (unsigned i{ 0 }; i < query.numSplits_; ++i)
+    {
+        range.casters_[i].Clear();
+        range.casterBox_[i].Clear();
+    }
 
-    for (PODVector<Drawable*>::ConstIterator i = drawables.Begin(); i != drawables.End(); ++i)
+    // Do the checks that do not depend on the split once for all splits
+    range.candidates_.Clear();
+    for (unsigned i{ range.start_ }; i < range.end_; ++i)
     {
-        Drawable* drawable = *i;
-        // In case this is a point or spot light query result reused for optimization, we may have non-shadowcasters included.
-        // Check for that first
-        if (!drawable->GetCastShadows())
-            continue;
+        Drawable* drawable = query.shadowCasterCandidates_[i];
         // Check shadow mask
         if (!(GetShadowMask(drawable) & lightMask))
             continue;
-        // For point light, check that this drawable is inside the split shadow camera frustum
-        if (type == LIGHT_POINT && shadowCameraFrustum.IsInsideFast(drawable->GetWorldBoundingBox()) == OUTSIDE)
-            continue;
 
         // Check shadow distance
         // Note: as lights are processed threaded, it is possible a drawable's UpdateBatches() function is called several
@@ -2430,64 +2920,94 @@ void View::ProcessShadowCasters(LightQueryResult& query, const PODVector<Drawabl
         if (maxShadowDistance > 0.0f && drawable->GetDistance() > maxShadowDistance)
             continue;
 
-        // Project shadow caster bounding box to light view space for visibility check
-        lightViewBox = drawable->GetWorldBoundingBox().Transformed(lightView);
-
-        if (IsShadowCasterVisible(drawable, lightViewBox, shadowCamera, lightView, lightViewFrustum, lightViewFrustumBox))
-        {
-            // Merge to shadow caster bounding box (only needed for focused spot lights) and add to the list
-            if (type == LIGHT_SPOT && light->GetShadowFocus().focus_)
-            {
-                lightProjBox = lightViewBox.Projected(lightProj);
-                query.shadowCasterBox_[splitIndex].Merge(lightProjBox);
-            }
-            query.shadowCasters_.Push(drawable);
-        }
+        range.candidates_.Push(drawable);
     }
 
-    query.shadowCasterEnd_[splitIndex] = query.shadowCasters_.Size();
-}
+    const unsigned numCandidates = range.candidates_.Size();
+    if (!numCandidates)
+        return;
 
-bool View::IsShadowCasterVisible(Drawable* drawable, BoundingBox lightViewBox, Camera* shadowCamera, const Matrix3x4& lightView,
-    const Frustum& lightViewFrustum, const BoundingBox& lightViewFrustumBox)
-{
-    if (shadowCamera->IsOrthographic())
+    // Pad to a multiple of four for the batched frustum tests
+    const unsigned stride = (numCandidates + 3) & ~3u;
+    range.boxes_.Resize(stride * 6);
+    range.states_.Resize(stride);
+    float* boxes = &range.boxes_[0];
+    unsigned char* states = &range.states_[0];
+    for (unsigned i{ numCandidates }; i < stride; ++i)
     {
-        // Extrude the light space bounding box up to the far edge of the frustum's light space bounding box
-        lightViewBox.max_.z_ = Max(lightViewBox.max_.z_, lightViewFrustumBox.max_.z_);
-        return lightViewFrustum.IsInsideFast(lightViewBox) != OUTSIDE;
+        states[i] = SHADOW_CASTER_HIDDEN;
+        for (unsigned j{ 0 }; j < 6; ++j)
+            boxes[j * stride + i] = 0.0f;
     }
-    else
+
+    for (unsigned split{ 0 }; split < query.numSplits_; ++split)
     {
-        // If light is not directional, can do a simple check: if object is visible, its shadow is too
-        if (drawable->IsInView(frame_))
-            return true;
+        if (!query.shadowSplitActive_[split])
+            continue;
 
-        // For perspective lights, extrusion direction depends on the position of the shadow caster
-        Vector3 center = lightViewBox.Center();
-        Ray extrusionRay(center, center);
+        Camera* shadowCamera = query.shadowCameras_[split];
+        const Frustum& shadowCameraFrustum = shadowCamera->GetFrustum();
+        const Matrix3x4& lightView = shadowCamera->GetView();
+        const Matrix4& lightProjection = query.shadowCameraProjections_[split];
+        const float frustumFarZ = query.shadowCasterFrustumFarZ_[split];
+        const bool orthographic = shadowCamera->IsOrthographic();
 
-        float extrusionDistance = shadowCamera->GetFarClip();
-        float originalDistance = Clamp(center.Length(), M_EPSILON, extrusionDistance);
+        // Project shadow caster bounding boxes to light view space and extrude them for the visibility check
+        for (unsigned i{ 0 }; i < numCandidates; ++i)
+        {
+            Drawable* drawable = range.candidates_[i];
+            const BoundingBox& worldBox = drawable->GetWorldBoundingBox();
 
-        // Because of the perspective, the bounding box must also grow when it is extruded to the distance
-        float sizeFactor = extrusionDistance / originalDistance;
+            // For point light, check that this drawable is inside the split shadow camera frustum
+            if (type == LIGHT_POINT && shadowCameraFrustum.IsInsideFast(worldBox) == OUTSIDE)
+            {
+                states[i] = SHADOW_CASTER_HIDDEN;
+                continue;
+            }
+            // If light is not directional, can do a simple check: if object is visible, its shadow is too
+            if (!orthographic && drawable->IsInView(frame_))
+            {
+                states[i] = SHADOW_CASTER_VISIBLE;
+                continue;
+            }
 
-        // Calculate the endpoint box and merge it to the original. Because it's axis-aligned, it will be larger
-        // than necessary, so the test will be conservative
-        Vector3 newCenter = extrusionDistance * extrusionRay.direction_;
-        Vector3 newHalfSize = lightViewBox.Size() * sizeFactor * 0.5f;
-        BoundingBox extrudedBox(newCenter - newHalfSize, newCenter + newHalfSize);
-        lightViewBox.Merge(extrudedBox);
+            BoundingBox lightViewBox = worldBox.Transformed(lightView);
+            ExtrudeShadowCasterBox(lightViewBox, shadowCamera, frustumFarZ);
+            boxes[i] = lightViewBox.min_.x_;
+            boxes[stride + i] = lightViewBox.min_.y_;
+            boxes[stride * 2 + i] = lightViewBox.min_.z_;
+            boxes[stride * 3 + i] = lightViewBox.max_.x_;
+            boxes[stride * 4 + i] = lightViewBox.max_.y_;
+            boxes[stride * 5 + i] = lightViewBox.max_.z_;
+            states[i] = SHADOW_CASTER_TEST;
+        }
+
+        TestShadowCasterBoxes(query.shadowCasterFrustums_[split], boxes, stride, states);
+
+        PODVector<Drawable*>& casters = range.casters_[split];
+        for (unsigned i{ 0 }; i < numCandidates; ++i)
+        {
+            if (states[i] == SHADOW_CASTER_HIDDEN)
+                continue;
 
-        return lightViewFrustum.IsInsideFast(lightViewBox) != OUTSIDE;
+            Drawable* drawable = range.candidates_[i];
+            // Merge to shadow caster bounding box (only needed for focused spot lights) and add to the list
+            if (focused)
+            {
+                BoundingBox lightViewBox = drawable->GetWorldBoundingBox().Transformed(lightView);
+                BoundingBox lightProjBox(lightViewBox.Projected(lightProjection));
+                range.casterBox_[split].Merge(lightProjBox);
+            }
+            casters.Push(drawable);
+        }
     }
 }
 
-IntRect View::GetShadowMapViewport(Light* light, int splitIndex, Texture2D* shadowMap)
+IntRect View::GetShadowMapViewport(Light* light, int splitIndex, const IntRect& area)
 {
-    int width = shadowMap->GetWidth();
-    int height = shadowMap->GetHeight();
+    int width = area.Width();
+    int height = area.Height();
+    IntRect viewport;
 
     switch (light->GetLightType())
     {
@@ -2495,23 +3015,26 @@ IntRect View::GetShadowMapViewport(Light* light, int splitIndex, Texture2D* shad
         {
             int numSplits = light->GetNumShadowSplits();
             if (numSplits == 1)
-                return {0, 0, width, height};
+                viewport = {0, 0, width, height};
             else if (numSplits == 2)
-                return {splitIndex * width / 2, 0, (splitIndex + 1) * width / 2, height};
+                viewport = {splitIndex * width / 2, 0, (splitIndex + 1) * width / 2, height};
             else
-                return {(splitIndex & 1) * width / 2, (splitIndex / 2) * height / 2,
+                viewport = {(splitIndex & 1) * width / 2, (splitIndex / 2) * height / 2,
                     ((splitIndex & 1) + 1) * width / 2, (splitIndex / 2 + 1) * height / 2};
         }
+        break;
 
     case LIGHT_SPOT:
-        return {0, 0, width, height};
+        viewport = {0, 0, width, height};
+        break;
 
     case LIGHT_POINT:
-        return {(splitIndex & 1) * width / 2, (splitIndex / 2) * height / 3,
+        viewport = {(splitIndex & 1) * width / 2, (splitIndex / 2) * height / 3,
             ((splitIndex & 1) + 1) * width / 2, (splitIndex / 2 + 1) * height / 3};
+        break;
     }
 
-    return {};
+    return viewport + IntRect(area.left_, area.top_, area.left_, area.top_);
 }
 
 void View::SetupShadowCameras(LightQueryResult& query)
@@ -2874,10 +3397,51 @@ void View::CheckMaterialForAuxView(Material* material)
     material->MarkForAuxView(frame_.frameNumber_);
 }
 
-void View::SetQueueShaderDefines(BatchQueue& queue, const RenderPathCommand& command)
+bool View::IsClusteredLight(Light* light) const
+{
+    // Lights that need shadows, textures or light masks keep their forward light passes
+    if (light->GetLightType() == LIGHT_DIRECTIONAL || light->GetPerVertex() || light->GetRampTexture() ||
+        light->GetShapeTexture() || light->GetLightMask() != DEFAULT_LIGHTMASK)
+        return false;
+
+    return !drawShadows_ || !light->GetCastShadows() || light->GetShadowIntensity() >= 1.0f;
+}
+
+bool View::HasClusteredPass(Technique* tech) const
+{
+    for (unsigned i{ 0 }; i < scenePasses_.Size(); ++i)
+    {
+        const ScenePassInfo& info = scenePasses_[i];
+        if (!info.clusteredLights_)
+            continue;
+
+        Pass* pass = tech->GetSupportedPass(info.passIndex_);
+        if (pass)
+            return pass->GetClusteredLights();
+    }
+
+    return false;
+}
+
+bool View::NeedsClusteredForwardLights(Drawable* drawable)
+{
+    const Vector<SourceBatch>& batches = drawable->GetBatches();
+    for (unsigned i{ 0 }; i < batches.Size(); ++i)
+    {
+        Technique* tech = GetTechnique(drawable, batches[i].material_);
+        if (tech && !HasClusteredPass(tech))
+            return true;
+    }
+
+    return false;
+}
+
+void View::SetQueueShaderDefines(BatchQueue& queue, const RenderPathCommand& command, bool clustered)
 {
     String vsDefines = command.vertexShaderDefines_.Trimmed();
     String psDefines = command.pixelShaderDefines_.Trimmed();
+    if (clustered)
+        psDefines = psDefines.IsEmpty() ? String("CLUSTERED") : psDefines + " CLUSTERED";
     if (vsDefines.Length() || psDefines.Length())
     {
         queue.hasExtraDefines_ = true;
@@ -2890,16 +3454,40 @@ void View::SetQueueShaderDefines(BatchQueue& queue, const RenderPathCommand& com
         queue.hasExtraDefines_ = false;
 }
 
-void View::AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, bool allowInstancing, bool allowShadows)
+void View::AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, bool allowInstancing, bool allowShadows,
+    Camera* camera)
 {
     if (!batch.material_)
         batch.material_ = renderer_->GetDefaultMaterial();
+    if (!camera)
+        camera = camera_;
+
+    // On OpenGL the view camera is flipped vertically while rendering to a texture, which reverses culling
+    bool reverseCulling = camera->GetReverseCulling();
+#ifdef DRY_OPENGL
+    if (camera == camera_ && renderTarget_ && !camera->GetFlipVertical())
+        reverseCulling = !reverseCulling;
+#endif
 
     // Convert to instanced if possible
+    int minInstances = minInstances_;
     if (allowInstancing && batch.geometryType_ == GEOM_STATIC && batch.geometry_->GetIndexBuffer())
+    {
         batch.geometryType_ = GEOM_INSTANCED;
+        // Draw from the shared buffers so that groups of different geometries can be combined
+        if (multiDrawIndirect_)
+        {
+            Geometry* pooled = renderer_->GetGeometryPool()->GetPooledGeometry(batch.geometry_);
+            // Pooled groups are combined into multi-draw calls, so even a single instance benefits
+            if (pooled != batch.geometry_)
+                minInstances = 1;
+            batch.geometry_ = pooled;
+        }
+    }
+    else if (allowInstancing && skinInstancing_ && batch.geometryType_ == GEOM_SKINNED && batch.geometry_->GetIndexBuffer())
+        batch.geometryType_ = GEOM_SKINNED_INSTANCED;
 
-    if (batch.geometryType_ == GEOM_INSTANCED)
+    if (batch.geometryType_ == GEOM_INSTANCED || batch.geometryType_ == GEOM_SKINNED_INSTANCED)
     {
         BatchGroupKey key(batch);
 
@@ -2907,10 +3495,26 @@ void View::AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, boo
         if (i == queue.batchGroups_.End())
         {
             // Create a new group based on the batch
-            // In case the group remains below the instancing limit, do not enable instancing shaders yet
+            // In case the group remains below the instancing limit, do not enable instancing shaders yet. Skinned
+            // instances can only be drawn instanced
             BatchGroup newGroup(batch);
-            newGroup.geometryType_ = GEOM_STATIC;
+            if (batch.geometryType_ == GEOM_INSTANCED)
+                newGroup.geometryType_ = GEOM_STATIC;
+            else
+            {
+                // Keep the non-instanced skinning shaders for when the instancing buffer or bone texture is unavailable
+                Batch skinnedBatch(batch);
+                skinnedBatch.geometryType_ = GEOM_SKINNED;
+                renderer_->SetBatchShaders(skinnedBatch, tech, allowShadows, queue);
+                newGroup.skinnedPass_ = skinnedBatch.pass_;
+                newGroup.skinnedVertexShader_ = skinnedBatch.vertexShader_;
+                newGroup.skinnedPixelShader_ = skinnedBatch.pixelShader_;
+            }
             renderer_->SetBatchShaders(newGroup, tech, allowShadows, queue);
+            // Skip batches whose shaders are still compiling and have no fallback, or are missing
+            if (!newGroup.vertexShader_ || !newGroup.pixelShader_)
+                return;
+            newGroup.CalculatePipelineState(graphics_, camera, reverseCulling);
             newGroup.CalculateSortKey();
             i = queue.batchGroups_.Insert(MakePair(key, newGroup));
         }
@@ -2918,16 +3522,29 @@ void View::AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, boo
         int oldSize = i->second_.instances_.Size();
         i->second_.AddTransforms(batch);
         // Convert to using instancing shaders when the instancing limit is reached
-        if (oldSize < minInstances_ && (int)i->second_.instances_.Size() >= minInstances_)
+        if (i->second_.geometryType_ == GEOM_STATIC && oldSize < minInstances &&
+            (int)i->second_.instances_.Size() >= minInstances)
         {
+            Pass* pass = i->second_.pass_;
             i->second_.geometryType_ = GEOM_INSTANCED;
             renderer_->SetBatchShaders(i->second_, tech, allowShadows, queue);
+            // Keep drawing the instances one by one until the instancing shaders are ready
+            if (!i->second_.vertexShader_ || !i->second_.pixelShader_)
+            {
+                i->second_.pass_ = pass;
+                i->second_.geometryType_ = GEOM_STATIC;
+                renderer_->SetBatchShaders(i->second_, tech, allowShadows, queue);
+            }
+            i->second_.CalculatePipelineState(graphics_, camera, reverseCulling);
             i->second_.CalculateSortKey();
         }
     }
     else
     {
         renderer_->SetBatchShaders(batch, tech, allowShadows, queue);
+        if (!batch.vertexShader_ || !batch.pixelShader_)
+            return;
+        batch.CalculatePipelineState(graphics_, camera, reverseCulling);
         batch.CalculateSortKey();
 
         // If batch is static with multiple world transforms and cannot instance, we must push copies of the batch individually
@@ -2947,53 +3564,115 @@ void View::AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, boo
     }
 }
 
-void View::PrepareInstancingBuffer()
+void View::RecordBatchQueues()
 {
-    // Prepare instancing buffer from the source view
+    // Prepare instancing buffer and record from the source view
     /// \todo If rendering the same view several times back-to-back, would not need to refill the buffer
     if (sourceView_)
     {
-        sourceView_->PrepareInstancingBuffer();
+        sourceView_->RecordBatchQueues();
         return;
     }
 
-    DRY_PROFILE(PrepareInstancingBuffer);
+    DRY_PROFILE(RecordBatchQueues);
 
-    unsigned totalInstances = 0;
+    PODVector<BatchQueue*> queues;
 
     for (HashMap<unsigned, BatchQueue>::Iterator i = batchQueues_.Begin(); i != batchQueues_.End(); ++i)
-        totalInstances += i->second_.GetNumInstances();
+        queues.Push(&i->second_);
 
     for (Vector<LightBatchQueue>::Iterator i = lightQueues_.Begin(); i != lightQueues_.End(); ++i)
     {
         for (unsigned j{ 0 }; j < i->shadowSplits_.Size(); ++j)
-            totalInstances += i->shadowSplits_[j].shadowBatches_.GetNumInstances();
-        totalInstances += i->litBaseBatches_.GetNumInstances();
-        totalInstances += i->litBatches_.GetNumInstances();
+        {
+            queues.Push(&i->shadowSplits_[j].shadowBatches_);
+            queues.Push(&i->shadowSplits_[j].dynamicShadowBatches_);
+        }
+        queues.Push(&i->litBaseBatches_);
+        queues.Push(&i->litBatches_);
     }
 
-    if (!totalInstances || !renderer_->ResizeInstancingBuffer(totalInstances))
-        return;
+    if (skinInstancing_)
+        UpdateSkinTexture(queues);
 
-    VertexBuffer* instancingBuffer = renderer_->GetInstancingBuffer();
-    unsigned freeIndex = 0;
-    void* dest = instancingBuffer->Lock(0, totalInstances, true);
-    if (!dest)
-        return;
+    RecordBatchQueueParams params{ nullptr, 0, renderer_->UseMultiDrawIndirect() };
+    VertexBuffer* instancingBuffer = nullptr;
 
-    const unsigned stride = instancingBuffer->GetVertexSize();
-    for (HashMap<unsigned, BatchQueue>::Iterator i = batchQueues_.Begin(); i != batchQueues_.End(); ++i)
-        i->second_.SetInstancingData(dest, stride, freeIndex);
+    // Reserve instancing buffer space for each queue up front, so that the queues can be filled independently
+    if (renderer_->GetDynamicInstancing() && graphics_->GetInstancingSupport())
+    {
+        unsigned totalInstances = 0;
+        for (unsigned i{ 0 }; i < queues.Size(); ++i)
+            totalInstances += queues[i]->GetNumInstances();
 
-    for (Vector<LightBatchQueue>::Iterator i = lightQueues_.Begin(); i != lightQueues_.End(); ++i)
+        if (totalInstances && renderer_->ResizeInstancingBuffer(totalInstances))
+        {
+            instancingBuffer = renderer_->GetInstancingBuffer();
+            params.instancingData_ = instancingBuffer->Lock(0, totalInstances, true);
+            params.instancingStride_ = instancingBuffer->GetVertexSize();
+
+            if (params.instancingData_)
+            {
+                unsigned freeIndex = 0;
+                for (unsigned i{ 0 }; i < queues.Size(); ++i)
+                    queues[i]->ReserveInstancingData(freeIndex);
+            }
+        }
+    }
+
+    auto* queue = GetSubsystem<WorkQueue>();
+
+    for (unsigned i{ 0 }; i < queues.Size(); ++i)
     {
-        for (unsigned j{ 0 }; j < i->shadowSplits_.Size(); ++j)
-            i->shadowSplits_[j].shadowBatches_.SetInstancingData(dest, stride, freeIndex);
-        i->litBaseBatches_.SetInstancingData(dest, stride, freeIndex);
-        i->litBatches_.SetInstancingData(dest, stride, freeIndex);
+        SharedPtr<WorkItem> item = queue->GetFreeItem();
+        item->priority_ = M_MAX_UNSIGNED;
+        item->workFunction_ = RecordBatchQueueWork;
+        item->aux_ = &params;
+        item->start_ = queues[i];
+        queue->AddWorkItem(item);
     }
 
-    instancingBuffer->Unlock();
+    queue->Complete(M_MAX_UNSIGNED);
+
+    if (params.instancingData_)
+        instancingBuffer->Unlock();
+}
+
+void View::UpdateSkinTexture(const PODVector<BatchQueue*>& queues)
+{
+    DRY_PROFILE(UpdateSkinTexture);
+
+    skinMatrices_.Clear();
+    skinMatrixOffsets_.Clear();
+
+    // The same palette is drawn in several passes and shadow splits, but is stored only once
+    for (unsigned i{ 0 }; i < queues.Size(); ++i)
+    {
+        HashMap<BatchGroupKey, BatchGroup>& groups = queues[i]->batchGroups_;
+        for (HashMap<BatchGroupKey, BatchGroup>::Iterator j = groups.Begin(); j != groups.End(); ++j)
+        {
+            BatchGroup& group = j->second_;
+            if (group.geometryType_ != GEOM_SKINNED_INSTANCED)
+                continue;
+
+            for (unsigned k{ 0 }; k < group.instances_.Size(); ++k)
+            {
+                InstanceData& instance = group.instances_[k];
+                HashMap<const Matrix3x4*, unsigned>::Iterator offset = skinMatrixOffsets_.Find(instance.worldTransform_);
+                if (offset == skinMatrixOffsets_.End())
+                {
+                    offset = skinMatrixOffsets_.Insert(MakePair(instance.worldTransform_, skinMatrices_.Size() * 3));
+                    skinMatrices_.Insert(skinMatrices_.End(), instance.worldTransform_,
+                        instance.worldTransform_ + group.numWorldTransforms_);
+                }
+
+                instance.skinOffset_ = offset->second_;
+            }
+        }
+    }
+
+    if (!skinMatrices_.IsEmpty())
+        renderer_->SetSkinMatrices(&skinMatrices_[0], skinMatrices_.Size());
 }
 
 void View::SetupLightVolumeBatch(Batch& batch)
@@ -3076,7 +3755,9 @@ void View::RenderShadowMap(const LightBatchQueue& queue)
         for (unsigned i{ 1 }; i < MAX_RENDERTARGETS; ++i)
             graphics_->SetRenderTarget(i, (RenderSurface*) nullptr);
         graphics_->SetViewport(IntRect(0, 0, shadowMap->GetWidth(), shadowMap->GetHeight()));
-        graphics_->Clear(CLEAR_DEPTH);
+        // The shadow atlas is cleared one split at a time, leaving the other tiles intact
+        if (!queue.shadowTile_)
+            graphics_->Clear(CLEAR_DEPTH);
     }
     else // if the shadow map is a color rendertarget
     {
@@ -3118,7 +3799,9 @@ void View::RenderShadowMap(const LightBatchQueue& queue)
 
         graphics_->SetDepthBias(multiplier * parameters.constantBias_ + addition, multiplier * parameters.slopeScaledBias_);
 
-        if (!shadowQueue.shadowBatches_.IsEmpty())
+        if (queue.shadowTile_)
+            RenderShadowAtlasSplit(queue, i);
+        else if (!shadowQueue.shadowBatches_.IsEmpty())
         {
             graphics_->SetViewport(shadowQueue.shadowViewport_);
             shadowQueue.shadowBatches_.Draw(this, shadowQueue.shadowCamera_, false, false, true);
@@ -3126,14 +3809,55 @@ void View::RenderShadowMap(const LightBatchQueue& queue)
     }
 
     // Scale filter blur amount to shadow map viewport size so that different shadow map resolutions don't behave differently
-    float blurScale = queue.shadowSplits_[0].shadowViewport_.Width() / 1024.0f;
-    renderer_->ApplyShadowMapFilter(this, shadowMap, blurScale);
+    if (!queue.shadowTile_)
+    {
+        float blurScale = queue.shadowSplits_[0].shadowViewport_.Width() / 1024.0f;
+        renderer_->ApplyShadowMapFilter(this, shadowMap, blurScale);
+    }
 
     // reset some parameters
     graphics_->SetColorWrite(true);
     graphics_->SetDepthBias(0.0f, 0.0f);
 }
 
+void View::RenderShadowAtlasSplit(const LightBatchQueue& queue, unsigned splitIndex)
+{
+    ShadowAtlas* atlas = renderer_->GetShadowAtlas();
+    const ShadowBatchQueue& shadowQueue = queue.shadowSplits_[splitIndex];
+    ShadowAtlasSplit& cache = queue.shadowTile_->splits_[splitIndex];
+    graphics_->SetViewport(shadowQueue.shadowViewport_);
+
+    // Redraw the static shadow casters if they or the shadow camera changed, else restore them if dynamic casters were
+    // drawn over them on an earlier frame
+    bool redrawStatic = cache.staticHash_ != shadowQueue.staticHash_;
+    if (!redrawStatic && !cache.staticOnly_)
+        redrawStatic = !atlas->CopyStatic(shadowQueue.shadowViewport_, true);
+
+    if (redrawStatic)
+    {
+        graphics_->Clear(CLEAR_DEPTH);
+        shadowQueue.shadowBatches_.Draw(this, shadowQueue.shadowCamera_, false, false, true);
+        cache.staticHash_ = shadowQueue.staticHash_;
+        cache.hasStaticCopy_ = false;
+        cache.staticOnly_ = true;
+    }
+
+    if (!shadowQueue.dynamicShadowBatches_.IsEmpty())
+    {
+        // Keep a copy of the static shadow casters before drawing the dynamic ones over them
+        if (!cache.hasStaticCopy_)
+            cache.hasStaticCopy_ = atlas->CopyStatic(shadowQueue.shadowViewport_, false);
+
+        graphics_->SetViewport(shadowQueue.shadowViewport_);
+        shadowQueue.dynamicShadowBatches_.Draw(this, shadowQueue.shadowCamera_, false, false, true);
+        cache.staticOnly_ = false;
+
+        // Without a copy the static shadow casters have to be redrawn next time
+        if (!cache.hasStaticCopy_)
+            cache.staticHash_ = 0;
+    }
+}
+
 RenderSurface* View::GetDepthStencil(RenderSurface* renderTarget)
 {
     // If using the backbuffer, return the backbuffer depth-stencil
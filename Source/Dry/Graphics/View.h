@@ -27,7 +27,10 @@
 #include "../Container/List.h"
 #include "../Core/Object.h"
 #include "../Graphics/Batch.h"
+#include "../Graphics/Geometry.h"
+#include "../Graphics/IndexBuffer.h"
 #include "../Graphics/Light.h"
+#include "../Graphics/LightClusters.h"
 #include "../Graphics/Zone.h"
 #include "../Math/Polyhedron.h"
 
@@ -61,6 +64,8 @@ struct LightQueryResult
     PODVector<Drawable*> litGeometries_;
     /// Shadow casters.
     PODVector<Drawable*> shadowCasters_;
+    /// Shadow caster candidates shared by all splits.
+    PODVector<Drawable*> shadowCasterCandidates_;
     /// Shadow cameras.
     Camera* shadowCameras_[MAX_LIGHT_SPLITS];
     /// Shadow caster start indices.
@@ -73,10 +78,39 @@ struct LightQueryResult
     float shadowNearSplits_[MAX_LIGHT_SPLITS];
     /// Shadow camera far splits (directional lights only.)
     float shadowFarSplits_[MAX_LIGHT_SPLITS];
+    /// Scene frustum in each shadow camera's view space, for the shadow caster visibility checks.
+    Frustum shadowCasterFrustums_[MAX_LIGHT_SPLITS];
+    /// Far Z of each light view space scene frustum's bounding box, for extruding directional light shadow casters.
+    float shadowCasterFrustumFarZ_[MAX_LIGHT_SPLITS];
+    /// Projection of each shadow camera, computed before the shadow caster checks run in parallel.
+    Matrix4 shadowCameraProjections_[MAX_LIGHT_SPLITS];
+    /// Whether each split needs shadow casters.
+    bool shadowSplitActive_[MAX_LIGHT_SPLITS];
     /// Shadow map split count.
     unsigned numSplits_;
 };
 
+/// Range of a light's shadow caster candidates checked against all splits by one work item.
+struct ShadowCasterRange
+{
+    /// Light query result.
+    LightQueryResult* query_;
+    /// First candidate index.
+    unsigned start_;
+    /// End candidate index.
+    unsigned end_;
+    /// Visible shadow casters per split.
+    PODVector<Drawable*> casters_[MAX_LIGHT_SPLITS];
+    /// Combined bounding box of the visible shadow casters per split. Only used for focused spot lights.
+    BoundingBox casterBox_[MAX_LIGHT_SPLITS];
+    /// Candidates that passed the checks common to all splits.
+    PODVector<Drawable*> candidates_;
+    /// Light view space bounding boxes of the candidates, as separate arrays of min and max coordinates.
+    PODVector<float> boxes_;
+    /// Visibility states of the candidates.
+    PODVector<unsigned char> states_;
+};
+
 /// Scene render pass info.
 struct ScenePassInfo
 {
@@ -88,6 +122,8 @@ struct ScenePassInfo
     bool markToStencil_;
     /// Vertex light flag.
     bool vertexLights_;
+    /// Clustered light flag.
+    bool clusteredLights_;
     /// Batch queue.
     BatchQueue* batchQueue_;
 };
@@ -112,6 +148,7 @@ class DRY_API View : public Object
 {
     friend void CheckVisibilityWork(const WorkItem* item, unsigned threadIndex);
     friend void ProcessLightWork(const WorkItem* item, unsigned threadIndex);
+    friend void ProcessShadowCastersWork(const WorkItem* item, unsigned threadIndex);
 
     DRY_OBJECT(View, Object);
 
@@ -172,6 +209,9 @@ public:
     /// Return light batch queues.
     const Vector<LightBatchQueue>& GetLightQueues() const { return lightQueues_; }
 
+    /// Return light clusters if the renderpath uses clustered lighting, null otherwise.
+    LightClusters* GetLightClusters() const { return clusteredLighting_ ? lightClusters_.Get() : nullptr; }
+
     /// Return the last used software occlusion buffer.
     OcclusionBuffer* GetOcclusionBuffer() const { return occlusionBuffer_; }
 
@@ -211,6 +251,10 @@ private:
     void UpdateGeometries();
     /// Get pixel lit batches for a certain light and drawable.
     void GetLitBatches(Drawable* drawable, LightBatchQueue& lightQueue, BatchQueue* alphaQueue);
+    /// Return the geometry of a static model batch reduced to the meshlets visible to the view. Return the batch's own geometry when cluster culling does not apply or culls nothing, and null when all meshlets are culled.
+    Geometry* GetClusterCulledGeometry(Drawable* drawable, unsigned batchIndex, const SourceBatch& batch);
+    /// Upload the compacted indices of the cluster culled geometries.
+    void UpdateClusterIndexBuffer();
     /// Execute render commands.
     void ExecuteRenderPathCommands();
     /// Set rendertargets for current render command.
@@ -237,8 +281,8 @@ private:
     void DrawOccluders(OcclusionBuffer* buffer, const PODVector<Drawable*>& occluders);
     /// Query for lit geometries and shadow casters for a light.
     void ProcessLight(LightQueryResult& query, unsigned threadIndex);
-    /// Process shadow casters' visibilities and build their combined view- or projection-space bounding box.
-    void ProcessShadowCasters(LightQueryResult& query, const PODVector<Drawable*>& drawables, unsigned splitIndex);
+    /// Process the visibilities of a range of shadow caster candidates in all splits and build their combined view- or projection-space bounding boxes.
+    void ProcessShadowCasters(ShadowCasterRange& range);
     /// Set up initial shadow camera view(s).
     void SetupShadowCameras(LightQueryResult& query);
     /// Set up a directional light shadow camera
@@ -249,11 +293,8 @@ private:
     /// Quantize a directional light shadow camera view to eliminate swimming.
     void
         QuantizeDirLightShadowCamera(Camera* shadowCamera, Light* light, const IntRect& shadowViewport, const BoundingBox& viewBox);
-    /// Check visibility of one shadow caster.
-    bool IsShadowCasterVisible(Drawable* drawable, BoundingBox lightViewBox, Camera* shadowCamera, const Matrix3x4& lightView,
-        const Frustum& lightViewFrustum, const BoundingBox& lightViewFrustumBox);
-    /// Return the viewport for a shadow map split.
-    IntRect GetShadowMapViewport(Light* light, int splitIndex, Texture2D* shadowMap);
+    /// Return the viewport for a shadow map split within the shadow map area of the light.
+    IntRect GetShadowMapViewport(Light* light, int splitIndex, const IntRect& area);
     /// Find and set a new zone for a drawable when it has moved.
     void FindZone(Drawable* drawable);
     /// Return material technique, considering the drawable's LOD distance.
@@ -261,17 +302,28 @@ private:
     /// Check if material should render an auxiliary view (if it has a camera attached.)
     void CheckMaterialForAuxView(Material* material);
     /// Set shader defines for a batch queue if used.
-    void SetQueueShaderDefines(BatchQueue& queue, const RenderPathCommand& command);
-    /// Choose shaders for a batch and add it to queue.
-    void AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, bool allowInstancing = true, bool allowShadows = true);
-    /// Prepare instancing buffer by filling it with all instance transforms.
-    void PrepareInstancingBuffer();
+    void SetQueueShaderDefines(BatchQueue& queue, const RenderPathCommand& command, bool clustered = false);
+    /// Return whether a light is applied through the light clusters instead of forward light passes.
+    bool IsClusteredLight(Light* light) const;
+    /// Return whether a technique's pass in the clustered scene passes adds the clustered lights.
+    bool HasClusteredPass(Technique* tech) const;
+    /// Return whether a drawable needs forward light batches for the clustered lights, because some of its techniques can not add them.
+    bool NeedsClusteredForwardLights(Drawable* drawable);
+    /// Choose shaders and pipeline state for a batch and add it to queue. The camera the queue is drawn with defaults to the view camera.
+    void AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, bool allowInstancing = true, bool allowShadows = true,
+        Camera* camera = nullptr);
+    /// Fill the instancing buffer with all instance transforms and record the draw call order and state changes of all batch queues, using worker threads.
+    void RecordBatchQueues();
+    /// Pack the skinning matrices of the skinned instances in batch queues into the bone texture and assign the instances their offsets.
+    void UpdateSkinTexture(const PODVector<BatchQueue*>& queues);
     /// Set up a light volume rendering batch.
     void SetupLightVolumeBatch(Batch& batch);
     /// Check whether a light queue needs shadow rendering.
     bool NeedRenderShadowMap(const LightBatchQueue& queue);
     /// Render a shadow map.
     void RenderShadowMap(const LightBatchQueue& queue);
+    /// Render a shadow map split into a shadow atlas tile, reusing the static shadow casters drawn on earlier frames.
+    void RenderShadowAtlasSplit(const LightBatchQueue& queue, unsigned splitIndex);
     /// Return the proper depth-stencil surface to use for a rendertarget.
     RenderSurface* GetDepthStencil(RenderSurface* renderTarget);
     /// Helper function to get the render surface from a texture. 2D textures will always return the first face only.
@@ -371,12 +423,20 @@ private:
     bool cameraZoneOverride_{};
     /// Draw shadows flag.
     bool drawShadows_{};
+    /// Multi-draw indirect flag. Instanced static geometry is drawn from the geometry pool.
+    bool multiDrawIndirect_{};
+    /// Skinned geometry instancing flag. Skinned instances take their skinning matrices from the bone texture.
+    bool skinInstancing_{};
+    /// Cluster culling flag. Static models with meshlets submit only their visible meshlets.
+    bool clusterCulling_{};
     /// Deferred flag. Inferred from the existence of a light volume command in the renderpath.
     bool deferred_{};
     /// Deferred ambient pass flag. This means that the destination rendertarget is being written to at the same time as albedo/normal/depth buffers, and needs to be RGBA on OpenGL.
     bool deferredAmbient_{};
     /// Forward light base pass optimization flag. If in use, combine the base pass and first light for all opaque objects.
     bool useLitBase_{};
+    /// Clustered lighting flag. Inferred from the renderpath's scene passes.
+    bool clusteredLighting_{};
     /// Has scene passes flag. If no scene passes, view can be defined without a valid scene or camera to only perform quad rendering.
     bool hasScenePasses_{};
     /// Whether is using a custom readable depth texture without a stencil channel.
@@ -401,8 +461,22 @@ private:
     PODVector<Drawable*> occluders_;
     /// Lights.
     PODVector<Light*> lights_;
+    /// Lights applied through the light clusters.
+    PODVector<Light*> clusteredLights_;
+    /// Light clusters.
+    SharedPtr<LightClusters> lightClusters_;
     /// Number of active occluders.
     unsigned activeOccluders_{};
+    /// Cluster culled geometries of the current frame by drawable and batch index.
+    HashMap<Pair<Drawable*, unsigned>, Geometry*> clusterGeometries_;
+    /// Geometries drawing the compacted indices, reused between frames.
+    Vector<SharedPtr<Geometry> > clusterGeometryPool_;
+    /// Number of pooled cluster culled geometries in use.
+    unsigned numClusterGeometries_{};
+    /// Compacted indices of the visible meshlets.
+    PODVector<unsigned> clusterIndices_;
+    /// Index buffer for the compacted indices.
+    SharedPtr<IndexBuffer> clusterIndexBuffer_;
 
     /// Drawables that limit their maximum light count.
     HashSet<Drawable*> maxLightsDrawables_;
@@ -410,6 +484,12 @@ private:
     HashMap<StringHash, Texture*> renderTargets_;
     /// Intermediate light processing results.
     Vector<LightQueryResult> lightQueryResults_;
+    /// Shadow caster candidate ranges processed in worker threads.
+    Vector<ShadowCasterRange> shadowCasterRanges_;
+    /// Skinning matrices of the skinned instances, in bone texture order.
+    PODVector<Matrix3x4> skinMatrices_;
+    /// Bone texture offsets of the skinning matrix palettes, for storing each palette once.
+    HashMap<const Matrix3x4*, unsigned> skinMatrixOffsets_;
     /// Info for scene render passes defined by the renderpath.
     PODVector<ScenePassInfo> scenePasses_;
     /// Per-pixel light queues.
@@ -0,0 +1,721 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+// Copyright (c) 2020-2023 LucKey Productions.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Container/Pair.h"
+#include "../Core/Thread.h"
+#include "../IO/AsyncFileReader.h"
+#include "../IO/File.h"
+#include "../IO/FileSystem.h"
+#include "../IO/Log.h"
+
+#if defined(DRY_THREADING) && defined(__linux__) && !defined(__ANDROID__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING
+#endif
+#endif
+
+#ifdef HAVE_IO_URING
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include <condition_variable>
+#include <mutex>
+
+#include "../DebugNew.h"
+
+namespace Dry
+{
+
+/// Number of submission queue entries of the io_uring.
+static const unsigned IO_URING_ENTRIES = 64;
+
+/// Finish a request and run its callback.
+static void CompleteRequest(AsyncReadRequest* request, bool success)
+{
+    request->success_ = success;
+    if (!success)
+        request->data_.Clear();
+    if (request->callback_)
+        request->callback_(request);
+    request->completed_ = true;
+}
+
+/// Read a request's file range with the regular file API. Return true if successful.
+static bool ReadRequestData(Context* context, AsyncReadRequest* request)
+{
+    File file(context, request->fileName_);
+    if (!file.IsOpen())
+        return false;
+
+    const unsigned fileSize = file.GetSize();
+    if (request->offset_ > fileSize)
+        return false;
+
+    const unsigned size = request->size_ ? request->size_ : fileSize - request->offset_;
+    if (request->offset_ + size > fileSize)
+        return false;
+
+    request->data_.Resize(size);
+    if (!size)
+        return true;
+
+    file.Seek(request->offset_);
+    return file.Read(&request->data_[0], size) == size;
+}
+
+/// Base class for the read backends.
+class AsyncReadBackend
+{
+public:
+    /// Destruct.
+    virtual ~AsyncReadBackend() = default;
+
+    /// Issue a batch of requests.
+    virtual void Submit(Vector<SharedPtr<AsyncReadRequest> >& requests) = 0;
+
+    /// Return whether this is the io_uring backend.
+    virtual bool IsIOUring() const { return false; }
+
+    /// Block until a request has completed.
+    void Wait(AsyncReadRequest* request)
+    {
+        std::unique_lock<std::mutex> lock(completionMutex_);
+        while (!request->completed_)
+            completionCondition_.wait(lock);
+    }
+
+    /// Block until no requests are in flight.
+    void WaitAll()
+    {
+        std::unique_lock<std::mutex> lock(completionMutex_);
+        while (numPending_)
+            completionCondition_.wait(lock);
+    }
+
+    /// Return number of requests in flight.
+    unsigned GetNumPending() const { return numPending_; }
+
+protected:
+    /// Complete a request and wake the threads waiting for completions.
+    void Finish(AsyncReadRequest* request, bool success)
+    {
+        CompleteRequest(request, success);
+        --numPending_;
+
+        // Taking the mutex orders the notification after a waiter's check of the completion, so that it can not be missed
+        {
+            std::lock_guard<std::mutex> lock(completionMutex_);
+        }
+        completionCondition_.notify_all();
+    }
+
+    /// Number of requests in flight.
+    std::atomic<unsigned> numPending_{};
+
+private:
+    /// Mutex for waiting on completions.
+    std::mutex completionMutex_;
+    /// Condition signaled when requests complete.
+    std::condition_variable completionCondition_;
+};
+
+/// Backend reading on a pool of I/O threads, or inline if there are none.
+class ThreadPoolReadBackend : public AsyncReadBackend
+{
+    /// I/O thread.
+    class IOThread : public RefCounted, public Thread
+    {
+    public:
+        /// Construct.
+        explicit IOThread(ThreadPoolReadBackend* owner) :
+            owner_(owner)
+        {
+        }
+
+        /// Process requests until shut down.
+        void ThreadFunction() override
+        {
+            while (SharedPtr<AsyncReadRequest> request = owner_->TakeRequest())
+                owner_->Process(request);
+        }
+
+    private:
+        /// Owning backend.
+        ThreadPoolReadBackend* owner_;
+    };
+
+public:
+    /// Construct and start the I/O threads.
+    ThreadPoolReadBackend(Context* context, unsigned numThreads) :
+        context_(context),
+        shutDown_(false)
+    {
+#ifdef DRY_THREADING
+        for (unsigned i{ 0 }; i < numThreads; ++i)
+        {
+            SharedPtr<IOThread> thread(new IOThread(this));
+            thread->Run();
+            threads_.Push(thread);
+        }
+#endif
+    }
+
+    /// Destruct. Wake and stop the I/O threads.
+    ~ThreadPoolReadBackend() override
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            shutDown_ = true;
+        }
+        queueCondition_.notify_all();
+
+        for (unsigned i{ 0 }; i < threads_.Size(); ++i)
+            threads_[i]->Stop();
+    }
+
+    /// Issue a batch of requests.
+    void Submit(Vector<SharedPtr<AsyncReadRequest> >& requests) override
+    {
+        numPending_ += requests.Size();
+
+        if (threads_.IsEmpty())
+        {
+            for (unsigned i{ 0 }; i < requests.Size(); ++i)
+                Process(requests[i]);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (unsigned i{ 0 }; i < requests.Size(); ++i)
+                queue_.Push(requests[i]);
+        }
+        queueCondition_.notify_all();
+    }
+
+    /// Block until there is a request to process and return it. Return null once shut down.
+    SharedPtr<AsyncReadRequest> TakeRequest()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (queue_.IsEmpty() && !shutDown_)
+            queueCondition_.wait(lock);
+
+        if (queue_.IsEmpty())
+            return SharedPtr<AsyncReadRequest>();
+
+        SharedPtr<AsyncReadRequest> request = queue_.Front();
+        queue_.PopFront();
+        return request;
+    }
+
+    /// Read and complete a request.
+    void Process(AsyncReadRequest* request)
+    {
+        Finish(request, ReadRequestData(context_, request));
+    }
+
+private:
+    /// Execution context.
+    Context* context_;
+    /// I/O threads.
+    Vector<SharedPtr<IOThread> > threads_;
+    /// Mutex for the request queue.
+    std::mutex mutex_;
+    /// Condition signaled when requests are queued or the backend shuts down.
+    std::condition_variable queueCondition_;
+    /// Requests waiting for an I/O thread.
+    List<SharedPtr<AsyncReadRequest> > queue_;
+    /// Shutdown flag.
+    bool shutDown_;
+};
+
+#ifdef HAVE_IO_URING
+
+/// Read operation in flight on the io_uring.
+struct IOUringOperation
+{
+    /// Request being served.
+    SharedPtr<AsyncReadRequest> request_;
+    /// File descriptor.
+    int fd_{-1};
+    /// Bytes read so far.
+    unsigned bytesRead_{};
+    /// Destination of the next read.
+    iovec iov_{};
+};
+
+/// Backend submitting reads to a Linux io_uring. A completion thread reaps the results.
+class IOUringReadBackend : public AsyncReadBackend, public Thread
+{
+public:
+    /// Construct.
+    IOUringReadBackend() :
+        ringFd_(-1),
+        sqRing_(nullptr),
+        cqRing_(nullptr),
+        sqes_(nullptr),
+        sqRingSize_(0),
+        cqRingSize_(0),
+        sqesSize_(0),
+        numInFlight_(0)
+    {
+    }
+
+    /// Destruct. Wake and stop the completion thread and release the ring.
+    ~IOUringReadBackend() override
+    {
+        if (IsStarted())
+        {
+            shouldRun_ = false;
+            {
+                MutexLock lock(sqMutex_);
+                if (PushEntry(IORING_OP_NOP, -1, nullptr, 0, 0))
+                    Enter(1, 0, 0);
+            }
+            Stop();
+        }
+
+        if (sqes_)
+            munmap(sqes_, sqesSize_);
+        if (cqRing_ && cqRing_ != sqRing_)
+            munmap(cqRing_, cqRingSize_);
+        if (sqRing_)
+            munmap(sqRing_, sqRingSize_);
+        if (ringFd_ >= 0)
+            close(ringFd_);
+    }
+
+    /// Set up the ring and start the completion thread. Return false if io_uring is unavailable.
+    bool Initialize()
+    {
+        io_uring_params params;     // NOLINT(hicpp-member-init)
+        memset(&params, 0, sizeof params);
+
+        ringFd_ = (int)syscall(__NR_io_uring_setup, IO_URING_ENTRIES, &params);
+        if (ringFd_ < 0)
+            return false;
+
+        sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMmap)
+            sqRingSize_ = cqRingSize_ = Max(sqRingSize_, cqRingSize_);
+
+        sqRing_ = static_cast<unsigned char*>(mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                                   ringFd_, IORING_OFF_SQ_RING));
+        if (sqRing_ == MAP_FAILED)
+        {
+            sqRing_ = nullptr;
+            return false;
+        }
+
+        if (singleMmap)
+            cqRing_ = sqRing_;
+        else
+        {
+            cqRing_ = static_cast<unsigned char*>(mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                                       ringFd_, IORING_OFF_CQ_RING));
+            if (cqRing_ == MAP_FAILED)
+            {
+                cqRing_ = nullptr;
+                return false;
+            }
+        }
+
+        sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                                ringFd_, IORING_OFF_SQES));
+        if (sqes_ == MAP_FAILED)
+        {
+            sqes_ = nullptr;
+            return false;
+        }
+
+        sqHead_ = reinterpret_cast<unsigned*>(sqRing_ + params.sq_off.head);
+        sqTail_ = reinterpret_cast<unsigned*>(sqRing_ + params.sq_off.tail);
+        sqMask_ = *reinterpret_cast<unsigned*>(sqRing_ + params.sq_off.ring_mask);
+        sqArray_ = reinterpret_cast<unsigned*>(sqRing_ + params.sq_off.array);
+        sqEntries_ = params.sq_entries;
+        cqHead_ = reinterpret_cast<unsigned*>(cqRing_ + params.cq_off.head);
+        cqTail_ = reinterpret_cast<unsigned*>(cqRing_ + params.cq_off.tail);
+        cqMask_ = *reinterpret_cast<unsigned*>(cqRing_ + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cqRing_ + params.cq_off.cqes);
+
+        return Run();
+    }
+
+    /// Issue a batch of requests.
+    void Submit(Vector<SharedPtr<AsyncReadRequest> >& requests) override
+    {
+        numPending_ += requests.Size();
+
+        // Requests that finish without a read are completed after the lock, like the reaped ones
+        Vector<Pair<SharedPtr<AsyncReadRequest>, bool> > finished;
+
+        {
+            MutexLock lock(sqMutex_);
+
+            for (unsigned i{ 0 }; i < requests.Size(); ++i)
+            {
+                AsyncReadRequest* request = requests[i];
+                const int fd = open(GetNativePath(request->fileName_).CString(), O_RDONLY | O_CLOEXEC);
+                if (fd < 0)
+                {
+                    DRY_LOGERROR("Could not open file " + request->fileName_);
+                    finished.Push(MakePair(requests[i], false));
+                    continue;
+                }
+
+                struct stat fileStat{};
+                if (fstat(fd, &fileStat) != 0 || request->offset_ > (unsigned)fileStat.st_size)
+                {
+                    close(fd);
+                    finished.Push(MakePair(requests[i], false));
+                    continue;
+                }
+
+                const unsigned size = request->size_ ? request->size_ : (unsigned)fileStat.st_size - request->offset_;
+                if (request->offset_ + size > (unsigned)fileStat.st_size)
+                {
+                    close(fd);
+                    finished.Push(MakePair(requests[i], false));
+                    continue;
+                }
+
+                request->data_.Resize(size);
+                if (!size)
+                {
+                    close(fd);
+                    finished.Push(MakePair(requests[i], true));
+                    continue;
+                }
+
+                auto* operation = new IOUringOperation();
+                operation->request_ = request;
+                operation->fd_ = fd;
+                pending_.Push(operation);
+            }
+
+            FlushPending();
+        }
+
+        for (unsigned i{ 0 }; i < finished.Size(); ++i)
+            Finish(finished[i].first_, finished[i].second_);
+    }
+
+    /// Return whether this is the io_uring backend.
+    bool IsIOUring() const override { return true; }
+
+    /// Reap completions until shut down.
+    void ThreadFunction() override
+    {
+        Vector<Pair<SharedPtr<AsyncReadRequest>, bool> > finished;
+
+        while (shouldRun_)
+        {
+            Enter(0, 1, IORING_ENTER_GETEVENTS);
+
+            {
+                MutexLock lock(sqMutex_);
+
+                unsigned head = *cqHead_;
+                const unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+                while (head != tail)
+                {
+                    const io_uring_cqe& cqe = cqes_[head & cqMask_];
+                    auto* operation = reinterpret_cast<IOUringOperation*>(cqe.user_data);
+                    const int result = cqe.res;
+                    ++head;
+
+                    if (!operation)
+                        continue;
+
+                    --numInFlight_;
+
+                    if (result == -EINTR || result == -EAGAIN)
+                        pending_.Push(operation);
+                    else if (result <= 0)
+                    {
+                        DRY_LOGERROR("Could not read file " + operation->request_->fileName_);
+                        close(operation->fd_);
+                        finished.Push(MakePair(operation->request_, false));
+                        delete operation;
+                    }
+                    else
+                    {
+                        operation->bytesRead_ += (unsigned)result;
+                        // Short reads are continued from where they stopped
+                        if (operation->bytesRead_ < operation->request_->data_.Size())
+                            pending_.Push(operation);
+                        else
+                        {
+                            close(operation->fd_);
+                            finished.Push(MakePair(operation->request_, true));
+                            delete operation;
+                        }
+                    }
+                }
+
+                __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+
+                FlushPending();
+            }
+
+            // Run the callbacks without the lock, so that work done in them, such as decoding, does not hold up submission
+            for (unsigned i{ 0 }; i < finished.Size(); ++i)
+                Finish(finished[i].first_, finished[i].second_);
+            finished.Clear();
+        }
+    }
+
+private:
+
+    /// Push pending operations to the submission queue as far as there is room, and submit them. Called with the mutex held.
+    void FlushPending()
+    {
+        unsigned numPushed = 0;
+        while (!pending_.IsEmpty() && numInFlight_ < sqEntries_)
+        {
+            IOUringOperation* operation = pending_.Front();
+            AsyncReadRequest* request = operation->request_;
+            operation->iov_.iov_base = &request->data_[operation->bytesRead_];
+            operation->iov_.iov_len = request->data_.Size() - operation->bytesRead_;
+
+            if (!PushEntry(IORING_OP_READV, operation->fd_, &operation->iov_, request->offset_ + operation->bytesRead_, operation))
+                break;
+
+            pending_.PopFront();
+            ++numInFlight_;
+            ++numPushed;
+        }
+
+        if (numPushed)
+            Enter(numPushed, 0, 0);
+    }
+
+    /// Add an entry to the submission queue. Return false if full. Called with the mutex held.
+    bool PushEntry(unsigned char opcode, int fd, iovec* iov, unsigned long long offset, IOUringOperation* operation)
+    {
+        const unsigned tail = *sqTail_;
+        if (tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_)
+            return false;
+
+        const unsigned index = tail & sqMask_;
+        io_uring_sqe& sqe = sqes_[index];
+        memset(&sqe, 0, sizeof sqe);
+        sqe.opcode = opcode;
+        sqe.fd = fd;
+        sqe.addr = (unsigned long long)(size_t)iov;
+        sqe.len = iov ? 1 : 0;
+        sqe.off = offset;
+        sqe.user_data = (unsigned long long)(size_t)operation;
+        sqArray_[index] = index;
+
+        __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    /// Submit entries and/or wait for completions.
+    int Enter(unsigned toSubmit, unsigned minComplete, unsigned flags)
+    {
+        return (int)syscall(__NR_io_uring_enter, ringFd_, toSubmit, minComplete, flags, nullptr, 0);
+    }
+
+    /// Ring file descriptor.
+    int ringFd_;
+    /// Submission queue ring mapping.
+    unsigned char* sqRing_;
+    /// Completion queue ring mapping.
+    unsigned char* cqRing_;
+    /// Submission queue entries.
+    io_uring_sqe* sqes_;
+    /// Submission queue ring mapping size.
+    size_t sqRingSize_;
+    /// Completion queue ring mapping size.
+    size_t cqRingSize_;
+    /// Submission queue entries mapping size.
+    size_t sqesSize_;
+    /// Submission queue head.
+    unsigned* sqHead_{};
+    /// Submission queue tail.
+    unsigned* sqTail_{};
+    /// Submission queue index array.
+    unsigned* sqArray_{};
+    /// Submission queue index mask.
+    unsigned sqMask_{};
+    /// Number of submission queue entries.
+    unsigned sqEntries_{};
+    /// Completion queue head.
+    unsigned* cqHead_{};
+    /// Completion queue tail.
+    unsigned* cqTail_{};
+    /// Completion queue index mask.
+    unsigned cqMask_{};
+    /// Completion queue entries.
+    io_uring_cqe* cqes_{};
+    /// Number of operations submitted and not yet reaped.
+    unsigned numInFlight_;
+    /// Operations waiting for room in the submission queue.
+    List<IOUringOperation*> pending_;
+    /// Mutex for the submission queue and pending operations.
+    Mutex sqMutex_;
+};
+
+#endif
+
+AsyncFileReader::AsyncFileReader(Context* context) :
+    Object(context),
+    backend_(nullptr),
+    numThreads_(4)
+{
+}
+
+AsyncFileReader::~AsyncFileReader()
+{
+    if (backend_)
+    {
+        backend_->WaitAll();
+
+        delete backend_;
+        backend_ = nullptr;
+    }
+}
+
+SharedPtr<AsyncReadRequest> AsyncFileReader::Read(const String& fileName, unsigned offset, unsigned size)
+{
+    SharedPtr<AsyncReadRequest> request(new AsyncReadRequest());
+    request->fileName_ = fileName;
+    request->offset_ = offset;
+    request->size_ = size;
+    Read(request);
+    return request;
+}
+
+void AsyncFileReader::Read(AsyncReadRequest* request)
+{
+    if (!request)
+        return;
+
+    request->completed_ = false;
+    request->success_ = false;
+
+    MutexLock lock(queueMutex_);
+    queued_.Push(SharedPtr<AsyncReadRequest>(request));
+}
+
+void AsyncFileReader::Submit()
+{
+    Vector<SharedPtr<AsyncReadRequest> > batch;
+    {
+        MutexLock lock(queueMutex_);
+        if (queued_.IsEmpty())
+            return;
+
+        CreateBackend();
+        batch.Swap(queued_);
+    }
+
+    backend_->Submit(batch);
+}
+
+bool AsyncFileReader::Wait(AsyncReadRequest* request)
+{
+    if (!request)
+        return false;
+
+    // A request still waiting for Submit() would never complete
+    bool queued;
+    {
+        MutexLock lock(queueMutex_);
+        queued = queued_.Contains(SharedPtr<AsyncReadRequest>(request));
+    }
+    if (queued)
+        Submit();
+
+    AsyncReadBackend* backend;
+    {
+        MutexLock lock(queueMutex_);
+        backend = backend_;
+    }
+    if (backend)
+        backend->Wait(request);
+
+    return request->success_;
+}
+
+void AsyncFileReader::SetNumThreads(unsigned num)
+{
+    MutexLock lock(queueMutex_);
+
+    if (backend_)
+    {
+        DRY_LOGERROR("Can not change number of I/O threads after the first request");
+        return;
+    }
+
+    numThreads_ = num;
+}
+
+bool AsyncFileReader::IsUsingIOUring() const
+{
+    MutexLock lock(queueMutex_);
+    return backend_ && backend_->IsIOUring();
+}
+
+unsigned AsyncFileReader::GetNumPendingRequests() const
+{
+    MutexLock lock(queueMutex_);
+    return queued_.Size() + (backend_ ? backend_->GetNumPending() : 0);
+}
+
+void AsyncFileReader::CreateBackend()
+{
+    if (backend_)
+        return;
+
+#ifdef HAVE_IO_URING
+    auto* ioUring = new IOUringReadBackend();
+    if (ioUring->Initialize())
+    {
+        DRY_LOGINFO("Using io_uring for asynchronous file reads");
+        backend_ = ioUring;
+        return;
+    }
+
+    // The kernel may be too old, or io_uring may be disallowed in a sandbox
+    delete ioUring;
+#endif
+
+    backend_ = new ThreadPoolReadBackend(context_, numThreads_);
+}
+
+}
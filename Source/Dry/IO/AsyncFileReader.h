@@ -0,0 +1,106 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+// Copyright (c) 2020-2023 LucKey Productions.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+/// \file
+
+#pragma once
+
+#include "../Container/List.h"
+#include "../Core/Mutex.h"
+#include "../Core/Object.h"
+
+#include <atomic>
+
+namespace Dry
+{
+
+class AsyncReadBackend;
+
+/// Asynchronous file read request.
+struct DRY_API AsyncReadRequest : public RefCounted
+{
+    /// Filesystem path of the file to read.
+    String fileName_;
+    /// Resource name the request was made for, if any.
+    String resourceName_;
+    /// Byte offset to start reading from.
+    unsigned offset_{};
+    /// Number of bytes to read. Zero reads until the end of the file.
+    unsigned size_{};
+    /// Data read. Valid once completed.
+    PODVector<unsigned char> data_;
+    /// Completion callback. Called from an I/O thread, or from the submitting thread when threading is disabled.
+    void (* callback_)(AsyncReadRequest*){};
+    /// Auxiliary data pointer for the callback.
+    void* aux_{};
+    /// Success flag. Valid once completed.
+    bool success_{};
+    /// Completed flag.
+    std::atomic<bool> completed_{};
+};
+
+/// %Asynchronous file reader subsystem. Batches read requests and completes them on I/O threads, using io_uring on Linux where available.
+class DRY_API AsyncFileReader : public Object
+{
+    DRY_OBJECT(AsyncFileReader, Object);
+
+public:
+    /// Construct.
+    explicit AsyncFileReader(Context* context);
+    /// Destruct. Wait for the requests in flight to finish.
+    ~AsyncFileReader() override;
+
+    /// Queue a read of a file range. Zero size reads until the end of the file. The request is issued on the next Submit(). Can be called from outside the main thread.
+    SharedPtr<AsyncReadRequest> Read(const String& fileName, unsigned offset = 0, unsigned size = 0);
+    /// Queue a prepared read request. Can be called from outside the main thread.
+    void Read(AsyncReadRequest* request);
+    /// Issue all queued requests as one batch. Can be called from outside the main thread.
+    void Submit();
+    /// Block until a request has completed, submitting the queued requests first if it is among them. Return its success.
+    bool Wait(AsyncReadRequest* request);
+    /// Set number of I/O threads used when io_uring is not available. Can only be called before the first request. Default 4.
+    void SetNumThreads(unsigned num);
+
+    /// Return number of I/O threads used when io_uring is not available.
+    unsigned GetNumThreads() const { return numThreads_; }
+
+    /// Return whether the io_uring backend is in use.
+    bool IsUsingIOUring() const;
+    /// Return number of requests queued or in flight.
+    unsigned GetNumPendingRequests() const;
+
+private:
+    /// Create the backend on first use.
+    void CreateBackend();
+
+    /// Backend performing the reads.
+    AsyncReadBackend* backend_;
+    /// Mutex for the queued requests.
+    mutable Mutex queueMutex_;
+    /// Requests waiting for Submit().
+    Vector<SharedPtr<AsyncReadRequest> > queued_;
+    /// Number of I/O threads for the fallback backend.
+    unsigned numThreads_;
+};
+
+}
@@ -48,6 +48,12 @@ public:
     /// Write bytes to the memory area.
     unsigned Write(const void* data, unsigned size) override;
 
+    /// Set a name for the memory area, for example the resource name it was read from.
+    void SetName(const String& name) { name_ = name; }
+
+    /// Return the name, if set.
+    const String& GetName() const override { return name_; }
+
     /// Return memory area.
     unsigned char* GetData() { return buffer_; }
 
@@ -59,6 +65,8 @@ private:
     unsigned char* buffer_;
     /// Read-only flag.
     bool readOnly_;
+    /// Name.
+    String name_;
 };
 
 }
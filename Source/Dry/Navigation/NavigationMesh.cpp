@@ -43,6 +43,7 @@
 #include "../Navigation/NavigationMesh.h"
 #include "../Navigation/Obstacle.h"
 #include "../Navigation/OffMeshConnection.h"
+#include "../Resource/DerivedDataCache.h"
 #ifdef DRY_PHYSICS
 #include "../Physics/CollisionShape.h"
 #endif
@@ -1344,6 +1345,60 @@ bool NavigationMesh::BuildTile(Vector<NavigationGeometryInfo>& geometryList, int
     if (build.vertices_.IsEmpty() || build.indices_.IsEmpty())
         return true; // Nothing to do
 
+    // Tiles built before from identical input geometry and parameters can be fetched from the derived data cache
+    auto* derivedDataCache = GetSubsystem<DerivedDataCache>();
+    DerivedDataHash tileHash;
+    if (derivedDataCache && derivedDataCache->IsEnabled())
+    {
+        tileHash.AddValue(x);
+        tileHash.AddValue(z);
+        tileHash.AddValue(cfg);
+        tileHash.AddValue(partitionType_);
+        tileHash.AddValue(agentHeight_);
+        tileHash.AddValue(agentRadius_);
+        tileHash.AddValue(agentMaxClimb_);
+        tileHash.Add(&build.vertices_[0], build.vertices_.Size() * sizeof(Vector3));
+        tileHash.Add(&build.indices_[0], build.indices_.Size() * sizeof(int));
+        for (unsigned i{ 0 }; i < build.navAreas_.Size(); ++i)
+        {
+            tileHash.AddValue(build.navAreas_[i].bounds_.min_);
+            tileHash.AddValue(build.navAreas_[i].bounds_.max_);
+            tileHash.AddValue(build.navAreas_[i].areaID_);
+        }
+        if (build.offMeshRadii_.Size())
+        {
+            tileHash.Add(&build.offMeshVertices_[0], build.offMeshVertices_.Size() * sizeof(Vector3));
+            tileHash.Add(&build.offMeshRadii_[0], build.offMeshRadii_.Size() * sizeof(float));
+            tileHash.Add(&build.offMeshFlags_[0], build.offMeshFlags_.Size() * sizeof(unsigned short));
+            tileHash.Add(&build.offMeshAreas_[0], build.offMeshAreas_.Size());
+            tileHash.Add(&build.offMeshDir_[0], build.offMeshDir_.Size());
+        }
+
+        PODVector<unsigned char> cachedData;
+        if (derivedDataCache->Load("NavigationTile", tileHash.GetValue(), cachedData) && cachedData.Size())
+        {
+            auto* navData = (unsigned char*)dtAlloc(cachedData.Size(), DT_ALLOC_PERM);
+            if (navData)
+            {
+                memcpy(navData, &cachedData[0], cachedData.Size());
+                if (dtStatusSucceed(navMesh_->addTile(navData, cachedData.Size(), DT_TILE_FREE_DATA, 0, nullptr)))
+                {
+                    using namespace NavigationAreaRebuilt;
+                    VariantMap& eventData = GetContext()->GetEventDataMap();
+                    eventData[P_NODE] = GetNode();
+                    eventData[P_MESH] = this;
+                    eventData[P_BOUNDSMIN] = Variant(tileBoundingBox.min_);
+                    eventData[P_BOUNDSMAX] = Variant(tileBoundingBox.max_);
+                    SendEvent(E_NAVIGATION_AREA_REBUILT, eventData);
+                    return true;
+                }
+
+                // Fall back to building the tile
+                dtFree(navData);
+            }
+        }
+    }
+
     build.heightField_ = rcAllocHeightfield();
     if (!build.heightField_)
     {
@@ -1508,6 +1563,9 @@ bool NavigationMesh::BuildTile(Vector<NavigationGeometryInfo>& geometryList, int
         return false;
     }
 
+    if (derivedDataCache && derivedDataCache->IsEnabled())
+        derivedDataCache->Store("NavigationTile", tileHash.GetValue(), navData, (unsigned)navDataSize);
+
     if (dtStatusFailed(navMesh_->addTile(navData, navDataSize, DT_TILE_FREE_DATA, 0, nullptr)))
     {
         DRY_LOGERROR("Failed to add navigation mesh tile");
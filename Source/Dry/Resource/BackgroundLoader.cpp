@@ -27,7 +27,9 @@
 
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
+#include "../IO/AsyncFileReader.h"
 #include "../IO/Log.h"
+#include "../IO/MemoryBuffer.h"
 #include "../Resource/BackgroundLoader.h"
 #include "../Resource/ResourceCache.h"
 #include "../Resource/ResourceEvents.h"
@@ -37,6 +39,9 @@
 namespace Dry
 {
 
+/// Maximum number of queued resources whose files are read in one batch.
+static const unsigned MAX_BACKGROUND_LOAD_BATCH = 16;
+
 BackgroundLoader::BackgroundLoader(ResourceCache* owner) :
     owner_(owner)
 {
@@ -51,21 +56,24 @@ BackgroundLoader::~BackgroundLoader()
 
 void BackgroundLoader::ThreadFunction()
 {
+    PODVector<BackgroundLoadItem*> batch;
+    Vector<String> names;
+    Vector<SharedPtr<AsyncReadRequest> > requests;
+
     while (shouldRun_)
     {
         backgroundLoadMutex_.Acquire();
 
-        // Search for a queued resource that has not been loaded yet
-        HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Begin();
-        while (i != backgroundLoadQueue_.End())
+        // Search for queued resources that have not been loaded yet
+        batch.Clear();
+        for (HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Begin();
+             i != backgroundLoadQueue_.End() && batch.Size() < MAX_BACKGROUND_LOAD_BATCH; ++i)
         {
             if (i->second_.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
-                break;
-            else
-                ++i;
+                batch.Push(&i->second_);
         }
 
-        if (i == backgroundLoadQueue_.End())
+        if (batch.IsEmpty())
         {
             // No resources to load found
             backgroundLoadMutex_.Release();
@@ -73,41 +81,67 @@ void BackgroundLoader::ThreadFunction()
         }
         else
         {
-            BackgroundLoadItem& item = i->second_;
-            Resource* resource = item.resource_;
-            // We can be sure that the item is not removed from the queue as long as it is in the
+            // We can be sure that the items are not removed from the queue as long as they are in the
             // "queued" or "loading" state
             backgroundLoadMutex_.Release();
 
-            bool success = false;
-            SharedPtr<File> file = owner_->GetFile(resource->GetName(), item.sendEventOnFailure_);
-            if (file)
+            // Issue the reads of the whole batch at once so that they overlap with each other and with parsing
+            names.Resize(batch.Size());
+            for (unsigned i{ 0 }; i < batch.Size(); ++i)
+                names[i] = batch[i]->resource_->GetName();
+            owner_->ReadFilesAsync(names, requests);
+
+            for (unsigned i{ 0 }; i < batch.Size(); ++i)
             {
-                resource->SetAsyncLoadState(ASYNC_LOADING);
-                success = resource->BeginLoad(*file);
+                LoadResource(*batch[i], requests[i]);
+                requests[i].Reset();
             }
+        }
+    }
+}
 
-            // Process dependencies now
-            // Need to lock the queue again when manipulating other entries
-            Pair<StringHash, StringHash> key = MakePair(resource->GetType(), resource->GetNameHash());
-            backgroundLoadMutex_.Acquire();
-            if (item.dependents_.Size())
-            {
-                for (HashSet<Pair<StringHash, StringHash> >::Iterator i = item.dependents_.Begin();
-                     i != item.dependents_.End(); ++i)
-                {
-                    HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.Find(*i);
-                    if (j != backgroundLoadQueue_.End())
-                        j->second_.dependencies_.Erase(key);
-                }
+void BackgroundLoader::LoadResource(BackgroundLoadItem& item, AsyncReadRequest* request)
+{
+    Resource* resource = item.resource_;
+    bool success = false;
 
-                item.dependents_.Clear();
-            }
+    if (request && reader_ && reader_->Wait(request))
+    {
+        MemoryBuffer buffer(request->data_);
+        buffer.SetName(request->resourceName_);
+        resource->SetAsyncLoadState(ASYNC_LOADING);
+        success = resource->BeginLoad(buffer);
+    }
+    else
+    {
+        // Not directly readable or the read failed; open normally, which also reports the failure
+        SharedPtr<File> file = owner_->GetFile(resource->GetName(), item.sendEventOnFailure_);
+        if (file)
+        {
+            resource->SetAsyncLoadState(ASYNC_LOADING);
+            success = resource->BeginLoad(*file);
+        }
+    }
 
-            resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
-            backgroundLoadMutex_.Release();
+    // Process dependencies now
+    // Need to lock the queue again when manipulating other entries
+    Pair<StringHash, StringHash> key = MakePair(resource->GetType(), resource->GetNameHash());
+    backgroundLoadMutex_.Acquire();
+    if (item.dependents_.Size())
+    {
+        for (HashSet<Pair<StringHash, StringHash> >::Iterator i = item.dependents_.Begin();
+             i != item.dependents_.End(); ++i)
+        {
+            HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.Find(*i);
+            if (j != backgroundLoadQueue_.End())
+                j->second_.dependencies_.Erase(key);
         }
+
+        item.dependents_.Clear();
     }
+
+    resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
+    backgroundLoadMutex_.Release();
 }
 
 bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller)
@@ -166,7 +200,10 @@ bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool s
 
     // Start the background loader thread now
     if (!IsStarted())
+    {
+        reader_ = owner_->GetSubsystem<AsyncFileReader>();
         Run();
+    }
 
     return true;
 }
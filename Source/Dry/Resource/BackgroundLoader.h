@@ -34,6 +34,8 @@
 namespace Dry
 {
 
+class AsyncFileReader;
+struct AsyncReadRequest;
 class Resource;
 class ResourceCache;
 
@@ -74,11 +76,15 @@ public:
     unsigned GetNumQueuedResources() const;
 
 private:
+    /// Begin loading one resource, from prefetched data if available.
+    void LoadResource(BackgroundLoadItem& item, AsyncReadRequest* request);
     /// Finish one background loaded resource.
     void FinishBackgroundLoading(BackgroundLoadItem& item);
 
     /// Resource cache.
     ResourceCache* owner_;
+    /// Asynchronous file reader, held so that it outlives the loader thread.
+    SharedPtr<AsyncFileReader> reader_;
     /// Mutex for thread-safe access to the background load queue.
     mutable Mutex backgroundLoadMutex_;
     /// Resources that are queued for background loading.
@@ -0,0 +1,350 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+// Copyright (c) 2020-2023 LucKey Productions.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Container/Sort.h"
+#include "../Core/Timer.h"
+#include "../IO/File.h"
+#include "../IO/FileSystem.h"
+#include "../IO/Log.h"
+#include "../Resource/DerivedDataCache.h"
+
+#include <cstdio>
+
+#include "../DebugNew.h"
+
+namespace Dry
+{
+
+static const char* DERIVED_DATA_EXTENSION = ".ddc";
+static const char* DERIVED_DATA_ID = "DDC1";
+
+/// Entry index iterator.
+typedef HashMap<String, DerivedDataEntry>::Iterator DerivedDataEntryIterator;
+
+static bool CompareEntryAccess(const DerivedDataEntryIterator& lhs, const DerivedDataEntryIterator& rhs)
+{
+    return lhs->second_.lastAccess_ < rhs->second_.lastAccess_;
+}
+
+DerivedDataCache::DerivedDataCache(Context* context) :
+    Object(context),
+    sizeBudget_(DEFAULT_DERIVED_DATA_CACHE_SIZE),
+    totalSize_(0),
+    tempFileCounter_(0),
+    numHits_(0),
+    numMisses_(0)
+{
+}
+
+DerivedDataCache::~DerivedDataCache() = default;
+
+bool DerivedDataCache::SetCacheDir(const String& path)
+{
+    String trimmedPath = path.Trimmed();
+    if (trimmedPath.IsEmpty())
+    {
+        MutexLock lock(cacheMutex_);
+        entries_.Clear();
+        totalSize_ = 0;
+        cacheDir_.Clear();
+        return true;
+    }
+
+    auto* fileSystem = GetSubsystem<FileSystem>();
+    String fixedPath = AddTrailingSlash(trimmedPath);
+    if (!fileSystem->DirExists(fixedPath) && !fileSystem->CreateDir(fixedPath))
+    {
+        DRY_LOGERROR("Could not create derived data cache directory " + fixedPath);
+
+        MutexLock lock(cacheMutex_);
+        entries_.Clear();
+        totalSize_ = 0;
+        cacheDir_.Clear();
+        return false;
+    }
+
+    // Index the existing entries before taking the lock. The last modified time doubles as the last access time
+    HashMap<String, DerivedDataEntry> entries;
+    unsigned long long totalSize{ 0 };
+    Vector<String> fileNames;
+    fileSystem->ScanDir(fileNames, fixedPath, String("*") + DERIVED_DATA_EXTENSION, SCAN_FILES, false);
+    for (unsigned i{ 0 }; i < fileNames.Size(); ++i)
+    {
+        const String fullName = fixedPath + fileNames[i];
+        File file(context_, fullName);
+        if (!file.IsOpen())
+            continue;
+
+        DerivedDataEntry& entry = entries[fileNames[i]];
+        entry.size_ = file.GetSize();
+        entry.lastAccess_ = fileSystem->GetLastModifiedTime(fullName);
+        totalSize += entry.size_;
+    }
+
+    DRY_LOGINFOF("Derived data cache %s holds %u entries, %s", fixedPath.CString(), entries.Size(),
+                 GetFileSizeString(totalSize).CString());
+
+    Vector<String> evictedFiles;
+    {
+        MutexLock lock(cacheMutex_);
+        cacheDir_ = fixedPath;
+        entries_.Swap(entries);
+        totalSize_ = totalSize;
+        EvictEntries(evictedFiles);
+    }
+
+    DeleteFiles(evictedFiles);
+    return true;
+}
+
+void DerivedDataCache::SetSizeBudget(unsigned long long budget)
+{
+    Vector<String> evictedFiles;
+    {
+        MutexLock lock(cacheMutex_);
+        sizeBudget_ = budget;
+        EvictEntries(evictedFiles);
+    }
+
+    DeleteFiles(evictedFiles);
+}
+
+bool DerivedDataCache::Load(const String& kind, unsigned long long hash, PODVector<unsigned char>& dest)
+{
+    const String fileName = GetEntryFileName(kind, hash);
+    String fullName;
+
+    {
+        MutexLock lock(cacheMutex_);
+        if (cacheDir_.IsEmpty())
+            return false;
+
+        if (!entries_.Contains(fileName))
+        {
+            ++numMisses_;
+            return false;
+        }
+
+        fullName = cacheDir_ + fileName;
+    }
+
+    // Read without the lock, so that other threads can use the cache meanwhile. Entries are replaced by renaming, so the
+    // file is either the old or the new version
+    File file(context_, fullName);
+    bool valid = file.IsOpen() && file.ReadFileID() == DERIVED_DATA_ID;
+    if (valid)
+    {
+        const unsigned size = file.ReadUInt();
+        valid = size == file.GetSize() - file.GetPosition();
+        if (valid)
+        {
+            dest.Resize(size);
+            valid = !size || file.Read(&dest[0], size) == size;
+        }
+    }
+    file.Close();
+
+    auto* fileSystem = GetSubsystem<FileSystem>();
+
+    if (!valid)
+    {
+        // Stale or truncated entry, forget it so that it is written again
+        DRY_LOGWARNING("Discarding invalid derived data cache entry " + fileName);
+        {
+            MutexLock lock(cacheMutex_);
+            DerivedDataEntryIterator i = entries_.Find(fileName);
+            if (i != entries_.End())
+            {
+                totalSize_ -= i->second_.size_;
+                entries_.Erase(i);
+            }
+        }
+        fileSystem->Delete(fullName);
+        ++numMisses_;
+        return false;
+    }
+
+    const unsigned accessTime = Time::GetTimeSinceEpoch();
+    {
+        MutexLock lock(cacheMutex_);
+        DerivedDataEntryIterator i = entries_.Find(fileName);
+        if (i != entries_.End())
+            i->second_.lastAccess_ = accessTime;
+    }
+    fileSystem->SetLastModifiedTime(fullName, accessTime);
+    ++numHits_;
+    return true;
+}
+
+bool DerivedDataCache::Store(const String& kind, unsigned long long hash, const void* data, unsigned size)
+{
+    const String fileName = GetEntryFileName(kind, hash);
+    String fullName;
+    String tempName;
+
+    {
+        MutexLock lock(cacheMutex_);
+        if (cacheDir_.IsEmpty())
+            return false;
+
+        fullName = cacheDir_ + fileName;
+        // Write to a temporary file first so that an interrupted write never leaves a truncated entry behind. The name is
+        // unique so that threads storing the same entry do not write into the same file
+        tempName = fullName + "." + String(tempFileCounter_++) + ".tmp";
+    }
+
+    auto* fileSystem = GetSubsystem<FileSystem>();
+
+    {
+        File file(context_, tempName, FILE_WRITE);
+        if (!file.IsOpen())
+        {
+            DRY_LOGERROR("Could not write derived data cache entry " + fileName);
+            return false;
+        }
+
+        file.WriteFileID(DERIVED_DATA_ID);
+        file.WriteUInt(size);
+        if (size && file.Write(data, size) != size)
+        {
+            DRY_LOGERROR("Could not write derived data cache entry " + fileName);
+            file.Close();
+            fileSystem->Delete(tempName);
+            return false;
+        }
+    }
+
+    if (fileSystem->FileExists(fullName))
+        fileSystem->Delete(fullName);
+    if (!fileSystem->Rename(tempName, fullName))
+    {
+        fileSystem->Delete(tempName);
+        return false;
+    }
+
+    Vector<String> evictedFiles;
+    {
+        MutexLock lock(cacheMutex_);
+
+        DerivedDataEntry& entry = entries_[fileName];
+        totalSize_ -= entry.size_;
+        entry.size_ = size + 8;
+        entry.lastAccess_ = Time::GetTimeSinceEpoch();
+        totalSize_ += entry.size_;
+
+        EvictEntries(evictedFiles);
+    }
+
+    DeleteFiles(evictedFiles);
+    return true;
+}
+
+void DerivedDataCache::Clear()
+{
+    Vector<String> fileNames;
+    {
+        MutexLock lock(cacheMutex_);
+
+        fileNames.Reserve(entries_.Size());
+        for (HashMap<String, DerivedDataEntry>::ConstIterator i = entries_.Begin(); i != entries_.End(); ++i)
+            fileNames.Push(cacheDir_ + i->first_);
+
+        entries_.Clear();
+        totalSize_ = 0;
+    }
+
+    DeleteFiles(fileNames);
+}
+
+bool DerivedDataCache::IsEnabled() const
+{
+    MutexLock lock(cacheMutex_);
+    return !cacheDir_.IsEmpty();
+}
+
+String DerivedDataCache::GetCacheDir() const
+{
+    MutexLock lock(cacheMutex_);
+    return cacheDir_;
+}
+
+unsigned long long DerivedDataCache::GetSizeBudget() const
+{
+    MutexLock lock(cacheMutex_);
+    return sizeBudget_;
+}
+
+unsigned long long DerivedDataCache::GetTotalSize() const
+{
+    MutexLock lock(cacheMutex_);
+    return totalSize_;
+}
+
+unsigned DerivedDataCache::GetNumEntries() const
+{
+    MutexLock lock(cacheMutex_);
+    return entries_.Size();
+}
+
+String DerivedDataCache::GetEntryFileName(const String& kind, unsigned long long hash) const
+{
+    char hashString[17];
+    sprintf(hashString, "%016llx", hash);
+    return kind + "_" + hashString + DERIVED_DATA_EXTENSION;
+}
+
+void DerivedDataCache::EvictEntries(Vector<String>& evictedFiles)
+{
+    if (!sizeBudget_ || totalSize_ <= sizeBudget_)
+        return;
+
+    // Sort once by last access and remove from the oldest until within the budget
+    Vector<DerivedDataEntryIterator> sorted;
+    sorted.Reserve(entries_.Size());
+    for (DerivedDataEntryIterator i = entries_.Begin(); i != entries_.End(); ++i)
+        sorted.Push(i);
+    Sort(sorted.Begin(), sorted.End(), CompareEntryAccess);
+
+    for (unsigned i{ 0 }; i < sorted.Size() && totalSize_ > sizeBudget_; ++i)
+    {
+        DerivedDataEntryIterator oldest = sorted[i];
+        DRY_LOGDEBUG("Derived data cache over size budget, evicting " + oldest->first_);
+        evictedFiles.Push(cacheDir_ + oldest->first_);
+        totalSize_ -= oldest->second_.size_;
+        entries_.Erase(oldest);
+    }
+}
+
+void DerivedDataCache::DeleteFiles(const Vector<String>& fileNames)
+{
+    if (fileNames.IsEmpty())
+        return;
+
+    auto* fileSystem = GetSubsystem<FileSystem>();
+    for (unsigned i{ 0 }; i < fileNames.Size(); ++i)
+        fileSystem->Delete(fileNames[i]);
+}
+
+}
@@ -0,0 +1,150 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+// Copyright (c) 2020-2023 LucKey Productions.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+/// \file
+
+#pragma once
+
+#include "../Container/HashMap.h"
+#include "../Core/Mutex.h"
+#include "../Core/Object.h"
+
+#include <atomic>
+
+namespace Dry
+{
+
+/// Default size budget of the derived data cache in bytes.
+static const unsigned long long DEFAULT_DERIVED_DATA_CACHE_SIZE = 256ULL * 1024ULL * 1024ULL;
+
+/// Incremental 64-bit FNV-1a hash used to key derived data by source content and build parameters.
+class DRY_API DerivedDataHash
+{
+public:
+    /// Construct with the FNV offset basis.
+    DerivedDataHash() :
+        value_(14695981039346656037ULL)
+    {
+    }
+
+    /// Hash a block of memory.
+    void Add(const void* data, unsigned size)
+    {
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        for (unsigned i{ 0 }; i < size; ++i)
+        {
+            value_ ^= bytes[i];
+            value_ *= 1099511628211ULL;
+        }
+    }
+
+    /// Hash a string.
+    void Add(const String& str) { Add(str.CString(), str.Length()); }
+
+    /// Hash a plain value.
+    template <class T> void AddValue(const T& value) { Add(&value, sizeof(T)); }
+
+    /// Return the hash value.
+    unsigned long long GetValue() const { return value_; }
+
+private:
+    /// Hash value.
+    unsigned long long value_;
+};
+
+/// %Derived data cache entry bookkeeping.
+struct DerivedDataEntry
+{
+    /// Size of the cached file in bytes.
+    unsigned size_{};
+    /// Last access time as seconds since 1.1.1970.
+    unsigned lastAccess_{};
+};
+
+/// %Derived data cache subsystem. Stores the results of expensive derivations (decompressed images, navigation tiles etc.) in a local directory, keyed by the hash of their inputs. Least recently used entries are evicted when the size budget is exceeded. Can be called from outside the main thread.
+class DRY_API DerivedDataCache : public Object
+{
+    DRY_OBJECT(DerivedDataCache, Object);
+
+public:
+    /// Construct.
+    explicit DerivedDataCache(Context* context);
+    /// Destruct.
+    ~DerivedDataCache() override;
+
+    /// Set the cache directory and index its contents. Empty path disables the cache. Return true if successful.
+    bool SetCacheDir(const String& path);
+    /// Set the size budget in bytes. Default 256 MB, 0 is unlimited.
+    void SetSizeBudget(unsigned long long budget);
+    /// Read cached data by kind and input hash. Return true on a cache hit.
+    bool Load(const String& kind, unsigned long long hash, PODVector<unsigned char>& dest);
+    /// Store derived data by kind and input hash. Return true if successful.
+    bool Store(const String& kind, unsigned long long hash, const void* data, unsigned size);
+    /// Remove all cached data.
+    void Clear();
+
+    /// Return whether the cache has a directory to store data in.
+    bool IsEnabled() const;
+    /// Return the cache directory.
+    String GetCacheDir() const;
+    /// Return the size budget in bytes.
+    unsigned long long GetSizeBudget() const;
+
+    /// Return the total size of the cached data in bytes.
+    unsigned long long GetTotalSize() const;
+    /// Return the number of cached entries.
+    unsigned GetNumEntries() const;
+
+    /// Return the number of cache hits since construction.
+    unsigned GetNumHits() const { return numHits_; }
+
+    /// Return the number of cache misses since construction.
+    unsigned GetNumMisses() const { return numMisses_; }
+
+private:
+    /// Return the file name for an entry.
+    String GetEntryFileName(const String& kind, unsigned long long hash) const;
+    /// Remove least recently used entries from the index until the size budget is met, and return the files to delete after releasing the mutex. Called with the mutex held.
+    void EvictEntries(Vector<String>& evictedFiles);
+    /// Delete files of removed entries. Called without the mutex.
+    void DeleteFiles(const Vector<String>& fileNames);
+
+    /// Mutex for thread-safe access to the entry index.
+    mutable Mutex cacheMutex_;
+    /// Cache directory.
+    String cacheDir_;
+    /// Entries by file name without path.
+    HashMap<String, DerivedDataEntry> entries_;
+    /// Size budget in bytes.
+    unsigned long long sizeBudget_;
+    /// Total size of the cached entries in bytes.
+    unsigned long long totalSize_;
+    /// Counter for unique temporary file names.
+    unsigned tempFileCounter_;
+    /// Number of cache hits.
+    std::atomic<unsigned> numHits_;
+    /// Number of cache misses.
+    std::atomic<unsigned> numMisses_;
+};
+
+}
@@ -25,12 +25,20 @@
 
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
+#include "../Core/Thread.h"
+#include "../Core/WorkQueue.h"
 #include "../IO/File.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
 #include "../Resource/Decompress.h"
+#include "../Resource/DerivedDataCache.h"
 
 #include <SDL/SDL_surface.h>
+
+#ifdef DRY_SSE
+#include <emmintrin.h>
+#endif
+
 #define STB_IMAGE_IMPLEMENTATION
 #include <STB/stb_image.h>
 #define STB_IMAGE_WRITE_IMPLEMENTATION
@@ -217,6 +225,336 @@ struct DDSurfaceDesc2
     unsigned dwTextureStage_;
 };
 
+/// Minimum number of pixels for processing an image on the work queue.
+static const unsigned PARALLEL_IMAGE_MIN_PIXELS = 128 * 128;
+
+/// Parameters for processing image rows in parallel. Only the fields each operation needs are set.
+struct ImageRowsParams
+{
+    /// Source image.
+    const Image* image_{};
+    /// Source data.
+    const unsigned char* src_{};
+    /// Destination data.
+    unsigned char* dest_{};
+    /// Source width.
+    int srcWidth_{};
+    /// Source height.
+    int srcHeight_{};
+    /// Destination width.
+    int destWidth_{};
+    /// Destination height.
+    int destHeight_{};
+    /// Number of components.
+    unsigned components_{};
+    /// Row size in bytes.
+    unsigned rowSize_{};
+    /// Compressed format.
+    CompressedFormat format_{CF_NONE};
+};
+
+/// Image row processing function.
+typedef void (*ImageRowsFunction)(const ImageRowsParams& params, int rowStart, int rowEnd);
+
+/// Image row processing work item data.
+struct ImageRowsWork
+{
+    /// Function to call.
+    ImageRowsFunction function_;
+    /// Parameters.
+    const ImageRowsParams* params_;
+};
+
+static void ProcessImageRowsWork(const WorkItem* item, unsigned threadIndex)
+{
+    const auto* work = static_cast<const ImageRowsWork*>(item->aux_);
+    work->function_(*work->params_, (int)(size_t)item->start_, (int)(size_t)item->end_);
+}
+
+/// Process image rows split in blocks across the work queue. Runs directly when the image is small, there are no worker threads, or when called outside the main thread.
+static void ProcessImageRows(Context* context, int numRows, int rowPixels, ImageRowsFunction function, const ImageRowsParams& params)
+{
+    auto* queue = context ? context->GetSubsystem<WorkQueue>() : nullptr;
+    const int numThreads = (queue && Thread::IsMainThread() && !queue->IsCompleting()) ? (int)queue->GetNumThreads() : 0;
+
+    if (!numThreads || numRows < 2 || (unsigned)(numRows * rowPixels) < PARALLEL_IMAGE_MIN_PIXELS)
+    {
+        function(params, 0, numRows);
+        return;
+    }
+
+    // One block for each worker thread and the main thread
+    const int numBlocks = Min(numThreads + 1, numRows);
+    const int rowsPerBlock = (numRows + numBlocks - 1) / numBlocks;
+    ImageRowsWork work{ function, &params };
+
+    for (int rowStart{ 0 }; rowStart < numRows; rowStart += rowsPerBlock)
+    {
+        SharedPtr<WorkItem> item = queue->GetFreeItem();
+        item->priority_ = M_MAX_UNSIGNED;
+        item->workFunction_ = ProcessImageRowsWork;
+        item->aux_ = &work;
+        item->start_ = reinterpret_cast<void*>((size_t)rowStart);
+        item->end_ = reinterpret_cast<void*>((size_t)Min(rowStart + rowsPerBlock, numRows));
+        queue->AddWorkItem(item);
+    }
+
+    queue->Complete(M_MAX_UNSIGNED);
+}
+
+static void DecompressBlockRows(const ImageRowsParams& params, int rowStart, int rowEnd)
+{
+    const int width = params.srcWidth_;
+    const int height = Min(params.srcHeight_ - rowStart * 4, (rowEnd - rowStart) * 4);
+    const unsigned char* src = params.src_ + rowStart * params.rowSize_;
+    unsigned char* dest = params.dest_ + rowStart * 4 * width * 4;
+
+    switch (params.format_)
+    {
+    case CF_DXT1:
+    case CF_DXT3:
+    case CF_DXT5:
+        DecompressImageDXT(dest, src, width, height, 1, params.format_);
+        break;
+
+    case CF_ETC2_RGBA:
+        DecompressImageETC(dest, src, width, height, true);
+        break;
+
+    default:
+        DecompressImageETC(dest, src, width, height, false);
+        break;
+    }
+}
+
+static void FlipRows(const ImageRowsParams& params, int rowStart, int rowEnd)
+{
+    const int numRows = params.srcHeight_;
+    for (int y{ rowStart }; y < rowEnd; ++y)
+        memcpy(&params.dest_[(numRows - y - 1) * params.rowSize_], &params.src_[y * params.rowSize_], params.rowSize_);
+}
+
+static void FlipBlockRows(const ImageRowsParams& params, int rowStart, int rowEnd)
+{
+    const int numRows = params.srcHeight_;
+    const unsigned blockSize = params.components_;
+    for (int y{ rowStart }; y < rowEnd; ++y)
+    {
+        const unsigned char* src = params.src_ + y * params.rowSize_;
+        unsigned char* dest = params.dest_ + (numRows - y - 1) * params.rowSize_;
+
+        for (unsigned x{ 0 }; x < params.rowSize_; x += blockSize)
+            FlipBlockVertical(dest + x, src + x, params.format_);
+    }
+}
+
+static void ResizeRows(const ImageRowsParams& params, int rowStart, int rowEnd)
+{
+    const int width = params.destWidth_;
+    const int height = params.destHeight_;
+    const unsigned components = params.components_;
+
+    for (int y{ rowStart }; y < rowEnd; ++y)
+    {
+        for (int x{ 0 }; x < width; ++x)
+        {
+            // Calculate float coordinates between 0 - 1 for resampling
+            float xF = (params.srcWidth_ > 1) ? (float)x / (float)(width - 1) : 0.0f;
+            float yF = (params.srcHeight_ > 1) ? (float)y / (float)(height - 1) : 0.0f;
+            unsigned uintColor = params.image_->GetPixelBilinear(xF, yF).ToUInt();
+            unsigned char* dest = params.dest_ + (y * width + x) * components;
+            auto* src = (unsigned char*)&uintColor;
+
+            switch (components)
+            {
+            case 4:
+                dest[3] = src[3];
+                // Fall through
+            case 3:
+                dest[2] = src[2];
+                // Fall through
+            case 2:
+                dest[1] = src[1];
+                // Fall through
+            default:
+                dest[0] = src[0];
+                break;
+            }
+        }
+    }
+}
+
+static void ConvertRowsToRGBA(const ImageRowsParams& params, int rowStart, int rowEnd)
+{
+    const int width = params.srcWidth_;
+    const unsigned char* src = params.src_ + rowStart * width * params.components_;
+    unsigned char* dest = params.dest_ + rowStart * width * 4;
+    const int numPixels = (rowEnd - rowStart) * width;
+    int i{ 0 };
+
+    switch (params.components_)
+    {
+    case 1:
+#ifdef DRY_SSE
+        {
+            // Sixteen pixels at a time: replicate each luminance byte four times and set alpha
+            const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+            for (; i + 16 <= numPixels; i += 16)
+            {
+                const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+                const __m128i pairsLow = _mm_unpacklo_epi8(pixels, pixels);
+                const __m128i pairsHigh = _mm_unpackhi_epi8(pixels, pixels);
+                auto* out = reinterpret_cast<__m128i*>(dest);
+                _mm_storeu_si128(out, _mm_or_si128(_mm_unpacklo_epi16(pairsLow, pairsLow), alpha));
+                _mm_storeu_si128(out + 1, _mm_or_si128(_mm_unpackhi_epi16(pairsLow, pairsLow), alpha));
+                _mm_storeu_si128(out + 2, _mm_or_si128(_mm_unpacklo_epi16(pairsHigh, pairsHigh), alpha));
+                _mm_storeu_si128(out + 3, _mm_or_si128(_mm_unpackhi_epi16(pairsHigh, pairsHigh), alpha));
+                src += 16;
+                dest += 64;
+            }
+        }
+#endif
+        for (; i < numPixels; ++i)
+        {
+            unsigned char pixel = *src++;
+            *dest++ = pixel;
+            *dest++ = pixel;
+            *dest++ = pixel;
+            *dest++ = 255;
+        }
+        break;
+
+    case 2:
+        for (; i < numPixels; ++i)
+        {
+            unsigned char pixel = *src++;
+            *dest++ = pixel;
+            *dest++ = pixel;
+            *dest++ = pixel;
+            *dest++ = *src++;
+        }
+        break;
+
+    case 3:
+        for (; i < numPixels; ++i)
+        {
+            *dest++ = *src++;
+            *dest++ = *src++;
+            *dest++ = *src++;
+            *dest++ = 255;
+        }
+        break;
+
+    default:
+        assert(false);  // Should never reach nere
+        break;
+    }
+}
+
+static void CalculateMipRows(const ImageRowsParams& params, int yStart, int yEnd)
+{
+    const unsigned char* pixelDataIn = params.src_;
+    unsigned char* pixelDataOut = params.dest_;
+    const int srcWidth = params.srcWidth_;
+    const int widthOut = params.destWidth_;
+
+    switch (params.components_)
+    {
+    case 1:
+        for (int y{ yStart }; y < yEnd; ++y)
+        {
+            const unsigned char* inUpper = &pixelDataIn[(y * 2) * srcWidth];
+            const unsigned char* inLower = &pixelDataIn[(y * 2 + 1) * srcWidth];
+            unsigned char* out = &pixelDataOut[y * widthOut];
+
+            for (int x{ 0 }; x < widthOut; ++x)
+            {
+                out[x] = (unsigned char)(((unsigned)inUpper[x * 2] + inUpper[x * 2 + 1] +
+                                          inLower[x * 2] + inLower[x * 2 + 1]) >> 2);
+            }
+        }
+        break;
+
+    case 2:
+        for (int y{ yStart }; y < yEnd; ++y)
+        {
+            const unsigned char* inUpper = &pixelDataIn[(y * 2) * srcWidth * 2];
+            const unsigned char* inLower = &pixelDataIn[(y * 2 + 1) * srcWidth * 2];
+            unsigned char* out = &pixelDataOut[y * widthOut * 2];
+
+            for (int x{ 0 }; x < widthOut * 2; x += 2)
+            {
+                out[x] = (unsigned char)(((unsigned)inUpper[x * 2] + inUpper[x * 2 + 2] +
+                                          inLower[x * 2] + inLower[x * 2 + 2]) >> 2);
+                out[x + 1] = (unsigned char)(((unsigned)inUpper[x * 2 + 1] + inUpper[x * 2 + 3] +
+                                              inLower[x * 2 + 1] + inLower[x * 2 + 3]) >> 2);
+            }
+        }
+        break;
+
+    case 3:
+        for (int y{ yStart }; y < yEnd; ++y)
+        {
+            const unsigned char* inUpper = &pixelDataIn[(y * 2) * srcWidth * 3];
+            const unsigned char* inLower = &pixelDataIn[(y * 2 + 1) * srcWidth * 3];
+            unsigned char* out = &pixelDataOut[y * widthOut * 3];
+
+            for (int x{ 0 }; x < widthOut * 3; x += 3)
+            {
+                out[x] = (unsigned char)(((unsigned)inUpper[x * 2] + inUpper[x * 2 + 3] +
+                                          inLower[x * 2] + inLower[x * 2 + 3]) >> 2);
+                out[x + 1] = (unsigned char)(((unsigned)inUpper[x * 2 + 1] + inUpper[x * 2 + 4] +
+                                              inLower[x * 2 + 1] + inLower[x * 2 + 4]) >> 2);
+                out[x + 2] = (unsigned char)(((unsigned)inUpper[x * 2 + 2] + inUpper[x * 2 + 5] +
+                                              inLower[x * 2 + 2] + inLower[x * 2 + 5]) >> 2);
+            }
+        }
+        break;
+
+    case 4:
+        for (int y{ yStart }; y < yEnd; ++y)
+        {
+            const unsigned char* inUpper = &pixelDataIn[(y * 2) * srcWidth * 4];
+            const unsigned char* inLower = &pixelDataIn[(y * 2 + 1) * srcWidth * 4];
+            unsigned char* out = &pixelDataOut[y * widthOut * 4];
+            int x{ 0 };
+
+#ifdef DRY_SSE
+            // Two output pixels at a time: widen to 16 bits, sum the 2x2 footprint and shift, which matches the scalar rounding
+            const __m128i zero = _mm_setzero_si128();
+            for (; x + 8 <= widthOut * 4; x += 8)
+            {
+                const __m128i upper = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&inUpper[x * 2]));
+                const __m128i lower = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&inLower[x * 2]));
+                const __m128i sumLeft = _mm_add_epi16(_mm_unpacklo_epi8(upper, zero), _mm_unpacklo_epi8(lower, zero));
+                const __m128i sumRight = _mm_add_epi16(_mm_unpackhi_epi8(upper, zero), _mm_unpackhi_epi8(lower, zero));
+                const __m128i pixelLeft = _mm_add_epi16(sumLeft, _mm_srli_si128(sumLeft, 8));
+                const __m128i pixelRight = _mm_add_epi16(sumRight, _mm_srli_si128(sumRight, 8));
+                const __m128i result = _mm_srli_epi16(_mm_unpacklo_epi64(pixelLeft, pixelRight), 2);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(&out[x]), _mm_packus_epi16(result, zero));
+            }
+#endif
+
+            for (; x < widthOut * 4; x += 4)
+            {
+                out[x] = (unsigned char)(((unsigned)inUpper[x * 2] + inUpper[x * 2 + 4] +
+                                          inLower[x * 2] + inLower[x * 2 + 4]) >> 2);
+                out[x + 1] = (unsigned char)(((unsigned)inUpper[x * 2 + 1] + inUpper[x * 2 + 5] +
+                                              inLower[x * 2 + 1] + inLower[x * 2 + 5]) >> 2);
+                out[x + 2] = (unsigned char)(((unsigned)inUpper[x * 2 + 2] + inUpper[x * 2 + 6] +
+                                              inLower[x * 2 + 2] + inLower[x * 2 + 6]) >> 2);
+                out[x + 3] = (unsigned char)(((unsigned)inUpper[x * 2 + 3] + inUpper[x * 2 + 7] +
+                                              inLower[x * 2 + 3] + inLower[x * 2 + 7]) >> 2);
+            }
+        }
+        break;
+
+    default:
+        assert(false);  // Should never reach here
+        break;
+    }
+}
+
 bool CompressedLevel::Decompress(unsigned char* dest) const
 {
     if (!data_)
@@ -227,16 +565,27 @@ bool CompressedLevel::Decompress(unsigned char* dest) const
     case CF_DXT1:
     case CF_DXT3:
     case CF_DXT5:
-        DecompressImageDXT(dest, data_, width_, height_, depth_, format_);
-        return true;
+        if (depth_ > 1)
+        {
+            DecompressImageDXT(dest, data_, width_, height_, depth_, format_);
+            return true;
+        }
+        // Fall through
 
-    // ETC2 format is compatible with ETC1, so we just use the same function.
     case CF_ETC1:
     case CF_ETC2_RGB:
-        DecompressImageETC(dest, data_, width_, height_, false);
-        return true;
     case CF_ETC2_RGBA:
-        DecompressImageETC(dest, data_, width_, height_, true);
+        {
+            // Rows of 4x4 blocks are independent, so decompress them in parallel
+            ImageRowsParams params;
+            params.src_ = data_;
+            params.dest_ = dest;
+            params.srcWidth_ = width_;
+            params.srcHeight_ = height_;
+            params.rowSize_ = rowSize_;
+            params.format_ = format_;
+            ProcessImageRows(context_, rows_, width_ * 4, DecompressBlockRows, params);
+        }
         return true;
 
     case CF_PVRTC_RGB_2BPP:
@@ -1110,10 +1459,13 @@ bool Image::FlipVertical()
     if (!IsCompressed())
     {
         SharedArrayPtr<unsigned char> newData(new unsigned char[width_ * height_ * components_]);
-        unsigned rowSize = width_ * components_;
 
-        for (int y{ 0 }; y < height_; ++y)
-            memcpy(&newData[(height_ - y - 1) * rowSize], &data_[y * rowSize], rowSize);
+        ImageRowsParams params;
+        params.src_ = data_.Get();
+        params.dest_ = newData.Get();
+        params.srcHeight_ = height_;
+        params.rowSize_ = width_ * components_;
+        ProcessImageRows(context_, height_, width_, FlipRows, params);
 
         data_ = newData;
     }
@@ -1138,14 +1490,14 @@ bool Image::FlipVertical()
                 return false;
             }
 
-            for (unsigned y{ 0 }; y < level.rows_; ++y)
-            {
-                unsigned char* src = level.data_ + y * level.rowSize_;
-                unsigned char* dest = newData.Get() + dataOffset + (level.rows_ - y - 1) * level.rowSize_;
-
-                for (unsigned x{ 0 }; x < level.rowSize_; x += level.blockSize_)
-                    FlipBlockVertical(dest + x, src + x, compressedFormat_);
-            }
+            ImageRowsParams params;
+            params.src_ = level.data_;
+            params.dest_ = newData.Get() + dataOffset;
+            params.srcHeight_ = level.rows_;
+            params.rowSize_ = level.rowSize_;
+            params.components_ = level.blockSize_;
+            params.format_ = compressedFormat_;
+            ProcessImageRows(context_, level.rows_, level.width_ * 4, FlipBlockRows, params);
 
             dataOffset += level.dataSize_;
         }
@@ -1177,34 +1529,16 @@ bool Image::Resize(int width, int height)
 
     /// \todo Reducing image size does not sample all needed pixels
     SharedArrayPtr<unsigned char> newData(new unsigned char[width * height * components_]);
-    for (int y{ 0 }; y < height; ++y)
-    {
-        for (int x{ 0 }; x < width; ++x)
-        {
-            // Calculate float coordinates between 0 - 1 for resampling
-            float xF = (width_ > 1) ? (float)x / (float)(width - 1) : 0.0f;
-            float yF = (height_ > 1) ? (float)y / (float)(height - 1) : 0.0f;
-            unsigned uintColor = GetPixelBilinear(xF, yF).ToUInt();
-            unsigned char* dest = newData + (y * width + x) * components_;
-            auto* src = (unsigned char*)&uintColor;
 
-            switch (components_)
-            {
-            case 4:
-                dest[3] = src[3];
-                // Fall through
-            case 3:
-                dest[2] = src[2];
-                // Fall through
-            case 2:
-                dest[1] = src[1];
-                // Fall through
-            default:
-                dest[0] = src[0];
-                break;
-            }
-        }
-    }
+    ImageRowsParams params;
+    params.image_ = this;
+    params.dest_ = newData.Get();
+    params.srcWidth_ = width_;
+    params.srcHeight_ = height_;
+    params.destWidth_ = width;
+    params.destHeight_ = height;
+    params.components_ = components_;
+    ProcessImageRows(context_, height, width, ResizeRows, params);
 
     width_ = width;
     height_ = height;
@@ -1695,84 +2029,13 @@ SharedPtr<Image> Image::GetNextLevel() const
     // 2D case
     else if (depth_ == 1)
     {
-        switch (components_)
-        {
-        case 1:
-            for (int y{ 0 }; y < heightOut; ++y)
-            {
-                const unsigned char* inUpper = &pixelDataIn[(y * 2) * width_];
-                const unsigned char* inLower = &pixelDataIn[(y * 2 + 1) * width_];
-                unsigned char* out = &pixelDataOut[y * widthOut];
-
-                for (int x{ 0 }; x < widthOut; ++x)
-                {
-                    out[x] = (unsigned char)(((unsigned)inUpper[x * 2] + inUpper[x * 2 + 1] +
-                                              inLower[x * 2] + inLower[x * 2 + 1]) >> 2);
-                }
-            }
-            break;
-
-        case 2:
-            for (int y{ 0 }; y < heightOut; ++y)
-            {
-                const unsigned char* inUpper = &pixelDataIn[(y * 2) * width_ * 2];
-                const unsigned char* inLower = &pixelDataIn[(y * 2 + 1) * width_ * 2];
-                unsigned char* out = &pixelDataOut[y * widthOut * 2];
-
-                for (int x{ 0 }; x < widthOut * 2; x += 2)
-                {
-                    out[x] = (unsigned char)(((unsigned)inUpper[x * 2] + inUpper[x * 2 + 2] +
-                                              inLower[x * 2] + inLower[x * 2 + 2]) >> 2);
-                    out[x + 1] = (unsigned char)(((unsigned)inUpper[x * 2 + 1] + inUpper[x * 2 + 3] +
-                                                  inLower[x * 2 + 1] + inLower[x * 2 + 3]) >> 2);
-                }
-            }
-            break;
-
-        case 3:
-            for (int y{ 0 }; y < heightOut; ++y)
-            {
-                const unsigned char* inUpper = &pixelDataIn[(y * 2) * width_ * 3];
-                const unsigned char* inLower = &pixelDataIn[(y * 2 + 1) * width_ * 3];
-                unsigned char* out = &pixelDataOut[y * widthOut * 3];
-
-                for (int x{ 0 }; x < widthOut * 3; x += 3)
-                {
-                    out[x] = (unsigned char)(((unsigned)inUpper[x * 2] + inUpper[x * 2 + 3] +
-                                              inLower[x * 2] + inLower[x * 2 + 3]) >> 2);
-                    out[x + 1] = (unsigned char)(((unsigned)inUpper[x * 2 + 1] + inUpper[x * 2 + 4] +
-                                                  inLower[x * 2 + 1] + inLower[x * 2 + 4]) >> 2);
-                    out[x + 2] = (unsigned char)(((unsigned)inUpper[x * 2 + 2] + inUpper[x * 2 + 5] +
-                                                  inLower[x * 2 + 2] + inLower[x * 2 + 5]) >> 2);
-                }
-            }
-            break;
-
-        case 4:
-            for (int y{ 0 }; y < heightOut; ++y)
-            {
-                const unsigned char* inUpper = &pixelDataIn[(y * 2) * width_ * 4];
-                const unsigned char* inLower = &pixelDataIn[(y * 2 + 1) * width_ * 4];
-                unsigned char* out = &pixelDataOut[y * widthOut * 4];
-
-                for (int x{ 0 }; x < widthOut * 4; x += 4)
-                {
-                    out[x] = (unsigned char)(((unsigned)inUpper[x * 2] + inUpper[x * 2 + 4] +
-                                              inLower[x * 2] + inLower[x * 2 + 4]) >> 2);
-                    out[x + 1] = (unsigned char)(((unsigned)inUpper[x * 2 + 1] + inUpper[x * 2 + 5] +
-                                                  inLower[x * 2 + 1] + inLower[x * 2 + 5]) >> 2);
-                    out[x + 2] = (unsigned char)(((unsigned)inUpper[x * 2 + 2] + inUpper[x * 2 + 6] +
-                                                  inLower[x * 2 + 2] + inLower[x * 2 + 6]) >> 2);
-                    out[x + 3] = (unsigned char)(((unsigned)inUpper[x * 2 + 3] + inUpper[x * 2 + 7] +
-                                                  inLower[x * 2 + 3] + inLower[x * 2 + 7]) >> 2);
-                }
-            }
-            break;
-
-        default:
-            assert(false);  // Should never reach here
-            break;
-        }
+        ImageRowsParams params;
+        params.src_ = pixelDataIn;
+        params.dest_ = pixelDataOut;
+        params.srcWidth_ = width_;
+        params.destWidth_ = widthOut;
+        params.components_ = components_;
+        ProcessImageRows(context_, heightOut, widthOut, CalculateMipRows, params);
     }
     // 3D case
     else
@@ -1933,47 +2196,13 @@ SharedPtr<Image> Image::ConvertToRGBA() const
     SharedPtr<Image> ret(new Image(context_));
     ret->SetSize(width_, height_, depth_, 4);
 
-    const unsigned char* src = data_;
-    unsigned char* dest = ret->GetData();
-
-    switch (components_)
-    {
-    case 1:
-        for (unsigned i{ 0 }; i < static_cast<unsigned>(width_ * height_ * depth_); ++i)
-        {
-            unsigned char pixel = *src++;
-            *dest++ = pixel;
-            *dest++ = pixel;
-            *dest++ = pixel;
-            *dest++ = 255;
-        }
-        break;
-
-    case 2:
-        for (unsigned i{ 0 }; i < static_cast<unsigned>(width_ * height_ * depth_); ++i)
-        {
-            unsigned char pixel = *src++;
-            *dest++ = pixel;
-            *dest++ = pixel;
-            *dest++ = pixel;
-            *dest++ = *src++;
-        }
-        break;
-
-    case 3:
-        for (unsigned i{ 0 }; i < static_cast<unsigned>(width_ * height_ * depth_); ++i)
-        {
-            *dest++ = *src++;
-            *dest++ = *src++;
-            *dest++ = *src++;
-            *dest++ = 255;
-        }
-        break;
-
-    default:
-        assert(false);  // Should never reach nere
-        break;
-    }
+    // Depth slices are stored one after another, so treat them as further rows
+    ImageRowsParams params;
+    params.src_ = data_.Get();
+    params.dest_ = ret->GetData();
+    params.srcWidth_ = width_;
+    params.components_ = components_;
+    ProcessImageRows(context_, height_ * depth_, width_, ConvertRowsToRGBA, params);
 
     return ret;
 }
@@ -1993,6 +2222,7 @@ CompressedLevel Image::GetCompressedLevel(unsigned index) const
         return level;
     }
 
+    level.context_ = context_;
     level.format_ = compressedFormat_;
     level.width_ = width_;
     level.height_ = height_;
@@ -2122,7 +2352,27 @@ SharedPtr<Image> Image::GetDecompressedImage() const
 
     auto decompressedImage = MakeShared<Image>(context_);
     decompressedImage->SetSize(compressedLevel.width_, compressedLevel.height_, 4);
-    compressedLevel.Decompress(decompressedImage->GetData());
+
+    // Decompression of large images is slow, so check for a previous result keyed by the compressed data
+    auto* derivedDataCache = GetSubsystem<DerivedDataCache>();
+    if (!derivedDataCache || !derivedDataCache->IsEnabled() || !compressedLevel.data_)
+    {
+        compressedLevel.Decompress(decompressedImage->GetData());
+        return decompressedImage;
+    }
+
+    DerivedDataHash hash;
+    hash.AddValue(compressedLevel.format_);
+    hash.AddValue(compressedLevel.width_);
+    hash.AddValue(compressedLevel.height_);
+    hash.Add(compressedLevel.data_, compressedLevel.dataSize_);
+
+    const unsigned decompressedSize = (unsigned)(compressedLevel.width_ * compressedLevel.height_ * 4);
+    PODVector<unsigned char> cachedData;
+    if (derivedDataCache->Load("DecompressedImage", hash.GetValue(), cachedData) && cachedData.Size() == decompressedSize)
+        memcpy(decompressedImage->GetData(), &cachedData[0], decompressedSize);
+    else if (compressedLevel.Decompress(decompressedImage->GetData()))
+        derivedDataCache->Store("DecompressedImage", hash.GetValue(), decompressedImage->GetData(), decompressedSize);
 
     return decompressedImage;
 }
@@ -58,6 +58,8 @@ struct CompressedLevel
     /// Decompress to RGBA. The destination buffer required is width * height * 4 bytes. Return true if successful.
     bool Decompress(unsigned char* dest) const;
 
+    /// Context for decompressing on the work queue. Null decompresses on the calling thread.
+    Context* context_{};
     /// Compressed image data.
     unsigned char* data_{};
     /// Compression format.
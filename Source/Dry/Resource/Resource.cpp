@@ -35,7 +35,9 @@ namespace Dry
 Resource::Resource(Context* context) :
     Object(context),
     memoryUse_(0),
-    asyncLoadState_(ASYNC_DONE)
+    asyncLoadState_(ASYNC_DONE),
+    requestedDistance_(M_INFINITY),
+    streamingDistance_(M_INFINITY)
 {
 }
 
@@ -118,6 +120,12 @@ void Resource::SetAsyncLoadState(AsyncLoadState newState)
     asyncLoadState_ = newState;
 }
 
+void Resource::ApplyStreamingDistance()
+{
+    streamingDistance_ = requestedDistance_;
+    requestedDistance_ = M_INFINITY;
+}
+
 unsigned Resource::GetUseTimer()
 {
     // If more references than the resource cache, return always 0 & reset the timer
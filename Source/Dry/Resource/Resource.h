@@ -82,6 +82,18 @@ public:
     void ResetUseTimer();
     /// Set the asynchronous loading state. Called by ResourceCache. Resources in the middle of asynchronous loading are not normally returned to user.
     void SetAsyncLoadState(AsyncLoadState newState);
+    /// Set residency level for streaming. Level 0 is fully resident, higher levels keep less data resident. Return true if changed. Called by ResourceCache from the main thread.
+    virtual bool SetResidencyLevel(unsigned level) { return false; }
+
+    /// Report a view distance the resource is needed at this frame. The nearest distance of the frame determines the streaming priority. Call only from the main thread.
+    void UpdateStreamingDistance(float distance)
+    {
+        if (distance < requestedDistance_)
+            requestedDistance_ = distance;
+    }
+
+    /// Begin a new streaming frame: latch the nearest distance reported during the previous one. Called by ResourceCache.
+    virtual void ApplyStreamingDistance();
 
     /// Return name.
     const String& GetName() const { return name_; }
@@ -98,6 +110,21 @@ public:
     /// Return the asynchronous loading state.
     AsyncLoadState GetAsyncLoadState() const { return asyncLoadState_; }
 
+    /// Return number of residency levels. A resource that can not be partially resident has one.
+    virtual unsigned GetNumResidencyLevels() const { return 1; }
+
+    /// Return current residency level.
+    virtual unsigned GetResidencyLevel() const { return 0; }
+
+    /// Return estimated memory use in bytes at a residency level.
+    virtual unsigned GetResidencyMemoryUse(unsigned level) const { return memoryUse_; }
+
+    /// Return the nearest view distance reported during the previous frame, or infinity if not seen.
+    float GetStreamingDistance() const { return streamingDistance_; }
+
+    /// Return streaming priority from the view distance. Zero when not seen during the previous frame.
+    float GetStreamingPriority() const { return streamingDistance_ < M_INFINITY ? 1.f / (1.f + Max(streamingDistance_, 0.f)) : 0.f; }
+
 private:
     /// Name.
     String name_;
@@ -109,6 +136,10 @@ private:
     unsigned memoryUse_;
     /// Asynchronous loading state.
     AsyncLoadState asyncLoadState_;
+    /// Nearest view distance reported during the current frame.
+    float requestedDistance_;
+    /// Nearest view distance reported during the previous frame.
+    float streamingDistance_;
 };
 
 /// Base class for resources that support arbitrary metadata stored. Metadata serialization shall be implemented in derived classes.
@@ -27,6 +27,7 @@
 #include "../Core/CoreEvents.h"
 #include "../Core/Profiler.h"
 #include "../Core/WorkQueue.h"
+#include "../IO/AsyncFileReader.h"
 #include "../IO/FileSystem.h"
 #include "../IO/FileWatcher.h"
 #include "../IO/Log.h"
@@ -74,7 +75,9 @@ ResourceCache::ResourceCache(Context* context) :
     returnFailedResources_(false),
     searchPackagesFirst_(true),
     isRouting_(false),
-    finishBackgroundResourcesMs_(5)
+    finishBackgroundResourcesMs_(5),
+    streamingEnabled_(false),
+    maxStreamingChanges_(8)
 {
     // Register Resource library object factories
     RegisterResourceLibrary(context_);
@@ -542,6 +545,48 @@ SharedPtr<File> ResourceCache::GetFile(const String& name, bool sendEventOnFailu
     return SharedPtr<File>();
 }
 
+void ResourceCache::ReadFilesAsync(const Vector<String>& names, Vector<SharedPtr<AsyncReadRequest> >& dest)
+{
+    dest.Clear();
+    dest.Resize(names.Size());
+
+    auto* reader = GetSubsystem<AsyncFileReader>();
+    if (!reader)
+        return;
+
+    {
+        MutexLock lock(resourceMutex_);
+
+        for (unsigned i{ 0 }; i < names.Size(); ++i)
+        {
+            String sanitatedName = SanitateResourceName(names[i]);
+            if (!isRouting_)
+            {
+                isRouting_ = true;
+                for (unsigned j{ 0 }; j < resourceRouters_.Size(); ++j)
+                    resourceRouters_[j]->Route(sanitatedName, RESOURCE_GETFILE);
+                isRouting_ = false;
+            }
+
+            String fileName;
+            unsigned offset{ 0 };
+            unsigned size{ 0 };
+            if (sanitatedName.IsEmpty() || !FindFileRange(sanitatedName, fileName, offset, size))
+                continue;
+
+            SharedPtr<AsyncReadRequest> request(new AsyncReadRequest());
+            request->fileName_ = fileName;
+            request->resourceName_ = sanitatedName;
+            request->offset_ = offset;
+            request->size_ = size;
+            reader->Read(request);
+            dest[i] = request;
+        }
+    }
+
+    reader->Submit();
+}
+
 Resource* ResourceCache::GetExistingResource(StringHash type, const String& name)
 {
     String sanitatedName = SanitateResourceName(name);
@@ -1043,6 +1088,7 @@ void ResourceCache::UpdateResourceGroup(StringHash type)
     {
         unsigned totalSize = 0;
         unsigned oldestTimer = 0;
+        float lowestPriority = M_INFINITY;
         HashMap<StringHash, SharedPtr<Resource> >::Iterator oldestResource = i->second_.resources_.End();
 
         for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
@@ -1050,8 +1096,14 @@ void ResourceCache::UpdateResourceGroup(StringHash type)
         {
             totalSize += j->second_->GetMemoryUse();
             unsigned useTimer = j->second_->GetUseTimer();
-            if (useTimer > oldestTimer)
+            if (!useTimer)
+                continue;
+
+            // Prefer the resource with the lowest streaming priority, then the least recently used
+            const float priority = j->second_->GetStreamingPriority();
+            if (priority < lowestPriority || (priority == lowestPriority && useTimer > oldestTimer))
             {
+                lowestPriority = priority;
                 oldestTimer = useTimer;
                 oldestResource = j;
             }
@@ -1099,6 +1151,117 @@ void ResourceCache::HandleBeginFrame(StringHash eventType, VariantMap& eventData
         backgroundLoader_->FinishResources(finishBackgroundResourcesMs_);
     }
 #endif
+
+    if (streamingEnabled_)
+        UpdateStreaming();
+}
+
+static bool CompareStreamingPriority(Resource* lhs, Resource* rhs)
+{
+    return lhs->GetStreamingPriority() > rhs->GetStreamingPriority();
+}
+
+void ResourceCache::UpdateStreaming()
+{
+    DRY_PROFILE(UpdateStreaming);
+
+    unsigned numChanges = 0;
+
+    for (HashMap<StringHash, ResourceGroup>::Iterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
+    {
+        ResourceGroup& group = i->second_;
+
+        bool streamable{ false };
+        for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = group.resources_.Begin(); j != group.resources_.End(); ++j)
+        {
+            Resource* resource = j->second_;
+            resource->ApplyStreamingDistance();
+            if (resource->GetNumResidencyLevels() > 1 && resource->GetAsyncLoadState() == ASYNC_DONE)
+                streamable = true;
+        }
+
+        if (!streamable || numChanges >= maxStreamingChanges_)
+            continue;
+
+        // Release unused resources first, as that is cheaper than lowering the residency of used ones. This may
+        // destroy resources, so collect the streaming resources only afterward
+        UpdateResourceGroup(i->first_);
+
+        streamingResources_.Clear();
+        for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = group.resources_.Begin(); j != group.resources_.End(); ++j)
+        {
+            Resource* resource = j->second_;
+            if (resource->GetNumResidencyLevels() > 1 && resource->GetAsyncLoadState() == ASYNC_DONE)
+                streamingResources_.Push(resource);
+        }
+
+        Sort(streamingResources_.Begin(), streamingResources_.End(), CompareStreamingPriority);
+
+        const unsigned long long budget = group.memoryBudget_;
+        unsigned long long memoryUse = group.memoryUse_;
+
+        // When over budget, lower the residency of the least important resources first
+        for (int j{ static_cast<int>(streamingResources_.Size()) - 1 }; j >= 0 && budget && memoryUse > budget; --j)
+        {
+            Resource* resource = streamingResources_[j];
+            while (memoryUse > budget && numChanges < maxStreamingChanges_ &&
+                   resource->GetResidencyLevel() + 1 < resource->GetNumResidencyLevels())
+            {
+                const unsigned oldUse = resource->GetMemoryUse();
+                if (!resource->SetResidencyLevel(resource->GetResidencyLevel() + 1))
+                    break;
+
+                memoryUse = memoryUse - oldUse + resource->GetMemoryUse();
+                ++numChanges;
+            }
+        }
+
+        // Raise the residency of visible resources by one level at a time, most important first. Make room by
+        // lowering the residency of less important resources if necessary
+        unsigned lowest = streamingResources_.Size();
+        for (unsigned j{ 0 }; j < streamingResources_.Size() && numChanges < maxStreamingChanges_; ++j)
+        {
+            Resource* resource = streamingResources_[j];
+            const float priority = resource->GetStreamingPriority();
+            if (priority <= 0.f)
+                break;
+
+            const unsigned level = resource->GetResidencyLevel();
+            if (!level)
+                continue;
+
+            const unsigned oldUse = resource->GetMemoryUse();
+            const unsigned newUse = resource->GetResidencyMemoryUse(level - 1);
+
+            while (budget && memoryUse - oldUse + newUse > budget && lowest > j + 1 && numChanges < maxStreamingChanges_)
+            {
+                Resource* victim = streamingResources_[lowest - 1];
+                const unsigned victimUse = victim->GetMemoryUse();
+                if (victim->GetStreamingPriority() >= priority || victim->GetResidencyLevel() + 1 >= victim->GetNumResidencyLevels() ||
+                    !victim->SetResidencyLevel(victim->GetResidencyLevel() + 1))
+                {
+                    --lowest;
+                    continue;
+                }
+
+                memoryUse = memoryUse - victimUse + victim->GetMemoryUse();
+                ++numChanges;
+            }
+
+            if (numChanges >= maxStreamingChanges_ || (budget && memoryUse - oldUse + newUse > budget))
+                break;
+
+            if (resource->SetResidencyLevel(level - 1))
+            {
+                memoryUse = memoryUse - oldUse + resource->GetMemoryUse();
+                ++numChanges;
+            }
+        }
+
+        group.memoryUse_ = memoryUse;
+    }
+
+    streamingResources_.Clear();
 }
 
 File* ResourceCache::SearchResourceDirs(const String& name)
@@ -1134,6 +1297,56 @@ File* ResourceCache::SearchPackages(const String& name)
     return nullptr;
 }
 
+bool ResourceCache::FindFileRange(const String& name, String& fileName, unsigned& offset, unsigned& size)
+{
+    auto* fileSystem = GetSubsystem<FileSystem>();
+
+    // Follow the same search order as GetFile()
+    for (unsigned pass{ 0 }; pass < 2; ++pass)
+    {
+        if ((pass == 0) == searchPackagesFirst_)
+        {
+            for (unsigned i{ 0 }; i < packages_.Size(); ++i)
+            {
+                const PackageEntry* entry = packages_[i]->GetEntry(name);
+                if (!entry)
+                    continue;
+
+                // Compressed entries need to be decompressed block by block by File, and zero size would read to the end
+                if (packages_[i]->IsCompressed() || !entry->size_)
+                    return false;
+
+                fileName = packages_[i]->GetName();
+                offset = entry->offset_;
+                size = entry->size_;
+                return true;
+            }
+        }
+        else
+        {
+            for (unsigned i{ 0 }; i < resourceDirs_.Size(); ++i)
+            {
+                if (fileSystem->FileExists(resourceDirs_[i] + name))
+                {
+                    fileName = resourceDirs_[i] + name;
+                    offset = size = 0;
+                    return true;
+                }
+            }
+
+            // Fallback using absolute path
+            if (fileSystem->FileExists(name))
+            {
+                fileName = name;
+                offset = size = 0;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
 void RegisterResourceLibrary(Context* context)
 {
     Image::RegisterObject(context);
@@ -34,6 +34,7 @@
 namespace Dry
 {
 
+struct AsyncReadRequest;
 class BackgroundLoader;
 class FileWatcher;
 class PackageFile;
@@ -121,6 +122,10 @@ public:
     void ReloadResourceWithDependencies(const String& fileName);
     /// Set memory budget for a specific resource type, default 0 is unlimited.
     void SetMemoryBudget(StringHash type, unsigned long long budget);
+    /// Enable or disable resource streaming. When enabled, the residency of partially resident resources is adjusted each frame by view distance priority to fit the memory budgets. Default false.
+    void SetStreamingEnabled(bool enable) { streamingEnabled_ = enable; }
+    /// Set maximum number of residency level changes per frame when streaming. Default 8.
+    void SetMaxStreamingChanges(unsigned num) { maxStreamingChanges_ = Max(num, 1U); }
     /// Enable or disable automatic reloading of resources as files are modified. Default false.
     void SetAutoReloadResources(bool enable);
     /// Enable or disable returning resources that failed to load. Default false. This may be useful in editing to not lose resource ref attributes.
@@ -139,6 +144,8 @@ public:
 
     /// Open and return a file from the resource load paths or from inside a package file. If not found, use a fallback search with absolute path. Return null if fails. Can be called from outside the main thread.
     SharedPtr<File> GetFile(const String& name, bool sendEventOnFailure = true);
+    /// Read several files from the resource load paths or uncompressed package files with one batch of asynchronous reads. A null request is returned for a file that must be opened with GetFile() instead, such as a compressed package entry or a missing file. Can be called from outside the main thread.
+    void ReadFilesAsync(const Vector<String>& names, Vector<SharedPtr<AsyncReadRequest> >& dest);
     /// Return a resource by type and name. Load if not loaded yet. Return null if not found or if fails, unless SetReturnFailedResources(true) has been called. Can be called only from the main thread.
     Resource* GetResource(StringHash type, const String& name, bool sendEventOnFailure = true);
     /// Load a resource without storing it in the resource cache. Return null if not found or if fails. Can be called from outside the main thread if the resource itself is safe to load completely (it does not possess for example GPU data.)
@@ -187,6 +194,12 @@ public:
     /// Return whether automatic resource reloading is enabled.
     bool GetAutoReloadResources() const { return autoReloadResources_; }
 
+    /// Return whether resource streaming is enabled.
+    bool IsStreamingEnabled() const { return streamingEnabled_; }
+
+    /// Return maximum number of residency level changes per frame when streaming.
+    unsigned GetMaxStreamingChanges() const { return maxStreamingChanges_; }
+
     /// Return whether resources that failed to load are returned.
     bool GetReturnFailedResources() const { return returnFailedResources_; }
 
@@ -222,12 +235,16 @@ private:
     void ReleasePackageResources(PackageFile* package, bool force = false);
     /// Update a resource group. Recalculate memory use and release resources if over memory budget.
     void UpdateResourceGroup(StringHash type);
+    /// Adjust the residency of partially resident resources to their streaming priority and the memory budgets.
+    void UpdateStreaming();
     /// Handle begin frame event. Automatic resource reloads and the finalization of background loaded resources are processed here.
     void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
     /// Search FileSystem for file.
     File* SearchResourceDirs(const String& name);
     /// Search resource packages for file.
     File* SearchPackages(const String& name);
+    /// Find the file name and byte range holding a resource for a direct read. Return false if not found or if the data is compressed.
+    bool FindFileRange(const String& name, String& fileName, unsigned& offset, unsigned& size);
 
     /// Mutex for thread-safe access to the resource directories, resource packages and resource dependencies.
     mutable Mutex resourceMutex_;
@@ -255,6 +272,12 @@ private:
     mutable bool isRouting_;
     /// How many milliseconds maximum per frame to spend on finishing background loaded resources.
     int finishBackgroundResourcesMs_;
+    /// Resource streaming flag.
+    bool streamingEnabled_;
+    /// Maximum residency level changes per frame.
+    unsigned maxStreamingChanges_;
+    /// Partially resident resources of a group sorted by priority. Used during the streaming update.
+    PODVector<Resource*> streamingResources_;
 };
 
 template <class T> T* ResourceCache::GetExistingResource(const String& name)
@@ -33,6 +33,7 @@
 #include <Dry/Graphics/IndexBuffer.h>
 #include <Dry/Graphics/Light.h>
 #include <Dry/Graphics/Material.h>
+#include <Dry/Graphics/MeshOptimizer.h>
 #include <Dry/Graphics/Octree.h>
 #include <Dry/Graphics/VertexBuffer.h>
 #include <Dry/Graphics/Zone.h>
@@ -164,6 +165,16 @@ bool noOverwriteTexture_ = false;
 bool noOverwriteNewerTexture_ = false;
 bool checkUniqueModel_ = true;
 bool moveToBindPose_ = false;
+bool compressAnimations_ = false;
+float animationPositionTolerance_ = DEFAULT_ANIMATION_POSITION_TOLERANCE;
+float animationRotationTolerance_ = DEFAULT_ANIMATION_ROTATION_TOLERANCE;
+float animationScaleTolerance_ = DEFAULT_ANIMATION_SCALE_TOLERANCE;
+unsigned generatedLodLevels_ = 0;
+float lodReduction_ = DEFAULT_LOD_REDUCTION;
+float lodDistanceStep_ = DEFAULT_LOD_DISTANCE_STEP;
+bool optimizeMeshes_ = false;
+bool quantizeTexCoords_ = false;
+unsigned meshletTriangles_ = 0;
 unsigned maxBones_ = 64;
 Vector<String> nonSkinningBoneIncludes_;
 Vector<String> nonSkinningBoneExcludes_;
@@ -307,6 +318,18 @@ void Run(const Vector<String>& arguments)
             "-split <start> <end> (animation model only)\n"
             "            Split animation, will only import from start frame to end frame\n"
             "-np         Do not suppress $fbx pivot nodes (FBX files only)\n"
+            "-ac [<pos> <rot> <scale>]\n"
+            "            Compress animations: remove keyframes that interpolation reproduces\n"
+            "            within the position, rotation (degrees) and scale tolerances, and\n"
+            "            save keyframes quantized. Default tolerances 0.0005 0.05 0.0005\n"
+            "-gl [<levels> <reduction> <distance step>]\n"
+            "            Generate model LOD levels by mesh simplification, each keeping a ratio\n"
+            "            of the previous level's triangles. Default 3 0.5 10\n"
+            "-mo         Optimize meshes for the vertex cache, overdraw and vertex fetch\n"
+            "-qt         Quantize 2D texture coordinates to half floats\n"
+            "-ml [<triangles>]\n"
+            "            Build meshlets for cluster culling of large static models, with at\n"
+            "            most the given number of triangles each. Default 128\n"
         );
     }
 
@@ -457,6 +480,40 @@ void Run(const Vector<String>& arguments)
                 checkUniqueModel_ = false;
             else if (argument == "bp")
                 moveToBindPose_ = true;
+            else if (argument == "ac")
+            {
+                compressAnimations_ = true;
+                String value2 = i + 2 < arguments.Size() ? arguments[i + 2] : String::EMPTY;
+                String value3 = i + 3 < arguments.Size() ? arguments[i + 3] : String::EMPTY;
+                if (value.Length() && value2.Length() && value3.Length() && (value[0] != '-') && (value2[0] != '-') && (value3[0] != '-'))
+                {
+                    animationPositionTolerance_ = ToFloat(value);
+                    animationRotationTolerance_ = ToFloat(value2);
+                    animationScaleTolerance_ = ToFloat(value3);
+                }
+            }
+            else if (argument == "gl")
+            {
+                generatedLodLevels_ = 3;
+                String value2 = i + 2 < arguments.Size() ? arguments[i + 2] : String::EMPTY;
+                String value3 = i + 3 < arguments.Size() ? arguments[i + 3] : String::EMPTY;
+                if (value.Length() && value2.Length() && value3.Length() && (value[0] != '-') && (value2[0] != '-') && (value3[0] != '-'))
+                {
+                    generatedLodLevels_ = ToUInt(value);
+                    lodReduction_ = ToFloat(value2);
+                    lodDistanceStep_ = ToFloat(value3);
+                }
+            }
+            else if (argument == "mo")
+                optimizeMeshes_ = true;
+            else if (argument == "qt")
+                quantizeTexCoords_ = true;
+            else if (argument == "ml")
+            {
+                meshletTriangles_ = DEFAULT_MESHLET_TRIANGLES;
+                if (value.Length() && value[0] != '-')
+                    meshletTriangles_ = Max(ToUInt(value), 1u);
+            }
             else if (argument == "split")
             {
                 String value2 = i + 2 < arguments.Size() ? arguments[i + 2] : String::EMPTY;
@@ -1219,6 +1276,35 @@ void BuildAndSaveModel(OutModel& model)
             outModel->SetGeometryBoneMappings(allBoneMappings);
     }
 
+    if (generatedLodLevels_)
+    {
+        PrintLine("Generating " + String(generatedLodLevels_) + " LOD levels");
+        outModel->GenerateLodLevels(generatedLodLevels_, lodReduction_, lodDistanceStep_);
+    }
+
+    if (optimizeMeshes_)
+    {
+        VertexCacheStatistics before;
+        VertexCacheStatistics after;
+        if (outModel->OptimizeGeometries(&before, &after))
+        {
+            PrintLine("Optimized meshes: ACMR " + String(before.GetACMR()) + " -> " + String(after.GetACMR()) +
+                ", ATVR " + String(before.GetATVR()) + " -> " + String(after.GetATVR()));
+        }
+    }
+
+    if (quantizeTexCoords_ && outModel->QuantizeTexCoords())
+        PrintLine("Quantized texture coordinates to half floats");
+
+    // Meshlets are built last, as they depend on the final triangle order
+    if (meshletTriangles_ && outModel->BuildMeshlets(meshletTriangles_))
+    {
+        unsigned numMeshlets{ 0 };
+        for (unsigned i{ 0 }; i < outModel->GetNumGeometries(); ++i)
+            numMeshlets += outModel->GetGeometryMeshlets(i).Size();
+        PrintLine("Built " + String(numMeshlets) + " meshlets");
+    }
+
     File outFile(context_);
     if (!outFile.Open(model.outName_, FILE_WRITE))
         ErrorExit("Could not open output file " + model.outName_);
@@ -1480,6 +1566,14 @@ void BuildAndSaveAnimations(OutModel* model)
             }
         }
 
+        if (compressAnimations_)
+        {
+            const unsigned removed = outAnim->ReduceKeyFrames(animationPositionTolerance_, animationRotationTolerance_,
+                animationScaleTolerance_);
+            outAnim->SetCompressed(true);
+            PrintLine("Removed " + String(removed) + " redundant keyframes");
+        }
+
         File outFile(context_);
         if (!outFile.Open(animOutName, FILE_WRITE))
             ErrorExit("Could not open output file " + animOutName);
@@ -174,6 +174,49 @@ float GetIntensity(vec3 color)
     return dot(color, vec3(0.299, 0.587, 0.114));
 }
 
+#if defined(CLUSTERED) && defined(GL3)
+void GetClusteredLights(vec3 normal, vec3 worldPos, vec2 screenUV, float depth, float specularPower, out vec3 diffuse, out vec3 specular)
+{
+    diffuse = vec3(0.0);
+    specular = vec3(0.0);
+
+    // Find the cluster from the screen position and the logarithm of normalized depth
+    ivec2 tile = clamp(ivec2(screenUV * cClusterParams.xy), ivec2(0), ivec2(cClusterParams.xy) - 1);
+    int slice = int(clamp(log(max(depth, 1e-6)) * cClusterParams.z + cClusterParams.w, 0.0, cClusterParams.w - 1.0));
+    vec2 cluster = texelFetch(sClusterGridMap, ivec2(tile.y * int(cClusterParams.x) + tile.x, slice), 0).rg;
+    int offset = int(cluster.r);
+    int count = int(cluster.g);
+    int indexWidth = textureSize(sClusterIndexMap, 0).x;
+
+    for (int i = 0; i < count; ++i)
+    {
+        int index = offset + i;
+        int light = int(texelFetch(sClusterIndexMap, ivec2(index % indexWidth, index / indexWidth), 0).r);
+        vec4 lightPos = texelFetch(sClusterLightMap, ivec2(0, light), 0);
+        vec4 lightColor = texelFetch(sClusterLightMap, ivec2(1, light), 0);
+        vec4 lightDir = texelFetch(sClusterLightMap, ivec2(2, light), 0);
+        float invCutoff = texelFetch(sClusterLightMap, ivec2(3, light), 0).r;
+
+        vec3 lightVec = (lightPos.xyz - worldPos) * lightPos.w;
+        float lightDist = length(lightVec);
+        vec3 localDir = lightVec / lightDist;
+        #ifdef TRANSLUCENT
+            float NdotL = abs(dot(normal, localDir));
+        #else
+            float NdotL = max(dot(normal, localDir), 0.0);
+        #endif
+        float atten = clamp(1.0 - lightDist * lightDist, 0.0, 1.0);
+        float spotAtten = clamp((dot(localDir, lightDir.xyz) - lightDir.w) * invCutoff, 0.0, 1.0);
+        float intensity = atten * spotAtten;
+
+        diffuse += lightColor.rgb * NdotL * intensity;
+        #ifdef SPECULAR
+            specular += lightColor.rgb * lightColor.a * intensity * GetSpecular(normal, cCameraPosPS - worldPos, localDir, specularPower);
+        #endif
+    }
+}
+#endif
+
 #ifdef SHADOW
 
 #if defined(DIRLIGHT) && (!defined(GL_ES) || defined(WEBGL))
@@ -280,7 +323,8 @@ float GetPointShadow(vec3 lightVec)
     // Read the 2D UV coordinates, adjust according to shadow map size and add face offset
     vec4 indirectPos = textureCube(sIndirectionCubeMap, lightVec);
     indirectPos.xy *= cShadowCubeAdjust.xy;
-    indirectPos.xy += vec2(cShadowCubeAdjust.z + indirectPos.z * 0.5, cShadowCubeAdjust.w + indirectPos.w);
+    indirectPos.xy += vec2(cShadowCubeAdjust.z + indirectPos.z * 0.5 * cShadowCubeFaceScale.x,
+        cShadowCubeAdjust.w + indirectPos.w * cShadowCubeFaceScale.y);
 
     vec4 shadowPos = vec4(indirectPos.xy, cShadowDepthFade.x + cShadowDepthFade.y / depth, 1.0);
     return GetShadow(shadowPos);
@@ -228,6 +228,15 @@ void PS()
             finalColor += lightInput.rgb * diffColor.rgb + lightSpecColor * specColor;
         #endif
 
+        #if defined(CLUSTERED) && defined(GL3)
+            // Add the clustered point and spot lights
+            vec3 clusterDiffuse;
+            vec3 clusterSpecular;
+            GetClusteredLights(normal, vWorldPos.xyz, vScreenPos.xy / vScreenPos.w, vWorldPos.w, cMatSpecColor.a,
+                clusterDiffuse, clusterSpecular);
+            finalColor += clusterDiffuse * diffColor.rgb + clusterSpecular * specColor;
+        #endif
+
         #ifdef ENVCUBEMAP
             finalColor += cMatEnvMapColor * textureCube(sEnvCubeMap, reflect(vReflectionVec, normal)).rgb;
         #endif
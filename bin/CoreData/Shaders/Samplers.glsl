@@ -24,6 +24,11 @@ uniform samplerCube sLightCubeMap;
     uniform samplerCube sIndirectionCubeMap;
     uniform samplerCube sZoneCubeMap;
     uniform sampler3D sZoneVolumeMap;
+    #ifdef CLUSTERED
+        uniform sampler2D sClusterLightMap;
+        uniform sampler2D sClusterGridMap;
+        uniform sampler2D sClusterIndexMap;
+    #endif
 #else
     uniform highp sampler2D sShadowMap;
 #endif
@@ -20,10 +20,32 @@ attribute vec4 iCubeTexCoord1;
     attribute vec4 iTexCoord4;
     attribute vec4 iTexCoord5;
     attribute vec4 iTexCoord6;
+    #ifdef VERTEXANIM
+        attribute vec4 iTexCoord7;
+    #endif
 #endif
 attribute float iObjectIndex;
 
-#ifdef SKINNED
+#if defined(SKINNED) && defined(INSTANCED)
+// Skinned instances read their skinning matrices from the bone texture, which requires GL3
+uniform sampler2D sSkinMap;
+
+vec4 GetSkinTexel(int index)
+{
+    int width = textureSize(sSkinMap, 0).x;
+    return texelFetch(sSkinMap, ivec2(index % width, index / width), 0);
+}
+
+mat4 GetSkinMatrix(vec4 blendWeights, vec4 blendIndices)
+{
+    ivec4 idx = ivec4(blendIndices) * 3 + int(iTexCoord4.x);
+    const vec4 lastColumn = vec4(0.0, 0.0, 0.0, 1.0);
+    return mat4(GetSkinTexel(idx.x), GetSkinTexel(idx.x + 1), GetSkinTexel(idx.x + 2), lastColumn) * blendWeights.x +
+        mat4(GetSkinTexel(idx.y), GetSkinTexel(idx.y + 1), GetSkinTexel(idx.y + 2), lastColumn) * blendWeights.y +
+        mat4(GetSkinTexel(idx.z), GetSkinTexel(idx.z + 1), GetSkinTexel(idx.z + 2), lastColumn) * blendWeights.z +
+        mat4(GetSkinTexel(idx.w), GetSkinTexel(idx.w + 1), GetSkinTexel(idx.w + 2), lastColumn) * blendWeights.w;
+}
+#elif defined(SKINNED)
 mat4 GetSkinMatrix(vec4 blendWeights, vec4 blendIndices)
 {
     ivec4 idx = ivec4(blendIndices) * 3;
@@ -43,6 +65,59 @@ mat4 GetInstanceMatrix()
 }
 #endif
 
+#if defined(VERTEXANIM) && defined(GL3)
+// Baked animations store the skinning matrices of each frame as one row of the skin map: x = numFrames, y = frame rate,
+// z = animation length. The last frame blends back to the first over what remains of the length
+#if !defined(SKINNED) || !defined(INSTANCED)
+uniform sampler2D sSkinMap;
+#endif
+uniform vec4 cVertexAnimParams;
+
+mat4 GetBakedBoneMatrix(int bone, int frame)
+{
+    const vec4 lastColumn = vec4(0.0, 0.0, 0.0, 1.0);
+    return mat4(texelFetch(sSkinMap, ivec2(bone * 3, frame), 0), texelFetch(sSkinMap, ivec2(bone * 3 + 1, frame), 0),
+        texelFetch(sSkinMap, ivec2(bone * 3 + 2, frame), 0), lastColumn);
+}
+
+mat4 GetVertexAnimMatrix(vec4 blendWeights, vec4 blendIndices)
+{
+    // Instances carry their time offset and speed in the first extra instancing element
+    #ifdef INSTANCED
+        float time = cElapsedTime * iTexCoord7.y + iTexCoord7.x;
+    #else
+        float time = cElapsedTime;
+    #endif
+    float loopTime = mod(time, cVertexAnimParams.z);
+    int numFrames = int(cVertexAnimParams.x);
+    int frame0 = min(int(loopTime * cVertexAnimParams.y), numFrames - 1);
+    int frame1 = frame0 + 1 < numFrames ? frame0 + 1 : 0;
+    float frameTime = float(frame0) / cVertexAnimParams.y;
+    float interval = min(1.0 / cVertexAnimParams.y, cVertexAnimParams.z - frameTime);
+    float t = interval > 0.0 ? clamp((loopTime - frameTime) / interval, 0.0, 1.0) : 0.0;
+
+    ivec4 idx = ivec4(blendIndices);
+    return (GetBakedBoneMatrix(idx.x, frame0) * (1.0 - t) + GetBakedBoneMatrix(idx.x, frame1) * t) * blendWeights.x +
+        (GetBakedBoneMatrix(idx.y, frame0) * (1.0 - t) + GetBakedBoneMatrix(idx.y, frame1) * t) * blendWeights.y +
+        (GetBakedBoneMatrix(idx.z, frame0) * (1.0 - t) + GetBakedBoneMatrix(idx.z, frame1) * t) * blendWeights.z +
+        (GetBakedBoneMatrix(idx.w, frame0) * (1.0 - t) + GetBakedBoneMatrix(idx.w, frame1) * t) * blendWeights.w;
+}
+#endif
+
+#ifdef CDLOD
+// Streamed terrain vertices morph onto their parent level's vertex: xyz = model space offset, w = scale of the node's LOD range.
+// cTerrainMorph holds the model space view position and the finest LOD range
+attribute vec4 iTexCoord3;
+uniform vec4 cTerrainMorph;
+
+vec3 GetMorphedPos(mat4 modelMatrix)
+{
+    float range = iTexCoord3.w * cTerrainMorph.w;
+    float morph = clamp((distance(iPos.xyz, cTerrainMorph.xyz) / range - 0.8) * 5.0, 0.0, 1.0);
+    return (vec4(iPos.xyz + iTexCoord3.xyz * morph, 1.0) * modelMatrix).xyz;
+}
+#endif
+
 mat3 GetNormalMatrix(mat4 modelMatrix)
 {
     return mat3(modelMatrix[0].xyz, modelMatrix[1].xyz, modelMatrix[2].xyz);
@@ -144,7 +219,11 @@ vec3 GetTrailNormal(vec4 iPos, vec3 iParentPos, vec3 iForward)
 }
 #endif
 
-#if defined(SKINNED)
+#if defined(VERTEXANIM) && defined(GL3) && defined(INSTANCED)
+    #define iModelMatrix (GetVertexAnimMatrix(iBlendWeights, iBlendIndices) * GetInstanceMatrix())
+#elif defined(VERTEXANIM) && defined(GL3)
+    #define iModelMatrix (GetVertexAnimMatrix(iBlendWeights, iBlendIndices) * cModel)
+#elif defined(SKINNED)
     #define iModelMatrix GetSkinMatrix(iBlendWeights, iBlendIndices)
 #elif defined(INSTANCED)
     #define iModelMatrix GetInstanceMatrix()
@@ -162,6 +241,8 @@ vec3 GetWorldPos(mat4 modelMatrix)
         return GetTrailPos(iPos, iTangent.xyz, iTangent.w, modelMatrix);
     #elif defined(TRAILBONE)
         return GetTrailPos(iPos, iTangent.xyz, iTangent.w, modelMatrix);
+    #elif defined(CDLOD)
+        return GetMorphedPos(modelMatrix);
     #else
         return (iPos * modelMatrix).xyz;
     #endif
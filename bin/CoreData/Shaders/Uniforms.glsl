@@ -34,7 +34,7 @@ uniform mat4 cZone;
 #else
     uniform highp mat4 cLightMatrices[2];
 #endif
-#ifdef SKINNED
+#if defined(SKINNED) && !defined(INSTANCED)
     uniform vec4 cSkinMatrices[MAXBONES*3];
 #endif
 #ifdef NUMVERTEXLIGHTS
@@ -78,7 +78,11 @@ uniform vec3 cZoneMin;
 uniform vec3 cZoneMax;
 uniform float cNearClipPS;
 uniform float cFarClipPS;
+#ifdef CLUSTERED
+uniform vec4 cClusterParams;
+#endif
 uniform vec4 cShadowCubeAdjust;
+uniform vec2 cShadowCubeFaceScale;
 uniform vec4 cShadowDepthFade;
 uniform vec2 cShadowIntensity;
 uniform vec2 cShadowMapInvSize;
@@ -148,7 +152,7 @@ uniform ObjectVS
 #ifdef BILLBOARD
     mat3 cBillboardRot;
 #endif
-#ifdef SKINNED
+#if defined(SKINNED) && !defined(INSTANCED)
     uniform vec4 cSkinMatrices[MAXBONES*3];
 #endif
 };
@@ -171,6 +175,9 @@ uniform CameraPS
     vec2 cGBufferInvSize;
     float cNearClipPS;
     float cFarClipPS;
+#ifdef CLUSTERED
+    vec4 cClusterParams;
+#endif
 };
 
 uniform ZonePS
@@ -189,6 +196,7 @@ uniform LightPS
     vec3 cLightDirPS;
     vec4 cNormalOffsetScalePS;
     vec4 cShadowCubeAdjust;
+    vec2 cShadowCubeFaceScale;
     vec4 cShadowDepthFade;
     vec2 cShadowIntensity;
     vec2 cShadowMapInvSize;
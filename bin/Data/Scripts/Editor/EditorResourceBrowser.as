@@ -101,6 +101,7 @@ const StringHash BINARY_TYPE_MODEL("UMDL");
 const StringHash BINARY_TYPE_MODEL2("UMD2");
 const StringHash BINARY_TYPE_SHADER("USHD");
 const StringHash BINARY_TYPE_ANIMATION("UANI");
+const StringHash BINARY_TYPE_COMPRESSED_ANIMATION("UANC");
 
 const StringHash EXTENSION_TYPE_TTF(".ttf");
 const StringHash EXTENSION_TYPE_OTF(".otf");
@@ -1317,7 +1318,7 @@ bool GetBinaryType(String path, StringHash &out fileType, bool useCache = false)
         fileType = BINARY_TYPE_MODEL;
     else if (type == BINARY_TYPE_SHADER)
         fileType = BINARY_TYPE_SHADER;
-    else if (type == BINARY_TYPE_ANIMATION)
+    else if (type == BINARY_TYPE_ANIMATION || type == BINARY_TYPE_COMPRESSED_ANIMATION)
         fileType = BINARY_TYPE_ANIMATION;
     else
         return false;